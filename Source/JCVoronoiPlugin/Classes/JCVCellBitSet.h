@@ -0,0 +1,302 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Cell Bit Set
+//
+// Dense set of cell indices, one bit per map cell. Set operations work on
+// whole 64-bit words, iteration yields the contained cell indices in
+// ascending order. Bits past the cell count are always clear.
+
+struct FJCVCellBitSet
+{
+    class FIterator
+    {
+    public:
+
+        FORCEINLINE FIterator(const FJCVCellBitSet& InSet, int32 InWordIndex)
+            : Words(InSet.Words.GetData())
+            , WordCount(InSet.Words.Num())
+            , WordIndex(InWordIndex)
+            , Bits(InWordIndex < InSet.Words.Num() ? InSet.Words[InWordIndex] : 0)
+        {
+            SkipEmptyWords();
+        }
+
+        FORCEINLINE int32 operator*() const
+        {
+            return (WordIndex << 6) | FPlatformMath::CountTrailingZeros64(Bits);
+        }
+
+        FORCEINLINE FIterator& operator++()
+        {
+            // Clear lowest set bit
+            Bits &= Bits-1;
+            SkipEmptyWords();
+            return *this;
+        }
+
+        FORCEINLINE bool operator!=(const FIterator& Other) const
+        {
+            return WordIndex != Other.WordIndex || Bits != Other.Bits;
+        }
+
+    private:
+
+        const uint64* Words;
+        int32 WordCount;
+        int32 WordIndex;
+        uint64 Bits;
+
+        FORCEINLINE void SkipEmptyWords()
+        {
+            while (! Bits && WordIndex < WordCount)
+            {
+                ++WordIndex;
+                Bits = WordIndex < WordCount ? Words[WordIndex] : 0;
+            }
+        }
+    };
+
+    FORCEINLINE FJCVCellBitSet()
+        : CellCount(0)
+    {
+    }
+
+    FORCEINLINE explicit FJCVCellBitSet(int32 InCellCount)
+    {
+        Init(InCellCount);
+    }
+
+    // Resize to the specified cell count and clear all bits
+    FORCEINLINE void Init(int32 InCellCount)
+    {
+        CellCount = FMath::Max(0, InCellCount);
+        Words.Reset();
+        Words.SetNumZeroed(GetWordCount(CellCount));
+    }
+
+    FORCEINLINE void Empty()
+    {
+        CellCount = 0;
+        Words.Empty();
+    }
+
+    // Clear all bits, keeps the cell count
+    FORCEINLINE void Clear()
+    {
+        if (Words.Num() > 0)
+        {
+            FMemory::Memzero(Words.GetData(), Words.Num() * sizeof(uint64));
+        }
+    }
+
+    FORCEINLINE int32 GetCellCount() const
+    {
+        return CellCount;
+    }
+
+    FORCEINLINE int32 GetWordCount() const
+    {
+        return Words.Num();
+    }
+
+    FORCEINLINE static int32 GetWordCount(int32 InCellCount)
+    {
+        return (InCellCount + 63) >> 6;
+    }
+
+    FORCEINLINE uint64* GetWords()
+    {
+        return Words.GetData();
+    }
+
+    FORCEINLINE const uint64* GetWords() const
+    {
+        return Words.GetData();
+    }
+
+    FORCEINLINE bool IsValidIndex(int32 i) const
+    {
+        return i >= 0 && i < CellCount;
+    }
+
+    FORCEINLINE void Add(int32 i)
+    {
+        check(IsValidIndex(i));
+        Words[i >> 6] |= uint64(1) << (i & 63);
+    }
+
+    FORCEINLINE void Remove(int32 i)
+    {
+        check(IsValidIndex(i));
+        Words[i >> 6] &= ~(uint64(1) << (i & 63));
+    }
+
+    FORCEINLINE bool Contains(int32 i) const
+    {
+        return IsValidIndex(i) && ((Words[i >> 6] >> (i & 63)) & 1);
+    }
+
+    bool IsEmpty() const
+    {
+        for (uint64 Word : Words)
+        {
+            if (Word)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Number of contained cells
+    int32 Num() const
+    {
+        int32 Count = 0;
+
+        for (uint64 Word : Words)
+        {
+            Count += FPlatformMath::CountBits(Word);
+        }
+
+        return Count;
+    }
+
+    // Union, sets of different cell count are combined up to the smaller
+    // cell count
+    FJCVCellBitSet& operator|=(const FJCVCellBitSet& Other)
+    {
+        const int32 WordCount = FMath::Min(Words.Num(), Other.Words.Num());
+        uint64* Dst = Words.GetData();
+        const uint64* Src = Other.Words.GetData();
+
+        for (int32 i=0; i<WordCount; ++i)
+        {
+            Dst[i] |= Src[i];
+        }
+
+        // Other set may have more cells in the shared last word
+        ClearPaddingBits();
+
+        return *this;
+    }
+
+    // Intersection, words past the other set word count are cleared
+    FJCVCellBitSet& operator&=(const FJCVCellBitSet& Other)
+    {
+        const int32 WordCount = FMath::Min(Words.Num(), Other.Words.Num());
+        uint64* Dst = Words.GetData();
+        const uint64* Src = Other.Words.GetData();
+
+        for (int32 i=0; i<WordCount; ++i)
+        {
+            Dst[i] &= Src[i];
+        }
+
+        for (int32 i=WordCount; i<Words.Num(); ++i)
+        {
+            Dst[i] = 0;
+        }
+
+        return *this;
+    }
+
+    // Difference, removes all cells contained in the other set
+    FJCVCellBitSet& operator-=(const FJCVCellBitSet& Other)
+    {
+        const int32 WordCount = FMath::Min(Words.Num(), Other.Words.Num());
+        uint64* Dst = Words.GetData();
+        const uint64* Src = Other.Words.GetData();
+
+        for (int32 i=0; i<WordCount; ++i)
+        {
+            Dst[i] &= ~Src[i];
+        }
+
+        return *this;
+    }
+
+    FORCEINLINE FJCVCellBitSet operator|(const FJCVCellBitSet& Other) const
+    {
+        FJCVCellBitSet Set(*this);
+        return Set |= Other;
+    }
+
+    FORCEINLINE FJCVCellBitSet operator&(const FJCVCellBitSet& Other) const
+    {
+        FJCVCellBitSet Set(*this);
+        return Set &= Other;
+    }
+
+    FORCEINLINE FJCVCellBitSet operator-(const FJCVCellBitSet& Other) const
+    {
+        FJCVCellBitSet Set(*this);
+        return Set -= Other;
+    }
+
+    // Write contained cell indices in ascending order
+    void ToIndices(TArray<int32>& OutIndices) const
+    {
+        OutIndices.Reset(Num());
+
+        for (int32 i : *this)
+        {
+            OutIndices.Emplace(i);
+        }
+    }
+
+    FORCEINLINE FIterator begin() const
+    {
+        return FIterator(*this, 0);
+    }
+
+    FORCEINLINE FIterator end() const
+    {
+        return FIterator(*this, Words.Num());
+    }
+
+private:
+
+    TArray<uint64> Words;
+    int32 CellCount;
+
+    // Clear last word bits past the cell count
+    FORCEINLINE void ClearPaddingBits()
+    {
+        const int32 PaddingBits = (Words.Num() << 6) - CellCount;
+
+        if (PaddingBits > 0)
+        {
+            Words.Last() &= ~uint64(0) >> PaddingBits;
+        }
+    }
+};
@@ -0,0 +1,302 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "Containers/ArrayView.h"
+#include "Math/VectorRegister.h"
+#include "JCVDiagramTypes.h"
+
+// Cell Polygon Store
+//
+// Structure of arrays cell polygons for vectorized point containment. Each
+// cell vertex run is closed by its first vertex and padded with it so that
+// the edge count is a multiple of the vector width. Padding edges have zero
+// length and always pass the half-plane test. Cells without edges have a
+// single vertex run and contain no point.
+//
+// Dynamic site updates rewrite cell runs in place, or append them if the
+// cell gained vertices. Abandoned runs are reclaimed on rebuild.
+
+class FJCVCellPolygons
+{
+    TArray<float> X;
+    TArray<float> Y;
+
+    // Vertex run per site array position, [Offsets[i], Ends[i])
+    TArray<int32> Offsets;
+    TArray<int32> Ends;
+
+    // Vertex count, excludes the tail padding
+    int32 VertexCount = 0;
+
+    // Abandoned vertex count of patched cells
+    int32 DeadCount = 0;
+
+public:
+
+    enum { VectorWidth = 4 };
+
+    FORCEINLINE bool IsValid() const
+    {
+        return Offsets.Num() > 0;
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return Offsets.Num();
+    }
+
+    FORCEINLINE void Empty()
+    {
+        X.Empty();
+        Y.Empty();
+        Offsets.Empty();
+        Ends.Empty();
+        VertexCount = 0;
+        DeadCount = 0;
+    }
+
+    FORCEINLINE SIZE_T GetAllocatedSize() const
+    {
+        return X.GetAllocatedSize()
+            + Y.GetAllocatedSize()
+            + Offsets.GetAllocatedSize()
+            + Ends.GetAllocatedSize();
+    }
+
+    void Build(const FJCVSite* Sites, int32 SiteCount)
+    {
+        Empty();
+
+        if (! Sites || SiteCount <= 0)
+        {
+            return;
+        }
+
+        Offsets.SetNumUninitialized(SiteCount);
+        Ends.SetNumUninitialized(SiteCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            Offsets[i] = VertexCount;
+            VertexCount += GetRunLength(Sites[i]);
+            Ends[i] = VertexCount;
+        }
+
+        // Extra tail padding for unaligned vector loads of the end vertex
+        X.SetNumUninitialized(VertexCount + VectorWidth);
+        Y.SetNumUninitialized(VertexCount + VectorWidth);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            WriteRun(Sites[i], i);
+        }
+
+        WriteTailPadding();
+    }
+
+    /**
+     * Patch cell runs after a dynamic site update. Sites are ordered by
+     * site index, the site array position is the site index.
+     *
+     * Returns false if the polygons require a rebuild instead.
+     */
+    bool Patch(const FJCVSite* Sites, int32 SiteCount, TArrayView<const int32> DirtyIndices)
+    {
+        if (! IsValid() || ! Sites || SiteCount <= 0)
+        {
+            return false;
+        }
+
+        // Resize to the updated cell count, new cells are dirty
+
+        const int32 PrevCount = Offsets.Num();
+
+        for (int32 i=SiteCount; i<PrevCount; ++i)
+        {
+            DeadCount += Ends[i]-Offsets[i];
+        }
+
+        Offsets.SetNumZeroed(SiteCount);
+        Ends.SetNumZeroed(SiteCount);
+
+        // Rewrite dirty runs in place if their vertices fit, padding the
+        // whole run keeps its edge count a multiple of the vector width
+
+        bool bAppended = false;
+
+        for (int32 i : DirtyIndices)
+        {
+            if (i < 0 || i >= SiteCount)
+            {
+                continue;
+            }
+
+            const int32 RunLength = GetRunLength(Sites[i]);
+            const int32 Capacity = Ends[i]-Offsets[i];
+
+            if (RunLength > Capacity)
+            {
+                DeadCount += Capacity;
+                Offsets[i] = VertexCount;
+                Ends[i] = VertexCount+RunLength;
+                VertexCount += RunLength;
+                bAppended = true;
+
+                X.SetNumUninitialized(VertexCount + VectorWidth, false);
+                Y.SetNumUninitialized(VertexCount + VectorWidth, false);
+            }
+            // Cells without edges keep a single vertex run
+            else
+            if (RunLength == 1)
+            {
+                DeadCount += Capacity-1;
+                Ends[i] = Offsets[i]+1;
+            }
+
+            WriteRun(Sites[i], i);
+        }
+
+        if (bAppended)
+        {
+            WriteTailPadding();
+        }
+
+        // Rebuild once abandoned vertices outnumber the live vertices
+        return DeadCount <= VertexCount/2;
+    }
+
+    /**
+     * Move cell runs to new site array positions, NewPositions is indexed
+     * by the current site array position.
+     */
+    void Permute(TArrayView<const int32> NewPositions)
+    {
+        check(NewPositions.Num() == Offsets.Num());
+
+        TArray<int32> NewOffsets;
+        TArray<int32> NewEnds;
+        NewOffsets.SetNumUninitialized(Offsets.Num());
+        NewEnds.SetNumUninitialized(Ends.Num());
+
+        for (int32 i=0; i<NewPositions.Num(); ++i)
+        {
+            NewOffsets[NewPositions[i]] = Offsets[i];
+            NewEnds[NewPositions[i]] = Ends[i];
+        }
+
+        Offsets = MoveTemp(NewOffsets);
+        Ends = MoveTemp(NewEnds);
+    }
+
+    /**
+     * Whether the point is within or on the boundary of the cell polygon
+     * at the specified site array position. Cell vertices are in counter
+     * clockwise order.
+     */
+    FORCEINLINE bool IsWithin(int32 SitePosition, const FVector2D& Pos) const
+    {
+        const int32 VertexStart = Offsets[SitePosition];
+        const int32 EdgeEnd = Ends[SitePosition]-1;
+
+        const VectorRegister PX = VectorSetFloat1(Pos.X);
+        const VectorRegister PY = VectorSetFloat1(Pos.Y);
+        const VectorRegister Zero = VectorZero();
+
+        const float* XData = X.GetData();
+        const float* YData = Y.GetData();
+
+        for (int32 i=VertexStart; i<EdgeEnd; i+=VectorWidth)
+        {
+            const VectorRegister X0 = VectorLoad(XData+i);
+            const VectorRegister Y0 = VectorLoad(YData+i);
+            const VectorRegister X1 = VectorLoad(XData+i+1);
+            const VectorRegister Y1 = VectorLoad(YData+i+1);
+
+            // Edge cross product (V1-V0) x (P-V0), negative if outside
+            const VectorRegister Cross = VectorSubtract(
+                VectorMultiply(VectorSubtract(X1, X0), VectorSubtract(PY, Y0)),
+                VectorMultiply(VectorSubtract(Y1, Y0), VectorSubtract(PX, X0))
+                );
+
+            if (VectorMaskBits(VectorCompareGT(Zero, Cross)))
+            {
+                return false;
+            }
+        }
+
+        return EdgeEnd > VertexStart;
+    }
+
+private:
+
+    FORCEINLINE static int32 GetPaddedEdgeCount(int32 EdgeCount)
+    {
+        return FMath::DivideAndRoundUp(EdgeCount, (int32) VectorWidth) * VectorWidth;
+    }
+
+    FORCEINLINE static int32 GetRunLength(const FJCVSite& s)
+    {
+        int32 EdgeCount = 0;
+        for (const FJCVEdge* g = s.edges; g; g = g->next)
+        {
+            ++EdgeCount;
+        }
+        return GetPaddedEdgeCount(EdgeCount) + 1;
+    }
+
+    // Write cell vertices padded with the first vertex up to the run end
+    FORCEINLINE void WriteRun(const FJCVSite& s, int32 SitePosition)
+    {
+        const FJCVEdge* g = s.edges;
+        const FJCVPoint FirstVertex(g ? g->pos[0] : s.p);
+
+        int32 vi = Offsets[SitePosition];
+
+        for (; g; g = g->next, ++vi)
+        {
+            X[vi] = g->pos[0].x;
+            Y[vi] = g->pos[0].y;
+        }
+
+        for (; vi<Ends[SitePosition]; ++vi)
+        {
+            X[vi] = FirstVertex.x;
+            Y[vi] = FirstVertex.y;
+        }
+    }
+
+    FORCEINLINE void WriteTailPadding()
+    {
+        for (int32 vi=VertexCount; vi<X.Num(); ++vi)
+        {
+            X[vi] = 0.f;
+            Y[vi] = 0.f;
+        }
+    }
+};
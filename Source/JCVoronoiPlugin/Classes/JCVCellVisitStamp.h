@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Cell Visit Stamp
+//
+// Reusable visited marks for graph traversals. Each traversal bumps the
+// stamp epoch instead of clearing or hashing, a cell is visited when its
+// stamp equals the current epoch. Marks are keyed by any dense cell or site
+// offset below the count given to Begin(). Also holds a scratch index queue
+// that is reset on every Begin().
+
+class FJCVCellVisitStamp
+{
+    TArray<uint32> Stamps;
+    TArray<int32> Queue;
+    uint32 Epoch = 0;
+    bool bInUse = false;
+
+public:
+
+    FORCEINLINE bool IsInUse() const
+    {
+        return bInUse;
+    }
+
+    FORCEINLINE void Begin(int32 CellCount)
+    {
+        check(! bInUse);
+        bInUse = true;
+
+        if (Stamps.Num() < CellCount)
+        {
+            Stamps.AddZeroed(CellCount-Stamps.Num());
+        }
+
+        // Clear stamps on epoch wrap around
+
+        if (++Epoch == 0)
+        {
+            FMemory::Memzero(Stamps.GetData(), Stamps.Num()*sizeof(uint32));
+            Epoch = 1;
+        }
+
+        Queue.Reset();
+    }
+
+    FORCEINLINE void End()
+    {
+        bInUse = false;
+    }
+
+    FORCEINLINE bool IsVisited(int32 i) const
+    {
+        return Stamps[i] == Epoch;
+    }
+
+    FORCEINLINE void MarkVisited(int32 i)
+    {
+        Stamps[i] = Epoch;
+    }
+
+    // Mark cell visited, return false if it has already been visited
+    FORCEINLINE bool TryVisit(int32 i)
+    {
+        uint32& Stamp(Stamps[i]);
+
+        if (Stamp == Epoch)
+        {
+            return false;
+        }
+
+        Stamp = Epoch;
+        return true;
+    }
+
+    FORCEINLINE TArray<int32>& GetQueue()
+    {
+        return Queue;
+    }
+
+    FORCEINLINE void Empty()
+    {
+        check(! bInUse);
+        Stamps.Empty();
+        Queue.Empty();
+        Epoch = 0;
+    }
+
+    FORCEINLINE SIZE_T GetAllocatedSize() const
+    {
+        return Stamps.GetAllocatedSize() + Queue.GetAllocatedSize();
+    }
+
+    /**
+     * Free calling thread local stamp, allocated on first use.
+     * Used by visit scopes whose owner stamp is busy or not owned by
+     * the calling thread.
+     */
+    JCVORONOIPLUGIN_API static FJCVCellVisitStamp& AcquireThreadLocal();
+};
+
+// Scoped visit stamp access. Uses the owner stamp on the game thread if it
+// is free, otherwise a thread local stamp. Nested and parallel traversals
+// each get their own stamp.
+
+class FJCVCellVisitScope
+{
+    FJCVCellVisitStamp* Stamp;
+
+public:
+
+    FORCEINLINE FJCVCellVisitScope(FJCVCellVisitStamp& OwnerStamp, int32 CellCount)
+        : Stamp((! OwnerStamp.IsInUse() && IsInGameThread())
+            ? &OwnerStamp
+            : &FJCVCellVisitStamp::AcquireThreadLocal())
+    {
+        Stamp->Begin(CellCount);
+    }
+
+    FORCEINLINE ~FJCVCellVisitScope()
+    {
+        Stamp->End();
+    }
+
+    FJCVCellVisitScope(const FJCVCellVisitScope&) = delete;
+    FJCVCellVisitScope& operator=(const FJCVCellVisitScope&) = delete;
+
+    FORCEINLINE FJCVCellVisitStamp& operator*() const
+    {
+        return *Stamp;
+    }
+
+    FORCEINLINE FJCVCellVisitStamp* operator->() const
+    {
+        return Stamp;
+    }
+};
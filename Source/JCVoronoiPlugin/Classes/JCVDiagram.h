@@ -29,7 +29,15 @@
 
 #include "SharedPointer.h"
 #include "UnrealMemory.h"
+#include "Containers/ArrayView.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeBool.h"
+#include "JCVoronoiPlugin.h"
 #include "JCVDiagramTypes.h"
+#include "JCVSiteKDTree.h"
+#include "JCVCellPolygons.h"
+#include "JCVDiagramAdjacency.h"
+#include "JCVCellVisitStamp.h"
 #include "Geom/GULGeometryUtilityLibrary.h"
 
 typedef jcv_diagram     FJCVDiagram;
@@ -42,10 +50,33 @@ class FJCVDiagramContext
     typedef TSharedPtr<FJCVDiagram> FPSDiagram;
     typedef TWeakPtr<FJCVDiagram>   FPWDiagram;
 
+    // Owns all diagram memory, declared before the diagram to outlive it
+    FJCVDiagramArena Arena;
+
     FPSDiagram Diagram;
     FBox2D DiagramBounds;
     const FJCVSite* Sites;
 
+    // Index ordered site storage used by dynamic site operations
+    FJCVSite* DynamicSites = nullptr;
+    int32 DynamicSiteCapacity = 0;
+
+    // Site search indices and cell adjacency, built on first use
+    mutable FJCVSiteGrid SiteGrid;
+    mutable FJCVSiteKDTree SiteTree;
+    mutable FJCVCellPolygons CellPolygons;
+    mutable FJCVDiagramAdjacency Adjacency;
+    mutable FCriticalSection SearchIndexLock;
+    mutable FThreadSafeBool bSiteGridBuilt;
+    mutable FThreadSafeBool bSiteTreeBuilt;
+    mutable FThreadSafeBool bCellPolygonsBuilt;
+    mutable FThreadSafeBool bAdjacencyBuilt;
+
+    // Traversal visit marks, see FJCVCellVisitScope
+    mutable FJCVCellVisitStamp VisitStamp;
+    bool bUseSiteGrid = true;
+    bool bUseCellPolygons = false;
+
     FJCVDiagramContext(const FJCVDiagramContext& Other) = default;
     FJCVDiagramContext& operator=(const FJCVDiagramContext& Other) = default;
 
@@ -70,11 +101,9 @@ public:
 
     void ResetDiagram()
     {
-        Diagram = FPSDiagram( new FJCVDiagram(), [=](FJCVDiagram* d){
-            if (d->internal)
-                jcv_diagram_free(d);
-        } );
-        FMemory::Memset(Diagram.Get(), 0, sizeof(jcv_diagram));
+        // Diagram memory is owned by the arena, jcv_diagram_free() is not required
+        Diagram = FPSDiagram( new FJCVDiagram() );
+        ResetArena();
     }
 
     FORCEINLINE void GenerateDiagram(const FVector2D& Size, const TArray<FVector2D>& InPoints)
@@ -83,7 +112,50 @@ public:
         GenerateDiagram(FBox2D(FVector2D(0.f, 0.f), Size), InPoints);
     }
 
-    void GenerateDiagram(const FBox2D& Bounds, const TArray<FVector2D>& InPoints)
+    FORCEINLINE void GenerateDiagram(const FBox2D& Bounds, const TArray<FVector2D>& InPoints)
+    {
+        GenerateDiagram(Bounds, TArrayView<const FVector2D>(InPoints));
+    }
+
+    /**
+     * Generate diagram from vector view. Vector memory is passed directly
+     * to jcv if vector and jcv point data layout are identical. Otherwise,
+     * points are converted into an intermediate point buffer.
+     */
+    FORCEINLINE void GenerateDiagram(const FBox2D& Bounds, TArrayView<const FVector2D> InPoints)
+    {
+        // Layout compatible, no intermediate point buffer
+        if (TIsSame<jcv_real, decltype(FVector2D::X)>::Value && sizeof(FVector2D) == sizeof(FJCVPoint))
+        {
+            GenerateDiagram(
+                Bounds,
+                TArrayView<const FJCVPoint>(
+                    reinterpret_cast<const FJCVPoint*>(InPoints.GetData()),
+                    InPoints.Num()
+                    )
+                );
+        }
+        // Otherwise, convert points
+        else
+        {
+            TArray<FJCVPoint> Points;
+            Points.SetNumUninitialized(InPoints.Num());
+
+            for (int32 i=0; i<InPoints.Num(); ++i)
+            {
+                Points[i].x = (jcv_real) InPoints[i].X;
+                Points[i].y = (jcv_real) InPoints[i].Y;
+            }
+
+            GenerateDiagram(Bounds, TArrayView<const FJCVPoint>(Points));
+        }
+    }
+
+    /**
+     * Generate diagram from jcv point view. Point memory is passed
+     * directly to jcv and is only required for the duration of the call.
+     */
+    void GenerateDiagram(const FBox2D& Bounds, TArrayView<const FJCVPoint> InPoints)
     {
         check(Bounds.Min.X <= Bounds.Max.X && Bounds.Min.Y <= Bounds.Max.Y);
         check(Diagram.IsValid());
@@ -101,43 +173,239 @@ public:
 
         const int32 PointCount = InPoints.Num();
 
-        FJCVPoint* Points = nullptr;
+        // Discard previous diagram and rewind the arena, reserved capacity is kept
+        ResetArena();
+
         {
-            void* p_points = FMemory::Malloc(sizeof(FJCVPoint) * PointCount);
-            Points = static_cast<FJCVPoint*>( p_points );
-            if (! Points)
-                return;
+            SCOPE_CYCLE_COUNTER(STAT_JCV_GenerateDiagram);
+
+            jcv_diagram_generate_useralloc(
+                PointCount,
+                InPoints.GetData(),
+                &JCVBounds,
+                &Arena,
+                jcv_alloc_fn,
+                jcv_free_fn,
+                Diagram.Get()
+                );
+        }
 
-            // Memcpy if point/vector data size are equals
-            if (sizeof(FJCVPoint) == InPoints.GetTypeSize())
-            {
-                FMemory::Memcpy(Points, InPoints.GetData(), PointCount*InPoints.GetTypeSize());
-            }
-            // Otherwise, standard array assign
-            else
+        INC_DWORD_STAT_BY(STAT_JCV_GeneratedSites, PointCount);
+        SET_MEMORY_STAT(STAT_JCV_ArenaPeakBytes, Arena.GetPeakBytes());
+
+        Sites = jcv_diagram_get_sites(Diagram.Get());
+    }
+
+    /**
+     * Generate diagram in parallel over a grid of tiles.
+     *
+     * Each tile diagram is generated from the points within the tile
+     * bounds expanded by the halo distance. Tile core sites are stitched
+     * into a single diagram with the same site indices and neighbours as
+     * the single pass generation. Falls back to single pass generation if
+     * the halo is too small to resolve any of the tile core cells.
+     *
+     * @param TileCount Number of tiles on each axis
+     * @param Halo      Tile overlap distance, estimated from the average
+     *                  point spacing if zero or less
+     */
+    JCVORONOIPLUGIN_API void GenerateDiagramTiled(const FBox2D& Bounds, TArrayView<const FVector2D> InPoints, FIntPoint TileCount, float Halo = 0.f);
+
+    /**
+     * Compare neighbour site indices of every site with another diagram.
+     */
+    JCVORONOIPLUGIN_API bool HasEqualNeighbours(const FJCVDiagramContext& Other) const;
+
+    /**
+     * Lloyd relaxation, move each site to its cell centroid and regenerate
+     * the diagram. Stops early once no site moves further than the
+     * convergence threshold.
+     *
+     * Site indices are kept if the diagram has no pruned input points.
+     * Returns the number of regenerated iterations.
+     */
+    JCVORONOIPLUGIN_API int32 RelaxDiagram(int32 Iterations, float ConvergenceThreshold = 0.f);
+
+    // -- DYNAMIC SITE OPERATIONS
+
+    /**
+     * Dynamic site operation result. Site indices refer to the updated
+     * diagram.
+     */
+    struct FSiteUpdate
+    {
+        // Sites with modified edges or neighbours
+        TArray<int32> DirtyIndices;
+
+        // Removed site index and the previous last site index moved into it
+        int32 RemovedIndex = INDEX_NONE;
+        int32 SwappedIndex = INDEX_NONE;
+
+        // Site storage changed, every site pointer is invalidated
+        bool bSitesReallocated = false;
+
+        // Local update failed and the whole diagram was regenerated
+        bool bRegenerated = false;
+    };
+
+    /**
+     * Insert a site and regenerate only the cells in conflict with it.
+     *
+     * The first dynamic operation reorders the site storage by site index
+     * (requires unique site indices without pruned input points). Site
+     * edge memory replaced by dynamic operations is kept in the arena
+     * until the next generation. The diagram edge list is not maintained.
+     * Built search indices and adjacency are patched for the dirty sites,
+     * they are only rebuilt if the whole diagram is regenerated or once
+     * patched storage has grown too stale.
+     *
+     * New site is assigned the last site index.
+     */
+    JCVORONOIPLUGIN_API bool InsertSite(const FVector2D& Position, FSiteUpdate& OutUpdate);
+
+    /**
+     * Remove a site and regenerate its neighbour cells. The last site
+     * is moved into the removed site index.
+     */
+    JCVORONOIPLUGIN_API bool RemoveSite(int32 SiteIndex, FSiteUpdate& OutUpdate);
+
+    /**
+     * Move a site and regenerate its previous neighbour cells and the
+     * cells in conflict with its new position.
+     */
+    JCVORONOIPLUGIN_API bool MoveSite(int32 SiteIndex, const FVector2D& Position, FSiteUpdate& OutUpdate);
+
+    // -- SEARCH INDEX
+
+    /**
+     * Enable or disable the closest site search grid. The grid is built
+     * on the first search after each diagram update.
+     */
+    FORCEINLINE void SetUseSiteGrid(bool bEnabled)
+    {
+        bUseSiteGrid = bEnabled;
+    }
+
+    FORCEINLINE bool IsUsingSiteGrid() const
+    {
+        return bUseSiteGrid;
+    }
+
+    /**
+     * Enable or disable vectorized point containment over precomputed
+     * cell polygons. Polygons are built on the first containment test
+     * after each diagram update.
+     */
+    FORCEINLINE void SetUseCellPolygons(bool bEnabled)
+    {
+        bUseCellPolygons = bEnabled;
+    }
+
+    FORCEINLINE bool IsUsingCellPolygons() const
+    {
+        return bUseCellPolygons;
+    }
+
+    FORCEINLINE const FJCVCellPolygons& GetCellPolygons() const
+    {
+        if (! bCellPolygonsBuilt)
+        {
+            BuildCellPolygons();
+        }
+        return CellPolygons;
+    }
+
+    /**
+     * Flat cell adjacency indexed by site index, built on first access
+     * after each diagram update. Requires unique site indices.
+     */
+    FORCEINLINE const FJCVDiagramAdjacency& GetAdjacency() const
+    {
+        if (! bAdjacencyBuilt)
+        {
+            BuildAdjacency();
+        }
+        return Adjacency;
+    }
+
+    /**
+     * Traversal visit stamp owned by this context. Access through
+     * FJCVCellVisitScope, which falls back to thread local stamps.
+     */
+    FORCEINLINE FJCVCellVisitStamp& GetVisitStamp() const
+    {
+        return VisitStamp;
+    }
+
+    /**
+     * Closest site search start, the grid bucket seed if available.
+     * Otherwise, the first site.
+     */
+    FORCEINLINE const FJCVSite* GetSearchSeed(const FVector2D& pos) const
+    {
+        if (bUseSiteGrid && ! IsEmpty())
+        {
+            const int32 Seed = GetSiteGrid().GetSeed(pos);
+
+            // Guard against seeds of sites removed by dynamic updates
+            if (Seed != INDEX_NONE && Seed < GetSiteNum())
             {
-                for (int32 i=0; i<PointCount; ++i)
-                {
-                    Points[i].x = InPoints[i].X;
-                    Points[i].y = InPoints[i].Y;
-                }
+                return &Site(Seed);
             }
         }
 
-        jcv_diagram_generate_useralloc(
-            PointCount,
-            Points,
-            &JCVBounds,
-            0,
-            jcv_alloc_fn,
-            jcv_free_fn,
-            Diagram.Get()
-            );
+        return GetSites();
+    }
 
-        Sites = jcv_diagram_get_sites(Diagram.Get());
-        FMemory::Free(Points);
+    /**
+     * Site tree for k-nearest and radius site queries,
+     * built on first access after each diagram update.
+     */
+    FORCEINLINE const FJCVSiteKDTree& GetSiteTree() const
+    {
+        if (! bSiteTreeBuilt)
+        {
+            BuildSiteTree();
+        }
+        return SiteTree;
     }
 
+    /**
+     * Find up to K nearest sites, output site indices and squared distances
+     * sorted by distance. Buffers must hold at least K elements.
+     *
+     * Return the number of output sites.
+     */
+    FORCEINLINE int32 FindKNearest(const FVector2D& Pos, int32 K, int32* OutSiteIndices, float* OutDistSqr) const
+    {
+        return GetSiteTree().FindKNearest(Pos, K, OutSiteIndices, OutDistSqr);
+    }
+
+    /**
+     * Find up to K nearest sites into reused caller buffers.
+     */
+    FORCEINLINE int32 FindKNearest(const FVector2D& Pos, int32 K, TArray<int32>& OutSiteIndices, TArray<float>& OutDistSqr) const
+    {
+        return GetSiteTree().FindKNearest(Pos, K, OutSiteIndices, OutDistSqr);
+    }
+
+    /**
+     * Find sites which origin is within radius into reused caller buffer.
+     */
+    FORCEINLINE int32 FindSitesInRadius(const FVector2D& Pos, float Radius, TArray<int32>& OutSiteIndices) const
+    {
+        return GetSiteTree().FindSitesInRadius(Pos, Radius, OutSiteIndices);
+    }
+
+    /**
+     * Find the cell index of each query point. Queries are walked in Morton
+     * order over parallel chunks, each walk is started from the previous
+     * hit. Results are written in input order, INDEX_NONE on empty diagram.
+     *
+     * Output view must have the same number of elements as the queries.
+     */
+    JCVORONOIPLUGIN_API void FindCellsBatch(TArrayView<const FVector2D> Points, TArrayView<int32> OutCellIndices) const;
+
     /**
      * Find a site that contain the specified point.
      *
@@ -258,8 +526,8 @@ public:
             return;
         }
 
-        TSet<const FJCVSite*> VisitedSiteSet;
-        VisitedSiteSet.Emplace(&s);
+        FJCVCellVisitScope Visited(VisitStamp, GetSiteNum());
+        Visited->MarkVisited(&s - Sites);
 
         const FJCVSite* NextSite = &s;
         while (NextSite)
@@ -274,13 +542,11 @@ public:
                 const FJCVSite* n = g->neighbor;
 
                 // Skip invalid or already visited neighbour
-                if (! n || VisitedSiteSet.Contains(n))
+                if (! n || ! Visited->TryVisit(n - Sites))
                 {
                     continue;
                 }
 
-                VisitedSiteSet.Emplace(n);
-
                 // End point is inside neighbour
                 if (IsWithin(*n, P1))
                 {
@@ -325,7 +591,7 @@ public:
 
         const FJCVPoint p( FJCVMathUtil::ToPt(pos) );
         const FJCVSite* s0 = nullptr;
-        const FJCVSite* s1 = GetSites();
+        const FJCVSite* s1 = GetSearchSeed(pos);
 
         while (s1)
         {
@@ -379,73 +645,59 @@ public:
             return;
         }
 
-        TSet<const FJCVSite*> SiteSet;
-        TQueue<const FJCVSite*> SiteQueue;
+        FJCVCellVisitScope Visited(VisitStamp, GetSiteNum());
+        FJCVSiteQueue SiteQueue(Sites, *Visited);
 
         // Find rect border cells
 
         if (bStartOnMin)
         {
             const FJCVSite* Search = &s;
-            Search = FindAllTo(FVector2D(r.Max.X, r.Min.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Max.X, r.Max.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Min.X, r.Max.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Min.X, r.Min.Y), *Search, SiteSet);
+            Search = FindAllTo(FVector2D(r.Max.X, r.Min.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Max.X, r.Max.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Min.X, r.Max.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Min.X, r.Min.Y), *Search, SiteQueue);
         }
         else if (bStartOnMax)
         {
             const FJCVSite* Search = &s;
-            Search = FindAllTo(FVector2D(r.Min.X, r.Max.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Min.X, r.Min.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Max.X, r.Min.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Max.X, r.Max.Y), *Search, SiteSet);
+            Search = FindAllTo(FVector2D(r.Min.X, r.Max.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Min.X, r.Min.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Max.X, r.Min.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Max.X, r.Max.Y), *Search, SiteQueue);
         }
         else
         {
             const FJCVSite* Search = FindClosest(r.Min);
-            Search = FindAllTo(FVector2D(r.Max.X, r.Min.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Max.X, r.Max.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Min.X, r.Max.Y), *Search, SiteSet);
-            Search = FindAllTo(FVector2D(r.Min.X, r.Min.Y), *Search, SiteSet);
+            Search = FindAllTo(FVector2D(r.Max.X, r.Min.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Max.X, r.Max.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Min.X, r.Max.Y), *Search, SiteQueue);
+            Search = FindAllTo(FVector2D(r.Min.X, r.Min.Y), *Search, SiteQueue);
         }
 
-        // Enqueue site expand search
-
-        for (const FJCVSite* Site : SiteSet)
-        {
-            SiteQueue.Enqueue(Site);
-        }
+        // Boundary expand search, queued sites are the found sites
 
-        TSet<const FJCVSite*> VisitedSiteSet(SiteSet);
+        TArray<int32>& SiteQueueIndices(Visited->GetQueue());
 
-        // Boundary expand search
-
-        while (! SiteQueue.IsEmpty())
+        for (int32 QueueIndex=0; QueueIndex<SiteQueueIndices.Num(); ++QueueIndex)
         {
-            const FJCVSite* Site;
-            SiteQueue.Dequeue(Site);
-
-            check(Site);
+            const FJCVSite* Site = Sites + SiteQueueIndices[QueueIndex];
 
             if (const FJCVEdge* g = Site->edges)
             do
             {
                 const FJCVSite* n = g->neighbor;
 
-                // Skip invalid site or registered site
-                if (! n || VisitedSiteSet.Contains(n))
+                // Skip invalid site or registered site, mark visited
+                if (! n || ! Visited->TryVisit(n - Sites))
                 {
                     continue;
                 }
 
-                // Mark visited
-                VisitedSiteSet.Emplace(n);
-
                 // Check if site center is within rect
                 if (r.IsInside(FJCVMathUtil::ToVector2D(n->p)))
                 {
-                    SiteSet.Emplace(n);
-                    SiteQueue.Enqueue(n);
+                    SiteQueueIndices.Emplace(n - Sites);
                 }
                 // Check if site edge points is within rect
                 else
@@ -455,8 +707,7 @@ public:
                     {
                         if (r.IsInside(FJCVMathUtil::ToVector2D(ng->pos[0])))
                         {
-                            SiteSet.Emplace(n);
-                            SiteQueue.Enqueue(n);
+                            SiteQueueIndices.Emplace(n - Sites);
                             break;
                         }
                     }
@@ -466,16 +717,21 @@ public:
             while ((g=g->next) != nullptr);
         }
 
-        OutSites.Reserve(SiteSet.Num());
+        OutSites.Reserve(OutSites.Num()+SiteQueueIndices.Num());
 
-        for (const FJCVSite* Site : SiteSet)
+        for (int32 SiteIndex : SiteQueueIndices)
         {
-            OutSites.Emplace(Site);
+            OutSites.Emplace(Sites + SiteIndex);
         }
     }
 
     FORCEINLINE bool IsWithin(const FJCVSite& s, const FVector2D& pos) const
     {
+        if (bUseCellPolygons)
+        {
+            return GetCellPolygons().IsWithin(&s - Sites, pos);
+        }
+
         const FJCVEdge* g = s.edges;
         const FJCVPoint& sp( s.p );
         if (g)
@@ -692,17 +948,95 @@ public:
         return DiagramBounds;
     }
 
+    FORCEINLINE const FJCVDiagramArena& GetArena() const
+    {
+        return Arena;
+    }
+
 private:
 
+    // Discard diagram and rewind the arena, invalidates all diagram memory
+    FORCEINLINE void ResetArena()
+    {
+        FMemory::Memset(Diagram.Get(), 0, sizeof(jcv_diagram));
+        Arena.Reset();
+        DynamicSites = nullptr;
+        DynamicSiteCapacity = 0;
+        InvalidateSearchIndex();
+    }
+
+    FORCEINLINE void InvalidateSearchIndex()
+    {
+        FScopeLock ScopeLock(&SearchIndexLock);
+        SiteGrid.Empty();
+        SiteTree.Empty();
+        CellPolygons.Empty();
+        Adjacency.Empty();
+        bSiteGridBuilt = false;
+        bSiteTreeBuilt = false;
+        bCellPolygonsBuilt = false;
+        bAdjacencyBuilt = false;
+    }
+
+    FORCEINLINE const FJCVSiteGrid& GetSiteGrid() const
+    {
+        if (! bSiteGridBuilt)
+        {
+            BuildSiteGrid();
+        }
+        return SiteGrid;
+    }
+
+    // Visit filtered site queue, collects FindAllTo() output into the
+    // visit stamp queue as site offsets
+    struct FJCVSiteQueue
+    {
+        const FJCVSite* Sites;
+        FJCVCellVisitStamp& Stamp;
+
+        FORCEINLINE FJCVSiteQueue(const FJCVSite* InSites, FJCVCellVisitStamp& InStamp)
+            : Sites(InSites)
+            , Stamp(InStamp)
+        {
+        }
+
+        FORCEINLINE void Emplace(const FJCVSite* s)
+        {
+            const int32 i = s - Sites;
+
+            if (Stamp.TryVisit(i))
+            {
+                Stamp.GetQueue().Emplace(i);
+            }
+        }
+    };
+
+    void BuildSiteGrid() const;
+    void BuildSiteTree() const;
+    void BuildCellPolygons() const;
+    void BuildAdjacency() const;
+
+    // Dynamic site operation utility, see InsertSite()
+    bool EnsureDynamicSites(int32 MinCapacity, FSiteUpdate& OutUpdate);
+    void CollectConflictSites(const FVector2D& Position, const TSet<int32>& TraversableSites, TArray<int32>& OutSites) const;
+    bool RegenerateCells(const TArray<int32>& UpdateSites, int32 ExcludedSite, const FBox2D& CellBounds, TArray<int32>& OutPrunedSites);
+    void RegenerateAll(TArray<FVector2D>& Points, FSiteUpdate& OutUpdate);
+
+    // Patch built search indices and adjacency after a local site update,
+    // indices that cannot be patched are rebuilt on next use. Placed site
+    // is the inserted or moved site, INDEX_NONE on site removal.
+    void PatchSearchIndex(const FSiteUpdate& Update, int32 PlacedSite);
+
     FORCEINLINE static void* jcv_alloc_fn(void* memctx, size_t size)
     {
-        (void) memctx;
-        return FMemory::Malloc(size);
+        check(memctx);
+        return static_cast<FJCVDiagramArena*>(memctx)->Allocate(size);
     }
 
     FORCEINLINE static void jcv_free_fn(void* memctx, void* p)
     {
+        // Arena memory is released on arena reset
         (void) memctx;
-        FMemory::Free(p);
+        (void) p;
     }
 };
@@ -42,7 +42,9 @@
 #endif
 
 class FJCVDiagramMap;
+class FJCVPathHierarchy;
 struct FJCVCellEdgeList;
+struct FJCVCellBitSet;
 
 UCLASS(BlueprintType)
 class JCVORONOIPLUGIN_API UJCVDiagramAccessor : public UObject
@@ -55,6 +57,16 @@ class JCVORONOIPLUGIN_API UJCVDiagramAccessor : public UObject
     int32 ContextId;
     int32 MapId;
 
+    // Site query buffers, reused between queries
+    TArray<int32> QuerySiteIndices;
+    TArray<float> QueryDistSqr;
+
+    // Path query buffer and hierarchy of the accessed map
+    TArray<int32> QueryPath;
+    TSharedPtr<FJCVPathHierarchy> PathHierarchy;
+
+    void GetPathCellRefs(TArray<FJCVCellRef>& PathCellRefs);
+
     void SetMap(FJCVDiagramMap& AccessedMap, int32 InContextId, int32 InMapId);
 
 public:
@@ -160,6 +172,27 @@ public:
     UFUNCTION(BlueprintCallable, Category="JCV")
     void GetCellsWithinRect(TArray<FJCVCellRef>& CellRefs, const FBox2D& Rect);
 
+    /**
+     * Find cell index of each point, output in input point order.
+     * Output array allocation is reused.
+     */
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void FindCellsBatch(const TArray<FVector2D>& Points, TArray<int32>& OutCellIndices);
+
+    /**
+     * Find up to K cells which origin is nearest to the specified point,
+     * sorted by distance. Output array allocation is reused.
+     */
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void FindKNearestCells(TArray<FJCVCellRef>& CellRefs, const FVector2D& Pos, int32 K);
+
+    /**
+     * Find all cells which origin is within radius of the specified point.
+     * Output array allocation is reused.
+     */
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void FindCellsInRadius(TArray<FJCVCellRef>& CellRefs, const FVector2D& Pos, float Radius);
+
     UFUNCTION(BlueprintCallable, Category="JCV")
     void GetCellWithinOriginRadius(
         TArray<FJCVCellRef>& CellRefs,
@@ -186,6 +219,26 @@ public:
     UFUNCTION(BlueprintCallable, Category="JCV")
     FJCVCellRefGroup MergeCellGroups(const TArray<FJCVCellRefGroup>& CellGroups);
 
+    // Feature Set Query
+    //
+    // Boolean operations over the cells of feature sets, each set is the
+    // union of the cells of its feature ids. Cell indices are ascending.
+
+    // Dense cell set of the union of the specified features
+    void GetFeatureCellSet(FJCVCellBitSet& CellSet, const TArray<FJCVFeatureId>& FeatureIds) const;
+
+    // Cells in A or B
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void GetFeatureUnionCells(TArray<int32>& CellIndices, const TArray<FJCVFeatureId>& FeatureIdsA, const TArray<FJCVFeatureId>& FeatureIdsB) const;
+
+    // Cells in both A and B
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void GetFeatureIntersectionCells(TArray<int32>& CellIndices, const TArray<FJCVFeatureId>& FeatureIdsA, const TArray<FJCVFeatureId>& FeatureIdsB) const;
+
+    // Cells in A but not in B
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void GetFeatureDifferenceCells(TArray<int32>& CellIndices, const TArray<FJCVFeatureId>& FeatureIdsA, const TArray<FJCVFeatureId>& FeatureIdsB) const;
+
     // Query Information
 
     UFUNCTION(BlueprintCallable, Category="JCV")
@@ -249,6 +302,35 @@ public:
         bool bAllowBorders = false
         );
 
+    // Path Search
+
+    // A* path from the start to the goal cell. Cell feature types are
+    // entered with their TypeCostMultipliers step cost multiplier, 1 if
+    // unspecified, types with negative multipliers are not entered.
+    UFUNCTION(BlueprintCallable, Category="JCV", meta=(AutoCreateRefTerm="TypeCostMultipliers"))
+    bool FindPath(
+        const FJCVCellRef& StartCellRef,
+        const FJCVCellRef& GoalCellRef,
+        TArray<FJCVCellRef>& PathCellRefs,
+        float& PathCost,
+        const TArray<float>& TypeCostMultipliers
+        );
+
+    // Precompute the hierarchical path graph of the current map features,
+    // feature groups are clusters. Rebuild after feature changes.
+    UFUNCTION(BlueprintCallable, Category="JCV", meta=(AutoCreateRefTerm="TypeCostMultipliers"))
+    void BuildPathHierarchy(const TArray<float>& TypeCostMultipliers);
+
+    // Approximate path from the start to the goal cell over the path
+    // hierarchy, see BuildPathHierarchy()
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    bool FindHierarchicalPath(
+        const FJCVCellRef& StartCellRef,
+        const FJCVCellRef& GoalCellRef,
+        TArray<FJCVCellRef>& PathCellRefs,
+        float& PathCost
+        );
+
 // CELL VALUE FUNCTIONS
 
     UFUNCTION(BlueprintCallable, Category="JCV")
@@ -266,6 +348,15 @@ public:
     UFUNCTION(BlueprintCallable, Category="JCV")
     void MapNormalizedDistanceFromCell(FJCVCellRef OriginCellRef, FJCVFeatureId FeatureId, bool bAgainstAnyType = false);
 
+    // Drainage of cell values, see FJCVDiagramMap::GenerateFlowField()
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void GenerateFlowField(TArray<float>& FilledValues, TArray<int32>& Receivers, TArray<float>& FlowAccumulation);
+
+    // Mark filled depressions as lakes and high flow cells as rivers,
+    // see FJCVDiagramMap::MarkLakesAndRivers()
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void MarkLakesAndRivers(uint8 LakeFeatureType, uint8 RiverFeatureType, float MinLakeDepth, float MinRiverFlow, bool bGroupFeatures = true);
+
 // CELL UTILITY FUNCTIONS
 
     //UFUNCTION(BlueprintCallable, Category="JCV")
@@ -354,9 +445,15 @@ public:
     UFUNCTION(BlueprintCallable, Category="JCV")
     void GroupByFeatures();
 
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void UpdateFeatureGroups();
+
     UFUNCTION(BlueprintCallable, Category="JCV")
     void ShrinkFeatures();
 
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    int32 LabelConnectedComponents(uint8 FeatureType, TArray<int32>& ComponentSizes);
+
 // MAP UTILITY FUNCTIONS
 
     UFUNCTION(BlueprintCallable, Category="JCV")
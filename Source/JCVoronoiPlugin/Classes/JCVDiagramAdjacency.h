@@ -0,0 +1,293 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "Containers/ArrayView.h"
+#include "Containers/BitArray.h"
+#include "JCVDiagramTypes.h"
+
+// Cell Adjacency
+//
+// Compressed sparse row neighbour lists indexed by site index. Neighbour
+// entries of a cell are contiguous, each entry holds the neighbour site
+// index and its source graph edge. Border cells are flagged separately,
+// border graph edges have no entry.
+//
+// Dynamic site updates patch cell entries in place, or append them if the
+// cell gained neighbours. Abandoned entries are reclaimed on rebuild.
+
+class FJCVDiagramAdjacency
+{
+    // Entry range per cell, [Offsets[i], Ends[i])
+    TArray<int32> Offsets;
+    TArray<int32> Ends;
+    TArray<int32> Neighbours;
+    TArray<FJCVEdge*> Edges;
+    TBitArray<> BorderFlags;
+
+    // Abandoned entry count of patched cells
+    int32 DeadCount = 0;
+
+public:
+
+    FORCEINLINE bool IsValid() const
+    {
+        return Offsets.Num() > 0;
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return Offsets.Num();
+    }
+
+    FORCEINLINE void Empty()
+    {
+        Offsets.Empty();
+        Ends.Empty();
+        Neighbours.Empty();
+        Edges.Empty();
+        BorderFlags.Empty();
+        DeadCount = 0;
+    }
+
+    FORCEINLINE SIZE_T GetAllocatedSize() const
+    {
+        return Offsets.GetAllocatedSize()
+            + Ends.GetAllocatedSize()
+            + Neighbours.GetAllocatedSize()
+            + Edges.GetAllocatedSize()
+            + BorderFlags.GetAllocatedSize();
+    }
+
+    void Build(const FJCVSite* Sites, int32 SiteCount)
+    {
+        Empty();
+
+        if (! Sites || SiteCount <= 0)
+        {
+            return;
+        }
+
+        // Count neighbour entries per site index
+
+        Offsets.SetNumZeroed(SiteCount);
+        Ends.SetNumUninitialized(SiteCount);
+        BorderFlags.Init(false, SiteCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            const FJCVSite& s(Sites[i]);
+            check(s.index >= 0 && s.index < SiteCount);
+
+            Offsets[s.index] = GetNeighbourEdgeCount(s);
+        }
+
+        int32 EntryCount = 0;
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            const int32 Count = Offsets[i];
+            Offsets[i] = EntryCount;
+            EntryCount += Count;
+        }
+
+        // Write neighbour entries in graph edge order
+
+        Neighbours.SetNumUninitialized(EntryCount);
+        Edges.SetNumUninitialized(EntryCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            WriteEntries(Sites[i], Offsets[Sites[i].index]);
+        }
+    }
+
+    /**
+     * Patch cell entries after a dynamic site update. Sites are ordered by
+     * site index. Dirty cells are rewritten, references to the swapped site
+     * index are remapped to the removed site index.
+     *
+     * Returns false if the adjacency requires a rebuild instead.
+     */
+    bool Patch(const FJCVSite* Sites, int32 SiteCount, TArrayView<const int32> DirtyIndices, int32 RemovedIndex, int32 SwappedIndex)
+    {
+        if (! IsValid() || ! Sites || SiteCount <= 0)
+        {
+            return false;
+        }
+
+        // Swapped site neighbours refer to its previous site index
+
+        if (RemovedIndex != INDEX_NONE && SwappedIndex != INDEX_NONE)
+        {
+            for (const FJCVEdge* g = Sites[RemovedIndex].edges; g; g = g->next)
+            {
+                if (! g->neighbor || g->neighbor->index >= Offsets.Num())
+                {
+                    continue;
+                }
+
+                const int32 ni = g->neighbor->index;
+
+                for (int32 Entry=Offsets[ni]; Entry<Ends[ni]; ++Entry)
+                {
+                    if (Neighbours[Entry] == SwappedIndex)
+                    {
+                        Neighbours[Entry] = RemovedIndex;
+                    }
+                }
+            }
+        }
+
+        // Resize to the updated cell count, new cells are dirty
+
+        const int32 PrevCount = Offsets.Num();
+
+        for (int32 i=SiteCount; i<PrevCount; ++i)
+        {
+            DeadCount += Ends[i]-Offsets[i];
+        }
+
+        Offsets.SetNumZeroed(SiteCount);
+        Ends.SetNumZeroed(SiteCount);
+
+        if (BorderFlags.Num() < SiteCount)
+        {
+            BorderFlags.Add(false, SiteCount-BorderFlags.Num());
+        }
+        else
+        {
+            BorderFlags.RemoveAt(SiteCount, BorderFlags.Num()-SiteCount);
+        }
+
+        // Rewrite dirty cells in place if their entries fit, append otherwise
+
+        for (int32 CellIndex : DirtyIndices)
+        {
+            if (CellIndex < 0 || CellIndex >= SiteCount)
+            {
+                continue;
+            }
+
+            const FJCVSite& s(Sites[CellIndex]);
+            const int32 Count = GetNeighbourEdgeCount(s);
+            const int32 Capacity = Ends[CellIndex]-Offsets[CellIndex];
+
+            if (Count > Capacity)
+            {
+                DeadCount += Capacity;
+                Offsets[CellIndex] = Neighbours.Num();
+                Neighbours.AddUninitialized(Count);
+                Edges.AddUninitialized(Count);
+            }
+            else
+            {
+                DeadCount += Capacity-Count;
+            }
+
+            BorderFlags[CellIndex] = false;
+            WriteEntries(s, Offsets[CellIndex]);
+        }
+
+        // Rebuild once abandoned entries outnumber the live entries
+        return DeadCount <= Neighbours.Num()/2;
+    }
+
+    FORCEINLINE TArrayView<const int32> GetNeighbours(int32 CellIndex) const
+    {
+        const int32 Offset = Offsets[CellIndex];
+        return TArrayView<const int32>(Neighbours.GetData()+Offset, Ends[CellIndex]-Offset);
+    }
+
+    FORCEINLINE int32 GetNeighbourNum(int32 CellIndex) const
+    {
+        return Ends[CellIndex]-Offsets[CellIndex];
+    }
+
+    FORCEINLINE bool IsBorder(int32 CellIndex) const
+    {
+        return BorderFlags[CellIndex];
+    }
+
+    // Entry range of a cell, [GetEntryBegin(), GetEntryEnd())
+
+    FORCEINLINE int32 GetEntryBegin(int32 CellIndex) const
+    {
+        return Offsets[CellIndex];
+    }
+
+    FORCEINLINE int32 GetEntryEnd(int32 CellIndex) const
+    {
+        return Ends[CellIndex];
+    }
+
+    FORCEINLINE int32 GetEntryNeighbour(int32 Entry) const
+    {
+        return Neighbours[Entry];
+    }
+
+    FORCEINLINE FJCVEdge* GetEntryEdge(int32 Entry) const
+    {
+        return Edges[Entry];
+    }
+
+private:
+
+    FORCEINLINE static int32 GetNeighbourEdgeCount(const FJCVSite& s)
+    {
+        int32 Count = 0;
+        for (const FJCVEdge* g = s.edges; g; g = g->next)
+        {
+            if (g->neighbor)
+            {
+                ++Count;
+            }
+        }
+        return Count;
+    }
+
+    // Write cell entries from the specified entry, sets the cell entry end
+    FORCEINLINE void WriteEntries(const FJCVSite& s, int32 Entry)
+    {
+        for (FJCVEdge* g = s.edges; g; g = g->next)
+        {
+            if (g->neighbor)
+            {
+                Neighbours[Entry] = g->neighbor->index;
+                Edges[Entry] = g;
+                ++Entry;
+            }
+            else
+            {
+                BorderFlags[s.index] = true;
+            }
+        }
+
+        Ends[s.index] = Entry;
+    }
+};
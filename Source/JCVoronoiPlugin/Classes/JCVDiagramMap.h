@@ -30,6 +30,8 @@
 #include "CoreMinimal.h"
 
 #include "JCVDiagram.h"
+#include "JCVCellBitSet.h"
+#include "JCVFeatureTypeMask.h"
 #include "JCVParameters.h"
 
 class FJCVDiagramMapContext;
@@ -63,29 +65,142 @@ enum EJCVCellFeature
     JCV_CF_UNMARKED = 0
 };
 
-struct FJCVCell
+// Cell feature change, journal entry of a cell feature type or index update
+
+struct FJCVFeatureChange
 {
-    const FJCVSite* Site = nullptr;
-    float Value          = 0.f;
-    bool bIsBorder       = false;
-    uint8 FeatureType    = JCV_CF_UNMARKED;
-    int32 FeatureIndex   = 0;
+    int32 CellIndex;
+    int32 OldIndex;
+    int32 NewIndex;
+    uint8 OldType;
+    uint8 NewType;
+};
 
-    FJCVCell(const FJCVSite& s, float h, bool b)
-        : Site(&s)
-        , Value(h)
-        , bIsBorder(b)
-        , FeatureType(JCV_CF_UNMARKED)
-        , FeatureIndex(0)
+// Cell attribute storage, structure of arrays indexed by cell index.
+// Bulk value operations run over the contiguous attribute arrays.
+
+struct FJCVCellStorage
+{
+    TArray<float> Values;
+    TArray<uint8> FeatureTypes;
+    TArray<int32> FeatureIndices;
+    TBitArray<> BorderFlags;
+
+    // Feature change journal, recorded while feature groups are maintained.
+    // Recording stops on overflow, feature groups then require a full regroup.
+    // Feature types must not be set concurrently while recording.
+    TArray<FJCVFeatureChange> FeatureChanges;
+    int32 MaxFeatureChanges = 0;
+    bool bRecordFeatureChanges = false;
+    bool bFeatureChangesOverflow = false;
+
+    FORCEINLINE int32 Num() const
+    {
+        return Values.Num();
+    }
+
+    FORCEINLINE void Init(int32 CellCount, uint8 FeatureType, int32 FeatureIndex)
+    {
+        Values.SetNumZeroed(CellCount);
+        FeatureTypes.Init(FeatureType, CellCount);
+        FeatureIndices.Init(FeatureIndex, CellCount);
+        BorderFlags.Init(false, CellCount);
+    }
+
+    FORCEINLINE void Add(float Value, bool bIsBorder, uint8 FeatureType, int32 FeatureIndex)
+    {
+        Values.Emplace(Value);
+        FeatureTypes.Emplace(FeatureType);
+        FeatureIndices.Emplace(FeatureIndex);
+        BorderFlags.Add(bIsBorder);
+    }
+
+    FORCEINLINE void Copy(int32 DstIndex, int32 SrcIndex)
+    {
+        Values[DstIndex] = Values[SrcIndex];
+        FeatureTypes[DstIndex] = FeatureTypes[SrcIndex];
+        FeatureIndices[DstIndex] = FeatureIndices[SrcIndex];
+        BorderFlags[DstIndex] = BorderFlags[SrcIndex];
+    }
+
+    FORCEINLINE void Pop()
+    {
+        Values.Pop(false);
+        FeatureTypes.Pop(false);
+        FeatureIndices.Pop(false);
+        BorderFlags.RemoveAt(BorderFlags.Num()-1);
+    }
+
+    FORCEINLINE void Empty()
+    {
+        Values.Empty();
+        FeatureTypes.Empty();
+        FeatureIndices.Empty();
+        BorderFlags.Empty();
+    }
+
+    FORCEINLINE bool IsType(int32 i, uint8 t, int32 fi = -1) const
+    {
+        return FeatureTypes[i] == t && (fi < 0 || FeatureIndices[i] == fi);
+    }
+
+    FORCEINLINE void SetType(int32 i, uint8 t, int32 fi)
+    {
+        if (bRecordFeatureChanges && (FeatureTypes[i] != t || FeatureIndices[i] != fi))
+        {
+            RecordFeatureChange(i, t, fi);
+        }
+
+        FeatureTypes[i] = t;
+        FeatureIndices[i] = fi;
+    }
+
+    // Feature change journal
+
+    FORCEINLINE bool HasFeatureChanges() const
+    {
+        return FeatureChanges.Num() > 0 || bFeatureChangesOverflow;
+    }
+
+    FORCEINLINE void StartFeatureJournal(int32 MaxChanges)
+    {
+        FeatureChanges.Reset();
+        MaxFeatureChanges = MaxChanges;
+        bRecordFeatureChanges = true;
+        bFeatureChangesOverflow = false;
+    }
+
+    FORCEINLINE void StopFeatureJournal()
     {
+        FeatureChanges.Empty();
+        MaxFeatureChanges = 0;
+        bRecordFeatureChanges = false;
+        bFeatureChangesOverflow = false;
     }
 
-    FJCVCell(const FJCVSite& s, float h, bool b, uint8 ft, uint8 fi)
+    void RecordFeatureChange(int32 i, uint8 t, int32 fi);
+
+    // Bulk value operations, feature index below zero match any non-negative
+    // feature index. Cells without feature index are never modified, as
+    // they are not members of any feature group.
+
+    void SetValues(float Value);
+    void InvertValues(uint8 FeatureType, int32 FeatureIndex = -1);
+    void ScaleValuesByFeatureIndex(uint8 FeatureType, float IndexOffset, float IndexScale);
+};
+
+// Cell proxy, cell attributes are kept in the owning map cell storage
+
+struct FJCVCell
+{
+    const FJCVSite* Site = nullptr;
+    FJCVCellStorage* Storage = nullptr;
+
+    FJCVCell() = default;
+
+    FJCVCell(const FJCVSite& s, FJCVCellStorage& InStorage)
         : Site(&s)
-        , Value(h)
-        , bIsBorder(b)
-        , FeatureType(ft)
-        , FeatureIndex(fi)
+        , Storage(&InStorage)
     {
     }
 
@@ -101,7 +216,17 @@ struct FJCVCell
 
     FORCEINLINE float GetValue() const
     {
-        return Value;
+        return Storage->Values[Site->index];
+    }
+
+    FORCEINLINE uint8 GetFeatureType() const
+    {
+        return Storage->FeatureTypes[Site->index];
+    }
+
+    FORCEINLINE int32 GetFeatureIndex() const
+    {
+        return Storage->FeatureIndices[Site->index];
     }
 
     FORCEINLINE FVector2D ToVector2D() const
@@ -154,36 +279,38 @@ struct FJCVCell
 
     FORCEINLINE bool IsBorder() const
     {
-        return bIsBorder;
+        return Storage->BorderFlags[Site->index];
     }
 
     FORCEINLINE bool IsType(uint8 t, int32 i = -1) const
     {
-        return FeatureType == t && (i < 0 || FeatureIndex == i);
+        return Storage->IsType(Site->index, t, i);
     }
 
+    FORCEINLINE void SetBorder(bool bIsBorder)
+    {
+        Storage->BorderFlags[Site->index] = bIsBorder;
+    }
 
     FORCEINLINE void SetType(uint8 t, int32 i = 0)
     {
-        FeatureType  = t;
-        FeatureIndex = i;
+        Storage->SetType(Site->index, t, i);
     }
 
     FORCEINLINE void SetType(const FJCVCell& rhs)
     {
-        SetType(rhs.FeatureType, rhs.FeatureIndex);
+        SetType(rhs.GetFeatureType(), rhs.GetFeatureIndex());
     }
 
     FORCEINLINE void SetValue(float v)
     {
-        Value = v;
+        Storage->Values[Site->index] = v;
     }
 
     FORCEINLINE void SetFeature(float v, uint8 t, int32 i)
     {
-        Value = v;
-        FeatureType  = t;
-        FeatureIndex = i;
+        SetValue(v);
+        SetType(t, i);
     }
 
     FORCEINLINE void SetFeature(float v, uint8 t)
@@ -299,11 +426,192 @@ struct FJCVCellEdgeList
     FEdgePair EdgePair;
 };
 
+// Feature cell group view, cell range of the map feature membership.
+// Cell pointers are resolved from cell indices on access.
+
+class FJCVCellGroupView
+{
+public:
+
+    class FIterator
+    {
+    public:
+
+        FORCEINLINE FIterator(FJCVCell* InCellData, const int32* InIndexPtr)
+            : CellData(InCellData)
+            , IndexPtr(InIndexPtr)
+        {
+        }
+
+        FORCEINLINE FJCVCell* operator*() const
+        {
+            return CellData + *IndexPtr;
+        }
+
+        FORCEINLINE FIterator& operator++()
+        {
+            ++IndexPtr;
+            return *this;
+        }
+
+        FORCEINLINE bool operator!=(const FIterator& Other) const
+        {
+            return IndexPtr != Other.IndexPtr;
+        }
+
+    private:
+
+        FJCVCell* CellData;
+        const int32* IndexPtr;
+    };
+
+    FJCVCellGroupView() = default;
+
+    FJCVCellGroupView(FJCVCell* InCellData, const int32* InCellIndices, int32 InCellCount)
+        : CellData(InCellData)
+        , CellIndices(InCellIndices)
+        , CellCount(InCellCount)
+    {
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return CellCount;
+    }
+
+    FORCEINLINE bool IsValidIndex(int32 i) const
+    {
+        return i >= 0 && i < CellCount;
+    }
+
+    FORCEINLINE FJCVCell* operator[](int32 i) const
+    {
+        checkSlow(IsValidIndex(i));
+        return CellData + CellIndices[i];
+    }
+
+    FORCEINLINE TArrayView<const int32> GetCellIndices() const
+    {
+        return TArrayView<const int32>(CellIndices, CellCount);
+    }
+
+    FORCEINLINE FIterator begin() const
+    {
+        return FIterator(CellData, CellIndices);
+    }
+
+    FORCEINLINE FIterator end() const
+    {
+        return FIterator(CellData, CellIndices+CellCount);
+    }
+
+    template<class FCellContainer>
+    FORCEINLINE void AppendTo(FCellContainer& OutCells) const
+    {
+        for (int32 i=0; i<CellCount; ++i)
+        {
+            OutCells.Emplace(CellData + CellIndices[i]);
+        }
+    }
+
+private:
+
+    FJCVCell* CellData = nullptr;
+    const int32* CellIndices = nullptr;
+    int32 CellCount = 0;
+};
+
+// Feature membership, cell indices sorted by (feature type, feature index).
+// Cell group of feature index fi in feature type t is group slot
+// g = TypeOffsets[t]+fi and spans GroupNums[g] cell indices from
+// GroupOffsets[g].
+//
+// Patch() moves changed cells between groups in place. Patched groups are
+// no longer sorted by cell index, groups that outgrow their capacity are
+// moved to the end of the cell index array. A full build restores order.
+
+struct FJCVFeatureMembership
+{
+    TArray<int32> CellIndices;
+    TArray<int32> GroupOffsets;
+    TArray<int32> TypeOffsets;
+
+    TArray<int32> GroupNums;
+    TArray<int32> GroupCapacities;
+    TArray<int32> CellSlots;
+    int32 DeadCount = 0;
+
+    // Counting sort of cell indices by feature type and feature index.
+    // Cells with feature index below zero count their feature type only.
+    void Build(const FJCVCellStorage& Storage);
+
+    // Parallel counting sort, per chunk histograms followed by a parallel
+    // scatter. Output is identical to Build(), small maps are built serially.
+    void BuildParallel(const FJCVCellStorage& Storage);
+
+    // Move changed cells from their old to their new cell group. Returns
+    // false without a complete patch if a new cell group is required or
+    // moved groups waste too much space, a full build is required then.
+    bool Patch(TArrayView<const FJCVFeatureChange> Changes);
+
+    FORCEINLINE int32 GetTypeCount() const
+    {
+        return FMath::Max(TypeOffsets.Num()-1, 0);
+    }
+
+    FORCEINLINE int32 GetGroupCount(int32 FeatureType) const
+    {
+        return (FeatureType >= 0 && FeatureType < GetTypeCount())
+            ? TypeOffsets[FeatureType+1]-TypeOffsets[FeatureType]
+            : 0;
+    }
+
+    FORCEINLINE FJCVCellGroupView GetCellGroup(FJCVCell* CellData, int32 FeatureType, int32 FeatureIndex) const
+    {
+        const int32 Slot = TypeOffsets[FeatureType]+FeatureIndex;
+        return FJCVCellGroupView(CellData, CellIndices.GetData()+GroupOffsets[Slot], GroupNums[Slot]);
+    }
+
+    FORCEINLINE void Empty()
+    {
+        CellIndices.Empty();
+        GroupOffsets.Empty();
+        TypeOffsets.Empty();
+        GroupNums.Empty();
+        GroupCapacities.Empty();
+        CellSlots.Empty();
+        DeadCount = 0;
+    }
+
+    FORCEINLINE SIZE_T GetAllocatedSize() const
+    {
+        return CellIndices.GetAllocatedSize()
+            + GroupOffsets.GetAllocatedSize()
+            + TypeOffsets.GetAllocatedSize()
+            + GroupNums.GetAllocatedSize()
+            + GroupCapacities.GetAllocatedSize()
+            + CellSlots.GetAllocatedSize();
+    }
+
+private:
+
+    // Fill group cell counts and capacities from the built group offsets
+    void InitGroupNums();
+};
+
+// Feature group, cell groups of a single feature type.
+//
+// Cell groups are read only views of the map feature membership, group
+// contents follow cell features. GetCellGroup() returns a const view and
+// CellGroups can no longer be filled directly. To move cells into a group,
+// set cell features with FJCVCell::SetType() or AddCell() and apply them
+// with FJCVDiagramMap::UpdateFeatureGroups().
+
 struct FJCVFeatureGroup
 {
     uint8 FeatureType;
-    TArray<FJCVCellGroup> CellGroups;
-    TSet<uint8> Neighbours;
+    TArray<FJCVCellGroupView> CellGroups;
+    FJCVFeatureTypeMask Neighbours;
 
     FORCEINLINE bool IsValidIndex(int32 FeatureIndex) const
     {
@@ -318,7 +626,7 @@ struct FJCVFeatureGroup
     FORCEINLINE int32 GetCellCount() const
     {
         int32 count = 0;
-        for (const FJCVCellGroup& cg : CellGroups)
+        for (const FJCVCellGroupView& cg : CellGroups)
             count += cg.Num();
         return count;
     }
@@ -347,7 +655,7 @@ struct FJCVFeatureGroup
     {
         if (HasCellGroups())
         {
-            for (const FJCVCellGroup& cg : CellGroups)
+            for (const FJCVCellGroupView& cg : CellGroups)
                 if (cg.Num() > 0)
                     return true;
         }
@@ -362,7 +670,7 @@ struct FJCVFeatureGroup
         return GetCellCount(FeatureIndex) > 0;
     }
 
-    FJCVCellGroup* GetCellGroup(int32 FeatureIndex)
+    const FJCVCellGroupView* GetCellGroup(int32 FeatureIndex) const
     {
         return IsValidIndex(FeatureIndex) ? &CellGroups[FeatureIndex] : nullptr;
     }
@@ -377,9 +685,9 @@ struct FJCVFeatureGroup
 
         OutCells.Reserve(GetCellCount());
 
-        for (const FJCVCellGroup& cg : CellGroups)
+        for (const FJCVCellGroupView& cg : CellGroups)
         {
-            OutCells.Append(cg);
+            cg.AppendTo(OutCells);
         }
     }
 
@@ -388,7 +696,7 @@ struct FJCVFeatureGroup
     {
         if (CellGroups.IsValidIndex(FeatureIndex))
         {
-            const FJCVCellGroup& cg(CellGroups[FeatureIndex]);
+            const FJCVCellGroupView& cg(CellGroups[FeatureIndex]);
 
             if (bClearOutput)
             {
@@ -396,7 +704,7 @@ struct FJCVFeatureGroup
             }
 
             OutCells.Reserve(cg.Num());
-            OutCells.Append(cg);
+            cg.AppendTo(OutCells);
         }
         else if (bClearOutput)
         {
@@ -409,30 +717,30 @@ struct FJCVFeatureGroup
         FeatureType = t;
     }
 
-    FORCEINLINE void AddCell(FJCVCell& c, int32 r = -1)
+    /**
+     * Set the cell feature type to this group feature type, keeping the
+     * cell feature index. Cells with negative feature index are ignored.
+     * The change is recorded in the map change journal, the cell is part
+     * of CellGroups after FJCVDiagramMap::UpdateFeatureGroups().
+     * ReserveCount is unused, group storage is owned by the map.
+     */
+    FORCEINLINE void AddCell(FJCVCell& c, int32 ReserveCount = -1)
     {
-        const int32 i = c.FeatureIndex;
+        const int32 i = c.GetFeatureIndex();
         if (i < 0)
             return;
-        if (! CellGroups.IsValidIndex(i))
-        {
-            CellGroups.SetNum(i+1);
-            if (r > 0)
-                CellGroups.Reserve(r);
-        }
-        CellGroups[i].Emplace(&c);
+        c.SetType(FeatureType, i);
     }
 
-    FORCEINLINE void AddNeighbour(const FJCVCell& c)
+    // Cell group views own no storage, nothing to shrink
+    FORCEINLINE void Shrink()
     {
-        if (! c.IsType(FeatureType) && ! Neighbours.Contains(c.FeatureType))
-            Neighbours.Emplace(c.FeatureType);
     }
 
-    FORCEINLINE void Shrink()
+    FORCEINLINE void AddNeighbour(const FJCVCell& c)
     {
-        for (FJCVCellGroup& g : CellGroups)
-            g.Shrink();
+        if (! c.IsType(FeatureType))
+            Neighbours.Add(c.GetFeatureType());
     }
 
     FORCEINLINE void Empty()
@@ -445,9 +753,9 @@ struct FJCVFeatureGroup
         FJCVCellSet OutSet;
         OutSet.Reserve(GetCellCount());
 
-        for (const FJCVCellGroup& cg : CellGroups)
+        for (const FJCVCellGroupView& cg : CellGroups)
         {
-            OutSet.Append(cg);
+            cg.AppendTo(OutSet);
         }
 
         return MoveTemp(OutSet);
@@ -462,7 +770,8 @@ struct FJCVFeatureGroup
 
         if (HasCells(FeatureIndex))
         {
-            FJCVCellSet OutSet(CellGroups[FeatureIndex]);
+            FJCVCellSet OutSet;
+            CellGroups[FeatureIndex].AppendTo(OutSet);
             return MoveTemp(OutSet);
         }
 
@@ -470,6 +779,52 @@ struct FJCVFeatureGroup
     }
 };
 
+// Cell group adjacency summary, feature types of cells adjacent to a cell
+// group, excluding the group cells, and whether the group touches the
+// diagram border. Cells of other groups of the same feature type add the
+// group feature type.
+
+struct FJCVCellGroupAdjacency
+{
+    FJCVFeatureTypeMask NeighbourTypes;
+    bool bBorder = false;
+
+    // Whether the group is enclosed only by cells of the specified type
+    FORCEINLINE bool IsEnclosedBy(uint8 FeatureType) const
+    {
+        FJCVFeatureTypeMask OtherTypes(NeighbourTypes);
+        OtherTypes.Remove(FeatureType);
+        return ! bBorder && OtherTypes.IsEmpty();
+    }
+};
+
+// Drainage of the cell value heightfield, arrays indexed by cell index
+
+struct FJCVFlowField
+{
+    // Cell values with depressions filled up to their spill height
+    TArray<float> FilledValues;
+
+    // Downhill receiver cell of each cell, INDEX_NONE for outlet cells and
+    // cells not connected to a border cell
+    TArray<int32> Receivers;
+
+    // Number of cells draining through each cell, including itself
+    TArray<float> FlowAccumulation;
+
+    FORCEINLINE int32 Num() const
+    {
+        return FilledValues.Num();
+    }
+
+    FORCEINLINE void Empty()
+    {
+        FilledValues.Empty();
+        Receivers.Empty();
+        FlowAccumulation.Empty();
+    }
+};
+
 class FJCVDiagramMap
 {
 public:
@@ -510,20 +865,73 @@ public:
         return Diagram.GetDiagramBounds();
     }
 
+    // -- DIAGRAM UPDATE OPERATIONS
+
+    /**
+     * Update cells after a dynamic site operation on the diagram,
+     * see FJCVDiagramContext::InsertSite().
+     *
+     * Cells of dirty sites are rebuilt with their cell value and feature
+     * kept. Removed cell is replaced by the swapped cell. Inserted cells
+     * are unmarked with zero value. Feature groups are patched through
+     * the feature journal, see UpdateFeatureGroups().
+     */
+    void ApplySiteUpdate(const FJCVDiagramContext::FSiteUpdate& Update);
+
     // -- FEATURE MODIFICATION OPERATIONS
 
     void ClearFeatures();
 
     void ResetFeatures(uint8 FeatureType, int32 FeatureIndex);
 
+    /**
+     * Rebuild feature groups from cell feature types and indices.
+     * Cell groups are views of the map feature membership, a single cell
+     * index array sorted by (feature type, feature index).
+     */
     void GroupByFeatures();
 
+    /**
+     * Apply cell feature changes recorded since the last grouping to the
+     * feature groups. Changed cells are moved between cell groups and
+     * neighbour lists generated by GenerateNeighbourList() are patched,
+     * both in the number of changes. Falls back to a full membership
+     * rebuild when a change requires a new cell group or the change
+     * journal overflowed, neighbour lists are then kept as is.
+     *
+     * Groups all cells if features have not been grouped.
+     */
+    void UpdateFeatureGroups();
+
+    FORCEINLINE bool HasPendingFeatureChanges() const
+    {
+        return CellStorage.HasFeatureChanges();
+    }
+
+    FORCEINLINE TArrayView<const FJCVFeatureChange> GetPendingFeatureChanges() const
+    {
+        return CellStorage.FeatureChanges;
+    }
+
     void ExpandFeature(uint8 ft, int32 fi);
 
     void ExpandFeature(uint8 ft);
 
     void ExpandFeature(FJCVCellSet& cellS, uint8 ft, int32 fi);
 
+    /**
+     * Compute adjacency summaries of all cell groups of a feature type,
+     * indexed by feature index. Cell groups are swept in parallel, group
+     * neighbours are tested against current cell features.
+     */
+    void ComputeCellGroupAdjacency(uint8 FeatureType, TArray<FJCVCellGroupAdjacency>& OutAdjacency) const;
+
+    /**
+     * Convert cell groups of type ft0 enclosed only by cells of type ft1
+     * and not touching the diagram border to feature (ft1, fi). Pending
+     * feature changes are applied before testing groups. Converted cells
+     * are moved to their new cell group if bGroupFeatures is true.
+     */
     void ConvertIsolated(
         uint8 ft0,
         uint8 ft1,
@@ -531,6 +939,17 @@ public:
         bool bGroupFeatures = false
         );
 
+    /**
+     * Split cells of a feature type into connected components using a
+     * parallel union-find over the cell adjacency. Each component is
+     * assigned a feature index, ordered by the lowest cell index of the
+     * component, and feature groups are rebuilt.
+     *
+     * Returns the component count. OutComponentSizes receives the cell
+     * count of each component by feature index.
+     */
+    int32 LabelConnectedComponents(uint8 FeatureType, TArray<int32>& OutComponentSizes);
+
     void MarkFiltered(
         const FJCVSite* InSite,
         uint8 FeatureType,
@@ -539,6 +958,12 @@ public:
         bool bAddToFilterIfMarked = false
         );
 
+    /**
+     * Move all cells of feature group fg0 to feature group fg1, keeping
+     * cell feature indices, and apply all pending feature changes. Feature
+     * group storage is reserved for every feature type, group references
+     * stay valid across the update.
+     */
     void MergeGroup(FJCVFeatureGroup& fg0, FJCVFeatureGroup& fg1);
 
     template<class FCallback>
@@ -557,7 +982,7 @@ public:
 
         for (const int32 fi : FeatureIndices)
         {
-            const FJCVCellGroup& CellGroup(FeatureGroup.CellGroups[fi]);
+            const FJCVCellGroupView& CellGroup(FeatureGroup.CellGroups[fi]);
 
             for (FJCVCell* Cell : CellGroup)
             {
@@ -567,6 +992,11 @@ public:
         }
     }
 
+    /**
+     * Add neighbour feature types of each feature group. Neighbour cell
+     * counts are kept for UpdateFeatureGroups() if there are no pending
+     * feature changes.
+     */
     void GenerateNeighbourList();
 
     void MergeNeighbourList(FJCVFeatureGroup& fg0, FJCVFeatureGroup& fg1);
@@ -610,6 +1040,33 @@ public:
         TArray<FJCVCellEdgeList>& EdgeLists
         );
 
+    // -- VALUE OPERATIONS (DRAINAGE)
+
+    /**
+     * Generate the drainage of cell values. Depressions are filled with a
+     * priority flood from border cells. Each cell drains to its steepest
+     * descent neighbour on the filled values, cells on filled flats drain
+     * along the flood order towards the spill point. Flow accumulates in
+     * topological order of the receivers.
+     */
+    void GenerateFlowField(FJCVFlowField& OutFlow) const;
+
+    /**
+     * Mark cells filled deeper than MinLakeDepth as (LakeType, 0) features
+     * and other cells with at least MinRiverFlow accumulated flow as
+     * (RiverType, 0) features. If bGroupFeatures is true, lakes are split
+     * into one feature index per connected lake and feature groups are
+     * rebuilt.
+     */
+    void MarkLakesAndRivers(
+        const FJCVFlowField& Flow,
+        uint8 LakeType,
+        uint8 RiverType,
+        float MinLakeDepth,
+        float MinRiverFlow,
+        bool bGroupFeatures = true
+        );
+
     // -- FEATURE QUERY OPERATIONS
 
     FORCEINLINE bool HasCells(uint8 Type) const
@@ -671,14 +1128,14 @@ public:
             : 0;
     }
 
-    FORCEINLINE FJCVCellGroup* GetFeatureCellGroup(uint8 Type, int32 Index)
+    FORCEINLINE const FJCVCellGroupView* GetFeatureCellGroup(uint8 Type, int32 Index) const
     {
         return FeatureGroups.IsValidIndex(Type)
             ? FeatureGroups[Type].GetCellGroup(Index)
             : nullptr;
     }
 
-    FORCEINLINE FJCVCellGroup* GetFeatureCellGroup(const FJCVFeatureId& FeatureId)
+    FORCEINLINE const FJCVCellGroupView* GetFeatureCellGroup(const FJCVFeatureId& FeatureId) const
     {
         return GetFeatureCellGroup(FeatureId.Type, FeatureId.Index);
     }
@@ -724,7 +1181,7 @@ public:
         bool bAgainstAnyType = false
         )
     {
-        FJCVCellGroup* f;
+        const FJCVCellGroupView* f;
         int32 i=0;
         do
         {
@@ -749,7 +1206,7 @@ public:
             bool bAgainstAnyType = false
             )
     {
-        FJCVCellGroup* f = GetFeatureCellGroup(t0, fi);
+        const FJCVCellGroupView* f = GetFeatureCellGroup(t0, fi);
         if (f)
         {
             g.Reserve(f->Num());
@@ -790,7 +1247,7 @@ public:
         for (const FJCVCell* c : cg)
         {
             const FJCVEdge* g = c->GetEdge();
-            const uint8 t = c->FeatureType;
+            const uint8 t = c->GetFeatureType();
             check(g != nullptr);
             do
             {
@@ -802,6 +1259,24 @@ public:
         }
     }
 
+    // -- FEATURE QUERY OPERATIONS (CELL SETS)
+
+    /**
+     * Add cells of the specified feature to the cell set. A negative
+     * FeatureIndex matches any non-negative feature index, as in
+     * FJCVFeatureUtility::GenerateDepthField(). Reads cell features
+     * directly, pending feature changes do not require a feature group
+     * update. The cell set is initialized to the map cell count if it has
+     * a different size.
+     */
+    void AddFeatureCells(FJCVCellBitSet& CellSet, uint8 FeatureType, int32 FeatureIndex = -1) const;
+
+    FORCEINLINE void GetFeatureCells(FJCVCellBitSet& CellSet, uint8 FeatureType, int32 FeatureIndex = -1) const
+    {
+        CellSet.Init(Num());
+        AddFeatureCells(CellSet, FeatureType, FeatureIndex);
+    }
+
     // -- FEATURE QUERY OPERATIONS (JUNCTIONS)
 
     void GetJunctionCells(FJCVCell& c, TArray<FJCVCellJunction>& Junctions);
@@ -855,6 +1330,16 @@ public:
         return Cells[i];
     }
 
+    FORCEINLINE const FJCVCellStorage& GetCellStorage() const
+    {
+        return CellStorage;
+    }
+
+    FORCEINLINE const FJCVFeatureMembership& GetFeatureMembership() const
+    {
+        return FeatureMembership;
+    }
+
     FORCEINLINE const FJCVCell* GetCellNeighbour(const FJCVEdge* g) const
     {
         return g ? GetCell(g->neighbor) : nullptr;
@@ -865,58 +1350,85 @@ public:
         return Cell ? Cell->GetIndex() : -1;
     }
 
+    FORCEINLINE const FJCVDiagramAdjacency& GetAdjacency() const
+    {
+        return Diagram.GetAdjacency();
+    }
+
+    FORCEINLINE FJCVCellVisitStamp& GetVisitStamp() const
+    {
+        return Diagram.GetVisitStamp();
+    }
+
     FORCEINLINE bool IsFeatureBorder(const FJCVCell& c, bool bTestBorder = false) const
     {
-        const FJCVEdge* g = c.GetEdge();
-        const uint8 t = c.FeatureType;
-        check(g != nullptr);
-        while (g)
+        const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+        const int32 i = c.GetIndex();
+        const uint8 t = c.GetFeatureType();
+        check(c.GetEdge() != nullptr);
+        if (bTestBorder && Adjacency.IsBorder(i))
+            return true;
+        for (int32 ni : Adjacency.GetNeighbours(i))
         {
-            const FJCVCell* n = GetCell(g->neighbor);
-            if ((bTestBorder && ! n) || (n && ! n->IsType(t)))
+            if (! Cells[ni].IsType(t))
                 return true;
-            g = g->next;
         }
         return false;
     }
 
     FORCEINLINE bool HasNeighbourType(const FJCVCell& c, uint8 t, bool bTestBorder = false) const
     {
-        const FJCVEdge* g = c.GetEdge();
-        check(g != nullptr);
-        while (g)
+        const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+        const int32 i = c.GetIndex();
+        check(c.GetEdge() != nullptr);
+        if (bTestBorder && Adjacency.IsBorder(i))
+            return true;
+        for (int32 ni : Adjacency.GetNeighbours(i))
         {
-            const FJCVCell* n = GetCell(g->neighbor);
-            if ((bTestBorder && ! n) || (n && n->IsType(t)))
+            if (Cells[ni].IsType(t))
                 return true;
-            g = g->next;
         }
         return false;
     }
 
-    template<class ContainerType>
-    void GetNeighbourTypes(const FJCVCell& c, ContainerType& Types) const
+    /**
+     * Feature types of the cell neighbours, excluding the cell feature type
+     */
+    FORCEINLINE FJCVFeatureTypeMask GetNeighbourTypeMask(int32 CellIndex) const
     {
-        const FJCVEdge* g = c.GetEdge();
-        const uint8 t = c.FeatureType;
-
-        check(g != nullptr);
+        const uint8* Types = CellStorage.FeatureTypes.GetData();
+        FJCVFeatureTypeMask Mask;
 
-        TSet<uint8> NeighbourTypes;
-
-        // Find neighbouring types
-        while (g)
+        for (int32 ni : GetAdjacency().GetNeighbours(CellIndex))
         {
-            const FJCVCell* n = GetCell(g->neighbor);
-            if (n && ! n->IsType(t) && ! NeighbourTypes.Contains(n->FeatureType))
-            {
-                NeighbourTypes.Emplace(n->FeatureType);
-            }
-            g = g->next;
+            Mask.Add(Types[ni]);
         }
 
+        Mask.Remove(Types[CellIndex]);
+
+        return Mask;
+    }
+
+    /**
+     * Compute neighbour feature type mask of every cell, indexed by cell
+     */
+    void ComputeNeighbourTypeMasks(TArray<FJCVFeatureTypeMask>& OutMasks) const;
+
+    /**
+     * Find cells with more than one neighbouring feature type other than
+     * their own, in cell order
+     */
+    void FindJunctionCells(TArray<int32>& OutCellIndices) const;
+
+    template<class ContainerType>
+    void GetNeighbourTypes(const FJCVCell& c, ContainerType& Types) const
+    {
+        check(c.GetEdge() != nullptr);
+
+        const FJCVFeatureTypeMask NeighbourTypes(GetNeighbourTypeMask(c.GetIndex()));
+
         // Store neighbouring types, if any
-        Types.Reserve(NeighbourTypes.Num());
+        Types.Reserve(Types.Num() + NeighbourTypes.Num());
         for (uint8 nt : NeighbourTypes)
         {
             Types.Emplace(nt);
@@ -925,25 +1437,8 @@ public:
 
     FORCEINLINE bool IsJunctionType(const FJCVCell& c) const
     {
-        const FJCVEdge* g = c.GetEdge();
-        const uint8 t = c.FeatureType;
-
-        check(g != nullptr);
-
-        TSet<uint8> NeighbourTypes;
-
-        // Find cell with multiple neighbouring types
-        while (g)
-        {
-            const FJCVCell* n = GetCell(g->neighbor);
-            if (n && ! n->IsType(t) && ! NeighbourTypes.Contains(n->FeatureType))
-            {
-                NeighbourTypes.Emplace(n->FeatureType);
-            }
-            g = g->next;
-        }
-
-        return NeighbourTypes.Num() > 1;
+        check(c.GetEdge() != nullptr);
+        return GetNeighbourTypeMask(c.GetIndex()).HasMultiple();
     }
 
     // -- CELL QUERY OPERATIONS
@@ -969,6 +1464,11 @@ public:
         return Cells[i];
     }
 
+    FORCEINLINE FJCVCellStorage& GetCellStorage()
+    {
+        return CellStorage;
+    }
+
     FORCEINLINE FJCVCell* GetCellNeighbour(const FJCVEdge* g)
     {
         return g ? GetCell(g->neighbor) : nullptr;
@@ -1041,17 +1541,11 @@ public:
     template<class FContainerType>
     void GetNeighbourCells(const FJCVCell& c, FContainerType& OutCells)
     {
-        if (const FJCVSite* Site = c.Site)
+        if (c.IsValid())
         {
-            TArray<const FJCVSite*> Neighbours;
-            Diagram.GetNeighbours(*Site, Neighbours);
-
-            for (const FJCVSite* ns : Neighbours)
+            for (int32 ni : GetAdjacency().GetNeighbours(c.GetIndex()))
             {
-                check(ns != nullptr);
-                check(GetCell(ns) != nullptr);
-
-                OutCells.Emplace(GetCell(ns));
+                OutCells.Emplace(&Cells[ni]);
             }
         }
     }
@@ -1059,17 +1553,12 @@ public:
     template<class FCallback>
     FORCEINLINE void VisitNeighbours(const FJCVCell& c, const FCallback& Callback) const
     {
-        if (const FJCVSite* Site = c.Site)
+        if (c.IsValid())
         {
-            TFunctionRef<void(const FJCVSite*)> SiteCallback(
-                [&](const FJCVSite* NeighbourSite)
-                {
-                    check(NeighbourSite != nullptr);
-                    check(GetCell(NeighbourSite) != nullptr);
-                    Callback(GetCell(NeighbourSite));
-                } );
-
-            Diagram.VisitNeighbours(*Site, SiteCallback);
+            for (int32 ni : GetAdjacency().GetNeighbours(c.GetIndex()))
+            {
+                Callback(&Cells[ni]);
+            }
         }
     }
 
@@ -1257,12 +1746,33 @@ private:
 
     FJCVDiagramContext& Diagram;
     TArray<FJCVCell> Cells;
+    FJCVCellStorage CellStorage;
+    FJCVFeatureMembership FeatureMembership;
     TArray<FJCVFeatureGroup> FeatureGroups;
 
+    // Neighbour cell counts of (feature type, neighbour feature type)
+    // pairs, counted from grouped cells. Valid from GenerateNeighbourList()
+    // until neighbour lists are modified directly.
+    TArray<int32> NeighbourCounts;
+    bool bNeighbourCountsValid = false;
+
     void Init(uint8 FeatureType, int32 FeatureIndex);
 
+    // Rebuild feature membership and rebind feature group cell views.
+    // Existing feature groups and their neighbour lists are kept.
+    // Restarts the feature change journal.
+    void UpdateFeatureMembership();
+
+    void RebindFeatureGroup(int32 FeatureType, int32 FeatureIndex);
+
+    void PatchNeighbourCounts(
+        const TArray<FJCVFeatureChange>& Changes,
+        const TMap<int32, int32>& ChangeMap,
+        TSet<int32>& ChangedPairs
+        );
+
     template<class ContainerType>
-    FORCEINLINE void GetBorderCells(ContainerType& g, uint8 t, FJCVCellGroup& f, bool bAllowBorder=false, bool bAgainstAnyType=false)
+    FORCEINLINE void GetBorderCells(ContainerType& g, uint8 t, const FJCVCellGroupView& f, bool bAllowBorder=false, bool bAgainstAnyType=false)
     {
         if (bAgainstAnyType)
         {
@@ -1328,6 +1838,13 @@ public:
         GenerateDiagram(Bounds, Points);
     }
 
+    // Takes ownership of the point array, points are released after generation
+    FJCVDiagramMapContext(const FBox2D& Bounds, TArray<FVector2D>&& Points)
+    {
+        TArray<FVector2D> SrcPoints(MoveTemp(Points));
+        GenerateDiagram(Bounds, SrcPoints);
+    }
+
     void GenerateDiagram(FVector2D Size, const TArray<FVector2D>& Points)
     {
         Diagram.GenerateDiagram(Size, Points);
@@ -1338,6 +1855,61 @@ public:
         Diagram.GenerateDiagram(Bounds, Points);
     }
 
+    void GenerateDiagram(const FBox2D& Bounds, TArrayView<const FJCVPoint> Points)
+    {
+        Diagram.GenerateDiagram(Bounds, Points);
+    }
+
+    void GenerateDiagramTiled(const FBox2D& Bounds, const TArray<FVector2D>& Points, FIntPoint TileCount, float Halo = 0.f)
+    {
+        Diagram.GenerateDiagramTiled(Bounds, Points, TileCount, Halo);
+    }
+
+    // Relax diagram and rebuild all maps, cell attributes are kept by index
+    int32 RelaxDiagram(int32 Iterations, float ConvergenceThreshold = 0.f)
+    {
+        const int32 IterationCount = Diagram.RelaxDiagram(Iterations, ConvergenceThreshold);
+
+        if (IterationCount > 0)
+        {
+            FJCVDiagramContext::FSiteUpdate Update;
+            Update.bSitesReallocated = true;
+            Update.bRegenerated = true;
+
+            TArray<int32> DirtyCells;
+            ApplySiteUpdate(Update, DirtyCells);
+        }
+
+        return IterationCount;
+    }
+
+    // Dynamic site operations, updates the diagram and all maps.
+    // Output dirty cell indices, see FJCVDiagramContext::FSiteUpdate.
+
+    bool InsertSite(const FVector2D& Position, TArray<int32>& OutDirtyCells)
+    {
+        FJCVDiagramContext::FSiteUpdate Update;
+        const bool bResult = Diagram.InsertSite(Position, Update);
+        ApplySiteUpdate(Update, OutDirtyCells);
+        return bResult;
+    }
+
+    bool RemoveSite(int32 SiteIndex, TArray<int32>& OutDirtyCells)
+    {
+        FJCVDiagramContext::FSiteUpdate Update;
+        const bool bResult = Diagram.RemoveSite(SiteIndex, Update);
+        ApplySiteUpdate(Update, OutDirtyCells);
+        return bResult;
+    }
+
+    bool MoveSite(int32 SiteIndex, const FVector2D& Position, TArray<int32>& OutDirtyCells)
+    {
+        FJCVDiagramContext::FSiteUpdate Update;
+        const bool bResult = Diagram.MoveSite(SiteIndex, Position, Update);
+        ApplySiteUpdate(Update, OutDirtyCells);
+        return bResult;
+    }
+
     FORCEINLINE bool HasMap(int32 i) const
     {
         return MapGroups.IsValidIndex(i) ? MapGroups[i].IsValid() : false;
@@ -1406,4 +1978,17 @@ private:
 
     FJCVDiagramContext Diagram;
     TArray<FPSJCVDiagramMap> MapGroups;
+
+    void ApplySiteUpdate(const FJCVDiagramContext::FSiteUpdate& Update, TArray<int32>& OutDirtyCells)
+    {
+        for (FPSJCVDiagramMap& Map : MapGroups)
+        {
+            if (Map.IsValid())
+            {
+                Map->ApplySiteUpdate(Update);
+            }
+        }
+
+        OutDirtyCells = Update.DirtyIndices;
+    }
 };
@@ -118,6 +118,32 @@ public:
     UFUNCTION(BlueprintCallable, Category="JCV")
     void CreateContextByBounds(int32 ContextId, const FBox2D& InBounds, const TArray<FVector2D>& InPoints);
 
+    /**
+     * Create context with diagram generated in parallel over tiles.
+     * Halo is the tile overlap distance, estimated if zero or less.
+     */
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void CreateContextByBoundsTiled(int32 ContextId, const FBox2D& InBounds, const TArray<FVector2D>& InPoints, FIntPoint TileCount, float Halo = 0.f);
+
+    /**
+     * Create context by moving the point array into the context,
+     * avoids keeping a copy of large point sets alive. InPoints is empty
+     * on return.
+     */
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void CreateContextMovePoints(int32 ContextId, const FVector2D& InSize, UPARAM(ref) TArray<FVector2D>& InPoints);
+
+    // See CreateContextMovePoints(), InPoints is empty on return
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    void CreateContextByBoundsMovePoints(int32 ContextId, const FBox2D& InBounds, UPARAM(ref) TArray<FVector2D>& InPoints);
+
+    /**
+     * Lloyd relax context diagram, stops early once no site moves further
+     * than the convergence threshold. Returns the performed iteration count.
+     */
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    int32 RelaxDiagram(int32 ContextId, int32 Iterations, float ConvergenceThreshold = 0.f);
+
     UFUNCTION(BlueprintCallable, Category="JCV")
     void CreateMap(int32 ContextId, int32 MapID);
 
@@ -129,4 +155,19 @@ public:
 
     UFUNCTION(BlueprintCallable, Category="JCV")
     UJCVDiagramAccessor* GetAccessor(int32 ContextId, int32 MapID);
+
+    /**
+     * Insert, remove or move a diagram site with only affected cells
+     * regenerated. Output indices of cells that require refresh.
+     * Removed cell index is refilled by the last cell.
+     */
+
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    bool InsertSite(int32 ContextId, const FVector2D& Position, TArray<int32>& OutDirtyCells);
+
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    bool RemoveSite(int32 ContextId, int32 SiteIndex, TArray<int32>& OutDirtyCells);
+
+    UFUNCTION(BlueprintCallable, Category="JCV")
+    bool MoveSite(int32 ContextId, int32 SiteIndex, const FVector2D& Position, TArray<int32>& OutDirtyCells);
 };
@@ -29,6 +29,11 @@
 
 #include "jc_voronoi.h"
 #include "UnrealMathUtility.h"
+#include "UnrealMemory.h"
+#include "Containers/Array.h"
+#include "Containers/ArrayView.h"
+#include "Math/Box2D.h"
+#include "Math/IntPoint.h"
 
 #define FJCV_INT3_SCALE     1000.f
 #define FJCV_INT3_SCALE_INV .001f
@@ -99,3 +104,376 @@ public:
         return FVector2D( GetMidValue(v0.X, v1.X), GetMidValue(v0.Y, v1.Y) );
     }
 };
+
+// Diagram Arena Allocator
+//
+// Linear allocator passed to jcv as the user allocation context. Memory is
+// only released on destruction, Reset() rewinds the arena and keeps the
+// reserved chunks for the next diagram generation.
+
+class FJCVDiagramArena
+{
+    struct FChunk
+    {
+        uint8* Data;
+        SIZE_T Size;
+    };
+
+    TArray<FChunk> Chunks;
+    int32 ChunkIndex = 0;
+    SIZE_T ChunkOffset = 0;
+
+    SIZE_T UsedBytes = 0;
+    SIZE_T PeakBytes = 0;
+
+    FJCVDiagramArena(const FJCVDiagramArena&) = delete;
+    FJCVDiagramArena& operator=(const FJCVDiagramArena&) = delete;
+
+public:
+
+    enum
+    {
+        DefaultChunkSize = 256*1024,
+        DefaultAlignment = 16
+    };
+
+    FJCVDiagramArena() = default;
+
+    ~FJCVDiagramArena()
+    {
+        Empty();
+    }
+
+    void* Allocate(SIZE_T Size)
+    {
+        Size = Align(Size, DefaultAlignment);
+
+        // Find the first retained chunk with enough space left
+        while (Chunks.IsValidIndex(ChunkIndex) && (ChunkOffset+Size) > Chunks[ChunkIndex].Size)
+        {
+            ++ChunkIndex;
+            ChunkOffset = 0;
+        }
+
+        // Out of retained chunks, reserve a new one
+        if (! Chunks.IsValidIndex(ChunkIndex))
+        {
+            AddChunk(FMath::Max<SIZE_T>(Size, DefaultChunkSize));
+            ChunkIndex = Chunks.Num()-1;
+            ChunkOffset = 0;
+        }
+
+        void* p = Chunks[ChunkIndex].Data + ChunkOffset;
+        ChunkOffset += Size;
+        UsedBytes += Size;
+        PeakBytes = FMath::Max(PeakBytes, UsedBytes);
+        return p;
+    }
+
+    // Rewinds the arena. Chunks from a generation that did not fit
+    // in a single chunk are merged so the next one allocates linearly.
+    void Reset()
+    {
+        if (Chunks.Num() > 1 && ChunkIndex > 0)
+        {
+            const SIZE_T MergedSize = Align(GetCapacity(), DefaultChunkSize);
+            Empty();
+            AddChunk(MergedSize);
+        }
+
+        ChunkIndex = 0;
+        ChunkOffset = 0;
+        UsedBytes = 0;
+    }
+
+    void Empty()
+    {
+        for (FChunk& Chunk : Chunks)
+        {
+            FMemory::Free(Chunk.Data);
+        }
+        Chunks.Empty();
+        ChunkIndex = 0;
+        ChunkOffset = 0;
+        UsedBytes = 0;
+    }
+
+    FORCEINLINE SIZE_T GetUsedBytes() const
+    {
+        return UsedBytes;
+    }
+
+    FORCEINLINE SIZE_T GetPeakBytes() const
+    {
+        return PeakBytes;
+    }
+
+    SIZE_T GetCapacity() const
+    {
+        SIZE_T Capacity = 0;
+        for (const FChunk& Chunk : Chunks)
+        {
+            Capacity += Chunk.Size;
+        }
+        return Capacity;
+    }
+
+private:
+
+    FORCEINLINE void AddChunk(SIZE_T Size)
+    {
+        FChunk Chunk;
+        Chunk.Data = static_cast<uint8*>(FMemory::Malloc(Size, DefaultAlignment));
+        Chunk.Size = Size;
+        Chunks.Emplace(Chunk);
+    }
+};
+
+// Site Bucket Grid
+//
+// Uniform grid over site positions. Each bucket holds a seed site close to
+// the bucket, used as the start of greedy closest site walks.
+
+class FJCVSiteGrid
+{
+    FVector2D Origin;
+    FVector2D InvBucketSize;
+    FIntPoint Dimension;
+
+    // Seed site array position per bucket
+    TArray<int32> Buckets;
+
+public:
+
+    enum
+    {
+        SitesPerBucket = 2,
+        MaxDimension = 4096
+    };
+
+    FJCVSiteGrid()
+        : Origin(FVector2D::ZeroVector)
+        , InvBucketSize(FVector2D::ZeroVector)
+        , Dimension(0, 0)
+    {
+    }
+
+    FORCEINLINE bool IsValid() const
+    {
+        return Buckets.Num() > 0;
+    }
+
+    FORCEINLINE void Empty()
+    {
+        Buckets.Empty();
+        Dimension = FIntPoint(0, 0);
+    }
+
+    FORCEINLINE SIZE_T GetAllocatedSize() const
+    {
+        return Buckets.GetAllocatedSize();
+    }
+
+    FORCEINLINE int32 GetBucketIndex(const FVector2D& Pos) const
+    {
+        const int32 X = FMath::Clamp(FMath::FloorToInt((Pos.X-Origin.X) * InvBucketSize.X), 0, Dimension.X-1);
+        const int32 Y = FMath::Clamp(FMath::FloorToInt((Pos.Y-Origin.Y) * InvBucketSize.Y), 0, Dimension.Y-1);
+        return X + Y*Dimension.X;
+    }
+
+    /**
+     * Return seed site array position for the specified point,
+     * INDEX_NONE if the grid is empty.
+     */
+    FORCEINLINE int32 GetSeed(const FVector2D& Pos) const
+    {
+        return IsValid() ? Buckets[GetBucketIndex(Pos)] : INDEX_NONE;
+    }
+
+    /**
+     * Build grid over the site positions. Bucket count is sized from site
+     * density, empty buckets are seeded from their nearest filled bucket.
+     */
+    void Build(const FBox2D& Bounds, const FJCVSite* Sites, int32 SiteCount)
+    {
+        Empty();
+
+        if (! Sites || SiteCount <= 0 || ! Bounds.bIsValid)
+        {
+            return;
+        }
+
+        const FVector2D Size(Bounds.GetSize().ComponentMax(FVector2D(KINDA_SMALL_NUMBER, KINDA_SMALL_NUMBER)));
+        const float BucketSize = FMath::Sqrt(Size.X*Size.Y*SitesPerBucket / SiteCount);
+
+        Origin = Bounds.Min;
+        Dimension.X = FMath::Clamp(FMath::CeilToInt(Size.X / BucketSize), 1, (int32) MaxDimension);
+        Dimension.Y = FMath::Clamp(FMath::CeilToInt(Size.Y / BucketSize), 1, (int32) MaxDimension);
+        InvBucketSize.X = Dimension.X / Size.X;
+        InvBucketSize.Y = Dimension.Y / Size.Y;
+
+        const int32 BucketCount = Dimension.X * Dimension.Y;
+
+        Buckets.Init(INDEX_NONE, BucketCount);
+
+        TArray<int32> BucketQueue;
+        BucketQueue.Reserve(BucketCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            const FJCVPoint& p(Sites[i].p);
+            int32& Bucket(Buckets[GetBucketIndex(FVector2D(p.x, p.y))]);
+
+            if (Bucket == INDEX_NONE)
+            {
+                Bucket = i;
+                BucketQueue.Emplace(GetBucketIndex(FVector2D(p.x, p.y)));
+            }
+        }
+
+        // Breadth first fill of empty buckets
+
+        for (int32 qi=0; qi<BucketQueue.Num(); ++qi)
+        {
+            const int32 bi = BucketQueue[qi];
+            const int32 X = bi % Dimension.X;
+            const int32 Y = bi / Dimension.X;
+            const int32 Seed = Buckets[bi];
+
+            const int32 NeighbourBuckets[4] = {
+                X > 0             ? bi-1           : INDEX_NONE,
+                X < Dimension.X-1 ? bi+1           : INDEX_NONE,
+                Y > 0             ? bi-Dimension.X : INDEX_NONE,
+                Y < Dimension.Y-1 ? bi+Dimension.X : INDEX_NONE
+            };
+
+            for (int32 nbi : NeighbourBuckets)
+            {
+                if (nbi != INDEX_NONE && Buckets[nbi] == INDEX_NONE)
+                {
+                    Buckets[nbi] = Seed;
+                    BucketQueue.Emplace(nbi);
+                }
+            }
+        }
+    }
+
+    // Dynamic site updates keep the buckets seeded by a site connected and
+    // around the bucket of the site position, so that each seed is found
+    // by a flood fill from its site position. See FJCVDiagramContext.
+
+    /**
+     * Replace a seed site by the seed of an adjacent bucket, or by the
+     * fallback seed if every bucket has the same seed. Used on site move
+     * or removal, the position is the previous seed site position.
+     */
+    void RemoveSeed(const FVector2D& Pos, int32 Seed, int32 FallbackSeed)
+    {
+        TArray<int32, TInlineAllocator<64>> SeedBuckets;
+        int32 AdjacentSeed = INDEX_NONE;
+
+        // Seed buckets are marked during flood fill and assigned afterwards
+
+        FloodSeed(Pos, Seed, MarkedSeed, [&](int32 nbi)
+        {
+            if (AdjacentSeed == INDEX_NONE && Buckets[nbi] != Seed && Buckets[nbi] != MarkedSeed)
+            {
+                AdjacentSeed = Buckets[nbi];
+            }
+        },
+        SeedBuckets);
+
+        const int32 NewSeed = (AdjacentSeed != INDEX_NONE) ? AdjacentSeed : FallbackSeed;
+
+        for (int32 bi : SeedBuckets)
+        {
+            Buckets[bi] = NewSeed;
+        }
+    }
+
+    /**
+     * Rename a seed site, used when a site is moved to another site array
+     * position. The position is the seed site position.
+     */
+    void RenameSeed(const FVector2D& Pos, int32 Seed, int32 NewSeed)
+    {
+        if (Seed != NewSeed)
+        {
+            TArray<int32, TInlineAllocator<64>> SeedBuckets;
+            FloodSeed(Pos, Seed, NewSeed, [](int32) {}, SeedBuckets);
+        }
+    }
+
+    /**
+     * Remap seed site array positions, NewPositions is indexed by the
+     * current site array position.
+     */
+    void RemapSeeds(TArrayView<const int32> NewPositions)
+    {
+        for (int32& Bucket : Buckets)
+        {
+            if (Bucket != INDEX_NONE)
+            {
+                Bucket = NewPositions[Bucket];
+            }
+        }
+    }
+
+private:
+
+    enum { MarkedSeed = -2 };
+
+    // Flood fill connected buckets with the specified seed from the bucket
+    // of the specified position, replacing the seed and visiting every
+    // bucket adjacent to the filled buckets
+    template<class FAdjacentCallback, class FAllocator>
+    void FloodSeed(const FVector2D& Pos, int32 Seed, int32 NewSeed, const FAdjacentCallback& OnAdjacent, TArray<int32, FAllocator>& OutBuckets)
+    {
+        if (! IsValid() || Seed == INDEX_NONE)
+        {
+            return;
+        }
+
+        const int32 StartBucket = GetBucketIndex(Pos);
+
+        if (Buckets[StartBucket] != Seed)
+        {
+            return;
+        }
+
+        Buckets[StartBucket] = NewSeed;
+        OutBuckets.Emplace(StartBucket);
+
+        for (int32 qi=0; qi<OutBuckets.Num(); ++qi)
+        {
+            const int32 bi = OutBuckets[qi];
+            const int32 X = bi % Dimension.X;
+            const int32 Y = bi / Dimension.X;
+
+            const int32 NeighbourBuckets[4] = {
+                X > 0             ? bi-1           : INDEX_NONE,
+                X < Dimension.X-1 ? bi+1           : INDEX_NONE,
+                Y > 0             ? bi-Dimension.X : INDEX_NONE,
+                Y < Dimension.Y-1 ? bi+Dimension.X : INDEX_NONE
+            };
+
+            for (int32 nbi : NeighbourBuckets)
+            {
+                if (nbi == INDEX_NONE)
+                {
+                    continue;
+                }
+
+                if (Buckets[nbi] == Seed)
+                {
+                    Buckets[nbi] = NewSeed;
+                    OutBuckets.Emplace(nbi);
+                }
+                else
+                {
+                    OnAdjacent(nbi);
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJCVDiagramMap;
+
+// Radix Heap
+//
+// Monotone priority queue of cell indices keyed by non-negative float
+// distances. Non-negative floats order as their bit patterns, entries are
+// bucketed by the highest bit that differs from the last popped key.
+// Pushed keys must not be below the last popped key.
+
+class FJCVRadixHeap
+{
+    typedef TPair<uint32, int32> FEntry;
+
+    TArray<FEntry> Buckets[33];
+    uint32 LastKey = 0;
+    int32 Count = 0;
+
+    FORCEINLINE static uint32 ToKey(float Value)
+    {
+        union { float F; uint32 U; } Bits;
+        Bits.F = Value;
+        return Bits.U;
+    }
+
+    FORCEINLINE static float FromKey(uint32 Key)
+    {
+        union { float F; uint32 U; } Bits;
+        Bits.U = Key;
+        return Bits.F;
+    }
+
+    FORCEINLINE int32 GetBucket(uint32 Key) const
+    {
+        return (Key == LastKey) ? 0 : 32-FMath::CountLeadingZeros(Key ^ LastKey);
+    }
+
+public:
+
+    FORCEINLINE bool IsEmpty() const
+    {
+        return Count == 0;
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return Count;
+    }
+
+    FORCEINLINE void Reset()
+    {
+        for (TArray<FEntry>& Bucket : Buckets)
+        {
+            Bucket.Reset();
+        }
+
+        LastKey = 0;
+        Count = 0;
+    }
+
+    FORCEINLINE void Push(float Distance, int32 CellIndex)
+    {
+        const uint32 Key = ToKey(Distance);
+        check(Distance >= 0.f && Key >= LastKey);
+        Buckets[GetBucket(Key)].Emplace(Key, CellIndex);
+        ++Count;
+    }
+
+    // Pop entry with the lowest distance, heap must not be empty
+    FORCEINLINE void Pop(float& OutDistance, int32& OutCellIndex)
+    {
+        check(Count > 0);
+
+        // Redistribute the lowest non-empty bucket by its minimum key,
+        // all of its entries move to lower buckets
+
+        if (Buckets[0].Num() == 0)
+        {
+            int32 b = 1;
+
+            while (Buckets[b].Num() == 0)
+            {
+                ++b;
+            }
+
+            TArray<FEntry>& Bucket(Buckets[b]);
+            uint32 MinKey = Bucket[0].Key;
+
+            for (const FEntry& Entry : Bucket)
+            {
+                MinKey = FMath::Min(MinKey, Entry.Key);
+            }
+
+            LastKey = MinKey;
+
+            for (const FEntry& Entry : Bucket)
+            {
+                Buckets[GetBucket(Entry.Key)].Emplace(Entry);
+            }
+
+            Bucket.Reset();
+        }
+
+        const FEntry Entry = Buckets[0].Pop(false);
+        OutDistance = FromKey(Entry.Key);
+        OutCellIndex = Entry.Value;
+        --Count;
+    }
+};
+
+// Distance field edge weight between neighbour cells
+enum class EJCVDistanceWeight : uint8
+{
+    // Distance between cell sites
+    SiteDistance,
+    // Length of the shared cell edge
+    EdgeLength
+};
+
+struct FJCVDistanceFieldParams
+{
+    EJCVDistanceWeight Weight = EJCVDistanceWeight::SiteDistance;
+
+    // Cost multiplier by feature type, types out of range use 1. Edge
+    // weights are scaled by the average multiplier of both cells. Cells of
+    // types with negative multipliers are not entered.
+    TArray<float> TypeCostMultipliers;
+
+    // Cells further than the maximum distance are not reached
+    float MaxDistance = BIG_NUMBER;
+};
+
+// Distance Field
+//
+// Multi-source Dijkstra geodesic distance over the cell adjacency.
+
+class FJCVDistanceField
+{
+public:
+
+    /**
+     * Compute distance of each cell from the nearest source cell index.
+     * Invalid sources are skipped. OutDistances receives BIG_NUMBER for
+     * unreached cells. OutNearestSources optionally receives the nearest
+     * source cell index of each cell, INDEX_NONE if unreached.
+     */
+    static void Compute(
+        const FJCVDiagramMap& Map,
+        TArrayView<const int32> Sources,
+        const FJCVDistanceFieldParams& Params,
+        TArray<float>& OutDistances,
+        TArray<int32>* OutNearestSources = nullptr
+        );
+};
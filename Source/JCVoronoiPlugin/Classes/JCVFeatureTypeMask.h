@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Feature Type Mask
+//
+// Fixed 256-bit set of feature types, one bit per uint8 feature type.
+// Set operations work on four 64-bit words, iteration yields the contained
+// feature types in ascending order.
+
+struct FJCVFeatureTypeMask
+{
+    uint64 Words[4];
+
+    class FIterator
+    {
+    public:
+
+        FORCEINLINE FIterator(const FJCVFeatureTypeMask& InMask, int32 InWordIndex)
+            : Mask(InMask)
+            , WordIndex(InWordIndex)
+            , Bits(InWordIndex < 4 ? InMask.Words[InWordIndex] : 0)
+        {
+            SkipEmptyWords();
+        }
+
+        FORCEINLINE uint8 operator*() const
+        {
+            return (uint8) ((WordIndex << 6) | FPlatformMath::CountTrailingZeros64(Bits));
+        }
+
+        FORCEINLINE FIterator& operator++()
+        {
+            // Clear lowest set bit
+            Bits &= Bits-1;
+            SkipEmptyWords();
+            return *this;
+        }
+
+        FORCEINLINE bool operator!=(const FIterator& Other) const
+        {
+            return WordIndex != Other.WordIndex || Bits != Other.Bits;
+        }
+
+    private:
+
+        const FJCVFeatureTypeMask& Mask;
+        int32 WordIndex;
+        uint64 Bits;
+
+        FORCEINLINE void SkipEmptyWords()
+        {
+            while (! Bits && WordIndex < 4)
+            {
+                ++WordIndex;
+                Bits = WordIndex < 4 ? Mask.Words[WordIndex] : 0;
+            }
+        }
+    };
+
+    FORCEINLINE FJCVFeatureTypeMask()
+    {
+        Empty();
+    }
+
+    FORCEINLINE explicit FJCVFeatureTypeMask(uint8 Type)
+    {
+        Empty();
+        Add(Type);
+    }
+
+    FORCEINLINE void Empty()
+    {
+        Words[0] = Words[1] = Words[2] = Words[3] = 0;
+    }
+
+    FORCEINLINE void Add(uint8 Type)
+    {
+        Words[Type >> 6] |= uint64(1) << (Type & 63);
+    }
+
+    // TSet compatible insertion
+    FORCEINLINE void Emplace(uint8 Type)
+    {
+        Add(Type);
+    }
+
+    FORCEINLINE void Remove(uint8 Type)
+    {
+        Words[Type >> 6] &= ~(uint64(1) << (Type & 63));
+    }
+
+    FORCEINLINE bool Contains(uint8 Type) const
+    {
+        return (Words[Type >> 6] >> (Type & 63)) & 1;
+    }
+
+    FORCEINLINE bool IsEmpty() const
+    {
+        return ! (Words[0] | Words[1] | Words[2] | Words[3]);
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return FPlatformMath::CountBits(Words[0])
+            + FPlatformMath::CountBits(Words[1])
+            + FPlatformMath::CountBits(Words[2])
+            + FPlatformMath::CountBits(Words[3]);
+    }
+
+    // Whether the mask contains more than one feature type, either more than
+    // one bit in a word or bits in more than one word
+    FORCEINLINE bool HasMultiple() const
+    {
+        const uint64 WordMultiple =
+            (Words[0] & (Words[0]-1)) |
+            (Words[1] & (Words[1]-1)) |
+            (Words[2] & (Words[2]-1)) |
+            (Words[3] & (Words[3]-1));
+        const int32 WordCount =
+            (Words[0] != 0) + (Words[1] != 0) + (Words[2] != 0) + (Words[3] != 0);
+        return WordMultiple != 0 || WordCount > 1;
+    }
+
+    FORCEINLINE FJCVFeatureTypeMask& operator|=(const FJCVFeatureTypeMask& Other)
+    {
+        Words[0] |= Other.Words[0];
+        Words[1] |= Other.Words[1];
+        Words[2] |= Other.Words[2];
+        Words[3] |= Other.Words[3];
+        return *this;
+    }
+
+    FORCEINLINE FJCVFeatureTypeMask& operator&=(const FJCVFeatureTypeMask& Other)
+    {
+        Words[0] &= Other.Words[0];
+        Words[1] &= Other.Words[1];
+        Words[2] &= Other.Words[2];
+        Words[3] &= Other.Words[3];
+        return *this;
+    }
+
+    FORCEINLINE FJCVFeatureTypeMask operator|(const FJCVFeatureTypeMask& Other) const
+    {
+        FJCVFeatureTypeMask Mask(*this);
+        return Mask |= Other;
+    }
+
+    FORCEINLINE FJCVFeatureTypeMask operator&(const FJCVFeatureTypeMask& Other) const
+    {
+        FJCVFeatureTypeMask Mask(*this);
+        return Mask &= Other;
+    }
+
+    FORCEINLINE FJCVFeatureTypeMask operator~() const
+    {
+        FJCVFeatureTypeMask Mask;
+        Mask.Words[0] = ~Words[0];
+        Mask.Words[1] = ~Words[1];
+        Mask.Words[2] = ~Words[2];
+        Mask.Words[3] = ~Words[3];
+        return Mask;
+    }
+
+    FORCEINLINE bool operator==(const FJCVFeatureTypeMask& Other) const
+    {
+        return Words[0] == Other.Words[0]
+            && Words[1] == Other.Words[1]
+            && Words[2] == Other.Words[2]
+            && Words[3] == Other.Words[3];
+    }
+
+    FORCEINLINE bool operator!=(const FJCVFeatureTypeMask& Other) const
+    {
+        return ! (*this == Other);
+    }
+
+    FORCEINLINE FIterator begin() const
+    {
+        return FIterator(*this, 0);
+    }
+
+    FORCEINLINE FIterator end() const
+    {
+        return FIterator(*this, 4);
+    }
+};
@@ -93,6 +93,25 @@ public:
 
     // Depth Map Utility
 
+    /**
+     * Generate cell depth from feature borders with a single search from
+     * the border cells of all matching cell groups. Feature border cells
+     * are cells next to another feature type or the diagram border, with
+     * zero depth. Depth only propagates within each cell group. Unmatched
+     * and unreached cells have INDEX_NONE depth.
+     *
+     * OutNearestBorderCells optionally receives the index of the border
+     * cell each cell is reached from.
+     */
+    static void GenerateDepthField(
+        const FJCVDiagramMap& Map,
+        const FJCVFeatureId& FeatureId,
+        TArray<int32>& OutDepths,
+        TArray<int32>* OutNearestBorderCells = nullptr
+        );
+
+    // Set DstMap cell features to (depth feature type, depth). Depth feature
+    // types start from 1, in order of the non-empty source cell groups.
     static void GenerateDepthMap(FJCVDiagramMap& SrcMap, FJCVDiagramMap& DstMap, const FJCVFeatureId& FeatureId);
 
     // Cell Query
@@ -124,6 +143,16 @@ public:
     UFUNCTION(BlueprintCallable, Category="JCV", meta=(DisplayName="GenerateDepthMap"))
     static void K2_GenerateDepthMap(UJCVDiagramAccessor* SrcAccessor, UJCVDiagramAccessor* DstAccessor, FJCVFeatureId FeatureId);
 
+    // Geodesic distance of each cell from the nearest source cell, see FJCVDistanceField
+    UFUNCTION(BlueprintCallable, Category="JCV", meta=(DisplayName="GenerateDistanceField", AutoCreateRefTerm="TypeCostMultipliers"))
+    static void K2_GenerateDistanceField(
+        UJCVDiagramAccessor* Accessor,
+        const TArray<FJCVCellRef>& SourceCellRefs,
+        TArray<float>& Distances,
+        const TArray<float>& TypeCostMultipliers,
+        bool bUseEdgeLength = false
+        );
+
     UFUNCTION(BlueprintCallable, Category="JCV")
     static void GetFeatureIdRange(TArray<FJCVFeatureId>& FeatureIds, uint8 FeatureType, int32 FeatureIndexStart, int32 FeatureIndexEnd, bool bInclusiveEnd = true);
 
@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/ParallelFor.h"
+#include "JCVDiagramAdjacency.h"
+#include "JCVoronoiPlugin.h"
+
+// Frontier Search
+//
+// Multi-source level synchronous breadth first search over the cell
+// adjacency. Each level expands the current frontier in parallel chunks.
+// Unvisited neighbours are claimed with an atomic minimum of the frontier
+// position, the lowest frontier position wins. The next frontier is
+// written in (frontier position, adjacency entry) order, which matches a
+// serial single queue search from the same sources regardless of thread
+// count.
+
+class FJCVFrontierSearch
+{
+public:
+
+    enum { ChunkSize = 1024 };
+
+    /**
+     * Search from source cell indices. Invalid and duplicate sources are
+     * skipped. CanVisit(CellIndex, ParentIndex) filters neighbour cells
+     * and may be called concurrently. OnLevel(Depth, Frontier) is called
+     * on the calling thread with the cells of each depth, the search
+     * stops if it returns false. Search also stops after MaxDepth.
+     *
+     * OutDistances receives the depth of each cell, OutSources receives
+     * the source cell index of each cell, both INDEX_NONE if unvisited.
+     *
+     * Returns the deepest visited depth, INDEX_NONE without sources.
+     */
+    template<class FCanVisit, class FOnLevel>
+    static int32 Search(
+        const FJCVDiagramAdjacency& Adjacency,
+        TArrayView<const int32> Sources,
+        const FCanVisit& CanVisit,
+        const FOnLevel& OnLevel,
+        TArray<int32>& OutDistances,
+        TArray<int32>& OutSources,
+        int32 MaxDepth = MAX_int32
+        )
+    {
+        const int32 CellCount = Adjacency.Num();
+
+        OutDistances.Reset();
+        OutSources.Reset();
+        OutDistances.SetNumUninitialized(CellCount);
+        OutSources.SetNumUninitialized(CellCount);
+
+        if (CellCount == 0)
+        {
+            return INDEX_NONE;
+        }
+
+        SCOPE_CYCLE_COUNTER(STAT_JCV_FrontierSearch);
+
+        TArray<int32> Claims;
+        Claims.SetNumUninitialized(CellCount);
+
+        int32* Distances = OutDistances.GetData();
+        int32* CellSources = OutSources.GetData();
+        int32* ClaimData = Claims.GetData();
+
+        const int32 InitChunkCount = FMath::DivideAndRoundUp(CellCount, (int32) ChunkSize*16);
+
+        ParallelFor(InitChunkCount, [&](int32 ci)
+        {
+            const int32 CellStart = ci * ChunkSize*16;
+            const int32 CellEnd = FMath::Min(CellStart+ChunkSize*16, CellCount);
+
+            for (int32 i=CellStart; i<CellEnd; ++i)
+            {
+                Distances[i] = INDEX_NONE;
+                CellSources[i] = INDEX_NONE;
+                ClaimData[i] = MAX_int32;
+            }
+        } );
+
+        // Source cells are the zero depth frontier
+
+        TArray<int32> Frontier;
+        TArray<int32> NextFrontier;
+        TArray<TArray<int32>> ChunkFrontiers;
+
+        Frontier.Reserve(Sources.Num());
+
+        for (int32 CellIndex : Sources)
+        {
+            if (CellIndex >= 0 && CellIndex < CellCount && Distances[CellIndex] < 0)
+            {
+                Distances[CellIndex] = 0;
+                CellSources[CellIndex] = CellIndex;
+                Frontier.Emplace(CellIndex);
+            }
+        }
+
+        if (Frontier.Num() == 0)
+        {
+            return INDEX_NONE;
+        }
+
+        int32 Depth = 0;
+
+        while (Frontier.Num() > 0)
+        {
+            if (! OnLevel(Depth, TArrayView<const int32>(Frontier)) || Depth >= MaxDepth)
+            {
+                break;
+            }
+
+            const int32 FrontierNum = Frontier.Num();
+            const int32 ChunkCount = FMath::DivideAndRoundUp(FrontierNum, (int32) ChunkSize);
+            const int32* FrontierData = Frontier.GetData();
+
+            // Claim unvisited neighbours with the lowest frontier position.
+            // Distances are not written until all claims are made.
+
+            ParallelFor(ChunkCount, [&](int32 ci)
+            {
+                const int32 PosStart = ci * ChunkSize;
+                const int32 PosEnd = FMath::Min(PosStart+ChunkSize, FrontierNum);
+
+                for (int32 p=PosStart; p<PosEnd; ++p)
+                {
+                    const int32 CellIndex = FrontierData[p];
+
+                    for (int32 ni : Adjacency.GetNeighbours(CellIndex))
+                    {
+                        if (Distances[ni] < 0 && CanVisit(ni, CellIndex))
+                        {
+                            int32 Claim = FPlatformAtomics::AtomicRead(ClaimData+ni);
+
+                            while (p < Claim)
+                            {
+                                const int32 PrevClaim = FPlatformAtomics::InterlockedCompareExchange(ClaimData+ni, p, Claim);
+
+                                if (PrevClaim == Claim)
+                                {
+                                    break;
+                                }
+
+                                Claim = PrevClaim;
+                            }
+                        }
+                    }
+                }
+            },
+            ChunkCount < 2 );
+
+            // Visit claimed neighbours by their claiming frontier cell.
+            // Claims of previously visited cells are stale and skipped by
+            // their distance, which only the claiming cell writes.
+
+            if (ChunkFrontiers.Num() < ChunkCount)
+            {
+                ChunkFrontiers.SetNum(ChunkCount);
+            }
+
+            ParallelFor(ChunkCount, [&](int32 ci)
+            {
+                const int32 PosStart = ci * ChunkSize;
+                const int32 PosEnd = FMath::Min(PosStart+ChunkSize, FrontierNum);
+
+                TArray<int32>& ChunkFrontier(ChunkFrontiers[ci]);
+                ChunkFrontier.Reset();
+
+                for (int32 p=PosStart; p<PosEnd; ++p)
+                {
+                    const int32 CellIndex = FrontierData[p];
+
+                    for (int32 ni : Adjacency.GetNeighbours(CellIndex))
+                    {
+                        if (ClaimData[ni] == p && Distances[ni] < 0)
+                        {
+                            Distances[ni] = Depth+1;
+                            CellSources[ni] = CellSources[CellIndex];
+                            ChunkFrontier.Emplace(ni);
+                        }
+                    }
+                }
+            },
+            ChunkCount < 2 );
+
+            // Concatenate chunk frontiers in frontier order
+
+            NextFrontier.Reset();
+
+            for (int32 ci=0; ci<ChunkCount; ++ci)
+            {
+                NextFrontier.Append(ChunkFrontiers[ci]);
+            }
+
+            if (NextFrontier.Num() == 0)
+            {
+                break;
+            }
+
+            Swap(Frontier, NextFrontier);
+            ++Depth;
+        }
+
+        return Depth;
+    }
+
+    // Search without level callback
+    template<class FCanVisit>
+    FORCEINLINE static int32 Search(
+        const FJCVDiagramAdjacency& Adjacency,
+        TArrayView<const int32> Sources,
+        const FCanVisit& CanVisit,
+        TArray<int32>& OutDistances,
+        TArray<int32>& OutSources,
+        int32 MaxDepth = MAX_int32
+        )
+    {
+        return Search(
+            Adjacency,
+            Sources,
+            CanVisit,
+            [](int32, TArrayView<const int32>) { return true; },
+            OutDistances,
+            OutSources,
+            MaxDepth
+            );
+    }
+};
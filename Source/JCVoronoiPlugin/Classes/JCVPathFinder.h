@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJCVDiagramMap;
+
+struct FJCVPathParams
+{
+    // Cost multiplier by feature type, types out of range use 1. Step
+    // costs are the site distance scaled by the average multiplier of both
+    // cells. Cells of types with negative multipliers are not entered.
+    TArray<float> TypeCostMultipliers;
+};
+
+// Path Finder
+//
+// A* path queries over the cell adjacency. Open and closed cell sets are
+// epoch stamped thread local buffers, queries do not clear or allocate
+// per cell buffers and may run concurrently on a const map.
+
+class FJCVPathFinder
+{
+public:
+
+    /**
+     * Find the lowest cost path from the start to the goal cell index.
+     * OutPath receives the path cell indices including both end cells.
+     * Returns false if the goal is not reachable.
+     */
+    static bool FindPath(
+        const FJCVDiagramMap& Map,
+        int32 StartIndex,
+        int32 GoalIndex,
+        const FJCVPathParams& Params,
+        TArray<int32>& OutPath,
+        float* OutCost = nullptr
+        );
+};
+
+// Path Hierarchy
+//
+// Two level path graph, HPA* style. Clusters are the map feature groups,
+// portals are cell pairs on the border of adjacent clusters, one pair per
+// adjacent cluster pair closest to the middle of their shared border.
+// Portals of a cluster are linked by their precomputed in-cluster path
+// costs. Queries search the portal graph, then refine each step with an
+// in-cluster A* search. Paths are approximate, each refined step is
+// optimal within its cluster.
+//
+// Built from current cell features, rebuild after feature changes. Build
+// runs one in-cluster Dijkstra search per portal, stopped once the higher
+// portals of its cluster are settled. A cluster with P portals and C cells
+// costs up to P-1 searches of O(C log C), clusters of few large feature
+// groups with long shared borders build slowest.
+
+class FJCVPathHierarchy
+{
+    // Step cost of each feature type, negative if not enterable
+    float TypeCosts[256];
+    float MinTypeCost = 1.f;
+
+    // Cluster of each cell, INDEX_NONE for cells without feature index
+    TArray<int32> CellClusters;
+
+    // Portal node of each cell, INDEX_NONE for non portal cells
+    TArray<int32> CellNodes;
+
+    // Portal node cells
+    TArray<int32> NodeCells;
+
+    // Portal graph, compressed sparse row edges of each node
+    TArray<int32> NodeEdgeOffsets;
+    TArray<int32> NodeEdgeTargets;
+    TArray<float> NodeEdgeCosts;
+
+    // Portal nodes of each cluster, compressed sparse row
+    TArray<int32> ClusterNodeOffsets;
+    TArray<int32> ClusterNodes;
+
+public:
+
+    FORCEINLINE bool IsValid() const
+    {
+        return CellClusters.Num() > 0;
+    }
+
+    // Whether the hierarchy was built for the cell count of the map
+    bool IsValidFor(const FJCVDiagramMap& Map) const;
+
+    FORCEINLINE int32 GetClusterCount() const
+    {
+        return FMath::Max(ClusterNodeOffsets.Num()-1, 0);
+    }
+
+    FORCEINLINE int32 GetNodeCount() const
+    {
+        return NodeCells.Num();
+    }
+
+    void Empty();
+
+    SIZE_T GetAllocatedSize() const;
+
+    void Build(const FJCVDiagramMap& Map, const FJCVPathParams& Params);
+
+    /**
+     * Find a path from the start to the goal cell index over the portal
+     * graph. Falls back to FJCVPathFinder::FindPath() with the hierarchy
+     * costs if either cell has no cluster. Returns false if the goal is
+     * not reachable. Search state is kept in calling thread scratch
+     * buffers, queries do not allocate once the buffers have grown.
+     */
+    bool FindPath(
+        const FJCVDiagramMap& Map,
+        int32 StartIndex,
+        int32 GoalIndex,
+        TArray<int32>& OutPath,
+        float* OutCost = nullptr
+        ) const;
+};
@@ -130,8 +130,8 @@ public:
             if (! c0 || ! c1)
                 continue;
             // Ensure valid involved incident plates
-            const FTectonicPlate** pPlate0(plateMap.Find(c0->FeatureType));
-            const FTectonicPlate** pPlate1(plateMap.Find(c1->FeatureType));
+            const FTectonicPlate** pPlate0(plateMap.Find(c0->GetFeatureType()));
+            const FTectonicPlate** pPlate1(plateMap.Find(c1->GetFeatureType()));
             if (! pPlate0 || ! pPlate1 || pPlate0 == pPlate1)
                 continue;
             const FTectonicPlate& plate0(**pPlate0);
@@ -0,0 +1,463 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#pragma once
+
+#include "JCVDiagramTypes.h"
+
+// Static 2D tree over site positions for k-nearest and radius site queries.
+//
+// Nodes are stored implicitly, each range [Lo, Hi) is split at its median
+// node along the axis of the larger range extent. Queries do not allocate.
+//
+// Dynamic site updates remove tree nodes in place and keep inserted or
+// moved sites in a linearly searched node list until the next build.
+
+class FJCVSiteKDTree
+{
+    struct FNode
+    {
+        FJCVPoint Point;
+        int32 SiteIndex;
+        int32 Axis;
+    };
+
+    TArray<FNode> Nodes;
+
+    // Sites inserted or moved since the last build
+    TArray<FNode> ExtraNodes;
+
+    // Tree node per site index, extra nodes are stored as ~ExtraNodeIndex.
+    // Built on the first dynamic site update.
+    TArray<int32> SiteNodes;
+
+    // Removed tree node count, removed nodes have no site index
+    int32 RemovedCount = 0;
+
+public:
+
+    FORCEINLINE bool IsValid() const
+    {
+        return Num() > 0;
+    }
+
+    FORCEINLINE int32 Num() const
+    {
+        return Nodes.Num() - RemovedCount + ExtraNodes.Num();
+    }
+
+    FORCEINLINE void Empty()
+    {
+        Nodes.Empty();
+        ExtraNodes.Empty();
+        SiteNodes.Empty();
+        RemovedCount = 0;
+    }
+
+    FORCEINLINE SIZE_T GetAllocatedSize() const
+    {
+        return Nodes.GetAllocatedSize()
+            + ExtraNodes.GetAllocatedSize()
+            + SiteNodes.GetAllocatedSize();
+    }
+
+    void Build(const FJCVSite* Sites, int32 SiteCount)
+    {
+        Nodes.Reset();
+        ExtraNodes.Reset();
+        SiteNodes.Reset();
+        RemovedCount = 0;
+
+        if (! Sites || SiteCount <= 0)
+        {
+            return;
+        }
+
+        Nodes.SetNumUninitialized(SiteCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            FNode& Node(Nodes[i]);
+            Node.Point = Sites[i].p;
+            Node.SiteIndex = Sites[i].index;
+            Node.Axis = 0;
+        }
+
+        BuildRange(0, SiteCount);
+    }
+
+    /**
+     * Insert or move a site, see FJCVDiagramContext::InsertSite(). Site
+     * indices are required to be unique, inserted sites have the last
+     * site index.
+     *
+     * Return false if the tree requires a rebuild instead.
+     */
+    bool SetSite(int32 SiteIndex, const FJCVPoint& Point)
+    {
+        EnsureSiteNodes();
+
+        if (SiteIndex < SiteNodes.Num())
+        {
+            RemoveNode(SiteIndex);
+        }
+        else
+        {
+            check(SiteIndex == SiteNodes.Num());
+            SiteNodes.AddUninitialized();
+        }
+
+        FNode Node;
+        Node.Point = Point;
+        Node.SiteIndex = SiteIndex;
+        Node.Axis = 0;
+
+        SiteNodes[SiteIndex] = ~ExtraNodes.Num();
+        ExtraNodes.Emplace(Node);
+
+        return ! NeedsRebuild();
+    }
+
+    /**
+     * Remove a site, the last site is moved into the removed site index.
+     *
+     * Return false if the tree requires a rebuild instead.
+     */
+    bool RemoveSite(int32 SiteIndex)
+    {
+        EnsureSiteNodes();
+
+        const int32 LastIndex = SiteNodes.Num()-1;
+
+        RemoveNode(SiteIndex);
+
+        if (SiteIndex != LastIndex)
+        {
+            const int32 LastNode = SiteNodes[LastIndex];
+            GetSiteNode(LastNode).SiteIndex = SiteIndex;
+            SiteNodes[SiteIndex] = LastNode;
+        }
+
+        SiteNodes.Pop(false);
+
+        return ! NeedsRebuild();
+    }
+
+    /**
+     * Find up to K nearest sites. Output site indices and squared distances
+     * are sorted by distance, both buffers must hold at least K elements.
+     *
+     * Return the number of output sites.
+     */
+    int32 FindKNearest(const FVector2D& Pos, int32 K, int32* OutSiteIndices, float* OutDistSqr) const
+    {
+        if (! IsValid() || K <= 0)
+        {
+            return 0;
+        }
+
+        check(OutSiteIndices);
+        check(OutDistSqr);
+
+        const FJCVPoint Point(FJCVMathUtil::ToPt(Pos));
+
+        int32 Count = 0;
+        SearchKNearest(0, Nodes.Num(), Point, K, OutSiteIndices, OutDistSqr, Count);
+
+        for (const FNode& Node : ExtraNodes)
+        {
+            InsertNearest(Node, FJCVMathUtil::DistSqr(Node.Point, Point), K, OutSiteIndices, OutDistSqr, Count);
+        }
+
+        return Count;
+    }
+
+    /**
+     * Find up to K nearest sites into caller buffers.
+     * Buffer allocations are kept and only grow if required.
+     */
+    int32 FindKNearest(const FVector2D& Pos, int32 K, TArray<int32>& OutSiteIndices, TArray<float>& OutDistSqr) const
+    {
+        const int32 MaxCount = FMath::Min(FMath::Max(K, 0), Num());
+
+        OutSiteIndices.SetNumUninitialized(MaxCount, false);
+        OutDistSqr.SetNumUninitialized(MaxCount, false);
+
+        const int32 Count = FindKNearest(Pos, MaxCount, OutSiteIndices.GetData(), OutDistSqr.GetData());
+        check(Count == MaxCount);
+
+        return Count;
+    }
+
+    /**
+     * Visit every site within radius, callback receives the site index
+     * and squared distance of each site. Visit order is unspecified.
+     */
+    template<class FCallback>
+    void ForEachInRadius(const FVector2D& Pos, float Radius, const FCallback& Callback) const
+    {
+        if (IsValid() && Radius >= 0.f)
+        {
+            const FJCVPoint Point(FJCVMathUtil::ToPt(Pos));
+            const float RadiusSqr = Radius*Radius;
+
+            SearchRadius(0, Nodes.Num(), Point, RadiusSqr, Callback);
+
+            for (const FNode& Node : ExtraNodes)
+            {
+                const float DistSqr = FJCVMathUtil::DistSqr(Node.Point, Point);
+
+                if (DistSqr <= RadiusSqr)
+                {
+                    Callback(Node.SiteIndex, DistSqr);
+                }
+            }
+        }
+    }
+
+    /**
+     * Find all sites within radius into caller buffer.
+     * Buffer allocation is kept and only grows if required.
+     */
+    int32 FindSitesInRadius(const FVector2D& Pos, float Radius, TArray<int32>& OutSiteIndices) const
+    {
+        OutSiteIndices.Reset();
+        ForEachInRadius(Pos, Radius, [&OutSiteIndices](int32 SiteIndex, float DistSqr)
+        {
+            OutSiteIndices.Emplace(SiteIndex);
+        });
+        return OutSiteIndices.Num();
+    }
+
+private:
+
+    FORCEINLINE static float GetAxisValue(const FJCVPoint& Point, int32 Axis)
+    {
+        return Axis ? Point.y : Point.x;
+    }
+
+    FORCEINLINE FNode& GetSiteNode(int32 SiteNode)
+    {
+        return SiteNode >= 0 ? Nodes[SiteNode] : ExtraNodes[~SiteNode];
+    }
+
+    // Linear extra node search cost is kept within the square root of
+    // the tree size, rebuild cost is amortized over as many updates
+    FORCEINLINE bool NeedsRebuild() const
+    {
+        const int32 MaxStaleCount = FMath::Max(64, FMath::CeilToInt(FMath::Sqrt((float) Nodes.Num())));
+        return RemovedCount + ExtraNodes.Num() > MaxStaleCount;
+    }
+
+    void EnsureSiteNodes()
+    {
+        if (SiteNodes.Num() > 0 || Nodes.Num() == 0)
+        {
+            return;
+        }
+
+        SiteNodes.SetNumUninitialized(Nodes.Num());
+
+        for (int32 i=0; i<Nodes.Num(); ++i)
+        {
+            SiteNodes[Nodes[i].SiteIndex] = i;
+        }
+    }
+
+    void RemoveNode(int32 SiteIndex)
+    {
+        const int32 SiteNode = SiteNodes[SiteIndex];
+
+        if (SiteNode >= 0)
+        {
+            Nodes[SiteNode].SiteIndex = INDEX_NONE;
+            ++RemovedCount;
+        }
+        else
+        {
+            const int32 ExtraIndex = ~SiteNode;
+
+            ExtraNodes.RemoveAtSwap(ExtraIndex, 1, false);
+
+            if (ExtraIndex < ExtraNodes.Num())
+            {
+                SiteNodes[ExtraNodes[ExtraIndex].SiteIndex] = SiteNode;
+            }
+        }
+    }
+
+    // Sorted insertion into the output buffers
+    FORCEINLINE static void InsertNearest(const FNode& Node, float DistSqr, int32 K, int32* OutSiteIndices, float* OutDistSqr, int32& Count)
+    {
+        if (Count < K || DistSqr < OutDistSqr[Count-1])
+        {
+            int32 i = Count < K ? Count++ : K-1;
+
+            for (; i>0 && OutDistSqr[i-1] > DistSqr; --i)
+            {
+                OutSiteIndices[i] = OutSiteIndices[i-1];
+                OutDistSqr[i] = OutDistSqr[i-1];
+            }
+
+            OutSiteIndices[i] = Node.SiteIndex;
+            OutDistSqr[i] = DistSqr;
+        }
+    }
+
+    void BuildRange(int32 Lo, int32 Hi)
+    {
+        if (Hi-Lo <= 1)
+        {
+            return;
+        }
+
+        FBox2D Bounds(ForceInit);
+
+        for (int32 i=Lo; i<Hi; ++i)
+        {
+            Bounds += FJCVMathUtil::ToVector2D(Nodes[i].Point);
+        }
+
+        const FVector2D Extent(Bounds.GetSize());
+        const int32 Axis = Extent.Y > Extent.X ? 1 : 0;
+        const int32 Mid = (Lo+Hi) / 2;
+
+        SelectNth(Lo, Hi-1, Mid, Axis);
+
+        Nodes[Mid].Axis = Axis;
+
+        BuildRange(Lo, Mid);
+        BuildRange(Mid+1, Hi);
+    }
+
+    // Partition [Lo, Hi] so that the Nth node is in sorted axis order
+    void SelectNth(int32 Lo, int32 Hi, int32 Nth, int32 Axis)
+    {
+        while (Lo < Hi)
+        {
+            const float Pivot = GetAxisValue(Nodes[(Lo+Hi) / 2].Point, Axis);
+            int32 i = Lo;
+            int32 j = Hi;
+
+            while (i <= j)
+            {
+                while (GetAxisValue(Nodes[i].Point, Axis) < Pivot) ++i;
+                while (GetAxisValue(Nodes[j].Point, Axis) > Pivot) --j;
+
+                if (i <= j)
+                {
+                    Swap(Nodes[i], Nodes[j]);
+                    ++i;
+                    --j;
+                }
+            }
+
+            if (Nth <= j)
+            {
+                Hi = j;
+            }
+            else
+            if (Nth >= i)
+            {
+                Lo = i;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    void SearchKNearest(int32 Lo, int32 Hi, const FJCVPoint& Point, int32 K, int32* OutSiteIndices, float* OutDistSqr, int32& Count) const
+    {
+        if (Lo >= Hi)
+        {
+            return;
+        }
+
+        const int32 Mid = (Lo+Hi) / 2;
+        const FNode& Node(Nodes[Mid]);
+        const float DistSqr = FJCVMathUtil::DistSqr(Node.Point, Point);
+
+        // Removed nodes only split their range
+        if (Node.SiteIndex != INDEX_NONE)
+        {
+            InsertNearest(Node, DistSqr, K, OutSiteIndices, OutDistSqr, Count);
+        }
+
+        const float Delta = GetAxisValue(Point, Node.Axis) - GetAxisValue(Node.Point, Node.Axis);
+
+        if (Delta < 0.f)
+        {
+            SearchKNearest(Lo, Mid, Point, K, OutSiteIndices, OutDistSqr, Count);
+
+            if (Count < K || Delta*Delta < OutDistSqr[Count-1])
+            {
+                SearchKNearest(Mid+1, Hi, Point, K, OutSiteIndices, OutDistSqr, Count);
+            }
+        }
+        else
+        {
+            SearchKNearest(Mid+1, Hi, Point, K, OutSiteIndices, OutDistSqr, Count);
+
+            if (Count < K || Delta*Delta < OutDistSqr[Count-1])
+            {
+                SearchKNearest(Lo, Mid, Point, K, OutSiteIndices, OutDistSqr, Count);
+            }
+        }
+    }
+
+    template<class FCallback>
+    void SearchRadius(int32 Lo, int32 Hi, const FJCVPoint& Point, float RadiusSqr, const FCallback& Callback) const
+    {
+        if (Lo >= Hi)
+        {
+            return;
+        }
+
+        const int32 Mid = (Lo+Hi) / 2;
+        const FNode& Node(Nodes[Mid]);
+        const float DistSqr = FJCVMathUtil::DistSqr(Node.Point, Point);
+
+        if (DistSqr <= RadiusSqr && Node.SiteIndex != INDEX_NONE)
+        {
+            Callback(Node.SiteIndex, DistSqr);
+        }
+
+        const float Delta = GetAxisValue(Point, Node.Axis) - GetAxisValue(Node.Point, Node.Axis);
+
+        if (Delta <= 0.f || Delta*Delta <= RadiusSqr)
+        {
+            SearchRadius(Lo, Mid, Point, RadiusSqr, Callback);
+        }
+
+        if (Delta >= 0.f || Delta*Delta <= RadiusSqr)
+        {
+            SearchRadius(Mid+1, Hi, Point, RadiusSqr, Callback);
+        }
+    }
+};
@@ -55,8 +55,29 @@ public class JCVoronoiPlugin: ModuleRules
         string JCVLib = Path.Combine(JCVPath, "lib");
 
         PublicIncludePaths.Add(Path.GetFullPath(JCVInclude));
-        PublicLibraryPaths.Add(Path.GetFullPath(JCVLib));
 
-        PublicAdditionalLibraries.Add("JCVoronoi.lib");
+        // -- JCV implementation
+        //
+        // jc_voronoi is compiled with the module from the vendored
+        // implementation (JCVoronoiLibrary.cpp). The prebuilt library is
+        // only available for Windows and is kept for comparison builds.
+
+        bool bUsePrebuiltJCV = false;
+
+        bool bIsWindows = (
+            Target.Platform == UnrealTargetPlatform.Win64 ||
+            Target.Platform == UnrealTargetPlatform.Win32
+            );
+
+        if (bUsePrebuiltJCV && bIsWindows)
+        {
+            PublicLibraryPaths.Add(Path.GetFullPath(JCVLib));
+            PublicAdditionalLibraries.Add("JCVoronoi.lib");
+            PublicDefinitions.Add("JCV_USE_PREBUILT_LIB=1");
+        }
+        else
+        {
+            PublicDefinitions.Add("JCV_USE_PREBUILT_LIB=0");
+        }
     }
 }
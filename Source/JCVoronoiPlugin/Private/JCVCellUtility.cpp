@@ -39,55 +39,49 @@ void FJCVCellUtility::PointFillVisit(
         return;
     }
 
-    TQueue<FJCVCell*> CellVisitQueue;
-    TSet<FJCVCell*> VisitedCellSet;
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+    FJCVCellVisitScope Visited(Map.GetVisitStamp(), Map.Num());
+    TArray<int32>& CellVisitQueue(Visited->GetQueue());
 
     // Visit starting cells, filter invalid and duplicate cells
     for (FJCVCell* c : OriginCells)
     {
-        if (c && ! VisitedCellSet.Contains(c))
+        if (c && Visited->TryVisit(c->GetIndex()))
         {
-            CellVisitQueue.Enqueue(c);
-            VisitedCellSet.Emplace(c);
+            CellVisitQueue.Emplace(c->GetIndex());
         }
     }
 
     // Visit cells in queue
-    while (! CellVisitQueue.IsEmpty())
+    for (int32 QueueIndex=0; QueueIndex<CellVisitQueue.Num(); ++QueueIndex)
     {
-        FJCVCell* Cell;
-        CellVisitQueue.Dequeue(Cell);
-
-        check(Cell != nullptr);
+        const int32 CellIndex = CellVisitQueue[QueueIndex];
+        const int32 EntryEnd = Adjacency.GetEntryEnd(CellIndex);
 
-        FJCVEdge* g = Cell->GetEdge();
-        check(g);
+        FJCVCell& Cell(Map.GetCell(CellIndex));
 
-        do
+        for (int32 Entry=Adjacency.GetEntryBegin(CellIndex); Entry<EntryEnd; ++Entry)
         {
-            FJCVCell* NeighbourCell = Map.GetCellNeighbour(g);
+            const int32 NeighbourIndex = Adjacency.GetEntryNeighbour(Entry);
 
-            //  Invalid neighbour or already visited cell, skip
-            if (! NeighbourCell || VisitedCellSet.Contains(NeighbourCell))
+            //  Already visited cell, skip. Otherwise, mark visited.
+            if (! Visited->TryVisit(NeighbourIndex))
             {
                 continue;
             }
 
-            check(g != nullptr);
-
-            // Add cell to the visited set
-            VisitedCellSet.Emplace(NeighbourCell);
+            FJCVCell& NeighbourCell(Map.GetCell(NeighbourIndex));
 
             // Call visit callback
-            bool bEnqueueCellVisit = VisitCallback(*Cell, *NeighbourCell, *g);
+            bool bEnqueueCellVisit = VisitCallback(Cell, NeighbourCell, *Adjacency.GetEntryEdge(Entry));
 
             // If visit callback return true, enqueue current neighbouring cell
             if (bEnqueueCellVisit)
             {
-                CellVisitQueue.Enqueue(NeighbourCell);
+                CellVisitQueue.Emplace(NeighbourIndex);
             }
         }
-        while ((g = g->next) != nullptr);
     }
 }
 
@@ -103,58 +97,61 @@ void FJCVCellUtility::ExpandVisit(
         return;
     }
 
-    TSet<FJCVCell*> VisitedCellSet;
-    TArray<FJCVCell*> CellVisitList;
-    TArray<FJCVCell*> CellVisitNextList;
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+    // Single visit queue, each expansion visits the cells
+    // enqueued by the previous expansion
+
+    FJCVCellVisitScope Visited(Map.GetVisitStamp(), Map.Num());
+    TArray<int32>& CellVisitQueue(Visited->GetQueue());
 
     // Visit starting cells, filter invalid and duplicate cells
     for (FJCVCell* c : OriginCells)
     {
-        if (c && ! VisitedCellSet.Contains(c))
+        if (c && Visited->TryVisit(c->GetIndex()))
         {
-            CellVisitList.Emplace(c);
-            VisitedCellSet.Emplace(c);
+            CellVisitQueue.Emplace(c->GetIndex());
         }
     }
 
+    int32 VisitBegin = 0;
+
     for (int32 It=0; It<ExpandCount; ++It)
     {
-        // Visit cells in list
-        for (int32 i=0; i<CellVisitList.Num(); ++i)
-        {
-            FJCVCell* Cell = CellVisitList[i];
+        const int32 VisitEnd = CellVisitQueue.Num();
 
-            check(Cell != nullptr);
+        // Visit cells enqueued by the previous expansion
+        for (int32 i=VisitBegin; i<VisitEnd; ++i)
+        {
+            const int32 CellIndex = CellVisitQueue[i];
+            const int32 EntryEnd = Adjacency.GetEntryEnd(CellIndex);
 
-            FJCVEdge* g = Cell->GetEdge();
-            check(g);
+            FJCVCell& Cell(Map.GetCell(CellIndex));
 
-            do
+            for (int32 Entry=Adjacency.GetEntryBegin(CellIndex); Entry<EntryEnd; ++Entry)
             {
-                FJCVCell* NeighbourCell = Map.GetCellNeighbour(g);
+                const int32 NeighbourIndex = Adjacency.GetEntryNeighbour(Entry);
 
-                //  Invalid neighbour or already visited cell, skip
-                if (! NeighbourCell || VisitedCellSet.Contains(NeighbourCell))
+                //  Already visited cell, skip. Otherwise, mark visited.
+                if (! Visited->TryVisit(NeighbourIndex))
                 {
                     continue;
                 }
 
-                // Add cell to the visited set
-                VisitedCellSet.Emplace(NeighbourCell);
+                FJCVCell& NeighbourCell(Map.GetCell(NeighbourIndex));
 
                 // Call visit callback
-                bool bEnqueueCellVisit = VisitCallback(*Cell, *NeighbourCell, *g);
+                bool bEnqueueCellVisit = VisitCallback(Cell, NeighbourCell, *Adjacency.GetEntryEdge(Entry));
 
                 // If visit callback return true, enqueue current neighbouring cell
                 if (bEnqueueCellVisit)
                 {
-                    CellVisitNextList.Emplace(NeighbourCell);
+                    CellVisitQueue.Emplace(NeighbourIndex);
                 }
             }
-            while ((g = g->next) != nullptr);
         }
 
-        CellVisitList = MoveTemp(CellVisitNextList);
+        VisitBegin = VisitEnd;
     }
 }
 
@@ -0,0 +1,1663 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+
+#include "JCVDiagram.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeBool.h"
+
+namespace JCVDiagramTiled
+{
+    struct FTile
+    {
+        FBox2D CoreBounds;
+        FBox2D HaloBounds;
+
+        // Tile input points and their index in the source point array
+        TArray<FJCVPoint> Points;
+        TArray<int32> PointIndices;
+        TArray<bool> CorePoints;
+
+        // Tile diagram and its resolved core sites
+        FJCVDiagramArena Arena;
+        FJCVDiagram Diagram;
+        TArray<const FJCVSite*> CoreSites;
+        int32 EdgeCount = 0;
+
+        // Offsets into the stitched diagram
+        int32 SiteOffset = 0;
+        int32 EdgeOffset = 0;
+    };
+
+    FORCEINLINE int32 GetTileCoord(float V, float Min, float TileSize, int32 TileCount)
+    {
+        return FMath::Clamp(FMath::FloorToInt((V-Min) / TileSize), 0, TileCount-1);
+    }
+
+    // A cell is resolved within the tile if the empty circle of each
+    // vertex is contained by the tile halo bounds. Halo sides that lie on
+    // the diagram bounds do not constrain the cell.
+    bool IsResolved(const FJCVSite& Site, const FBox2D& HaloBounds, const FBox2D& Bounds)
+    {
+        const bool bCheckMinX = HaloBounds.Min.X > Bounds.Min.X;
+        const bool bCheckMinY = HaloBounds.Min.Y > Bounds.Min.Y;
+        const bool bCheckMaxX = HaloBounds.Max.X < Bounds.Max.X;
+        const bool bCheckMaxY = HaloBounds.Max.Y < Bounds.Max.Y;
+
+        for (const FJCVEdge* g = Site.edges; g; g = g->next)
+        {
+            const FJCVPoint& v(g->pos[0]);
+            const float RadiusSq = FJCVMathUtil::DistSqr(v, Site.p);
+
+            if ((bCheckMinX && FMath::Square(v.x-HaloBounds.Min.X) < RadiusSq) ||
+                (bCheckMinY && FMath::Square(v.y-HaloBounds.Min.Y) < RadiusSq) ||
+                (bCheckMaxX && FMath::Square(HaloBounds.Max.X-v.x) < RadiusSq) ||
+                (bCheckMaxY && FMath::Square(HaloBounds.Max.Y-v.y) < RadiusSq))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+void FJCVDiagramContext::GenerateDiagramTiled(const FBox2D& Bounds, TArrayView<const FVector2D> InPoints, FIntPoint TileCount, float Halo)
+{
+    using namespace JCVDiagramTiled;
+
+    check(Bounds.Min.X <= Bounds.Max.X && Bounds.Min.Y <= Bounds.Max.Y);
+    check(Diagram.IsValid());
+
+    const int32 PointCount = InPoints.Num();
+
+    if (PointCount == 0)
+        return;
+
+    TileCount.X = FMath::Max(1, TileCount.X);
+    TileCount.Y = FMath::Max(1, TileCount.Y);
+
+    const int32 TileNum = TileCount.X * TileCount.Y;
+
+    // Single tile, use single pass generation
+    if (TileNum == 1)
+    {
+        GenerateDiagram(Bounds, InPoints);
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_GenerateDiagramTiled);
+
+    const FVector2D BoundsSize(Bounds.GetSize());
+    const FVector2D TileSize(BoundsSize.X / TileCount.X, BoundsSize.Y / TileCount.Y);
+
+    // Default halo, a few times the average point spacing
+    if (Halo <= 0.f)
+    {
+        Halo = 4.f * FMath::Sqrt((BoundsSize.X*BoundsSize.Y) / PointCount);
+    }
+
+    TArray<FTile> Tiles;
+    Tiles.SetNum(TileNum);
+
+    for (int32 ty=0; ty<TileCount.Y; ++ty)
+    for (int32 tx=0; tx<TileCount.X; ++tx)
+    {
+        FTile& Tile(Tiles[tx + ty*TileCount.X]);
+        const FVector2D TileMin(Bounds.Min + FVector2D(tx*TileSize.X, ty*TileSize.Y));
+        Tile.CoreBounds = FBox2D(TileMin, TileMin+TileSize);
+        Tile.HaloBounds = FBox2D(
+            (Tile.CoreBounds.Min-Halo).ComponentMax(Bounds.Min),
+            (Tile.CoreBounds.Max+Halo).ComponentMin(Bounds.Max)
+            );
+    }
+
+    // Bin points to tiles, each point belongs to the core of a single tile
+    // and to the halo of its surrounding tiles. Points on the bounds are
+    // kept, matching jcv input pruning.
+
+    auto IsWithinBounds = [&](const FVector2D& Point)
+    {
+        return Point.X >= Bounds.Min.X && Point.X <= Bounds.Max.X
+            && Point.Y >= Bounds.Min.Y && Point.Y <= Bounds.Max.Y;
+    };
+
+    auto VisitPointTiles = [&](const FVector2D& Point, TFunctionRef<void(int32, bool)> Callback)
+    {
+        const int32 cx = GetTileCoord(Point.X, Bounds.Min.X, TileSize.X, TileCount.X);
+        const int32 cy = GetTileCoord(Point.Y, Bounds.Min.Y, TileSize.Y, TileCount.Y);
+        const int32 x0 = GetTileCoord(Point.X-Halo, Bounds.Min.X, TileSize.X, TileCount.X);
+        const int32 y0 = GetTileCoord(Point.Y-Halo, Bounds.Min.Y, TileSize.Y, TileCount.Y);
+        const int32 x1 = GetTileCoord(Point.X+Halo, Bounds.Min.X, TileSize.X, TileCount.X);
+        const int32 y1 = GetTileCoord(Point.Y+Halo, Bounds.Min.Y, TileSize.Y, TileCount.Y);
+
+        for (int32 ty=y0; ty<=y1; ++ty)
+        for (int32 tx=x0; tx<=x1; ++tx)
+        {
+            Callback(tx + ty*TileCount.X, tx == cx && ty == cy);
+        }
+    };
+
+    {
+        TArray<int32> TilePointCounts;
+        TilePointCounts.SetNumZeroed(TileNum);
+
+        for (const FVector2D& Point : InPoints)
+        {
+            if (IsWithinBounds(Point))
+            {
+                VisitPointTiles(Point, [&](int32 ti, bool) { ++TilePointCounts[ti]; });
+            }
+        }
+
+        for (int32 ti=0; ti<TileNum; ++ti)
+        {
+            Tiles[ti].Points.Reserve(TilePointCounts[ti]);
+            Tiles[ti].PointIndices.Reserve(TilePointCounts[ti]);
+            Tiles[ti].CorePoints.Reserve(TilePointCounts[ti]);
+        }
+
+        for (int32 i=0; i<PointCount; ++i)
+        {
+            const FVector2D& Point(InPoints[i]);
+
+            if (IsWithinBounds(Point))
+            {
+                VisitPointTiles(Point, [&](int32 ti, bool bIsCore)
+                {
+                    FTile& Tile(Tiles[ti]);
+                    Tile.Points.Emplace(FJCVMathUtil::ToPt(Point));
+                    Tile.PointIndices.Emplace(i);
+                    Tile.CorePoints.Emplace(bIsCore);
+                } );
+            }
+        }
+    }
+
+    // Generate tile diagrams and resolve tile core sites
+
+    FThreadSafeBool bIsResolved(true);
+
+    ParallelFor(TileNum, [&](int32 ti)
+    {
+        FTile& Tile(Tiles[ti]);
+
+        FMemory::Memset(&Tile.Diagram, 0, sizeof(FJCVDiagram));
+
+        if (Tile.Points.Num() == 0)
+            return;
+
+        jcv_rect JCVBounds;
+        JCVBounds.min.x = Tile.HaloBounds.Min.X;
+        JCVBounds.min.y = Tile.HaloBounds.Min.Y;
+        JCVBounds.max.x = Tile.HaloBounds.Max.X;
+        JCVBounds.max.y = Tile.HaloBounds.Max.Y;
+
+        jcv_diagram_generate_useralloc(
+            Tile.Points.Num(),
+            Tile.Points.GetData(),
+            &JCVBounds,
+            &Tile.Arena,
+            jcv_alloc_fn,
+            jcv_free_fn,
+            &Tile.Diagram
+            );
+
+        const FJCVSite* TileSites = jcv_diagram_get_sites(&Tile.Diagram);
+        const int32 TileSiteNum = Tile.Diagram.numsites;
+
+        Tile.CoreSites.Reserve(TileSiteNum);
+
+        for (int32 i=0; i<TileSiteNum; ++i)
+        {
+            const FJCVSite& Site(TileSites[i]);
+
+            if (! Tile.CorePoints[Site.index])
+                continue;
+
+            if (! IsResolved(Site, Tile.HaloBounds, Bounds))
+            {
+                bIsResolved = false;
+                return;
+            }
+
+            for (const FJCVEdge* g = Site.edges; g; g = g->next)
+            {
+                ++Tile.EdgeCount;
+            }
+
+            Tile.CoreSites.Emplace(&Site);
+        }
+    } );
+
+    if (! bIsResolved)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::GenerateDiagramTiled() TILE HALO (%f) TOO SMALL, FALLBACK TO SINGLE PASS GENERATION"), Halo);
+        Tiles.Empty();
+        GenerateDiagram(Bounds, InPoints);
+        return;
+    }
+
+    // Allocate stitched diagram
+
+    int32 SiteNum = 0;
+    int32 EdgeNum = 0;
+
+    for (FTile& Tile : Tiles)
+    {
+        Tile.SiteOffset = SiteNum;
+        Tile.EdgeOffset = EdgeNum;
+        SiteNum += Tile.CoreSites.Num();
+        EdgeNum += Tile.EdgeCount;
+    }
+
+    ResetArena();
+
+    FJCVSite* DstSites = static_cast<FJCVSite*>(Arena.Allocate(sizeof(FJCVSite) * FMath::Max(1, SiteNum)));
+    FJCVEdge* DstGraphEdges = static_cast<FJCVEdge*>(Arena.Allocate(sizeof(FJCVEdge) * FMath::Max(1, EdgeNum)));
+    jcv_edge* DstEdges = static_cast<jcv_edge*>(Arena.Allocate(sizeof(jcv_edge) * FMath::Max(1, EdgeNum)));
+
+    // Map source point index to stitched site index
+
+    TArray<int32> SiteMap;
+    SiteMap.Init(INDEX_NONE, PointCount);
+
+    ParallelFor(TileNum, [&](int32 ti)
+    {
+        const FTile& Tile(Tiles[ti]);
+        for (int32 i=0; i<Tile.CoreSites.Num(); ++i)
+        {
+            SiteMap[Tile.PointIndices[Tile.CoreSites[i]->index]] = Tile.SiteOffset + i;
+        }
+    } );
+
+    // Stitch tile core sites, neighbour links are remapped to stitched sites
+
+    FThreadSafeBool bIsStitched(true);
+
+    ParallelFor(TileNum, [&](int32 ti)
+    {
+        const FTile& Tile(Tiles[ti]);
+
+        FJCVSite* DstSite = DstSites + Tile.SiteOffset;
+        FJCVEdge* DstGraphEdge = DstGraphEdges + Tile.EdgeOffset;
+        jcv_edge* DstEdge = DstEdges + Tile.EdgeOffset;
+
+        for (const FJCVSite* SrcSite : Tile.CoreSites)
+        {
+            DstSite->p = SrcSite->p;
+            DstSite->index = Tile.PointIndices[SrcSite->index];
+            DstSite->edges = nullptr;
+
+            FJCVEdge* PrevGraphEdge = nullptr;
+
+            for (const FJCVEdge* g = SrcSite->edges; g; g = g->next)
+            {
+                FJCVSite* Neighbour = nullptr;
+
+                if (g->neighbor)
+                {
+                    const int32 SiteIndex = SiteMap[Tile.PointIndices[g->neighbor->index]];
+
+                    if (SiteIndex == INDEX_NONE)
+                    {
+                        bIsStitched = false;
+                        return;
+                    }
+
+                    Neighbour = DstSites + SiteIndex;
+                }
+
+                DstEdge->next = nullptr;
+                DstEdge->sites[0] = DstSite;
+                DstEdge->sites[1] = Neighbour;
+                DstEdge->pos[0] = g->pos[0];
+                DstEdge->pos[1] = g->pos[1];
+                DstEdge->a = g->edge->a;
+                DstEdge->b = g->edge->b;
+                DstEdge->c = g->edge->c;
+
+                DstGraphEdge->next = nullptr;
+                DstGraphEdge->edge = DstEdge;
+                DstGraphEdge->neighbor = Neighbour;
+                DstGraphEdge->pos[0] = g->pos[0];
+                DstGraphEdge->pos[1] = g->pos[1];
+                DstGraphEdge->angle = g->angle;
+
+                if (PrevGraphEdge)
+                {
+                    PrevGraphEdge->next = DstGraphEdge;
+                }
+                else
+                {
+                    DstSite->edges = DstGraphEdge;
+                }
+
+                PrevGraphEdge = DstGraphEdge;
+
+                ++DstGraphEdge;
+                ++DstEdge;
+            }
+
+            ++DstSite;
+        }
+    } );
+
+    if (! bIsStitched)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::GenerateDiagramTiled() UNRESOLVED TILE NEIGHBOUR, FALLBACK TO SINGLE PASS GENERATION"));
+        Tiles.Empty();
+        GenerateDiagram(Bounds, InPoints);
+        return;
+    }
+
+    // Edge list, each edge shared by two sites is listed once
+
+    jcv_edge* EdgeList = nullptr;
+
+    for (int32 i=EdgeNum-1; i>=0; --i)
+    {
+        jcv_edge& Edge(DstEdges[i]);
+
+        if (! Edge.sites[1] || Edge.sites[0]->index < Edge.sites[1]->index)
+        {
+            Edge.next = EdgeList;
+            EdgeList = &Edge;
+        }
+    }
+
+    FJCVDiagram& StitchedDiagram(*Diagram.Get());
+    StitchedDiagram.internal = nullptr;
+    StitchedDiagram.edges = EdgeList;
+    StitchedDiagram.sites = DstSites;
+    StitchedDiagram.numsites = SiteNum;
+    StitchedDiagram.min.x = Bounds.Min.X;
+    StitchedDiagram.min.y = Bounds.Min.Y;
+    StitchedDiagram.max.x = Bounds.Max.X;
+    StitchedDiagram.max.y = Bounds.Max.Y;
+
+    DiagramBounds = Bounds;
+    Sites = DstSites;
+
+    SET_MEMORY_STAT(STAT_JCV_ArenaPeakBytes, Arena.GetPeakBytes());
+    INC_DWORD_STAT_BY(STAT_JCV_GeneratedSites, SiteNum);
+}
+
+bool FJCVDiagramContext::HasEqualNeighbours(const FJCVDiagramContext& Other) const
+{
+    const int32 SiteCount = GetSiteNum();
+
+    if (SiteCount != Other.GetSiteNum())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::HasEqualNeighbours() SITE COUNT MISMATCH (%d != %d)"), SiteCount, Other.GetSiteNum());
+        return false;
+    }
+
+    // Sorted neighbour indices by site index
+
+    auto GetNeighbourIndices = [](const FJCVDiagramContext& Context, TArray<TArray<int32>>& OutIndices)
+    {
+        const int32 Num = Context.GetSiteNum();
+        OutIndices.SetNum(Num);
+
+        for (int32 i=0; i<Num; ++i)
+        {
+            const FJCVSite& Site(Context.Site(i));
+
+            if (! OutIndices.IsValidIndex(Site.index))
+                continue;
+
+            TArray<int32>& Indices(OutIndices[Site.index]);
+
+            for (const FJCVEdge* g = Site.edges; g; g = g->next)
+            {
+                if (g->neighbor)
+                {
+                    Indices.Emplace(g->neighbor->index);
+                }
+            }
+
+            Indices.Sort();
+        }
+    };
+
+    TArray<TArray<int32>> Indices0;
+    TArray<TArray<int32>> Indices1;
+
+    GetNeighbourIndices(*this, Indices0);
+    GetNeighbourIndices(Other, Indices1);
+
+    int32 MismatchCount = 0;
+
+    for (int32 i=0; i<SiteCount; ++i)
+    {
+        if (Indices0[i] != Indices1[i])
+        {
+            ++MismatchCount;
+        }
+    }
+
+    if (MismatchCount > 0)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::HasEqualNeighbours() %d SITE NEIGHBOUR SETS MISMATCH"), MismatchCount);
+    }
+
+    return MismatchCount == 0;
+}
+
+// -- SEARCH INDEX
+
+void FJCVDiagramContext::BuildSiteGrid() const
+{
+    FScopeLock ScopeLock(&SearchIndexLock);
+
+    if (bSiteGridBuilt)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_BuildSiteGrid);
+
+    SiteGrid.Build(DiagramBounds, GetSites(), GetSiteNum());
+    bSiteGridBuilt = true;
+}
+
+void FJCVDiagramContext::BuildSiteTree() const
+{
+    FScopeLock ScopeLock(&SearchIndexLock);
+
+    if (bSiteTreeBuilt)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_BuildSiteTree);
+
+    SiteTree.Build(GetSites(), GetSiteNum());
+    bSiteTreeBuilt = true;
+}
+
+void FJCVDiagramContext::BuildCellPolygons() const
+{
+    FScopeLock ScopeLock(&SearchIndexLock);
+
+    if (bCellPolygonsBuilt)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_BuildCellPolygons);
+
+    CellPolygons.Build(GetSites(), GetSiteNum());
+    bCellPolygonsBuilt = true;
+}
+
+FJCVCellVisitStamp& FJCVCellVisitStamp::AcquireThreadLocal()
+{
+    // Pool grows with traversal nesting depth
+    static thread_local TArray<TUniquePtr<FJCVCellVisitStamp>> StampPool;
+
+    for (TUniquePtr<FJCVCellVisitStamp>& Stamp : StampPool)
+    {
+        if (! Stamp->IsInUse())
+        {
+            return *Stamp;
+        }
+    }
+
+    StampPool.Emplace(MakeUnique<FJCVCellVisitStamp>());
+    return *StampPool.Last();
+}
+
+void FJCVDiagramContext::BuildAdjacency() const
+{
+    FScopeLock ScopeLock(&SearchIndexLock);
+
+    if (bAdjacencyBuilt)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_BuildAdjacency);
+
+    Adjacency.Build(GetSites(), GetSiteNum());
+    bAdjacencyBuilt = true;
+}
+
+namespace JCVDiagramBatch
+{
+    // Interleave the lower 16 bits of X and Y
+    FORCEINLINE uint32 GetMortonCode(uint32 X, uint32 Y)
+    {
+        auto Part1By1 = [](uint32 v)
+        {
+            v &= 0x0000FFFF;
+            v = (v | (v << 8)) & 0x00FF00FF;
+            v = (v | (v << 4)) & 0x0F0F0F0F;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        return Part1By1(X) | (Part1By1(Y) << 1);
+    }
+
+    // LSD radix sort of keys by their upper 32 bits
+    void SortByUpperKey(TArray<uint64>& Keys, TArray<uint64>& Buffer)
+    {
+        const int32 KeyCount = Keys.Num();
+        Buffer.SetNumUninitialized(KeyCount, false);
+
+        uint64* Src = Keys.GetData();
+        uint64* Dst = Buffer.GetData();
+
+        for (int32 Shift=32; Shift<64; Shift+=8)
+        {
+            int32 Offsets[256] = { 0 };
+
+            for (int32 i=0; i<KeyCount; ++i)
+            {
+                ++Offsets[(Src[i] >> Shift) & 0xFF];
+            }
+
+            int32 Sum = 0;
+            for (int32& Offset : Offsets)
+            {
+                const int32 Count = Offset;
+                Offset = Sum;
+                Sum += Count;
+            }
+
+            for (int32 i=0; i<KeyCount; ++i)
+            {
+                Dst[Offsets[(Src[i] >> Shift) & 0xFF]++] = Src[i];
+            }
+
+            Swap(Src, Dst);
+        }
+
+        // Even pass count, sorted keys end up in the source array
+        check(Src == Keys.GetData());
+    }
+}
+
+void FJCVDiagramContext::FindCellsBatch(TArrayView<const FVector2D> Points, TArrayView<int32> OutCellIndices) const
+{
+    using namespace JCVDiagramBatch;
+
+    check(Points.Num() == OutCellIndices.Num());
+
+    const int32 PointCount = Points.Num();
+
+    if (IsEmpty())
+    {
+        for (int32& CellIndex : OutCellIndices)
+        {
+            CellIndex = INDEX_NONE;
+        }
+        return;
+    }
+
+    if (PointCount <= 0)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_FindCellsBatch);
+
+    // Morton ordered query keys, Morton code on upper bits, point index on lower bits
+
+    const FVector2D BoundsMin(DiagramBounds.Min);
+    const FVector2D BoundsSize(DiagramBounds.GetSize().ComponentMax(FVector2D(KINDA_SMALL_NUMBER, KINDA_SMALL_NUMBER)));
+    const FVector2D QuantizeScale(FVector2D(65535.f, 65535.f) / BoundsSize);
+
+    TArray<uint64> Keys;
+    TArray<uint64> KeyBuffer;
+    Keys.SetNumUninitialized(PointCount);
+
+    for (int32 i=0; i<PointCount; ++i)
+    {
+        const FVector2D Q((Points[i]-BoundsMin) * QuantizeScale);
+        const uint32 X = (uint32) FMath::Clamp(FMath::FloorToInt(Q.X), 0, 65535);
+        const uint32 Y = (uint32) FMath::Clamp(FMath::FloorToInt(Q.Y), 0, 65535);
+        Keys[i] = (uint64(GetMortonCode(X, Y)) << 32) | uint32(i);
+    }
+
+    SortByUpperKey(Keys, KeyBuffer);
+
+    // Walk each chunk from its first query grid seed, then from the last hit
+
+    const int32 ChunkSize = 4096;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(PointCount, ChunkSize);
+
+    // Build search index before spawning workers
+    GetSearchSeed(Points[0]);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 QueryStart = ci * ChunkSize;
+        const int32 QueryEnd = FMath::Min(QueryStart+ChunkSize, PointCount);
+
+        const FJCVSite* s = GetSearchSeed(Points[uint32(Keys[QueryStart])]);
+
+        for (int32 qi=QueryStart; qi<QueryEnd; ++qi)
+        {
+            const int32 PointIndex = uint32(Keys[qi]);
+            const FJCVPoint p(FJCVMathUtil::ToPt(Points[PointIndex]));
+
+            while (const FJCVSite* s1 = FindCloser(*s, p))
+            {
+                s = s1;
+            }
+
+            OutCellIndices[PointIndex] = s->index;
+        }
+    });
+}
+
+// -- RELAXATION
+
+namespace JCVDiagramRelax
+{
+    // Polygon centroid of a closed cell, computed relative to the site
+    // origin for precision. Degenerate cells keep the site origin.
+    FORCEINLINE FJCVPoint GetCellCentroid(const FJCVSite& Site)
+    {
+        const FJCVPoint& o(Site.p);
+
+        float Area = 0.f;
+        float Cx = 0.f;
+        float Cy = 0.f;
+
+        for (const FJCVEdge* g = Site.edges; g; g = g->next)
+        {
+            const float x0 = g->pos[0].x - o.x;
+            const float y0 = g->pos[0].y - o.y;
+            const float x1 = g->pos[1].x - o.x;
+            const float y1 = g->pos[1].y - o.y;
+            const float Cross = x0*y1 - x1*y0;
+
+            Area += Cross;
+            Cx += (x0+x1) * Cross;
+            Cy += (y0+y1) * Cross;
+        }
+
+        if (FMath::Abs(Area) <= SMALL_NUMBER)
+        {
+            return o;
+        }
+
+        const float InvArea3 = 1.f / (3.f * Area);
+
+        FJCVPoint Centroid;
+        Centroid.x = o.x + Cx * InvArea3;
+        Centroid.y = o.y + Cy * InvArea3;
+        return Centroid;
+    }
+}
+
+int32 FJCVDiagramContext::RelaxDiagram(int32 Iterations, float ConvergenceThreshold)
+{
+    using namespace JCVDiagramRelax;
+
+    if (IsEmpty() || Iterations <= 0)
+    {
+        return 0;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_RelaxDiagram);
+
+    const int32 SiteCount = GetSiteNum();
+    const FBox2D Bounds(DiagramBounds);
+    const float ThresholdSqr = FMath::Square(FMath::Max(0.f, ConvergenceThreshold));
+
+    // Keep site indices if they map to the point buffer, otherwise
+    // relaxed points are ordered by site order
+
+    bool bKeepIndices = true;
+
+    for (int32 i=0; i<SiteCount; ++i)
+    {
+        if (Site(i).index < 0 || Site(i).index >= SiteCount)
+        {
+            bKeepIndices = false;
+            break;
+        }
+    }
+
+    // Point and chunk buffers are reused between iterations, diagram memory
+    // is reused through the arena
+
+    const int32 ChunkSize = 1024;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(SiteCount, ChunkSize);
+
+    TArray<FJCVPoint> Points;
+    TArray<float> ChunkMaxDistSqr;
+
+    Points.SetNumUninitialized(SiteCount);
+    ChunkMaxDistSqr.SetNumUninitialized(ChunkCount);
+
+    int32 Iteration = 0;
+
+    for (; Iteration<Iterations; ++Iteration)
+    {
+        check(GetSiteNum() == SiteCount);
+
+        ParallelFor(ChunkCount, [&](int32 ci)
+        {
+            const int32 SiteStart = ci * ChunkSize;
+            const int32 SiteEnd = FMath::Min(SiteStart+ChunkSize, SiteCount);
+
+            float MaxDistSqr = 0.f;
+
+            for (int32 i=SiteStart; i<SiteEnd; ++i)
+            {
+                const FJCVSite& s(Site(i));
+
+                FJCVPoint Centroid(GetCellCentroid(s));
+                Centroid.x = FMath::Clamp(Centroid.x, Bounds.Min.X, Bounds.Max.X);
+                Centroid.y = FMath::Clamp(Centroid.y, Bounds.Min.Y, Bounds.Max.Y);
+
+                MaxDistSqr = FMath::Max(MaxDistSqr, FJCVMathUtil::DistSqr(s.p, Centroid));
+
+                Points[bKeepIndices ? s.index : i] = Centroid;
+            }
+
+            ChunkMaxDistSqr[ci] = MaxDistSqr;
+        });
+
+        float MaxDistSqr = 0.f;
+
+        for (float ChunkDistSqr : ChunkMaxDistSqr)
+        {
+            MaxDistSqr = FMath::Max(MaxDistSqr, ChunkDistSqr);
+        }
+
+        // Converged, current diagram is within threshold of its centroids
+
+        if (MaxDistSqr <= ThresholdSqr)
+        {
+            break;
+        }
+
+        GenerateDiagram(Bounds, TArrayView<const FJCVPoint>(Points));
+
+        // Centroids of disjoint cells are unique, sites should never be pruned
+        if (GetSiteNum() != SiteCount)
+        {
+            UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::RelaxDiagram() ABORTED, RELAXED SITES PRUNED"));
+            ++Iteration;
+            break;
+        }
+    }
+
+    return Iteration;
+}
+
+// -- DYNAMIC SITE OPERATIONS
+
+namespace JCVDiagramDynamic
+{
+    FORCEINLINE bool IsWithinBounds(const FBox2D& Bounds, const FVector2D& Point)
+    {
+        return Point.X >= Bounds.Min.X && Point.X <= Bounds.Max.X
+            && Point.Y >= Bounds.Min.Y && Point.Y <= Bounds.Max.Y;
+    }
+
+    // A site is in conflict with a position if any of its cell vertex is
+    // closer to the position than to the site. Co-circular vertices are
+    // treated as conflicts to regenerate degenerate edges.
+    FORCEINLINE bool HasConflict(const FJCVSite& Site, const FJCVPoint& Point)
+    {
+        for (const FJCVEdge* g = Site.edges; g; g = g->next)
+        {
+            if (FJCVMathUtil::DistSqr(g->pos[0], Point) <= FJCVMathUtil::DistSqr(g->pos[0], Site.p))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    FORCEINLINE bool IsLinked(const FJCVSite& Site, const FJCVSite* Neighbour)
+    {
+        for (const FJCVEdge* g = Site.edges; g; g = g->next)
+        {
+            if (g->neighbor == Neighbour)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Unlinks neighbour edges rejected by the predicate. Only degenerate
+    // edges may be unlinked, returns false on a rejected non-degenerate edge.
+    // bOutPruned is set if any edge is unlinked.
+    template<class FPredicate>
+    bool PruneEdges(FJCVSite& Site, float DegenerateDistSqr, const FPredicate& Predicate, bool& bOutPruned)
+    {
+        FJCVEdge** gp = &Site.edges;
+
+        while (FJCVEdge* g = *gp)
+        {
+            if (g->neighbor && ! Predicate(*g->neighbor))
+            {
+                if (FJCVMathUtil::DistSqr(g->pos[0], g->pos[1]) > DegenerateDistSqr)
+                {
+                    return false;
+                }
+
+                *gp = g->next;
+                bOutPruned = true;
+            }
+            else
+            {
+                gp = &g->next;
+            }
+        }
+
+        return true;
+    }
+
+    FORCEINLINE void ReplaceSite(jcv_edge* Edge, const FJCVSite* Src, FJCVSite* Dst)
+    {
+        if (Edge->sites[0] == Src) Edge->sites[0] = Dst;
+        if (Edge->sites[1] == Src) Edge->sites[1] = Dst;
+    }
+}
+
+bool FJCVDiagramContext::EnsureDynamicSites(int32 MinCapacity, FSiteUpdate& OutUpdate)
+{
+    if (DynamicSites && DynamicSiteCapacity >= MinCapacity)
+    {
+        return true;
+    }
+
+    const int32 SiteCount = GetSiteNum();
+
+    // Dynamic site storage is ordered by site index, requires unique site indices
+    if (! DynamicSites)
+    {
+        TBitArray<> IndexMask(false, SiteCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            const int32 SiteIndex = Site(i).index;
+
+            if (SiteIndex < 0 || SiteIndex >= SiteCount || IndexMask[SiteIndex])
+            {
+                UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::EnsureDynamicSites() ABORTED, DIAGRAM SITE INDICES ARE NOT UNIQUE"));
+                return false;
+            }
+
+            IndexMask[SiteIndex] = true;
+        }
+    }
+
+    const int32 Capacity = FMath::Max3(MinCapacity, DynamicSiteCapacity*2, SiteCount+SiteCount/4+16);
+    const bool bReorder = (DynamicSites == nullptr);
+
+    FJCVSite* NewSites = static_cast<FJCVSite*>(Arena.Allocate(sizeof(FJCVSite) * Capacity));
+
+    for (int32 i=0; i<SiteCount; ++i)
+    {
+        const FJCVSite& s(Site(i));
+        NewSites[s.index] = s;
+    }
+
+    // Remap site references, previous site memory is still valid within the arena
+
+    for (int32 i=0; i<SiteCount; ++i)
+    {
+        for (FJCVEdge* g = NewSites[i].edges; g; g = g->next)
+        {
+            if (g->neighbor)
+            {
+                g->neighbor = NewSites + g->neighbor->index;
+            }
+
+            jcv_edge* e = g->edge;
+
+            for (int32 si=0; si<2; ++si)
+            {
+                if (e->sites[si])
+                {
+                    e->sites[si] = NewSites + e->sites[si]->index;
+                }
+            }
+        }
+    }
+
+    // Site array positions become site indices. Site tree and adjacency
+    // are indexed by site index and graph edges are kept, only site array
+    // position indices are remapped.
+
+    if (bReorder)
+    {
+        FScopeLock ScopeLock(&SearchIndexLock);
+
+        TArray<int32> NewPositions;
+        NewPositions.SetNumUninitialized(SiteCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            NewPositions[i] = Site(i).index;
+        }
+
+        if (bSiteGridBuilt)
+        {
+            SiteGrid.RemapSeeds(NewPositions);
+        }
+
+        if (bCellPolygonsBuilt)
+        {
+            CellPolygons.Permute(NewPositions);
+        }
+    }
+
+    DynamicSites = NewSites;
+    DynamicSiteCapacity = Capacity;
+    Sites = NewSites;
+
+    FJCVDiagram& d(*Diagram.Get());
+    d.sites = NewSites;
+    d.edges = nullptr;
+
+    OutUpdate.bSitesReallocated = true;
+
+    return true;
+}
+
+void FJCVDiagramContext::CollectConflictSites(const FVector2D& Position, const TSet<int32>& TraversableSites, TArray<int32>& OutSites) const
+{
+    using namespace JCVDiagramDynamic;
+
+    const FJCVSite* StartSite = FindClosest(Position);
+
+    if (! StartSite)
+    {
+        return;
+    }
+
+    const FJCVPoint Point(FJCVMathUtil::ToPt(Position));
+
+    TSet<int32> VisitedSet;
+    TArray<const FJCVSite*> SiteStack;
+
+    VisitedSet.Emplace(StartSite->index);
+    SiteStack.Emplace(StartSite);
+
+    while (SiteStack.Num() > 0)
+    {
+        const FJCVSite& s(*SiteStack.Pop(false));
+
+        const bool bHasConflict = HasConflict(s, Point);
+
+        if (bHasConflict)
+        {
+            OutSites.Emplace(s.index);
+        }
+
+        // Conflict region is connected, only expand from conflicting or traversable sites
+        if (! bHasConflict && ! TraversableSites.Contains(s.index))
+        {
+            continue;
+        }
+
+        for (const FJCVEdge* g = s.edges; g; g = g->next)
+        {
+            if (g->neighbor && ! VisitedSet.Contains(g->neighbor->index))
+            {
+                VisitedSet.Emplace(g->neighbor->index);
+                SiteStack.Emplace(g->neighbor);
+            }
+        }
+    }
+}
+
+bool FJCVDiagramContext::RegenerateCells(const TArray<int32>& UpdateSites, int32 ExcludedSite, const FBox2D& CellBounds, TArray<int32>& OutPrunedSites)
+{
+    using namespace JCVDiagramDynamic;
+
+    check(DynamicSites);
+
+    const int32 SiteCount = GetSiteNum();
+    const FVector2D CellExtent(CellBounds.GetSize());
+
+    TSet<int32> UpdateSet;
+    UpdateSet.Append(UpdateSites);
+
+    TArray<FJCVPoint> Points;
+    TArray<int32> PointIndices;
+    TBitArray<> VisitedMask;
+    TArray<int32> SiteStack;
+
+    float Halo = FMath::Max(CellExtent.X, CellExtent.Y) * .5f + KINDA_SMALL_NUMBER;
+
+    // Expand local diagram window until all updated cells are resolved
+
+    for (int32 Attempt=0; Attempt<4; ++Attempt, Halo*=2.f)
+    {
+        const FBox2D WindowBounds(
+            (CellBounds.Min-Halo).ComponentMax(DiagramBounds.Min),
+            (CellBounds.Max+Halo).ComponentMin(DiagramBounds.Max)
+            );
+
+        // Gather sites within window, cells intersecting the window are
+        // connected and reachable from the updated cells
+
+        Points.Reset();
+        PointIndices.Reset();
+        SiteStack.Reset();
+        VisitedMask.Init(false, SiteCount);
+
+        for (int32 SiteIndex : UpdateSites)
+        {
+            VisitedMask[SiteIndex] = true;
+            SiteStack.Emplace(SiteIndex);
+        }
+
+        if (ExcludedSite != INDEX_NONE && ! VisitedMask[ExcludedSite])
+        {
+            VisitedMask[ExcludedSite] = true;
+            SiteStack.Emplace(ExcludedSite);
+        }
+
+        while (SiteStack.Num() > 0)
+        {
+            const int32 SiteIndex = SiteStack.Pop(false);
+            const FJCVSite& s(DynamicSites[SiteIndex]);
+
+            if (SiteIndex != ExcludedSite && (UpdateSet.Contains(SiteIndex) || IsWithinBounds(WindowBounds, FJCVMathUtil::ToVector2D(s.p))))
+            {
+                Points.Emplace(s.p);
+                PointIndices.Emplace(SiteIndex);
+            }
+
+            FBox2D SiteBounds;
+            GetSiteBounds(s, SiteBounds);
+
+            if (SiteBounds.bIsValid && ! SiteBounds.Intersect(WindowBounds) && ! UpdateSet.Contains(SiteIndex))
+            {
+                continue;
+            }
+
+            for (const FJCVEdge* g = s.edges; g; g = g->next)
+            {
+                if (g->neighbor && ! VisitedMask[g->neighbor->index])
+                {
+                    VisitedMask[g->neighbor->index] = true;
+                    SiteStack.Emplace(g->neighbor->index);
+                }
+            }
+        }
+
+        // Generate local diagram
+
+        FJCVDiagramArena LocalArena;
+        FJCVDiagram LocalDiagram;
+        FMemory::Memset(&LocalDiagram, 0, sizeof(FJCVDiagram));
+
+        jcv_rect JCVBounds;
+        JCVBounds.min.x = WindowBounds.Min.X;
+        JCVBounds.min.y = WindowBounds.Min.Y;
+        JCVBounds.max.x = WindowBounds.Max.X;
+        JCVBounds.max.y = WindowBounds.Max.Y;
+
+        jcv_diagram_generate_useralloc(
+            Points.Num(),
+            Points.GetData(),
+            &JCVBounds,
+            &LocalArena,
+            jcv_alloc_fn,
+            jcv_free_fn,
+            &LocalDiagram
+            );
+
+        const FJCVSite* LocalSites = jcv_diagram_get_sites(&LocalDiagram);
+        const int32 LocalSiteCount = LocalDiagram.numsites;
+
+        TArray<const FJCVSite*> ResolvedSites;
+        ResolvedSites.Reserve(UpdateSites.Num());
+
+        for (int32 i=0; i<LocalSiteCount; ++i)
+        {
+            const FJCVSite& ls(LocalSites[i]);
+
+            if (! UpdateSet.Contains(PointIndices[ls.index]))
+                continue;
+
+            if (! JCVDiagramTiled::IsResolved(ls, WindowBounds, DiagramBounds))
+                break;
+
+            ResolvedSites.Emplace(&ls);
+        }
+
+        if (ResolvedSites.Num() != UpdateSites.Num())
+        {
+            continue;
+        }
+
+        // Collect non-updated sites bordering updated cells before and after
+        // the update, degenerate edges between them are resolved below
+
+        TSet<int32> BorderSites;
+
+        auto CollectBorderSites = [&](const FJCVSite& s)
+        {
+            for (const FJCVEdge* g = s.edges; g; g = g->next)
+            {
+                if (g->neighbor && g->neighbor->index != ExcludedSite && ! UpdateSet.Contains(g->neighbor->index))
+                {
+                    BorderSites.Emplace(g->neighbor->index);
+                }
+            }
+        };
+
+        for (int32 SiteIndex : UpdateSites)
+        {
+            CollectBorderSites(DynamicSites[SiteIndex]);
+        }
+
+        // Replace updated site edges with the resolved local cell edges
+
+        for (const FJCVSite* ls : ResolvedSites)
+        {
+            FJCVSite& s(DynamicSites[PointIndices[ls->index]]);
+
+            int32 EdgeCount = 0;
+            for (const FJCVEdge* g = ls->edges; g; g = g->next)
+            {
+                ++EdgeCount;
+            }
+
+            FJCVEdge* DstGraphEdges = static_cast<FJCVEdge*>(Arena.Allocate(sizeof(FJCVEdge) * FMath::Max(1, EdgeCount)));
+            jcv_edge* DstEdges = static_cast<jcv_edge*>(Arena.Allocate(sizeof(jcv_edge) * FMath::Max(1, EdgeCount)));
+
+            FJCVEdge* PrevGraphEdge = nullptr;
+            int32 ei = 0;
+
+            s.edges = nullptr;
+
+            for (const FJCVEdge* g = ls->edges; g; g = g->next, ++ei)
+            {
+                FJCVSite* Neighbour = g->neighbor
+                    ? DynamicSites + PointIndices[g->neighbor->index]
+                    : nullptr;
+
+                jcv_edge& e(DstEdges[ei]);
+                e.next = nullptr;
+                e.sites[0] = &s;
+                e.sites[1] = Neighbour;
+                e.pos[0] = g->pos[0];
+                e.pos[1] = g->pos[1];
+                e.a = g->edge->a;
+                e.b = g->edge->b;
+                e.c = g->edge->c;
+
+                FJCVEdge& ge(DstGraphEdges[ei]);
+                ge.next = nullptr;
+                ge.edge = &e;
+                ge.neighbor = Neighbour;
+                ge.pos[0] = g->pos[0];
+                ge.pos[1] = g->pos[1];
+                ge.angle = g->angle;
+
+                if (PrevGraphEdge)
+                {
+                    PrevGraphEdge->next = &ge;
+                }
+                else
+                {
+                    s.edges = &ge;
+                }
+
+                PrevGraphEdge = &ge;
+            }
+
+            CollectBorderSites(s);
+        }
+
+        // Degenerate (zero length) edges between co-circular sites depend on
+        // the generation input, unlink those that are not mutual
+
+        const float DegenerateDistSqr = FMath::Square(KINDA_SMALL_NUMBER * DiagramBounds.GetSize().GetMax());
+
+        for (int32 SiteIndex : UpdateSites)
+        {
+            FJCVSite& s(DynamicSites[SiteIndex]);
+
+            auto IsMutual = [&](const FJCVSite& n)
+            {
+                return UpdateSet.Contains(n.index) || IsLinked(n, &s);
+            };
+
+            bool bPruned = false;
+
+            if (! PruneEdges(s, DegenerateDistSqr, IsMutual, bPruned))
+            {
+                return false;
+            }
+        }
+
+        // Border sites with unlinked edges have modified neighbours
+
+        OutPrunedSites.Reset();
+
+        for (int32 SiteIndex : BorderSites)
+        {
+            FJCVSite& s(DynamicSites[SiteIndex]);
+
+            auto IsMutual = [&](const FJCVSite& n)
+            {
+                return ! UpdateSet.Contains(n.index) || IsLinked(n, &s);
+            };
+
+            bool bPruned = false;
+
+            if (! PruneEdges(s, DegenerateDistSqr, IsMutual, bPruned))
+            {
+                return false;
+            }
+
+            if (bPruned)
+            {
+                OutPrunedSites.Emplace(SiteIndex);
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void FJCVDiagramContext::PatchSearchIndex(const FSiteUpdate& Update, int32 PlacedSite)
+{
+    FScopeLock ScopeLock(&SearchIndexLock);
+
+    const int32 SiteCount = GetSiteNum();
+
+    if (bSiteTreeBuilt)
+    {
+        const bool bPatched = (PlacedSite != INDEX_NONE)
+            ? SiteTree.SetSite(PlacedSite, DynamicSites[PlacedSite].p)
+            : SiteTree.RemoveSite(Update.RemovedIndex);
+
+        if (! bPatched)
+        {
+            SiteTree.Empty();
+            bSiteTreeBuilt = false;
+        }
+    }
+
+    if (bCellPolygonsBuilt && ! CellPolygons.Patch(DynamicSites, SiteCount, Update.DirtyIndices))
+    {
+        CellPolygons.Empty();
+        bCellPolygonsBuilt = false;
+    }
+
+    if (bAdjacencyBuilt && ! Adjacency.Patch(DynamicSites, SiteCount, Update.DirtyIndices, Update.RemovedIndex, Update.SwappedIndex))
+    {
+        Adjacency.Empty();
+        bAdjacencyBuilt = false;
+    }
+}
+
+void FJCVDiagramContext::RegenerateAll(TArray<FVector2D>& Points, FSiteUpdate& OutUpdate)
+{
+    UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::RegenerateAll() UNRESOLVED LOCAL UPDATE, REGENERATING DIAGRAM"));
+
+    GenerateDiagram(DiagramBounds, Points);
+
+    OutUpdate.DirtyIndices.Reset();
+    for (int32 i=0; i<GetSiteNum(); ++i)
+    {
+        OutUpdate.DirtyIndices.Emplace(Site(i).index);
+    }
+
+    OutUpdate.bSitesReallocated = true;
+    OutUpdate.bRegenerated = true;
+}
+
+bool FJCVDiagramContext::InsertSite(const FVector2D& Position, FSiteUpdate& OutUpdate)
+{
+    using namespace JCVDiagramDynamic;
+
+    if (IsEmpty())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::InsertSite() ABORTED, EMPTY DIAGRAM"));
+        return false;
+    }
+
+    if (! IsWithinBounds(DiagramBounds, Position))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::InsertSite() ABORTED, POSITION OUTSIDE DIAGRAM BOUNDS"));
+        return false;
+    }
+
+    const FJCVSite* ClosestSite = FindClosest(Position);
+
+    if (ClosestSite && FJCVMathUtil::ToVector2D(ClosestSite->p) == Position)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::InsertSite() ABORTED, DUPLICATE SITE POSITION"));
+        return false;
+    }
+
+    TArray<int32> UpdateSites;
+    CollectConflictSites(Position, TSet<int32>(), UpdateSites);
+
+    const int32 SiteIndex = GetSiteNum();
+
+    if (! EnsureDynamicSites(SiteIndex+1, OutUpdate))
+    {
+        return false;
+    }
+
+    FBox2D CellBounds(Position, Position);
+
+    for (int32 i : UpdateSites)
+    {
+        FBox2D SiteBounds;
+        GetSiteBounds(DynamicSites[i], SiteBounds);
+        CellBounds += SiteBounds;
+    }
+
+    FJCVSite& NewSite(DynamicSites[SiteIndex]);
+    NewSite.p = FJCVMathUtil::ToPt(Position);
+    NewSite.index = SiteIndex;
+    NewSite.edges = nullptr;
+
+    Diagram->numsites = SiteIndex+1;
+
+    UpdateSites.Emplace(SiteIndex);
+
+    TArray<int32> PrunedSites;
+
+    if (! RegenerateCells(UpdateSites, INDEX_NONE, CellBounds, PrunedSites))
+    {
+        TArray<FVector2D> Points;
+        Points.SetNumUninitialized(GetSiteNum());
+        for (int32 i=0; i<Points.Num(); ++i)
+        {
+            Points[i] = FJCVMathUtil::ToVector2D(DynamicSites[i].p);
+        }
+        RegenerateAll(Points, OutUpdate);
+        return true;
+    }
+
+    OutUpdate.DirtyIndices.Append(UpdateSites);
+    OutUpdate.DirtyIndices.Append(PrunedSites);
+
+    // Grid seeds stay valid, the new site is reached from its neighbours
+    PatchSearchIndex(OutUpdate, SiteIndex);
+
+    return true;
+}
+
+bool FJCVDiagramContext::RemoveSite(int32 SiteIndex, FSiteUpdate& OutUpdate)
+{
+    using namespace JCVDiagramDynamic;
+
+    const int32 SiteCount = GetSiteNum();
+
+    if (SiteIndex < 0 || SiteIndex >= SiteCount)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::RemoveSite() ABORTED, INVALID SITE INDEX"));
+        return false;
+    }
+
+    if (SiteCount < 2)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::RemoveSite() ABORTED, UNABLE TO REMOVE THE LAST SITE"));
+        return false;
+    }
+
+    if (! EnsureDynamicSites(SiteCount, OutUpdate))
+    {
+        return false;
+    }
+
+    FJCVSite& RemovedSite(DynamicSites[SiteIndex]);
+
+    TArray<int32> UpdateSites;
+    FBox2D CellBounds;
+    GetSiteBounds(RemovedSite, CellBounds);
+
+    for (const FJCVEdge* g = RemovedSite.edges; g; g = g->next)
+    {
+        if (g->neighbor)
+        {
+            UpdateSites.AddUnique(g->neighbor->index);
+
+            FBox2D SiteBounds;
+            GetSiteBounds(*g->neighbor, SiteBounds);
+            CellBounds += SiteBounds;
+        }
+    }
+
+    const int32 LastIndex = SiteCount-1;
+
+    TArray<int32> PrunedSites;
+
+    if (! RegenerateCells(UpdateSites, SiteIndex, CellBounds, PrunedSites))
+    {
+        TArray<FVector2D> Points;
+        Points.SetNumUninitialized(SiteCount);
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            Points[i] = FJCVMathUtil::ToVector2D(DynamicSites[i].p);
+        }
+        Points.RemoveAtSwap(SiteIndex, 1, false);
+        RegenerateAll(Points, OutUpdate);
+        OutUpdate.RemovedIndex = SiteIndex;
+        OutUpdate.SwappedIndex = (SiteIndex != LastIndex) ? LastIndex : INDEX_NONE;
+        return true;
+    }
+
+    // Merge grid buckets seeded by the removed site into an adjacent seed,
+    // then rename buckets seeded by the last site to its new site index
+
+    if (bSiteGridBuilt)
+    {
+        FScopeLock ScopeLock(&SearchIndexLock);
+
+        SiteGrid.RemoveSeed(FJCVMathUtil::ToVector2D(RemovedSite.p), SiteIndex, (SiteIndex != LastIndex) ? SiteIndex : 0);
+        SiteGrid.RenameSeed(FJCVMathUtil::ToVector2D(DynamicSites[LastIndex].p), LastIndex, SiteIndex);
+    }
+
+    // Move the last site into the removed site index
+
+    if (SiteIndex != LastIndex)
+    {
+        FJCVSite* LastSite = DynamicSites + LastIndex;
+        FJCVSite* DstSite = DynamicSites + SiteIndex;
+
+        *DstSite = *LastSite;
+        DstSite->index = SiteIndex;
+
+        for (FJCVEdge* g = DstSite->edges; g; g = g->next)
+        {
+            ReplaceSite(g->edge, LastSite, DstSite);
+
+            if (FJCVSite* n = g->neighbor)
+            {
+                for (FJCVEdge* ng = n->edges; ng; ng = ng->next)
+                {
+                    if (ng->neighbor == LastSite)
+                    {
+                        ng->neighbor = DstSite;
+                        ReplaceSite(ng->edge, LastSite, DstSite);
+                    }
+                }
+            }
+        }
+
+        for (int32& i : UpdateSites)
+        {
+            if (i == LastIndex)
+            {
+                i = SiteIndex;
+            }
+        }
+
+        for (int32& i : PrunedSites)
+        {
+            if (i == LastIndex)
+            {
+                i = SiteIndex;
+            }
+        }
+
+        UpdateSites.AddUnique(SiteIndex);
+
+        OutUpdate.SwappedIndex = LastIndex;
+    }
+
+    Diagram->numsites = LastIndex;
+
+    OutUpdate.RemovedIndex = SiteIndex;
+    OutUpdate.DirtyIndices.Append(UpdateSites);
+
+    for (int32 i : PrunedSites)
+    {
+        OutUpdate.DirtyIndices.AddUnique(i);
+    }
+
+    PatchSearchIndex(OutUpdate, INDEX_NONE);
+
+    return true;
+}
+
+bool FJCVDiagramContext::MoveSite(int32 SiteIndex, const FVector2D& Position, FSiteUpdate& OutUpdate)
+{
+    using namespace JCVDiagramDynamic;
+
+    const int32 SiteCount = GetSiteNum();
+
+    if (SiteIndex < 0 || SiteIndex >= SiteCount)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::MoveSite() ABORTED, INVALID SITE INDEX"));
+        return false;
+    }
+
+    if (! IsWithinBounds(DiagramBounds, Position))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::MoveSite() ABORTED, POSITION OUTSIDE DIAGRAM BOUNDS"));
+        return false;
+    }
+
+    if (! EnsureDynamicSites(SiteCount, OutUpdate))
+    {
+        return false;
+    }
+
+    FJCVSite& MovedSite(DynamicSites[SiteIndex]);
+
+    if (FJCVMathUtil::ToVector2D(MovedSite.p) == Position)
+    {
+        return true;
+    }
+
+    const FJCVSite* ClosestSite = FindClosest(Position);
+
+    if (ClosestSite && ClosestSite != &MovedSite && FJCVMathUtil::ToVector2D(ClosestSite->p) == Position)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramContext::MoveSite() ABORTED, DUPLICATE SITE POSITION"));
+        return false;
+    }
+
+    // Previous neighbours gain the previous moved cell area, the conflict
+    // search expands through them as their cells are not final
+
+    TSet<int32> TraversableSites;
+    TraversableSites.Emplace(SiteIndex);
+
+    TArray<int32> UpdateSites;
+    UpdateSites.Emplace(SiteIndex);
+
+    FBox2D CellBounds(Position, Position);
+
+    for (const FJCVEdge* g = MovedSite.edges; g; g = g->next)
+    {
+        if (g->neighbor)
+        {
+            TraversableSites.Emplace(g->neighbor->index);
+        }
+    }
+
+    TArray<int32> ConflictSites;
+    CollectConflictSites(Position, TraversableSites, ConflictSites);
+
+    for (int32 i : TraversableSites)
+    {
+        UpdateSites.AddUnique(i);
+    }
+
+    for (int32 i : ConflictSites)
+    {
+        UpdateSites.AddUnique(i);
+    }
+
+    for (int32 i : UpdateSites)
+    {
+        FBox2D SiteBounds;
+        GetSiteBounds(DynamicSites[i], SiteBounds);
+        CellBounds += SiteBounds;
+    }
+
+    // Grid buckets seeded by the moved site are merged into an adjacent
+    // seed, the moved site is reached from its neighbours
+
+    if (bSiteGridBuilt)
+    {
+        FScopeLock ScopeLock(&SearchIndexLock);
+        SiteGrid.RemoveSeed(FJCVMathUtil::ToVector2D(MovedSite.p), SiteIndex, SiteIndex);
+    }
+
+    MovedSite.p = FJCVMathUtil::ToPt(Position);
+
+    TArray<int32> PrunedSites;
+
+    if (! RegenerateCells(UpdateSites, INDEX_NONE, CellBounds, PrunedSites))
+    {
+        TArray<FVector2D> Points;
+        Points.SetNumUninitialized(SiteCount);
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            Points[i] = FJCVMathUtil::ToVector2D(DynamicSites[i].p);
+        }
+        RegenerateAll(Points, OutUpdate);
+        return true;
+    }
+
+    OutUpdate.DirtyIndices.Append(UpdateSites);
+    OutUpdate.DirtyIndices.Append(PrunedSites);
+
+    PatchSearchIndex(OutUpdate, SiteIndex);
+
+    return true;
+}
@@ -29,6 +29,7 @@
 #include "JCVDiagramMap.h"
 #include "JCVCellUtility.h"
 #include "JCVFeatureUtility.h"
+#include "JCVPathFinder.h"
 #include "JCVValueGenerator.h"
 #include "JCVPlateGenerator.h"
 
@@ -39,6 +40,7 @@ void UJCVDiagramAccessor::SetMap(FJCVDiagramMap& AccessedMap, int32 InContextId,
     Map = &AccessedMap;
     ContextId = InContextId;
     MapId = InMapId;
+    PathHierarchy.Reset();
 }
 
 FBox2D UJCVDiagramAccessor::K2_GetBounds() const
@@ -645,7 +647,7 @@ int32 UJCVDiagramAccessor::GetFeatureCellCount(FJCVFeatureId FeatureId) const
 {
     if (Map)
     {
-        FJCVCellGroup* FeatureCells = Map->GetFeatureCellGroup(FeatureId);
+        const FJCVCellGroupView* FeatureCells = Map->GetFeatureCellGroup(FeatureId);
         return FeatureCells ? FeatureCells->Num() : 0;
     }
     
@@ -787,6 +789,18 @@ void UJCVDiagramAccessor::GroupByFeatures()
     }
 }
 
+void UJCVDiagramAccessor::UpdateFeatureGroups()
+{
+    if (HasValidMap())
+    {
+        Map->UpdateFeatureGroups();
+    }
+    else
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::UpdateFeatureGroups() ABORTED, INVALID MAP"));
+    }
+}
+
 void UJCVDiagramAccessor::ShrinkFeatures()
 {
     if (HasValidMap())
@@ -799,6 +813,21 @@ void UJCVDiagramAccessor::ShrinkFeatures()
     }
 }
 
+int32 UJCVDiagramAccessor::LabelConnectedComponents(uint8 FeatureType, TArray<int32>& ComponentSizes)
+{
+    if (HasValidMap())
+    {
+        return Map->LabelConnectedComponents(FeatureType, ComponentSizes);
+    }
+    else
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::LabelConnectedComponents() ABORTED, INVALID MAP"));
+    }
+
+    ComponentSizes.Reset();
+    return 0;
+}
+
 void UJCVDiagramAccessor::ScaleFeatureValuesByIndex(uint8 FeatureType, int32 IndexOffset)
 {
     if (! HasValidMap())
@@ -815,21 +844,7 @@ void UJCVDiagramAccessor::ScaleFeatureValuesByIndex(uint8 FeatureType, int32 Ind
         const int32 LastFeatureIndex = (FeatureCount-1) + IndexOffset;
         const float FeatureCountInv = FeatureCount > 1 ? (1.f/LastFeatureIndex) : 1.f;
 
-        TArray<int32> FeatureIndices;
-        Map->GetFeatureIndices(FeatureIndices, FeatureType, -1, true);
-
-        for (const int32 fi : FeatureIndices)
-        {
-            FJCVCellGroup& CellGroup(FeatureGroupPtr->CellGroups[fi]);
-            const float IndexValue = fi + IndexOffset;
-            const float Scale = IndexValue * FeatureCountInv;
-
-            for (FJCVCell* Cell : CellGroup)
-            {
-                check(Cell != nullptr);
-                Cell->Value *= Scale;
-            }
-        }
+        Map->GetCellStorage().ScaleValuesByFeatureIndex(FeatureType, IndexOffset, FeatureCountInv);
     }
 }
 
@@ -841,23 +856,9 @@ void UJCVDiagramAccessor::InvertFeatureValues(FJCVFeatureId FeatureId)
         return;
     }
 
-    FJCVFeatureGroup* FeatureGroupPtr = Map->GetFeatureGroup(FeatureId.Type);
-
-    if (FeatureGroupPtr)
+    if (Map->GetFeatureGroup(FeatureId.Type))
     {
-        TArray<int32> FeatureIndices;
-        Map->GetFeatureIndices(FeatureIndices, FeatureId.Type, FeatureId.Index, true);
-
-        for (const int32 fi : FeatureIndices)
-        {
-            FJCVCellGroup& CellGroup(FeatureGroupPtr->CellGroups[fi]);
-
-            for (FJCVCell* Cell : CellGroup)
-            {
-                check(Cell != nullptr);
-                Cell->Value = 1.f-Cell->Value;
-            }
-        }
+        Map->GetCellStorage().InvertValues(FeatureId.Type, FeatureId.Index);
     }
 }
 
@@ -875,21 +876,19 @@ void UJCVDiagramAccessor::ApplyCurveToFeatureValues(uint8 FeatureType, UCurveFlo
         return;
     }
 
-    FJCVFeatureGroup* FeatureGroupPtr = Map->GetFeatureGroup(FeatureType);
-
-    if (FeatureGroupPtr)
+    if (Map->GetFeatureGroup(FeatureType))
     {
-        TArray<int32> FeatureIndices;
-        Map->GetFeatureIndices(FeatureIndices, FeatureType, -1, true);
+        FJCVCellStorage& CellStorage(Map->GetCellStorage());
+        const int32 CellCount = CellStorage.Num();
 
-        for (const int32 fi : FeatureIndices)
-        {
-            FJCVCellGroup& CellGroup(FeatureGroupPtr->CellGroups[fi]);
+        // Cells without feature index are not feature group members
 
-            for (FJCVCell* Cell : CellGroup)
+        for (int32 i=0; i<CellCount; ++i)
+        {
+            if (CellStorage.FeatureTypes[i] == FeatureType && CellStorage.FeatureIndices[i] >= 0)
             {
-                check(Cell != nullptr);
-                Cell->Value = ValueCurve->GetFloatValue(Cell->Value);
+                float& Value(CellStorage.Values[i]);
+                Value = ValueCurve->GetFloatValue(Value);
             }
         }
     }
@@ -920,6 +919,43 @@ void UJCVDiagramAccessor::MapNormalizedDistanceFromCell(FJCVCellRef OriginCellRe
     FJCVValueGenerator::MapNormalizedDistanceFromCell(*Map, *OriginCell, FeatureId, bAgainstAnyType);
 }
 
+void UJCVDiagramAccessor::GenerateFlowField(TArray<float>& FilledValues, TArray<int32>& Receivers, TArray<float>& FlowAccumulation)
+{
+    FilledValues.Reset();
+    Receivers.Reset();
+    FlowAccumulation.Reset();
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::GenerateFlowField() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    FJCVFlowField Flow;
+    Map->GenerateFlowField(Flow);
+
+    FilledValues = MoveTemp(Flow.FilledValues);
+    Receivers = MoveTemp(Flow.Receivers);
+    FlowAccumulation = MoveTemp(Flow.FlowAccumulation);
+}
+
+void UJCVDiagramAccessor::MarkLakesAndRivers(uint8 LakeFeatureType, uint8 RiverFeatureType, float MinLakeDepth, float MinRiverFlow, bool bGroupFeatures)
+{
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::MarkLakesAndRivers() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    FJCVFlowField Flow;
+    Map->GenerateFlowField(Flow);
+
+    if (Flow.Num() > 0)
+    {
+        Map->MarkLakesAndRivers(Flow, LakeFeatureType, RiverFeatureType, MinLakeDepth, MinRiverFlow, bGroupFeatures);
+    }
+}
+
 void UJCVDiagramAccessor::GetFeaturePoints(TArray<FVector2D>& Points, FJCVFeatureId FeatureId)
 {
     if (! HasValidMap())
@@ -937,11 +973,11 @@ void UJCVDiagramAccessor::GetFeaturePoints(TArray<FVector2D>& Points, FJCVFeatur
     // Get all feature points of a feature type
     if (FeatureId.Index < 0)
     {
-        const FJCVCellGroup* CellGroupPtr = Map->GetFeatureCellGroup(FeatureId);
+        const FJCVCellGroupView* CellGroupPtr = Map->GetFeatureCellGroup(FeatureId);
 
         if (CellGroupPtr)
         {
-            const FJCVCellGroup& CellGroup(*CellGroupPtr);
+            const FJCVCellGroupView& CellGroup(*CellGroupPtr);
 
             Points.Reserve(CellGroup.Num());
 
@@ -957,7 +993,7 @@ void UJCVDiagramAccessor::GetFeaturePoints(TArray<FVector2D>& Points, FJCVFeatur
     {
         const FJCVFeatureGroup& FeatureGroup(*Map->GetFeatureGroup(FeatureId.Type));
 
-        for (const FJCVCellGroup& CellGroup : FeatureGroup.CellGroups)
+        for (const FJCVCellGroupView& CellGroup : FeatureGroup.CellGroups)
         {
             Points.Reserve(Points.Num() + CellGroup.Num());
 
@@ -997,7 +1033,7 @@ void UJCVDiagramAccessor::GetFeatureCells(TArray<FJCVCellRef>& CellRefs, FJCVFea
 
         for (const int32 fi : FeatureIndices)
         {
-            const FJCVCellGroup& CellGroup(FeatureGroupPtr->CellGroups[fi]);
+            const FJCVCellGroupView& CellGroup(FeatureGroupPtr->CellGroups[fi]);
 
             for (const FJCVCell* Cell : CellGroup)
             {
@@ -1054,16 +1090,13 @@ void UJCVDiagramAccessor::GetNeighbourCells(const FJCVCellRef& CellRef, TArray<F
 
     FJCVDiagramMap& MapRef(*Map);
 
-    TArray<const FJCVSite*> Neighbours;
-    MapRef->GetNeighbours(*CellRef.Data->Site, Neighbours);
+    TArrayView<const int32> Neighbours(MapRef.GetAdjacency().GetNeighbours(CellRef.Data->GetIndex()));
 
-    NeighbourCellRefs.Reserve(Neighbours.Num());
+    NeighbourCellRefs.Reserve(NeighbourCellRefs.Num()+Neighbours.Num());
 
-    for (int32 i=0; i<Neighbours.Num(); ++i)
+    for (int32 ni : Neighbours)
     {
-        const FJCVCell* Cell(MapRef.GetCell(Neighbours[i]));
-        check(Cell != nullptr);
-        NeighbourCellRefs.Emplace(Cell);
+        NeighbourCellRefs.Emplace(&MapRef.GetCell(ni));
     }
 }
 
@@ -1220,7 +1253,7 @@ FJCVCellRef UJCVDiagramAccessor::GetRandomCellByFeature(int32 Seed, const FJCVFe
         // Find random cells without specified feature index
         if (FeatureId.Index < 0)
         {
-            const TArray<FJCVCellGroup>& CellGroups(FeatureGroup.CellGroups);
+            const TArray<FJCVCellGroupView>& CellGroups(FeatureGroup.CellGroups);
             const int32 CellGroupCount = CellGroups.Num();
             TArray<int32> NonEmptyCellGroups;
 
@@ -1241,7 +1274,7 @@ FJCVCellRef UJCVDiagramAccessor::GetRandomCellByFeature(int32 Seed, const FJCVFe
                     for (; TraitsCheckIt<JCV_RANDOM_CELL_TRAITS_CHECK_MAX_ITERATION; ++TraitsCheckIt)
                     {
                         int32 CellGroupIndex = Rand.RandHelper(NonEmptyCellGroups.Num());
-                        const FJCVCellGroup& CellGroup = CellGroups[NonEmptyCellGroups[CellGroupIndex]];
+                        const FJCVCellGroupView& CellGroup = CellGroups[NonEmptyCellGroups[CellGroupIndex]];
 
                         int32 CellIndex = Rand.RandHelper(CellGroup.Num());
                         FJCVCell* Cell(CellGroup[CellIndex]);
@@ -1262,7 +1295,7 @@ FJCVCellRef UJCVDiagramAccessor::GetRandomCellByFeature(int32 Seed, const FJCVFe
                 else
                 {
                     int32 CellGroupIndex = Rand.RandHelper(NonEmptyCellGroups.Num());
-                    const FJCVCellGroup& CellGroup = CellGroups[NonEmptyCellGroups[CellGroupIndex]];
+                    const FJCVCellGroupView& CellGroup = CellGroups[NonEmptyCellGroups[CellGroupIndex]];
                     int32 CellIndex = Rand.RandHelper(CellGroup.Num());
                     CellRef = FJCVCellRef(CellGroup[CellIndex]);
                 }
@@ -1272,7 +1305,7 @@ FJCVCellRef UJCVDiagramAccessor::GetRandomCellByFeature(int32 Seed, const FJCVFe
         else
         if (FeatureGroup.CellGroups.IsValidIndex(FeatureId.Index))
         {
-            const FJCVCellGroup& CellGroup = FeatureGroup.CellGroups[FeatureId.Index];
+            const FJCVCellGroupView& CellGroup = FeatureGroup.CellGroups[FeatureId.Index];
 
             if (Traits.HasValidTraits())
             {
@@ -1434,7 +1467,7 @@ void UJCVDiagramAccessor::GetRandomCellsByFeature(TArray<FJCVCellRef>& CellRefs,
         // Find random cells without specified feature index
         if (FeatureId.Index < 0)
         {
-            const TArray<FJCVCellGroup>& CellGroups(FeatureGroup.CellGroups);
+            const TArray<FJCVCellGroupView>& CellGroups(FeatureGroup.CellGroups);
             const int32 FeatureCellCount = FeatureGroup.GetCellCount();
             const int32 CellCount = FMath::Clamp(Count, 0, FeatureCellCount);
 
@@ -1443,7 +1476,7 @@ void UJCVDiagramAccessor::GetRandomCellsByFeature(TArray<FJCVCellRef>& CellRefs,
             // Feature cell count equals specified output count, copy feature cells
             if (CellCount == FeatureCellCount)
             {
-                for (const FJCVCellGroup& CellGroup : CellGroups)
+                for (const FJCVCellGroupView& CellGroup : CellGroups)
                 {
                     for (FJCVCell* Cell : CellGroup)
                     {
@@ -1463,9 +1496,9 @@ void UJCVDiagramAccessor::GetRandomCellsByFeature(TArray<FJCVCellRef>& CellRefs,
                 TArray<FJCVCell*> FeatureCells;
                 FeatureCells.Reserve(FeatureCellCount);
 
-                for (const FJCVCellGroup& CellGroup : CellGroups)
+                for (const FJCVCellGroupView& CellGroup : CellGroups)
                 {
-                    FeatureCells.Append(CellGroup);
+                    CellGroup.AppendTo(FeatureCells);
                 }
 
                 while (CellRefs.Num() < CellCount && FeatureCells.Num() > 0)
@@ -1486,7 +1519,7 @@ void UJCVDiagramAccessor::GetRandomCellsByFeature(TArray<FJCVCellRef>& CellRefs,
         else
         if (FeatureGroup.CellGroups.IsValidIndex(FeatureId.Index))
         {
-            const FJCVCellGroup& CellGroup(FeatureGroup.CellGroups[FeatureId.Index]);
+            const FJCVCellGroupView& CellGroup(FeatureGroup.CellGroups[FeatureId.Index]);
             const int32 FeatureCellCount = CellGroup.Num();
             const int32 CellCount = FMath::Clamp(Count, 0, FeatureCellCount);
 
@@ -1585,6 +1618,60 @@ FJCVCellRef UJCVDiagramAccessor::GetClosestCellAt(const FVector2D& Pos)
     return FJCVCellRef();
 }
 
+void UJCVDiagramAccessor::FindCellsBatch(const TArray<FVector2D>& Points, TArray<int32>& OutCellIndices)
+{
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindCellsBatch() ABORTED, INVALID MAP"));
+        OutCellIndices.Reset();
+        return;
+    }
+
+    OutCellIndices.SetNumUninitialized(Points.Num(), false);
+
+    (*Map)->FindCellsBatch(Points, OutCellIndices);
+}
+
+void UJCVDiagramAccessor::FindKNearestCells(TArray<FJCVCellRef>& CellRefs, const FVector2D& Pos, int32 K)
+{
+    CellRefs.Reset();
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindKNearestCells() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    FJCVDiagramMap& MapRef(*Map);
+
+    const int32 CellCount = MapRef->FindKNearest(Pos, K, QuerySiteIndices, QueryDistSqr);
+
+    CellRefs.Reserve(CellCount);
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        CellRefs.Emplace(&MapRef.GetCell(QuerySiteIndices[i]));
+    }
+}
+
+void UJCVDiagramAccessor::FindCellsInRadius(TArray<FJCVCellRef>& CellRefs, const FVector2D& Pos, float Radius)
+{
+    CellRefs.Reset();
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindCellsInRadius() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    FJCVDiagramMap& MapRef(*Map);
+
+    MapRef->GetSiteTree().ForEachInRadius(Pos, Radius, [&](int32 SiteIndex, float DistSqr)
+    {
+        CellRefs.Emplace(&MapRef.GetCell(SiteIndex));
+    });
+}
+
 void UJCVDiagramAccessor::GetCellsWithinRect(TArray<FJCVCellRef>& CellRefs, const FBox2D& Rect)
 {
     if (! HasValidMap())
@@ -1637,44 +1724,38 @@ void UJCVDiagramAccessor::GetCellWithinOriginRadius(
 
 
     FJCVDiagramMap& MapRef(*Map);
-    TSet<const FJCVCell*> VisitedSet;
-    TQueue<const FJCVCell*> ExpandQueue;
+    const FJCVDiagramAdjacency& Adjacency(MapRef.GetAdjacency());
+    FJCVCellVisitScope Visited(MapRef.GetVisitStamp(), MapRef.Num());
+    TArray<int32>& ExpandQueue(Visited->GetQueue());
 
     CellRefs.Emplace(OriginCellRef);
-    VisitedSet.Emplace(OriginCell);
-    ExpandQueue.Enqueue(OriginCell);
+    Visited->MarkVisited(OriginCell->GetIndex());
+    ExpandQueue.Emplace(OriginCell->GetIndex());
 
     const FVector2D Center(OriginCell->ToVector2D());
     const float RadiusSq = Radius * Radius;
 
-    while (! ExpandQueue.IsEmpty())
+    for (int32 QueueIndex=0; QueueIndex<ExpandQueue.Num(); ++QueueIndex)
     {
-        const FJCVCell* Cell;
-        ExpandQueue.Dequeue(Cell);
-
-        check(Cell);
-
-        TArray<const FJCVSite*> Neighbours;
-        MapRef->GetNeighbours(*Cell->Site, Neighbours);
+        const int32 CellIndex = ExpandQueue[QueueIndex];
 
-        for (const FJCVSite* Site : Neighbours)
+        for (int32 ni : Adjacency.GetNeighbours(CellIndex))
         {
-            const FJCVCell* Neighbour(MapRef.GetCell(Site));
-
-            if (! Neighbour || VisitedSet.Contains(Neighbour))
+            if (Visited->IsVisited(ni))
             {
                 continue;
             }
 
-            TArray<FVector2D> Points;
-            MapRef->GetPoints(*Site, Points);
+            const FJCVCell* Neighbour(&MapRef.GetCell(ni));
+
+            // Visit neighbour if any of its points is within radius
 
-            for (const FVector2D& Point : Points)
+            for (const FJCVEdge* g = Neighbour->GetEdge(); g; g = g->next)
             {
-                if ((Point-Center).SizeSquared() < RadiusSq)
+                if ((FJCVMathUtil::ToVector2D(g->pos[0])-Center).SizeSquared() < RadiusSq)
                 {
-                    VisitedSet.Emplace(Neighbour);
-                    ExpandQueue.Enqueue(Neighbour);
+                    Visited->MarkVisited(ni);
+                    ExpandQueue.Emplace(ni);
 
                     if (bAgainstAnyType || Neighbour->IsType(FeatureId.Type, FeatureId.Index))
                     {
@@ -2441,34 +2522,32 @@ FJCVCellRefGroup UJCVDiagramAccessor::ExpandCellQuery(const FJCVCellRef& CellRef
     }
 
     FJCVDiagramMap& MapRef(*Map);
-    TSet<const FJCVCell*> VisitedSet;
-    TArray<const FJCVCell*> ExpandQueue0;
-    TArray<const FJCVCell*> ExpandQueue1;
+    const FJCVDiagramAdjacency& Adjacency(MapRef.GetAdjacency());
+    FJCVCellVisitScope Visited(MapRef.GetVisitStamp(), MapRef.Num());
+    TArray<int32>& ExpandQueue(Visited->GetQueue());
 
     Cells.Emplace(CellRef);
-    VisitedSet.Emplace(CellRef.Data);
-    ExpandQueue0.Emplace(CellRef.Data);
+    Visited->MarkVisited(CellRef.Data->GetIndex());
+    ExpandQueue.Emplace(CellRef.Data->GetIndex());
+
+    int32 ExpandBegin = 0;
 
     for (int32 It=0; It<ExpandCount; ++It)
     {
-        for (const FJCVCell* Cell : ExpandQueue0)
-        {
-            check(Cell);
+        const int32 ExpandEnd = ExpandQueue.Num();
 
-            TArray<const FJCVSite*> Neighbours;
-            MapRef->GetNeighbours(*Cell->Site, Neighbours);
-
-            for (const FJCVSite* Site : Neighbours)
+        for (int32 i=ExpandBegin; i<ExpandEnd; ++i)
+        {
+            for (int32 ni : Adjacency.GetNeighbours(ExpandQueue[i]))
             {
-                const FJCVCell* Neighbour(MapRef.GetCell(Site));
-
-                if (! Neighbour || VisitedSet.Contains(Neighbour))
+                if (! Visited->TryVisit(ni))
                 {
                     continue;
                 }
 
-                VisitedSet.Emplace(Neighbour);
-                ExpandQueue1.Emplace(Neighbour);
+                const FJCVCell* Neighbour(&MapRef.GetCell(ni));
+
+                ExpandQueue.Emplace(ni);
 
                 if (bAgainstAnyType || Neighbour->IsType(FeatureId.Type, FeatureId.Index))
                 {
@@ -2477,7 +2556,7 @@ FJCVCellRefGroup UJCVDiagramAccessor::ExpandCellQuery(const FJCVCellRef& CellRef
             }
         }
 
-        ExpandQueue0 = MoveTemp(ExpandQueue1);
+        ExpandBegin = ExpandEnd;
     }
 
     return CellGroup;
@@ -2494,13 +2573,11 @@ FJCVCellRefGroup UJCVDiagramAccessor::ExpandCellGroupQuery(const FJCVCellRefGrou
     }
 
     FJCVDiagramMap& MapRef(*Map);
-    TSet<const FJCVCell*> VisitedSet;
-    TArray<const FJCVCell*> ExpandQueue0;
-    TArray<const FJCVCell*> ExpandQueue1;
+    const FJCVDiagramAdjacency& Adjacency(MapRef.GetAdjacency());
+    FJCVCellVisitScope Visited(MapRef.GetVisitStamp(), MapRef.Num());
+    TArray<int32>& ExpandQueue(Visited->GetQueue());
 
     Cells.Reserve(CellGroup.Data.Num());
-    VisitedSet.Reserve(CellGroup.Data.Num());
-    ExpandQueue0.Reserve(CellGroup.Data.Num());
 
     for (const FJCVCellRef& CellRef : CellGroup.Data)
     {
@@ -2509,31 +2586,32 @@ FJCVCellRefGroup UJCVDiagramAccessor::ExpandCellGroupQuery(const FJCVCellRefGrou
         if (Cell)
         {
             Cells.Emplace(Cell);
-            VisitedSet.Emplace(Cell);
-            ExpandQueue0.Emplace(Cell);
+
+            if (Visited->TryVisit(Cell->GetIndex()))
+            {
+                ExpandQueue.Emplace(Cell->GetIndex());
+            }
         }
     }
 
+    int32 ExpandBegin = 0;
+
     for (int32 It=0; It<ExpandCount; ++It)
     {
-        for (const FJCVCell* Cell : ExpandQueue0)
-        {
-            check(Cell);
+        const int32 ExpandEnd = ExpandQueue.Num();
 
-            TArray<const FJCVSite*> Neighbours;
-            MapRef->GetNeighbours(*Cell->Site, Neighbours);
-
-            for (const FJCVSite* Site : Neighbours)
+        for (int32 i=ExpandBegin; i<ExpandEnd; ++i)
+        {
+            for (int32 ni : Adjacency.GetNeighbours(ExpandQueue[i]))
             {
-                const FJCVCell* Neighbour(MapRef.GetCell(Site));
-
-                if (! Neighbour || VisitedSet.Contains(Neighbour))
+                if (! Visited->TryVisit(ni))
                 {
                     continue;
                 }
 
-                VisitedSet.Emplace(Neighbour);
-                ExpandQueue1.Emplace(Neighbour);
+                const FJCVCell* Neighbour(&MapRef.GetCell(ni));
+
+                ExpandQueue.Emplace(ni);
 
                 if (bAgainstAnyType || Neighbour->IsType(FeatureId.Type, FeatureId.Index))
                 {
@@ -2542,7 +2620,7 @@ FJCVCellRefGroup UJCVDiagramAccessor::ExpandCellGroupQuery(const FJCVCellRefGrou
             }
         }
 
-        ExpandQueue0 = MoveTemp(ExpandQueue1);
+        ExpandBegin = ExpandEnd;
     }
 
     return OutGroup;
@@ -2587,35 +2665,112 @@ FJCVCellRefGroup UJCVDiagramAccessor::MergeCellGroups(const TArray<FJCVCellRefGr
     FJCVCellRefGroup CellGroup;
     TArray<FJCVCellRef>& Cells(CellGroup.Data);
 
-    TSet<const FJCVCell*> CellSet;
-    int32 CellCount = 0;
-
-    for (const FJCVCellRefGroup& cg : CellGroups)
+    if (! HasValidMap())
     {
-        CellCount += cg.Data.Num();
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::MergeCellGroups() ABORTED, INVALID MAP"));
+        return CellGroup;
     }
 
-    CellSet.Reserve(CellCount);
+    FJCVCellBitSet CellSet(Map->Num());
 
     for (const FJCVCellRefGroup& cg : CellGroups)
     for (const FJCVCellRef& Cell : cg.Data)
     {
-        if (Cell.Data)
+        if (Cell.Data && CellSet.IsValidIndex(Cell.Data->GetIndex()))
         {
-            CellSet.Emplace(Cell.Data);
+            CellSet.Add(Cell.Data->GetIndex());
         }
     }
 
     Cells.Reserve(CellSet.Num());
 
-    for (const FJCVCell* Cell : CellSet)
+    for (int32 i : CellSet)
     {
-        Cells.Emplace(Cell);
+        Cells.Emplace(&Map->GetCell(i));
     }
 
     return CellGroup;
 }
 
+void UJCVDiagramAccessor::GetFeatureCellSet(FJCVCellBitSet& CellSet, const TArray<FJCVFeatureId>& FeatureIds) const
+{
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::GetFeatureCellSet() ABORTED, INVALID MAP"));
+        CellSet.Empty();
+        return;
+    }
+
+    CellSet.Init(Map->Num());
+
+    for (const FJCVFeatureId& FeatureId : FeatureIds)
+    {
+        Map->AddFeatureCells(CellSet, FeatureId.Type, FeatureId.Index);
+    }
+}
+
+void UJCVDiagramAccessor::GetFeatureUnionCells(TArray<int32>& CellIndices, const TArray<FJCVFeatureId>& FeatureIdsA, const TArray<FJCVFeatureId>& FeatureIdsB) const
+{
+    CellIndices.Reset();
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::GetFeatureUnionCells() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    // Union adds both feature sets into a single cell set
+    FJCVCellBitSet CellSet;
+    GetFeatureCellSet(CellSet, FeatureIdsA);
+
+    for (const FJCVFeatureId& FeatureId : FeatureIdsB)
+    {
+        Map->AddFeatureCells(CellSet, FeatureId.Type, FeatureId.Index);
+    }
+
+    CellSet.ToIndices(CellIndices);
+}
+
+void UJCVDiagramAccessor::GetFeatureIntersectionCells(TArray<int32>& CellIndices, const TArray<FJCVFeatureId>& FeatureIdsA, const TArray<FJCVFeatureId>& FeatureIdsB) const
+{
+    CellIndices.Reset();
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::GetFeatureIntersectionCells() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    FJCVCellBitSet CellSetA;
+    FJCVCellBitSet CellSetB;
+
+    GetFeatureCellSet(CellSetA, FeatureIdsA);
+    GetFeatureCellSet(CellSetB, FeatureIdsB);
+
+    CellSetA &= CellSetB;
+    CellSetA.ToIndices(CellIndices);
+}
+
+void UJCVDiagramAccessor::GetFeatureDifferenceCells(TArray<int32>& CellIndices, const TArray<FJCVFeatureId>& FeatureIdsA, const TArray<FJCVFeatureId>& FeatureIdsB) const
+{
+    CellIndices.Reset();
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::GetFeatureDifferenceCells() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    FJCVCellBitSet CellSetA;
+    FJCVCellBitSet CellSetB;
+
+    GetFeatureCellSet(CellSetA, FeatureIdsA);
+    GetFeatureCellSet(CellSetB, FeatureIdsB);
+
+    CellSetA -= CellSetB;
+    CellSetA.ToIndices(CellIndices);
+}
+
 TArray<FJCVCellJunctionRef> UJCVDiagramAccessor::FilterUniqueJunctions(const TArray<FJCVCellJunctionRef>& Junctions)
 {
     TArray<FJCVCellJunctionRef> UniqueJunctions;
@@ -2693,6 +2848,122 @@ float UJCVDiagramAccessor::GetFurthestDistanceToFeature(const FJCVCellRef& Origi
     return FJCVCellUtility::GetFurthestDistanceFromCell(*Map, *OriginCell, FeatureId, false);
 }
 
+void UJCVDiagramAccessor::GetPathCellRefs(TArray<FJCVCellRef>& PathCellRefs)
+{
+    PathCellRefs.Reset(QueryPath.Num());
+
+    for (int32 CellIndex : QueryPath)
+    {
+        PathCellRefs.Emplace(&Map->GetCell(CellIndex));
+    }
+}
+
+bool UJCVDiagramAccessor::FindPath(
+    const FJCVCellRef& StartCellRef,
+    const FJCVCellRef& GoalCellRef,
+    TArray<FJCVCellRef>& PathCellRefs,
+    float& PathCost,
+    const TArray<float>& TypeCostMultipliers
+    )
+{
+    PathCellRefs.Reset();
+    PathCost = 0.f;
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindPath() ABORTED, INVALID MAP"));
+        return false;
+    }
+
+    if (! Map->IsValidCell(StartCellRef.Data) || ! Map->IsValidCell(GoalCellRef.Data))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindPath() ABORTED, INVALID START OR GOAL CELL"));
+        return false;
+    }
+
+    FJCVPathParams Params;
+    Params.TypeCostMultipliers = TypeCostMultipliers;
+
+    const bool bFound = FJCVPathFinder::FindPath(
+        *Map,
+        StartCellRef.Data->GetIndex(),
+        GoalCellRef.Data->GetIndex(),
+        Params,
+        QueryPath,
+        &PathCost
+        );
+
+    if (bFound)
+    {
+        GetPathCellRefs(PathCellRefs);
+    }
+
+    return bFound;
+}
+
+void UJCVDiagramAccessor::BuildPathHierarchy(const TArray<float>& TypeCostMultipliers)
+{
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::BuildPathHierarchy() ABORTED, INVALID MAP"));
+        return;
+    }
+
+    if (! PathHierarchy.IsValid())
+    {
+        PathHierarchy = MakeShared<FJCVPathHierarchy>();
+    }
+
+    FJCVPathParams Params;
+    Params.TypeCostMultipliers = TypeCostMultipliers;
+
+    PathHierarchy->Build(*Map, Params);
+}
+
+bool UJCVDiagramAccessor::FindHierarchicalPath(
+    const FJCVCellRef& StartCellRef,
+    const FJCVCellRef& GoalCellRef,
+    TArray<FJCVCellRef>& PathCellRefs,
+    float& PathCost
+    )
+{
+    PathCellRefs.Reset();
+    PathCost = 0.f;
+
+    if (! HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindHierarchicalPath() ABORTED, INVALID MAP"));
+        return false;
+    }
+
+    if (! PathHierarchy.IsValid() || ! PathHierarchy->IsValidFor(*Map))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindHierarchicalPath() ABORTED, PATH HIERARCHY NOT BUILT"));
+        return false;
+    }
+
+    if (! Map->IsValidCell(StartCellRef.Data) || ! Map->IsValidCell(GoalCellRef.Data))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramAccessor::FindHierarchicalPath() ABORTED, INVALID START OR GOAL CELL"));
+        return false;
+    }
+
+    const bool bFound = PathHierarchy->FindPath(
+        *Map,
+        StartCellRef.Data->GetIndex(),
+        GoalCellRef.Data->GetIndex(),
+        QueryPath,
+        &PathCost
+        );
+
+    if (bFound)
+    {
+        GetPathCellRefs(PathCellRefs);
+    }
+
+    return bFound;
+}
+
 // CELL UTILITY FUNCTIONS
 
 //TArray<int32> UJCVDiagramAccessor::GenerateCellGridIndices(const FJCVCellRef& Cell, const FIntPoint& GridDimension, const float BoundsExpand)
@@ -3046,13 +3317,13 @@ void UJCVDiagramAccessor::GenerateDualGeometryByFeature(FJCVDualGeometry& Geomet
             {
                 CenterVertIndex = Points.Num();
                 CenterCellIndexMap.Emplace(CenterCellIndex, CenterVertIndex);
-                Points.Emplace(CenterCell.ToVector2D(), CenterCell.Value);
+                Points.Emplace(CenterCell.ToVector2D(), CenterCell.GetValue());
             }
 
             int32 IndexOffset = Points.Num();
 
-            Points.Emplace(NeighbourCell0.ToVector2D(), NeighbourCell0.Value);
-            Points.Emplace(NeighbourCell1.ToVector2D(), NeighbourCell1.Value);
+            Points.Emplace(NeighbourCell0.ToVector2D(), NeighbourCell0.GetValue());
+            Points.Emplace(NeighbourCell1.ToVector2D(), NeighbourCell1.GetValue());
 
             PolyIndices.Emplace(IndexOffset+1);
             PolyIndices.Emplace(IndexOffset  );
@@ -3061,7 +3332,7 @@ void UJCVDiagramAccessor::GenerateDualGeometryByFeature(FJCVDualGeometry& Geomet
 
     for (const int32 fi : FeatureIndices)
     {
-        const FJCVCellGroup& CellGroup(FeatureGroup.CellGroups[fi]);
+        const FJCVCellGroupView& CellGroup(FeatureGroup.CellGroups[fi]);
 
         for (const FJCVCell* FeatureCell : CellGroup)
         {
@@ -3126,7 +3397,7 @@ void UJCVDiagramAccessor::GeneratePolyGeometryByFeature(UPARAM(ref) FJCVPolyGeom
 
     for (const int32 fi : FeatureIndices)
     {
-        const FJCVCellGroup& CellGroup(FeatureGroup.CellGroups[fi]);
+        const FJCVCellGroupView& CellGroup(FeatureGroup.CellGroups[fi]);
 
         for (const FJCVCell* FeatureCell : CellGroup)
         {
@@ -3203,9 +3474,9 @@ void UJCVDiagramAccessor::GetPointDualGeometry(
     int32 i1 = i0 + 1;
     int32 i2 = i0 + 2;
 
-    Points.Emplace(Cell0.ToVector2D(), Cell0.Value);
-    Points.Emplace(Cell1.ToVector2D(), Cell1.Value);
-    Points.Emplace(Cell2.ToVector2D(), Cell2.Value);
+    Points.Emplace(Cell0.ToVector2D(), Cell0.GetValue());
+    Points.Emplace(Cell1.ToVector2D(), Cell1.GetValue());
+    Points.Emplace(Cell2.ToVector2D(), Cell2.GetValue());
 
     PolyIndices.Emplace(i0);
     PolyIndices.Emplace(i1);
@@ -3240,21 +3511,21 @@ void UJCVDiagramAccessor::GetPointDualGeometry(
     {
         CellIndexMap.Emplace(ci0, Points.Num());
         CellIndices.Emplace(ci0);
-        Points.Emplace(Cell0.ToVector2D(), Cell0.Value);
+        Points.Emplace(Cell0.ToVector2D(), Cell0.GetValue());
     }
 
     if (! CellIndexMap.Contains(ci1))
     {
         CellIndexMap.Emplace(ci1, Points.Num());
         CellIndices.Emplace(ci1);
-        Points.Emplace(Cell1.ToVector2D(), Cell1.Value);
+        Points.Emplace(Cell1.ToVector2D(), Cell1.GetValue());
     }
 
     if (! CellIndexMap.Contains(ci2))
     {
         CellIndexMap.Emplace(ci2, Points.Num());
         CellIndices.Emplace(ci2);
-        Points.Emplace(Cell2.ToVector2D(), Cell2.Value);
+        Points.Emplace(Cell2.ToVector2D(), Cell2.GetValue());
     }
 
     PolyIndices.Emplace(CellIndexMap.FindChecked(ci2));
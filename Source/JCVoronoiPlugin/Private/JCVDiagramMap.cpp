@@ -26,337 +26,1326 @@
 // 
 
 #include "JCVDiagramMap.h"
+#include "JCVDistanceField.h"
+#include "Async/ParallelFor.h"
 
-FJCVDiagramMap::FJCVDiagramMap(FJCVDiagramContext& d) : Diagram(d)
+// -- CELL STORAGE
+
+void FJCVCellStorage::RecordFeatureChange(int32 i, uint8 t, int32 fi)
 {
-    Init(JCV_CF_UNMARKED, 0);
+    if (FeatureChanges.Num() < MaxFeatureChanges)
+    {
+        FJCVFeatureChange Change;
+        Change.CellIndex = i;
+        Change.OldIndex = FeatureIndices[i];
+        Change.NewIndex = fi;
+        Change.OldType = FeatureTypes[i];
+        Change.NewType = t;
+        FeatureChanges.Emplace(Change);
+    }
+    else
+    {
+        // Journal overflow, feature groups require a full rebuild
+        FeatureChanges.Empty();
+        bRecordFeatureChanges = false;
+        bFeatureChangesOverflow = true;
+    }
 }
 
-FJCVDiagramMap::FJCVDiagramMap(FJCVDiagramContext& d, uint8 FeatureType, int32 FeatureIndex) : Diagram(d)
+void FJCVCellStorage::SetValues(float Value)
 {
-    Init(FeatureType, FeatureIndex);
+    float* Data = Values.GetData();
+    const int32 CellCount = Num();
+    const int32 VectorCount = CellCount & ~3;
+    const VectorRegister ValueVector = VectorSetFloat1(Value);
+
+    int32 i = 0;
+
+    for (; i<VectorCount; i+=4)
+    {
+        VectorStore(ValueVector, Data+i);
+    }
+
+    for (; i<CellCount; ++i)
+    {
+        Data[i] = Value;
+    }
 }
 
-FJCVDiagramMap::FJCVDiagramMap(const FJCVDiagramMap& SrcMap)
-    : Diagram(SrcMap.Diagram)
+void FJCVCellStorage::InvertValues(uint8 FeatureType, int32 FeatureIndex)
 {
-    // Copy cells
+    float* Data = Values.GetData();
+    const int32 CellCount = Num();
+    const int32 VectorCount = CellCount & ~3;
+    const VectorRegister OneVector = VectorOne();
 
-    Cells = SrcMap.Cells;
+    // Cells without feature index are excluded
+    auto IsMasked = [&](int32 i) { return IsType(i, FeatureType, FeatureIndex) && FeatureIndices[i] >= 0; };
+    auto GetMask = [&](int32 i) { return IsMasked(i) ? 0xFFFFFFFF : 0; };
+
+    int32 i = 0;
+
+    for (; i<VectorCount; i+=4)
+    {
+        const VectorRegister Mask = MakeVectorRegister(GetMask(i), GetMask(i+1), GetMask(i+2), GetMask(i+3));
+        const VectorRegister Value = VectorLoad(Data+i);
+        VectorStore(VectorSelect(Mask, VectorSubtract(OneVector, Value), Value), Data+i);
+    }
+
+    for (; i<CellCount; ++i)
+    {
+        if (IsMasked(i))
+        {
+            Data[i] = 1.f-Data[i];
+        }
+    }
+}
+
+void FJCVCellStorage::ScaleValuesByFeatureIndex(uint8 FeatureType, float IndexOffset, float IndexScale)
+{
+    float* Data = Values.GetData();
+    const int32 CellCount = Num();
+    const int32 VectorCount = CellCount & ~3;
 
-    // Copy feature groups
+    // Cells without feature index are excluded
+    auto GetScale = [&](int32 i)
+    {
+        return (FeatureTypes[i] == FeatureType && FeatureIndices[i] >= 0)
+            ? (FeatureIndices[i]+IndexOffset) * IndexScale
+            : 1.f;
+    };
+
+    int32 i = 0;
+
+    for (; i<VectorCount; i+=4)
+    {
+        const VectorRegister Scale = MakeVectorRegister(GetScale(i), GetScale(i+1), GetScale(i+2), GetScale(i+3));
+        VectorStore(VectorMultiply(VectorLoad(Data+i), Scale), Data+i);
+    }
+
+    for (; i<CellCount; ++i)
+    {
+        Data[i] *= GetScale(i);
+    }
+}
+
+// -- FEATURE MEMBERSHIP
+
+void FJCVFeatureMembership::Build(const FJCVCellStorage& Storage)
+{
+    const int32 CellCount = Storage.Num();
+    const uint8* Types = Storage.FeatureTypes.GetData();
+    const int32* Indices = Storage.FeatureIndices.GetData();
+
+    // Find feature type count and group count of each feature type
+
+    int32 GroupCounts[256] = { 0 };
+    int32 TypeCount = 0;
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        const uint8 t = Types[i];
+        TypeCount = FMath::Max<int32>(TypeCount, t+1);
+        GroupCounts[t] = FMath::Max(GroupCounts[t], Indices[i]+1);
+    }
 
-    const int32 FeatureGroupCount = SrcMap.GetFeatureCount();
-    FeatureGroups.SetNum(FeatureGroupCount);
+    TypeOffsets.SetNumUninitialized(TypeCount+1, false);
+    TypeOffsets[0] = 0;
 
-    for (int32 fgi=0; fgi<FeatureGroupCount; ++fgi)
+    for (int32 t=0; t<TypeCount; ++t)
     {
-        const FJCVFeatureGroup& SrcFeatureGroup(*SrcMap.GetFeatureGroup(fgi));
-        FJCVFeatureGroup& DstFeatureGroup(FeatureGroups[fgi]);
+        TypeOffsets[t+1] = TypeOffsets[t] + GroupCounts[t];
+    }
+
+    const int32 GroupCount = TypeOffsets[TypeCount];
 
-        const int32 CellGroupCount = SrcFeatureGroup.CellGroups.Num();
-        DstFeatureGroup.CellGroups.SetNum(CellGroupCount);
+    // Count group cells, offset by one slot for the exclusive prefix sum
 
-        for (int32 cgi=0; cgi<CellGroupCount; ++cgi)
+    GroupOffsets.Reset();
+    GroupOffsets.SetNumZeroed(GroupCount+1, false);
+
+    int32* Offsets = GroupOffsets.GetData();
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (Indices[i] >= 0)
         {
-            const FJCVCellGroup& SrcCellGroup(SrcFeatureGroup.CellGroups[cgi]);
-            FJCVCellGroup& DstCellGroup(DstFeatureGroup.CellGroups[cgi]);
+            ++Offsets[TypeOffsets[Types[i]]+Indices[i]+1];
+        }
+    }
+
+    for (int32 g=0; g<GroupCount; ++g)
+    {
+        Offsets[g+1] += Offsets[g];
+    }
 
-            DstCellGroup.SetNumUninitialized(SrcCellGroup.Num());
+    // Scatter cell indices in cell order, group offsets are advanced to
+    // the group end and shifted back to the group start afterwards
 
-            for (int32 ci=0; ci<SrcCellGroup.Num(); ++ci)
-            {
-                DstCellGroup[ci] = GetCell(SrcCellGroup[ci]->Site);
-            }
+    CellIndices.SetNumUninitialized(Offsets[GroupCount], false);
+    CellSlots.SetNumUninitialized(CellCount, false);
+
+    int32* Dst = CellIndices.GetData();
+    int32* Slots = CellSlots.GetData();
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (Indices[i] >= 0)
+        {
+            const int32 Slot = Offsets[TypeOffsets[Types[i]]+Indices[i]]++;
+            Dst[Slot] = i;
+            Slots[i] = Slot;
         }
+        else
+        {
+            Slots[i] = INDEX_NONE;
+        }
+    }
+
+    if (GroupCount > 0)
+    {
+        FMemory::Memmove(Offsets+1, Offsets, (GroupCount-1) * sizeof(int32));
+        Offsets[0] = 0;
     }
+
+    InitGroupNums();
 }
 
-void FJCVDiagramMap::Init(uint8 FeatureType, int32 FeatureIndex)
+void FJCVFeatureMembership::BuildParallel(const FJCVCellStorage& Storage)
 {
-    // Diagram is empty, no further action required
-    if (Diagram.IsEmpty())
+    const int32 MinChunkSize = 65536;
+
+    const int32 CellCount = Storage.Num();
+    const int32 ChunkCount = FMath::Min(FPlatformMisc::NumberOfCoresIncludingHyperthreads(), CellCount/MinChunkSize);
+
+    if (ChunkCount < 2)
     {
+        Build(Storage);
         return;
     }
 
-    const int32 CellCount = Diagram.GetSiteNum();
-    const FJCVSite* Sites = Diagram.GetSites();
+    const int32 ChunkSize = FMath::DivideAndRoundUp(CellCount, ChunkCount);
+    const uint8* Types = Storage.FeatureTypes.GetData();
+    const int32* Indices = Storage.FeatureIndices.GetData();
 
-    Cells.SetNumUninitialized(CellCount);
+    // Find feature type count and group count of each feature type per chunk
 
-    for (int32 i=0; i<CellCount; ++i)
+    TArray<int32> ChunkGroupCounts;
+    TArray<int32> ChunkTypeCounts;
+    ChunkGroupCounts.SetNumZeroed(ChunkCount*256);
+    ChunkTypeCounts.SetNumZeroed(ChunkCount);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
     {
-        bool bIsBorder = false;
-        const FJCVSite& s(Sites[i]);
-        const FJCVEdge* g(s.edges);
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
 
-        while (g)
+        int32* GroupCounts = ChunkGroupCounts.GetData() + ci*256;
+        int32 TypeCount = 0;
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
         {
-            if (! g->neighbor)
-            {
-                bIsBorder = true;
-                break;
-            }
+            const uint8 t = Types[i];
+            TypeCount = FMath::Max<int32>(TypeCount, t+1);
+            GroupCounts[t] = FMath::Max(GroupCounts[t], Indices[i]+1);
+        }
 
-            g = g->next;
+        ChunkTypeCounts[ci] = TypeCount;
+    });
+
+    int32 TypeCount = 0;
+
+    for (int32 ci=0; ci<ChunkCount; ++ci)
+    {
+        TypeCount = FMath::Max(TypeCount, ChunkTypeCounts[ci]);
+    }
+
+    TypeOffsets.SetNumUninitialized(TypeCount+1, false);
+    TypeOffsets[0] = 0;
+
+    for (int32 t=0; t<TypeCount; ++t)
+    {
+        int32 GroupCount = 0;
+
+        for (int32 ci=0; ci<ChunkCount; ++ci)
+        {
+            GroupCount = FMath::Max(GroupCount, ChunkGroupCounts[ci*256+t]);
         }
 
-        Cells[s.index] = FJCVCell(s, 0.f, bIsBorder, FeatureType, FeatureIndex);
+        TypeOffsets[t+1] = TypeOffsets[t] + GroupCount;
     }
-}
 
-// -- FEATURE OPERATIONS
+    const int32 GroupCount = TypeOffsets[TypeCount];
 
-void FJCVDiagramMap::ClearFeatures()
-{
-    FeatureGroups.Empty();
-}
+    // Per chunk histograms outgrow the cells, serial sort is cheaper
 
-void FJCVDiagramMap::ResetFeatures(uint8 FeatureType, int32 FeatureIndex)
-{
-    if (FeatureIndex < 0)
+    if (int64(GroupCount) * ChunkCount > CellCount)
     {
-        const FJCVFeatureGroup* pft = GetFeatureGroup(FeatureType);
-        if (! pft)
-            return;
-        const FJCVFeatureGroup& ft( *pft );
+        Build(Storage);
+        return;
+    }
 
-        for (int32 i=0; i<ft.GetGroupCount(); ++i)
+    // Count group cells of each chunk
+
+    TArray<int32> ChunkOffsets;
+    ChunkOffsets.SetNumZeroed(ChunkCount*GroupCount);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        int32* Counts = ChunkOffsets.GetData() + ci*GroupCount;
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
         {
-            bool bResult = true;
-            const FJCVCellGroup& fg( ft.CellGroups[i] );
-            for (FJCVCell* c : fg)
-                if (c)
-                    c->SetType(JCV_CF_UNMARKED);
+            if (Indices[i] >= 0)
+            {
+                ++Counts[TypeOffsets[Types[i]]+Indices[i]];
+            }
+        }
+    });
+
+    // Exclusive prefix sum in (group, chunk) order, chunk histograms become
+    // the chunk write offsets of each group
+
+    GroupOffsets.SetNumUninitialized(GroupCount+1, false);
+
+    int32 Offset = 0;
+
+    for (int32 g=0; g<GroupCount; ++g)
+    {
+        GroupOffsets[g] = Offset;
+
+        for (int32 ci=0; ci<ChunkCount; ++ci)
+        {
+            int32& ChunkOffset(ChunkOffsets[ci*GroupCount+g]);
+            const int32 Count = ChunkOffset;
+            ChunkOffset = Offset;
+            Offset += Count;
         }
     }
-    else
+
+    GroupOffsets[GroupCount] = Offset;
+
+    // Scatter cell indices, each chunk writes its own group ranges in cell order
+
+    CellIndices.SetNumUninitialized(Offset, false);
+    CellSlots.SetNumUninitialized(CellCount, false);
+
+    int32* Dst = CellIndices.GetData();
+    int32* Slots = CellSlots.GetData();
+
+    ParallelFor(ChunkCount, [&](int32 ci)
     {
-        FJCVCellGroup* f = GetFeatureCellGroup(FeatureType, FeatureIndex);
-        if (f)
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        int32* Cursors = ChunkOffsets.GetData() + ci*GroupCount;
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
         {
-            const FJCVCellGroup& fg( *f );
-            for (FJCVCell* c : fg)
-                if (c)
-                    c->SetType(JCV_CF_UNMARKED);
+            if (Indices[i] >= 0)
+            {
+                const int32 Slot = Cursors[TypeOffsets[Types[i]]+Indices[i]]++;
+                Dst[Slot] = i;
+                Slots[i] = Slot;
+            }
+            else
+            {
+                Slots[i] = INDEX_NONE;
+            }
         }
+    });
+
+    InitGroupNums();
+}
+
+void FJCVFeatureMembership::InitGroupNums()
+{
+    const int32 GroupCount = GroupOffsets.Num()-1;
+
+    GroupNums.SetNumUninitialized(GroupCount, false);
+
+    for (int32 g=0; g<GroupCount; ++g)
+    {
+        GroupNums[g] = GroupOffsets[g+1]-GroupOffsets[g];
     }
+
+    GroupCapacities = GroupNums;
+    DeadCount = 0;
 }
 
-void FJCVDiagramMap::GroupByFeatures()
+bool FJCVFeatureMembership::Patch(TArrayView<const FJCVFeatureChange> Changes)
 {
-    const int32 cellN = Num();
+    // Moved groups waste more space than the packed cell indices, rebuild
 
-    FeatureGroups.Reset();
+    if (DeadCount > GroupOffsets.Last())
+    {
+        return false;
+    }
 
-    for (FJCVCell& c : Cells)
+    for (const FJCVFeatureChange& Change : Changes)
     {
-        if (! FeatureGroups.IsValidIndex(c.FeatureType))
+        // Cell leaves its old cell group, last group cell is moved into its place
+
+        if (Change.OldIndex >= 0)
         {
-            FeatureGroups.SetNum(c.FeatureType+1);
+            if (Change.OldIndex >= GetGroupCount(Change.OldType))
+            {
+                return false;
+            }
+
+            const int32 Group = TypeOffsets[Change.OldType]+Change.OldIndex;
+            const int32 Slot = CellSlots[Change.CellIndex];
+            const int32 LastSlot = GroupOffsets[Group] + (--GroupNums[Group]);
+            const int32 LastCell = CellIndices[LastSlot];
+
+            CellIndices[Slot] = LastCell;
+            CellSlots[LastCell] = Slot;
+            CellSlots[Change.CellIndex] = INDEX_NONE;
         }
 
-        FeatureGroups[c.FeatureType].AddCell(c, cellN);
+        // Cell joins its new cell group, full groups are moved to the end
+        // of the cell index array with doubled capacity
+
+        if (Change.NewIndex >= 0)
+        {
+            if (Change.NewIndex >= GetGroupCount(Change.NewType))
+            {
+                return false;
+            }
+
+            const int32 Group = TypeOffsets[Change.NewType]+Change.NewIndex;
+
+            // Cells added since the build have no slot yet
+            if (Change.CellIndex >= CellSlots.Num())
+            {
+                CellSlots.SetNumUninitialized(Change.CellIndex+1, false);
+            }
+
+            if (GroupNums[Group] == GroupCapacities[Group])
+            {
+                const int32 Capacity = FMath::Max(GroupCapacities[Group]*2, 16);
+                const int32 Offset = CellIndices.AddUninitialized(Capacity);
+
+                for (int32 i=0; i<GroupNums[Group]; ++i)
+                {
+                    const int32 Cell = CellIndices[GroupOffsets[Group]+i];
+                    CellIndices[Offset+i] = Cell;
+                    CellSlots[Cell] = Offset+i;
+                }
+
+                DeadCount += GroupCapacities[Group];
+                GroupOffsets[Group] = Offset;
+                GroupCapacities[Group] = Capacity;
+            }
+
+            const int32 Slot = GroupOffsets[Group] + (GroupNums[Group]++);
+
+            CellIndices[Slot] = Change.CellIndex;
+            CellSlots[Change.CellIndex] = Slot;
+        }
     }
 
-    for (int32 i=0; i<GetFeatureCount(); ++i)
+    return true;
+}
+
+FJCVDiagramMap::FJCVDiagramMap(FJCVDiagramContext& d) : Diagram(d)
+{
+    Init(JCV_CF_UNMARKED, 0);
+}
+
+FJCVDiagramMap::FJCVDiagramMap(FJCVDiagramContext& d, uint8 FeatureType, int32 FeatureIndex) : Diagram(d)
+{
+    Init(FeatureType, FeatureIndex);
+}
+
+FJCVDiagramMap::FJCVDiagramMap(const FJCVDiagramMap& SrcMap)
+    : Diagram(SrcMap.Diagram)
+{
+    // Copy cells, rebind cell storage
+
+    Cells = SrcMap.Cells;
+    CellStorage = SrcMap.CellStorage;
+
+    for (FJCVCell& Cell : Cells)
     {
-        FeatureGroups[i].SetType((uint8) i);
+        Cell.Storage = &CellStorage;
     }
 
-    for (FJCVFeatureGroup& fg : FeatureGroups)
+    // Copy feature groups, cell group views are rebuilt over the copied cells
+
+    if (SrcMap.GetFeatureCount() > 0)
+    {
+        FeatureGroups = SrcMap.FeatureGroups;
+        UpdateFeatureMembership();
+    }
+    else
     {
-        fg.Shrink();
+        CellStorage.StopFeatureJournal();
     }
 }
 
-void FJCVDiagramMap::ExpandFeature(uint8 ft, int32 fi)
+void FJCVDiagramMap::Init(uint8 FeatureType, int32 FeatureIndex)
 {
-    if (! HasCells(ft, fi))
+    // Diagram is empty, no further action required
+    if (Diagram.IsEmpty())
+    {
         return;
+    }
 
-    FJCVCellGroup& cellG( FeatureGroups[ft].CellGroups[fi] );
-    FJCVCellSet cellS( cellG );
+    const int32 CellCount = Diagram.GetSiteNum();
+    const FJCVSite* Sites = Diagram.GetSites();
 
-    for (FJCVCell* c : cellG)
+    Cells.SetNumUninitialized(CellCount);
+    CellStorage.Init(CellCount, FeatureType, FeatureIndex);
+
+    for (int32 i=0; i<CellCount; ++i)
     {
-        check(c);
-        FJCVEdge* g = c->GetEdge();
+        bool bIsBorder = false;
+        const FJCVSite& s(Sites[i]);
+        const FJCVEdge* g(s.edges);
+
         while (g)
         {
-            FJCVCell* n = GetCell(g->neighbor);
-            if (n && ! cellS.Contains(n))
+            if (! g->neighbor)
             {
-                cellS.Emplace(n);
-                n->SetType(ft, fi);
+                bIsBorder = true;
+                break;
             }
+
             g = g->next;
         }
+
+        Cells[s.index] = FJCVCell(s, CellStorage);
+        CellStorage.BorderFlags[s.index] = bIsBorder;
     }
 }
 
-void FJCVDiagramMap::ExpandFeature(uint8 ft)
+// -- DIAGRAM UPDATE OPERATIONS
+
+void FJCVDiagramMap::ApplySiteUpdate(const FJCVDiagramContext::FSiteUpdate& Update)
 {
-    if (! HasCellGroups(ft))
-        return;
+    const bool bHasFeatureGroups = GetFeatureCount() > 0;
 
-    FJCVFeatureGroup& featureGroup( FeatureGroups[ft] );
+    // Diagram regenerated, rebuild cells and restore cell attributes by index
 
-    for (int32 fi=0; fi<featureGroup.GetGroupCount(); ++fi)
+    if (Update.bRegenerated)
     {
-        if (! featureGroup.HasCells(fi))
+        FJCVCellStorage SrcStorage(MoveTemp(CellStorage));
+
+        Cells.Reset();
+        CellStorage.Empty();
+        ClearFeatures();
+        Init(JCV_CF_UNMARKED, 0);
+
+        for (int32 i=0; i<Cells.Num(); ++i)
         {
-            continue;
+            const int32 SrcIndex = (i == Update.RemovedIndex && Update.SwappedIndex != INDEX_NONE)
+                ? Update.SwappedIndex
+                : i;
+
+            if (SrcIndex < SrcStorage.Num())
+            {
+                CellStorage.Values[i] = SrcStorage.Values[SrcIndex];
+                CellStorage.FeatureTypes[i] = SrcStorage.FeatureTypes[SrcIndex];
+                CellStorage.FeatureIndices[i] = SrcStorage.FeatureIndices[SrcIndex];
+            }
+        }
+
+        if (bHasFeatureGroups)
+        {
+            GroupByFeatures();
+        }
+
+        return;
+    }
+
+    // Remove cell, swap last cell into the removed cell index.
+    // Cell sites may be stale here, cell attributes are accessed by index.
+
+    const int32 RemovedIndex = Update.RemovedIndex;
+    const int32 SwappedIndex = Update.SwappedIndex;
+
+    // Feature changes of the moved, removed and inserted cells are set
+    // through the feature journal, feature groups are patched afterwards.
+
+    if (Cells.IsValidIndex(RemovedIndex))
+    {
+        if (Cells.IsValidIndex(SwappedIndex))
+        {
+            CellStorage.SetType(RemovedIndex, CellStorage.FeatureTypes[SwappedIndex], CellStorage.FeatureIndices[SwappedIndex]);
+            CellStorage.Copy(RemovedIndex, SwappedIndex);
+        }
+
+        const int32 LastIndex = Cells.Num()-1;
+        CellStorage.SetType(LastIndex, CellStorage.FeatureTypes[LastIndex], INDEX_NONE);
+
+        Cells.Pop(false);
+        CellStorage.Pop();
+    }
+
+    // Add inserted cells
+
+    const FJCVCell* PrevCellData = Cells.GetData();
+    const int32 InsertIndex = Cells.Num();
+    const int32 CellCount = Diagram.GetSiteNum();
+
+    for (int32 i=InsertIndex; i<CellCount; ++i)
+    {
+        Cells.Emplace(Diagram.Site(i), CellStorage);
+        CellStorage.Add(0.f, false, JCV_CF_UNMARKED, INDEX_NONE);
+        CellStorage.SetType(i, JCV_CF_UNMARKED, 0);
+    }
+
+    // Patch feature membership, falls back to a full rebuild if the
+    // journal overflowed or a patch is not possible. Neighbour counts
+    // follow the diagram adjacency, which changed with the update.
+
+    if (bHasFeatureGroups)
+    {
+        bNeighbourCountsValid = false;
+        UpdateFeatureGroups();
+
+        // Reallocated cells require all cell groups to be rebound
+        if (Cells.GetData() != PrevCellData)
+        {
+            for (int32 ft=0; ft<FeatureGroups.Num(); ++ft)
+            {
+                for (int32 fi=0; fi<FeatureGroups[ft].GetGroupCount(); ++fi)
+                {
+                    RebindFeatureGroup(ft, fi);
+                }
+            }
+        }
+    }
+
+    // Rebind cell sites and update border state
+
+    if (Update.bSitesReallocated)
+    {
+        for (int32 i=0; i<CellCount; ++i)
+        {
+            Cells[i].Site = &Diagram.Site(i);
+        }
+    }
+
+    for (int32 i : Update.DirtyIndices)
+    {
+        if (! Cells.IsValidIndex(i))
+        {
+            continue;
+        }
+
+        FJCVCell& c(Cells[i]);
+        c.Site = &Diagram.Site(i);
+        c.SetBorder(false);
+
+        for (const FJCVEdge* g = c.Site->edges; g; g = g->next)
+        {
+            if (! g->neighbor)
+            {
+                c.SetBorder(true);
+                break;
+            }
+        }
+    }
+}
+
+// -- FEATURE OPERATIONS
+
+void FJCVDiagramMap::ClearFeatures()
+{
+    // Keep feature group storage, see UpdateFeatureMembership()
+    FeatureGroups.Reset();
+    FeatureMembership.Empty();
+    NeighbourCounts.Empty();
+    bNeighbourCountsValid = false;
+    CellStorage.StopFeatureJournal();
+}
+
+void FJCVDiagramMap::ResetFeatures(uint8 FeatureType, int32 FeatureIndex)
+{
+    if (FeatureIndex < 0)
+    {
+        const FJCVFeatureGroup* pft = GetFeatureGroup(FeatureType);
+        if (! pft)
+            return;
+        const FJCVFeatureGroup& ft( *pft );
+
+        for (int32 i=0; i<ft.GetGroupCount(); ++i)
+        {
+            bool bResult = true;
+            const FJCVCellGroupView& fg( ft.CellGroups[i] );
+            for (FJCVCell* c : fg)
+                if (c)
+                    c->SetType(JCV_CF_UNMARKED);
+        }
+    }
+    else
+    {
+        const FJCVCellGroupView* f = GetFeatureCellGroup(FeatureType, FeatureIndex);
+        if (f)
+        {
+            const FJCVCellGroupView& fg( *f );
+            for (FJCVCell* c : fg)
+                if (c)
+                    c->SetType(JCV_CF_UNMARKED);
+        }
+    }
+}
+
+void FJCVDiagramMap::GroupByFeatures()
+{
+    FeatureGroups.Reset();
+    bNeighbourCountsValid = false;
+    UpdateFeatureMembership();
+}
+
+void FJCVDiagramMap::UpdateFeatureGroups()
+{
+    // Features not grouped, group all cells
+    if (GetFeatureCount() == 0)
+    {
+        GroupByFeatures();
+        return;
+    }
+
+    if (! CellStorage.HasFeatureChanges())
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_UpdateFeatureGroups);
+
+    // Change journal overflowed, rebuild membership
+    if (CellStorage.bFeatureChangesOverflow)
+    {
+        bNeighbourCountsValid = false;
+        UpdateFeatureMembership();
+        return;
+    }
+
+    // Collapse journal to the first recorded old feature and the current
+    // feature of each changed cell, skip cells changed back
+
+    TArray<FJCVFeatureChange> Changes;
+    TMap<int32, int32> ChangeMap;
+
+    Changes.Reserve(CellStorage.FeatureChanges.Num());
+    ChangeMap.Reserve(CellStorage.FeatureChanges.Num());
+
+    for (const FJCVFeatureChange& Change : CellStorage.FeatureChanges)
+    {
+        if (! ChangeMap.Contains(Change.CellIndex))
+        {
+            ChangeMap.Emplace(Change.CellIndex, Changes.Emplace(Change));
+        }
+    }
+
+    ChangeMap.Reset();
+
+    for (int32 i=0; i<Changes.Num(); ++i)
+    {
+        FJCVFeatureChange& Change(Changes[i]);
+
+        // Cells removed by a site update leave their cell group
+        if (Change.CellIndex < CellStorage.Num())
+        {
+            Change.NewType = CellStorage.FeatureTypes[Change.CellIndex];
+            Change.NewIndex = CellStorage.FeatureIndices[Change.CellIndex];
+        }
+        else
+        {
+            Change.NewType = Change.OldType;
+            Change.NewIndex = INDEX_NONE;
+        }
+    }
+
+    Changes.RemoveAll([](const FJCVFeatureChange& Change)
+    {
+        return Change.OldType == Change.NewType && Change.OldIndex == Change.NewIndex;
+    } );
+
+    for (int32 i=0; i<Changes.Num(); ++i)
+    {
+        ChangeMap.Emplace(Changes[i].CellIndex, i);
+    }
+
+    // Patch neighbour counts before membership, counts use the old features
+
+    TSet<int32> ChangedPairs;
+
+    if (bNeighbourCountsValid)
+    {
+        PatchNeighbourCounts(Changes, ChangeMap, ChangedPairs);
+    }
+
+    // Patch membership and rebind changed cell groups. Moved cell index
+    // memory requires all cell groups to be rebound.
+
+    const int32* PrevCellIndexData = FeatureMembership.CellIndices.GetData();
+
+    if (FeatureMembership.Patch(Changes))
+    {
+        CellStorage.FeatureChanges.Reset();
+
+        if (FeatureMembership.CellIndices.GetData() != PrevCellIndexData)
+        {
+            for (int32 ft=0; ft<FeatureGroups.Num(); ++ft)
+            {
+                for (int32 fi=0; fi<FeatureGroups[ft].GetGroupCount(); ++fi)
+                {
+                    RebindFeatureGroup(ft, fi);
+                }
+            }
+        }
+        else
+        {
+            for (const FJCVFeatureChange& Change : Changes)
+            {
+                RebindFeatureGroup(Change.OldType, Change.OldIndex);
+                RebindFeatureGroup(Change.NewType, Change.NewIndex);
+            }
+        }
+    }
+    else
+    {
+        UpdateFeatureMembership();
+    }
+
+    // Update neighbour lists of feature type pairs with changed counts
+
+    for (int32 PairKey : ChangedPairs)
+    {
+        const int32 ft = PairKey >> 8;
+        const uint8 nft = PairKey & 0xFF;
+
+        if (! FeatureGroups.IsValidIndex(ft))
+        {
+            continue;
+        }
+
+        FJCVFeatureGroup& FeatureGroup(FeatureGroups[ft]);
+
+        if (NeighbourCounts[PairKey] > 0)
+        {
+            if (! FeatureGroup.HasNeighbour(nft))
+            {
+                FeatureGroup.Neighbours.Add(nft);
+            }
+        }
+        else
+        {
+            FeatureGroup.Neighbours.Remove(nft);
+        }
+    }
+}
+
+void FJCVDiagramMap::RebindFeatureGroup(int32 FeatureType, int32 FeatureIndex)
+{
+    if (FeatureGroups.IsValidIndex(FeatureType) &&
+        FeatureGroups[FeatureType].IsValidIndex(FeatureIndex) &&
+        FeatureIndex < FeatureMembership.GetGroupCount(FeatureType))
+    {
+        FeatureGroups[FeatureType].CellGroups[FeatureIndex] = FeatureMembership.GetCellGroup(Cells.GetData(), FeatureType, FeatureIndex);
+    }
+}
+
+void FJCVDiagramMap::PatchNeighbourCounts(
+    const TArray<FJCVFeatureChange>& Changes,
+    const TMap<int32, int32>& ChangeMap,
+    TSet<int32>& ChangedPairs
+    )
+{
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+
+    auto AddCount = [&](uint8 ft, uint8 nft, int32 Count)
+    {
+        if (ft != nft)
+        {
+            const int32 PairKey = (int32(ft) << 8) | nft;
+            NeighbourCounts[PairKey] += Count;
+            ChangedPairs.Emplace(PairKey);
+        }
+    };
+
+    // Each neighbour pair with a changed cell is counted once. Pairs from a
+    // changed cell are updated when visiting the changed cell, pairs from an
+    // unchanged cell are updated when visiting its changed neighbour.
+
+    for (const FJCVFeatureChange& Change : Changes)
+    {
+        for (int32 ni : Adjacency.GetNeighbours(Change.CellIndex))
+        {
+            const int32* NeighbourChange = ChangeMap.Find(ni);
+            const uint8 nft = CellStorage.FeatureTypes[ni];
+            const uint8 OldNft = NeighbourChange ? Changes[*NeighbourChange].OldType : nft;
+
+            if (Change.OldIndex >= 0)
+            {
+                AddCount(Change.OldType, OldNft, -1);
+            }
+
+            if (Change.NewIndex >= 0)
+            {
+                AddCount(Change.NewType, nft, 1);
+            }
+
+            if (! NeighbourChange && CellStorage.FeatureIndices[ni] >= 0)
+            {
+                AddCount(nft, Change.OldType, -1);
+                AddCount(nft, Change.NewType, 1);
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::UpdateFeatureMembership()
+{
+    SCOPE_CYCLE_COUNTER(STAT_JCV_GroupByFeatures);
+
+    FeatureMembership.BuildParallel(CellStorage);
+    CellStorage.StartFeatureJournal(FMath::Max(Num()/8, 1024));
+
+    const int32 TypeCount = FeatureMembership.GetTypeCount();
+
+    // Reserve all feature types so growing never reallocates, feature
+    // group references held by callers stay valid across updates
+    FeatureGroups.Reserve(256);
+
+    if (FeatureGroups.Num() < TypeCount)
+    {
+        FeatureGroups.SetNum(TypeCount);
+    }
+
+    FJCVCell* CellData = Cells.GetData();
+
+    for (int32 ft=0; ft<FeatureGroups.Num(); ++ft)
+    {
+        FJCVFeatureGroup& FeatureGroup(FeatureGroups[ft]);
+        const int32 GroupCount = FeatureMembership.GetGroupCount(ft);
+
+        FeatureGroup.SetType((uint8) ft);
+        FeatureGroup.CellGroups.SetNumUninitialized(GroupCount, false);
+
+        for (int32 fi=0; fi<GroupCount; ++fi)
+        {
+            FeatureGroup.CellGroups[fi] = FeatureMembership.GetCellGroup(CellData, ft, fi);
+        }
+    }
+}
+
+void FJCVDiagramMap::ExpandFeature(uint8 ft, int32 fi)
+{
+    if (! HasCells(ft, fi))
+        return;
+
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    const FJCVCellGroupView& cellG( FeatureGroups[ft].CellGroups[fi] );
+    FJCVCellSet cellS;
+    cellG.AppendTo(cellS);
+
+    for (FJCVCell* c : cellG)
+    {
+        check(c);
+        for (int32 ni : Adjacency.GetNeighbours(c->GetIndex()))
+        {
+            FJCVCell* n = &Cells[ni];
+            if (! cellS.Contains(n))
+            {
+                cellS.Emplace(n);
+                n->SetType(ft, fi);
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::ExpandFeature(uint8 ft)
+{
+    if (! HasCellGroups(ft))
+        return;
+
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    FJCVFeatureGroup& featureGroup( FeatureGroups[ft] );
+
+    for (int32 fi=0; fi<featureGroup.GetGroupCount(); ++fi)
+    {
+        if (! featureGroup.HasCells(fi))
+        {
+            continue;
+        }
+
+        const FJCVCellGroupView& cellG( featureGroup.CellGroups[fi] );
+        FJCVCellSet cellS;
+        cellG.AppendTo(cellS);
+
+        for (FJCVCell* c : cellG)
+        {
+            check(c);
+            for (int32 ni : Adjacency.GetNeighbours(c->GetIndex()))
+            {
+                FJCVCell* n = &Cells[ni];
+                if (! cellS.Contains(n))
+                {
+                    cellS.Emplace(n);
+                    n->SetType(ft, fi);
+                }
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::ExpandFeature(FJCVCellSet& cellS, uint8 ft, int32 fi)
+{
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    FJCVCellGroup cellG( cellS.Array() );
+    for (FJCVCell* c : cellG)
+    {
+        if (! c)
+            continue;
+        for (int32 ni : Adjacency.GetNeighbours(c->GetIndex()))
+        {
+            FJCVCell* n = &Cells[ni];
+            if (! cellS.Contains(n))
+            {
+                cellS.Emplace(n);
+                n->SetType(ft, fi);
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::GenerateNeighbourList()
+{
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+
+    // Neighbour counts match cell features only without pending changes
+    bNeighbourCountsValid = ! CellStorage.HasFeatureChanges();
+
+    if (bNeighbourCountsValid)
+    {
+        NeighbourCounts.Reset();
+        NeighbourCounts.SetNumZeroed(256*256);
+    }
+
+    for (FJCVFeatureGroup& fg : FeatureGroups)
+    {
+        int32* Counts = bNeighbourCountsValid
+            ? NeighbourCounts.GetData() + (int32(fg.FeatureType) << 8)
+            : nullptr;
+
+        for (const FJCVCellGroupView& cg : fg.CellGroups)
+        {
+            for (int32 ci : cg.GetCellIndices())
+            {
+                for (int32 ni : Adjacency.GetNeighbours(ci))
+                {
+                    const FJCVCell& n(Cells[ni]);
+
+                    fg.AddNeighbour(n);
+
+                    if (Counts && ! n.IsType(fg.FeatureType))
+                    {
+                        ++Counts[n.GetFeatureType()];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::MarkFiltered(const FJCVSite* InSite, uint8 FeatureType, int32 FeatureIndex, TSet<const FJCVSite*>& FilterSet, bool bAddToFilterIfMarked)
+{
+    if (InSite && ! FilterSet.Contains(InSite))
+    {
+        FJCVCell* c = GetCell(InSite);
+
+        if (c)
+        {
+            c->SetType(FeatureType, FeatureIndex);
+
+            if (bAddToFilterIfMarked)
+            {
+                FilterSet.Emplace(InSite);
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::MergeGroup(FJCVFeatureGroup& SrcFeatureGroup, FJCVFeatureGroup& DstFeatureGroup)
+{
+    const uint8 srcft = SrcFeatureGroup.FeatureType;
+    const uint8 dstft = DstFeatureGroup.FeatureType;
+
+    // Move cells from SrcFeatureGroup to DstFeatureGroup
+    for (int32 fi=0; fi<SrcFeatureGroup.GetGroupCount(); ++fi)
+    {
+        for (FJCVCell* c : SrcFeatureGroup.CellGroups[fi])
+        {
+            c->SetType(dstft, fi);
+        }
+    }
+
+    // Move changed cells to their new cell groups, then clear merged cell
+    // group container. The update applies all pending changes and may
+    // rebuild membership, source group is fetched again by feature type.
+    UpdateFeatureGroups();
+
+    if (FeatureGroups.IsValidIndex(srcft))
+    {
+        FeatureGroups[srcft].Empty();
+    }
+}
+
+void FJCVDiagramMap::ComputeCellGroupAdjacency(uint8 FeatureType, TArray<FJCVCellGroupAdjacency>& OutAdjacency) const
+{
+    const FJCVFeatureGroup* pfg = GetFeatureGroup(FeatureType);
+
+    if (! pfg || pfg->GetGroupCount() == 0)
+    {
+        OutAdjacency.Reset();
+        return;
+    }
+
+    const FJCVFeatureGroup& fg(*pfg);
+    const int32 GroupCount = fg.GetGroupCount();
+
+    OutAdjacency.Reset();
+    OutAdjacency.SetNum(GroupCount);
+
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    const uint8* Types = CellStorage.FeatureTypes.GetData();
+    const int32* Indices = CellStorage.FeatureIndices.GetData();
+
+    ParallelFor(GroupCount, [&](int32 fi)
+    {
+        FJCVCellGroupAdjacency& GroupAdjacency(OutAdjacency[fi]);
+
+        for (int32 ci : fg.CellGroups[fi].GetCellIndices())
+        {
+            GroupAdjacency.bBorder |= Adjacency.IsBorder(ci);
+
+            for (int32 ni : Adjacency.GetNeighbours(ci))
+            {
+                if (Types[ni] != FeatureType || Indices[ni] != fi)
+                {
+                    GroupAdjacency.NeighbourTypes.Add(Types[ni]);
+                }
+            }
+        }
+    });
+}
+
+void FJCVDiagramMap::ConvertIsolated(uint8 ft0, uint8 ft1, int32 fi, bool bGroupFeatures)
+{
+    if (! GetFeatureGroup(ft0))
+    {
+        return;
+    }
+
+    // Group cells must match cell features
+    UpdateFeatureGroups();
+
+    TArray<FJCVCellGroupAdjacency> GroupAdjacency;
+    ComputeCellGroupAdjacency(ft0, GroupAdjacency);
+
+    const FJCVFeatureGroup& fg(FeatureGroups[ft0]);
+
+    for (int32 i=0; i<GroupAdjacency.Num(); ++i)
+    {
+        if (GroupAdjacency[i].IsEnclosedBy(ft1))
+        {
+            for (int32 ci : fg.CellGroups[i].GetCellIndices())
+            {
+                CellStorage.SetType(ci, ft1, fi);
+            }
+        }
+    }
+
+    if (bGroupFeatures)
+    {
+        UpdateFeatureGroups();
+    }
+}
+
+int32 FJCVDiagramMap::LabelConnectedComponents(uint8 FeatureType, TArray<int32>& OutComponentSizes)
+{
+    OutComponentSizes.Reset();
+
+    const int32 CellCount = Num();
+
+    if (CellCount == 0)
+    {
+        return 0;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_LabelConnectedComponents);
+
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    const uint8* Types = CellStorage.FeatureTypes.GetData();
+    int32* Indices = CellStorage.FeatureIndices.GetData();
+
+    const int32 ChunkSize = 4096;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(CellCount, ChunkSize);
+
+    // Union-find parent of each cell of the feature type, INDEX_NONE for
+    // other cells. Parents always point to a lower cell index, the root
+    // of a component is the lowest cell index of the component.
+
+    TArray<int32> Parents;
+    Parents.SetNumUninitialized(CellCount);
+
+    int32* P = Parents.GetData();
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
+        {
+            P[i] = (Types[i] == FeatureType) ? i : INDEX_NONE;
+        }
+    });
+
+    // Find root with path halving. Concurrent halving only moves a parent
+    // closer to its root and is safe to lose.
+    auto Find = [P](int32 x)
+    {
+        int32 p = FPlatformAtomics::AtomicRead(P+x);
+
+        while (p != x)
+        {
+            const int32 gp = FPlatformAtomics::AtomicRead(P+p);
+
+            if (gp != p)
+            {
+                FPlatformAtomics::InterlockedCompareExchange(P+x, gp, p);
+            }
+
+            x = gp;
+            p = FPlatformAtomics::AtomicRead(P+x);
         }
 
-        FJCVCellGroup& cellG( featureGroup.CellGroups[fi] );
-        FJCVCellSet cellS( cellG );
+        return x;
+    };
 
-        for (FJCVCell* c : cellG)
+    // Link higher root to lower root, retry if the root was linked by
+    // another thread
+    auto Union = [P, &Find](int32 a, int32 b)
+    {
+        for (;;)
         {
-            check(c);
-            FJCVEdge* g = c->GetEdge();
-            while (g)
+            a = Find(a);
+            b = Find(b);
+
+            if (a == b)
             {
-                FJCVCell* n = GetCell(g->neighbor);
-                if (n && ! cellS.Contains(n))
-                {
-                    cellS.Emplace(n);
-                    n->SetType(ft, fi);
-                }
-                g = g->next;
+                return;
             }
-        }
-    }
-}
 
-void FJCVDiagramMap::ExpandFeature(FJCVCellSet& cellS, uint8 ft, int32 fi)
-{
-    FJCVCellGroup cellG( cellS.Array() );
-    for (FJCVCell* c : cellG)
-    {
-        if (! c)
-            continue;
-        FJCVEdge* g = c->GetEdge();
-        while (g)
-        {
-            FJCVCell* n = GetCell(g->neighbor);
-            if (n && ! cellS.Contains(n))
+            if (a > b)
             {
-                cellS.Emplace(n);
-                n->SetType(ft, fi);
+                Swap(a, b);
+            }
+
+            if (FPlatformAtomics::InterlockedCompareExchange(P+b, a, b) == b)
+            {
+                return;
             }
-            g = g->next;
         }
-    }
-}
+    };
 
-void FJCVDiagramMap::GenerateNeighbourList()
-{
-    for (FJCVFeatureGroup& fg : FeatureGroups)
+    // Union each neighbour pair once, from the higher cell index
+
+    ParallelFor(ChunkCount, [&](int32 ci)
     {
-        for (const FJCVCellGroup& cg : fg.CellGroups)
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
         {
-            for (const FJCVCell* c : cg)
+            if (Types[i] != FeatureType)
+            {
+                continue;
+            }
+
+            for (int32 ni : Adjacency.GetNeighbours(i))
             {
-                const FJCVEdge* g = c->GetEdge();
-                do
+                if (ni < i && Types[ni] == FeatureType)
                 {
-                    const FJCVCell* n = GetCell(g->neighbor);
-                    if (n)
-                        fg.AddNeighbour(*n);
+                    Union(i, ni);
                 }
-                while ((g=g->next) != nullptr);
             }
         }
-    }
-}
+    });
 
-void FJCVDiagramMap::MarkFiltered(const FJCVSite* InSite, uint8 FeatureType, int32 FeatureIndex, TSet<const FJCVSite*>& FilterSet, bool bAddToFilterIfMarked)
-{
-    if (InSite && ! FilterSet.Contains(InSite))
+    // Flatten parents to component roots
+
+    ParallelFor(ChunkCount, [&](int32 ci)
     {
-        FJCVCell* c = GetCell(InSite);
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
 
-        if (c)
+        for (int32 i=CellStart; i<CellEnd; ++i)
         {
-            c->SetType(FeatureType, FeatureIndex);
-
-            if (bAddToFilterIfMarked)
+            if (P[i] != INDEX_NONE)
             {
-                FilterSet.Emplace(InSite);
+                P[i] = Find(i);
             }
         }
-    }
-}
+    });
 
-void FJCVDiagramMap::MergeGroup(FJCVFeatureGroup& SrcFeatureGroup, FJCVFeatureGroup& DstFeatureGroup)
-{
-    const int32 cellN = Num();
-    const uint8 srcft = SrcFeatureGroup.FeatureType;
-    const uint8 dstft = DstFeatureGroup.FeatureType;
+    // Assign feature indices in cell order. A component root precedes its
+    // cells, its feature index is assigned before it is read.
 
-    // Add cells from SrcFeatureGroup to DstFeatureGroup, then clear SrcFeatureGroup
-    for (int32 fi=0; fi<SrcFeatureGroup.GetGroupCount(); ++fi)
+    for (int32 i=0; i<CellCount; ++i)
     {
-        FJCVCellGroup& cg(SrcFeatureGroup.CellGroups[fi]);
+        const int32 Root = P[i];
 
-        for (FJCVCell* c : cg)
+        if (Root == INDEX_NONE)
         {
-            c->SetType(dstft, fi);
-            DstFeatureGroup.AddCell(*c, cellN);
+            continue;
         }
 
-        cg.Empty();
+        if (Root == i)
+        {
+            Indices[i] = OutComponentSizes.Emplace(1);
+        }
+        else
+        {
+            Indices[i] = Indices[Root];
+            ++OutComponentSizes[Indices[i]];
+        }
     }
 
-    // Clear merged cell group container
-    SrcFeatureGroup.Empty();
-}
-
-void FJCVDiagramMap::ConvertIsolated(uint8 ft0, uint8 ft1, int32 fi, bool bGroupFeatures)
-{
-    const FJCVFeatureGroup* pfg = GetFeatureGroup(ft0);
+    const int32 ComponentCount = OutComponentSizes.Num();
 
-    if (! pfg)
+    if (ComponentCount == 0)
     {
-        return;
+        return 0;
     }
 
-    const FJCVFeatureGroup& fg(*pfg);
+    // Regroup cells. Feature indices are written directly, feature types
+    // and neighbour counts are unchanged unless other changes are pending.
 
-    for (int32 i=0; i<fg.GetGroupCount(); ++i)
+    if (GetFeatureCount() == 0)
+    {
+        GroupByFeatures();
+    }
+    else
     {
-        bool bResult = true;
-        const FJCVCellGroup& cg(fg.CellGroups[i]);
-        for (FJCVCell* c : cg)
+        if (CellStorage.HasFeatureChanges())
         {
-            if (! c)
-                continue;
-            const FJCVEdge* g = c->GetEdge();
-            while (g)
-            {
-                const FJCVCell* n = GetCell(g->neighbor);
-                if (! n || (! n->IsType(ft0, i) && ! n->IsType(ft1)))
-                {
-                    bResult = false;
-                    break;
-                }
-                g = g->next;
-            }
-            if (! bResult)
-                break;
+            bNeighbourCountsValid = false;
         }
-        if (bResult)
-            for (FJCVCell* c : cg)
-                c->SetType(ft1, fi);
-    }
 
-    if (bGroupFeatures)
-    {
-        GroupByFeatures();
+        UpdateFeatureMembership();
     }
+
+    return ComponentCount;
 }
 
 void FJCVDiagramMap::MergeNeighbourList(FJCVFeatureGroup& SrcFg, FJCVFeatureGroup& DstFg)
@@ -364,6 +1353,9 @@ void FJCVDiagramMap::MergeNeighbourList(FJCVFeatureGroup& SrcFg, FJCVFeatureGrou
     const uint8 DstFt = DstFg.FeatureType;
     const uint8 SrcFt = SrcFg.FeatureType;
 
+    // Neighbour lists no longer follow neighbour counts
+    bNeighbourCountsValid = false;
+
     // Update group connections
     for (uint8 ft2 : SrcFg.Neighbours)
     {
@@ -385,7 +1377,7 @@ void FJCVDiagramMap::MergeNeighbourList(FJCVFeatureGroup& SrcFg, FJCVFeatureGrou
     SrcFg.Neighbours.Empty();
 
     // Removes stale groups from neighbour list
-    TSet<uint8> nftS = DstFg.Neighbours;
+    const FJCVFeatureTypeMask nftS(DstFg.Neighbours);
     for (uint8 n : nftS)
         if (! HasCellGroups(n))
             DstFg.Neighbours.Remove(n);
@@ -401,10 +1393,10 @@ void FJCVDiagramMap::ShrinkGroups()
 
     const int32 LastFeatureGroupCount = FeatureGroups.Num();
 
-    // Remove empty feature groups
+    // Remove empty feature groups, storage is kept
     FeatureGroups.RemoveAllSwap(
         [&](const FJCVFeatureGroup& fg) { return ! fg.HasCells(); },
-        true
+        false
         );
 
     // Feature group count unchanged, no further update required, return
@@ -414,7 +1406,8 @@ void FJCVDiagramMap::ShrinkGroups()
     }
 
     // Map of the original to the current feature type
-    TMap<uint8, uint8> MergeGroupMap;
+    FJCVFeatureTypeMask MergeGroupMask;
+    uint8 MergeGroupMap[256];
 
     // Map new feature type and update cell feature type if required
     for (int32 i=0; i<FeatureGroups.Num(); ++i)
@@ -423,7 +1416,8 @@ void FJCVDiagramMap::ShrinkGroups()
         const uint8 ft0 = fg.FeatureType;
         const uint8 ft1 = i;
 
-        MergeGroupMap.Emplace(ft0, ft1);
+        MergeGroupMask.Add(ft0);
+        MergeGroupMap[ft0] = ft1;
 
         // Feature type unchanged, skip
         if (ft0 == ft1)
@@ -444,16 +1438,17 @@ void FJCVDiagramMap::ShrinkGroups()
     // Remap neighbour list
     for (FJCVFeatureGroup& fg : FeatureGroups)
     {
-        TSet<uint8> neighbours = fg.Neighbours;
+        const FJCVFeatureTypeMask neighbours(fg.Neighbours & MergeGroupMask);
         fg.Neighbours.Empty();
         for (uint8 n : neighbours)
         {
-            if (MergeGroupMap.Contains(n))
-            {
-                fg.Neighbours.Emplace(MergeGroupMap.FindChecked(n));
-            }
+            fg.Neighbours.Add(MergeGroupMap[n]);
         }
     }
+
+    // Rebuild membership of the remapped feature types
+    bNeighbourCountsValid = false;
+    UpdateFeatureMembership();
 }
 
 // -- FEATURE MODIFICATION OPERATIONS (BORDERS)
@@ -664,11 +1659,326 @@ void FJCVDiagramMap::GenerateSortedBorderEdges(
     EdgeLists.Shrink();
 }
 
+// -- VALUE OPERATIONS (DRAINAGE)
+
+void FJCVDiagramMap::GenerateFlowField(FJCVFlowField& OutFlow) const
+{
+    const int32 CellCount = Num();
+
+    OutFlow.Empty();
+
+    if (CellCount == 0)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_FlowField);
+
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    const float* Values = CellStorage.Values.GetData();
+
+    OutFlow.FilledValues = CellStorage.Values;
+    OutFlow.Receivers.Init(INDEX_NONE, CellCount);
+    OutFlow.FlowAccumulation.Init(1.f, CellCount);
+
+    float* Filled = OutFlow.FilledValues.GetData();
+    int32* Receivers = OutFlow.Receivers.GetData();
+    float* Flow = OutFlow.FlowAccumulation.GetData();
+
+    // Priority flood from border cells. Popped heights never decrease,
+    // heap keys are heights offset by the lowest value to be non-negative.
+    // Each cell is first reached from its flood receiver.
+
+    float MinValue = Values[0];
+
+    for (int32 i=1; i<CellCount; ++i)
+    {
+        MinValue = FMath::Min(MinValue, Values[i]);
+    }
+
+    TArray<int32> FloodReceivers;
+    FloodReceivers.Init(INDEX_NONE, CellCount);
+
+    FJCVCellVisitScope Visited(GetVisitStamp(), CellCount);
+    FJCVRadixHeap Heap;
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (CellStorage.BorderFlags[i])
+        {
+            Visited->MarkVisited(i);
+            Heap.Push(Values[i]-MinValue, i);
+        }
+    }
+
+    if (Heap.IsEmpty())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramMap::GenerateFlowField() ABORTED, NO BORDER CELL"));
+        return;
+    }
+
+    while (! Heap.IsEmpty())
+    {
+        float Key;
+        int32 CellIndex;
+
+        Heap.Pop(Key, CellIndex);
+
+        for (int32 ni : Adjacency.GetNeighbours(CellIndex))
+        {
+            if (Visited->TryVisit(ni))
+            {
+                Filled[ni] = FMath::Max(Values[ni], Filled[CellIndex]);
+                FloodReceivers[ni] = CellIndex;
+                Heap.Push(Filled[ni]-MinValue, ni);
+            }
+        }
+    }
+
+    // Steepest descent receivers on filled values, flats fall back to the
+    // flood receiver. Receivers never rise and flat receivers precede
+    // their donors in flood order, receivers form a forest.
+
+    const int32 ChunkSize = 4096;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(CellCount, ChunkSize);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
+        {
+            if (CellStorage.BorderFlags[i])
+            {
+                continue;
+            }
+
+            const FVector2D CellPoint = Cells[i].ToVector2DUnsafe();
+
+            int32 Receiver = FloodReceivers[i];
+            float MaxSlope = 0.f;
+
+            for (int32 ni : Adjacency.GetNeighbours(i))
+            {
+                const float Drop = Filled[i]-Filled[ni];
+
+                if (Drop > 0.f)
+                {
+                    const float Distance = (Cells[ni].ToVector2DUnsafe()-CellPoint).Size();
+                    const float Slope = Drop / FMath::Max(Distance, KINDA_SMALL_NUMBER);
+
+                    if (Slope > MaxSlope)
+                    {
+                        MaxSlope = Slope;
+                        Receiver = ni;
+                    }
+                }
+            }
+
+            Receivers[i] = Receiver;
+        }
+    } );
+
+    // Accumulate flow from source cells to receivers in topological order
+
+    TArray<int32> DonorCounts;
+    DonorCounts.SetNumZeroed(CellCount);
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (Receivers[i] != INDEX_NONE)
+        {
+            ++DonorCounts[Receivers[i]];
+        }
+    }
+
+    TArray<int32>& Queue(Visited->GetQueue());
+    Queue.Reset();
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (DonorCounts[i] == 0)
+        {
+            Queue.Emplace(i);
+        }
+    }
+
+    for (int32 q=0; q<Queue.Num(); ++q)
+    {
+        const int32 CellIndex = Queue[q];
+        const int32 Receiver = Receivers[CellIndex];
+
+        if (Receiver != INDEX_NONE)
+        {
+            Flow[Receiver] += Flow[CellIndex];
+
+            if (--DonorCounts[Receiver] == 0)
+            {
+                Queue.Emplace(Receiver);
+            }
+        }
+    }
+}
+
+void FJCVDiagramMap::MarkLakesAndRivers(
+    const FJCVFlowField& Flow,
+    uint8 LakeType,
+    uint8 RiverType,
+    float MinLakeDepth,
+    float MinRiverFlow,
+    bool bGroupFeatures
+    )
+{
+    if (Flow.Num() != Num())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("FJCVDiagramMap::MarkLakesAndRivers() ABORTED, FLOW FIELD AND MAP HAVE DIFFERENT CELL COUNT"));
+        return;
+    }
+
+    for (int32 i=0; i<Num(); ++i)
+    {
+        if ((Flow.FilledValues[i]-CellStorage.Values[i]) > MinLakeDepth)
+        {
+            CellStorage.SetType(i, LakeType, 0);
+        }
+        else
+        if (Flow.FlowAccumulation[i] >= MinRiverFlow)
+        {
+            CellStorage.SetType(i, RiverType, 0);
+        }
+    }
+
+    // Split lakes into connected lakes, also regroups all features
+    if (bGroupFeatures)
+    {
+        TArray<int32> LakeSizes;
+        LabelConnectedComponents(LakeType, LakeSizes);
+    }
+}
+
+// -- FEATURE QUERY OPERATIONS (CELL SETS)
+
+void FJCVDiagramMap::AddFeatureCells(FJCVCellBitSet& CellSet, uint8 FeatureType, int32 FeatureIndex) const
+{
+    const int32 CellCount = Num();
+
+    if (CellSet.GetCellCount() != CellCount)
+    {
+        CellSet.Init(CellCount);
+    }
+
+    if (CellCount == 0)
+    {
+        return;
+    }
+
+    const uint8* Types = CellStorage.FeatureTypes.GetData();
+    const int32* Indices = CellStorage.FeatureIndices.GetData();
+    uint64* Words = CellSet.GetWords();
+
+    // Chunks cover whole words, each word is written by a single worker
+
+    const int32 WordCount = CellSet.GetWordCount();
+    const int32 ChunkSize = 64;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(WordCount, ChunkSize);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 WordStart = ci * ChunkSize;
+        const int32 WordEnd = FMath::Min(WordStart+ChunkSize, WordCount);
+
+        for (int32 wi=WordStart; wi<WordEnd; ++wi)
+        {
+            const int32 CellStart = wi << 6;
+            const int32 CellEnd = FMath::Min(CellStart+64, CellCount);
+
+            uint64 Word = 0;
+
+            if (FeatureIndex < 0)
+            {
+                // Any feature index, cells without feature index excluded
+                for (int32 i=CellStart; i<CellEnd; ++i)
+                {
+                    const bool bIsType = Types[i] == FeatureType && Indices[i] >= 0;
+                    Word |= uint64(bIsType) << (i-CellStart);
+                }
+            }
+            else
+            {
+                for (int32 i=CellStart; i<CellEnd; ++i)
+                {
+                    const bool bIsType = Types[i] == FeatureType && Indices[i] == FeatureIndex;
+                    Word |= uint64(bIsType) << (i-CellStart);
+                }
+            }
+
+            Words[wi] |= Word;
+        }
+    } );
+}
+
 // -- FEATURE QUERY OPERATIONS (JUNCTIONS)
 
+void FJCVDiagramMap::ComputeNeighbourTypeMasks(TArray<FJCVFeatureTypeMask>& OutMasks) const
+{
+    const int32 CellCount = Num();
+
+    OutMasks.SetNumUninitialized(CellCount);
+
+    if (CellCount == 0)
+    {
+        return;
+    }
+
+    const FJCVDiagramAdjacency& Adjacency(GetAdjacency());
+    const uint8* Types = CellStorage.FeatureTypes.GetData();
+
+    const int32 ChunkSize = 4096;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(CellCount, ChunkSize);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
+        {
+            FJCVFeatureTypeMask Mask;
+
+            for (int32 ni : Adjacency.GetNeighbours(i))
+            {
+                Mask.Add(Types[ni]);
+            }
+
+            Mask.Remove(Types[i]);
+            OutMasks[i] = Mask;
+        }
+    });
+}
+
+void FJCVDiagramMap::FindJunctionCells(TArray<int32>& OutCellIndices) const
+{
+    OutCellIndices.Reset();
+
+    for (int32 i=0; i<Num(); ++i)
+    {
+        if (GetNeighbourTypeMask(i).HasMultiple())
+        {
+            OutCellIndices.Emplace(i);
+        }
+    }
+}
+
 void FJCVDiagramMap::GetJunctionCells(FJCVCell& c, TArray<FJCVCellJunction>& Junctions)
 {
-    const uint8 t = c.FeatureType;
+    // Junctions require at least two neighbour types other than the cell type
+    if (! GetNeighbourTypeMask(c.GetIndex()).HasMultiple())
+    {
+        return;
+    }
+
+    const uint8 t = c.GetFeatureType();
 
     FJCVCell* n0 = nullptr;
     FJCVCell* n1 = nullptr;
@@ -682,7 +1992,7 @@ void FJCVDiagramMap::GetJunctionCells(FJCVCell& c, TArray<FJCVCellJunction>& Jun
 
         if (n1 && ! n1->IsType(t))
         {
-            if (g0 && n0 && ! n1->IsType(n0->FeatureType))
+            if (g0 && n0 && ! n1->IsType(n0->GetFeatureType()))
             {
                 int32 conn0 = connected(*g0, *g1);
                 int32 conn1 = connectedRev(*g0, *g1);
@@ -715,7 +2025,7 @@ void FJCVDiagramMap::GetJunctionCells(FJCVCell& c, TArray<FJCVCellJunction>& Jun
         g1 = c.GetEdge();
         n1 = GetCell(g1->neighbor);
 
-        if (n1 && ! n1->IsType(t) && ! n1->IsType(n0->FeatureType))
+        if (n1 && ! n1->IsType(t) && ! n1->IsType(n0->GetFeatureType()))
         {
             int32 conn0 = connected(*g0, *g1);
             int32 conn1 = connectedRev(*g0, *g1);
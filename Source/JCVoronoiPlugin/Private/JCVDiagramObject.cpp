@@ -90,6 +90,80 @@ void UJCVDiagramObject::CreateContextByBounds(int32 ContextId, const FBox2D& InB
     }
 }
 
+void UJCVDiagramObject::CreateContextByBoundsTiled(int32 ContextId, const FBox2D& InBounds, const TArray<FVector2D>& InPoints, FIntPoint TileCount, float Halo)
+{
+    FBox2D Bounds(InBounds.Min, InBounds.Max);
+
+    if (InPoints.Num() <= 0)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::CreateContextByBoundsTiled() ABORTED, UNABLE TO GENERATE ISLAND WITH EMPTY POINTS"));
+        return;
+    }
+    else
+    if (! Bounds.bIsValid || Bounds.Min.X > Bounds.Max.X || Bounds.Min.Y > Bounds.Max.Y)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::CreateContextByBoundsTiled() ABORTED, INVALID BOUNDS"));
+        return;
+    }
+
+    if (! HasContext(ContextId))
+    {
+        FPSJCVDiagramMapContext Context(new FJCVDiagramMapContext());
+        Context->GenerateDiagramTiled(Bounds, InPoints, TileCount, Halo);
+        ContextMap.Emplace(ContextId, Context);
+    }
+}
+
+void UJCVDiagramObject::CreateContextMovePoints(int32 ContextId, const FVector2D& InSize, TArray<FVector2D>& InPoints)
+{
+    if (InSize.X <= 0.f || InSize.Y <= 0.f)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::CreateContextMovePoints() ABORTED, INVALID SIZE"));
+        InPoints.Empty();
+        return;
+    }
+
+    CreateContextByBoundsMovePoints(ContextId, FBox2D(FVector2D(0.f, 0.f), InSize), InPoints);
+}
+
+void UJCVDiagramObject::CreateContextByBoundsMovePoints(int32 ContextId, const FBox2D& InBounds, TArray<FVector2D>& InPoints)
+{
+    FBox2D Bounds(InBounds.Min, InBounds.Max);
+
+    if (InPoints.Num() <= 0)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::CreateContextByBoundsMovePoints() ABORTED, UNABLE TO GENERATE ISLAND WITH EMPTY POINTS"));
+        return;
+    }
+    else
+    if (! Bounds.bIsValid || Bounds.Min.X > Bounds.Max.X || Bounds.Min.Y > Bounds.Max.Y)
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::CreateContextByBoundsMovePoints() ABORTED, INVALID BOUNDS"));
+        InPoints.Empty();
+        return;
+    }
+
+    if (! HasContext(ContextId))
+    {
+        FPSJCVDiagramMapContext Context(new FJCVDiagramMapContext(Bounds, MoveTemp(InPoints)));
+        ContextMap.Emplace(ContextId, Context);
+    }
+
+    // Points are consumed even if the context already exists
+    InPoints.Empty();
+}
+
+int32 UJCVDiagramObject::RelaxDiagram(int32 ContextId, int32 Iterations, float ConvergenceThreshold)
+{
+    if (! HasContext(ContextId))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::RelaxDiagram() ABORTED, INVALID ISLAND CONTEXT"));
+        return 0;
+    }
+
+    return GetContext(ContextId)->RelaxDiagram(Iterations, ConvergenceThreshold);
+}
+
 void UJCVDiagramObject::CreateMap(int32 ContextId, int32 MapId)
 {
     if (HasContext(ContextId))
@@ -149,6 +223,39 @@ void UJCVDiagramObject::CopyMap(int32 ContextId, int32 SrcMapId, int32 DstMapId)
     cid.AccessorMap.Emplace(DstMapId, aid);
 }
 
+bool UJCVDiagramObject::InsertSite(int32 ContextId, const FVector2D& Position, TArray<int32>& OutDirtyCells)
+{
+    if (! HasContext(ContextId))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::InsertSite() ABORTED, INVALID ISLAND CONTEXT"));
+        return false;
+    }
+
+    return GetContext(ContextId)->InsertSite(Position, OutDirtyCells);
+}
+
+bool UJCVDiagramObject::RemoveSite(int32 ContextId, int32 SiteIndex, TArray<int32>& OutDirtyCells)
+{
+    if (! HasContext(ContextId))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::RemoveSite() ABORTED, INVALID ISLAND CONTEXT"));
+        return false;
+    }
+
+    return GetContext(ContextId)->RemoveSite(SiteIndex, OutDirtyCells);
+}
+
+bool UJCVDiagramObject::MoveSite(int32 ContextId, int32 SiteIndex, const FVector2D& Position, TArray<int32>& OutDirtyCells)
+{
+    if (! HasContext(ContextId))
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVDiagramObject::MoveSite() ABORTED, INVALID ISLAND CONTEXT"));
+        return false;
+    }
+
+    return GetContext(ContextId)->MoveSite(SiteIndex, Position, OutDirtyCells);
+}
+
 UJCVDiagramAccessor* UJCVDiagramObject::GetAccessor(int32 ContextId, int32 MapId)
 {
     if (HasMap(ContextId, MapId))
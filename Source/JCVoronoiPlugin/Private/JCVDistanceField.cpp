@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "JCVDistanceField.h"
+#include "JCVDiagramMap.h"
+
+void FJCVDistanceField::Compute(
+    const FJCVDiagramMap& Map,
+    TArrayView<const int32> Sources,
+    const FJCVDistanceFieldParams& Params,
+    TArray<float>& OutDistances,
+    TArray<int32>* OutNearestSources
+    )
+{
+    const int32 CellCount = Map.Num();
+
+    OutDistances.Reset();
+    OutDistances.Init(BIG_NUMBER, CellCount);
+
+    if (OutNearestSources)
+    {
+        OutNearestSources->Reset();
+        OutNearestSources->Init(INDEX_NONE, CellCount);
+    }
+
+    if (CellCount == 0)
+    {
+        return;
+    }
+
+    SCOPE_CYCLE_COUNTER(STAT_JCV_DistanceField);
+
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+    const uint8* Types = Map.GetCellStorage().FeatureTypes.GetData();
+
+    // Cost multiplier table of all feature types
+
+    float TypeCosts[256];
+
+    for (int32 t=0; t<256; ++t)
+    {
+        TypeCosts[t] = Params.TypeCostMultipliers.IsValidIndex(t)
+            ? Params.TypeCostMultipliers[t]
+            : 1.f;
+    }
+
+    const bool bEdgeLength = Params.Weight == EJCVDistanceWeight::EdgeLength;
+    const float MaxDistance = Params.MaxDistance;
+
+    float* Distances = OutDistances.GetData();
+    int32* NearestSources = OutNearestSources ? OutNearestSources->GetData() : nullptr;
+
+    FJCVRadixHeap Heap;
+
+    for (int32 CellIndex : Sources)
+    {
+        if (CellIndex >= 0 && CellIndex < CellCount && Distances[CellIndex] > 0.f)
+        {
+            Distances[CellIndex] = 0.f;
+
+            if (NearestSources)
+            {
+                NearestSources[CellIndex] = CellIndex;
+            }
+
+            Heap.Push(0.f, CellIndex);
+        }
+    }
+
+    while (! Heap.IsEmpty())
+    {
+        float Distance;
+        int32 CellIndex;
+
+        Heap.Pop(Distance, CellIndex);
+
+        // Stale entry, cell already settled with a lower distance
+        if (Distance > Distances[CellIndex])
+        {
+            continue;
+        }
+
+        const float CellCost = TypeCosts[Types[CellIndex]];
+        const FVector2D CellPoint = Map.GetCell(CellIndex).ToVector2DUnsafe();
+        const int32 EntryEnd = Adjacency.GetEntryEnd(CellIndex);
+
+        for (int32 Entry=Adjacency.GetEntryBegin(CellIndex); Entry<EntryEnd; ++Entry)
+        {
+            const int32 ni = Adjacency.GetEntryNeighbour(Entry);
+            const float NeighbourCost = TypeCosts[Types[ni]];
+
+            if (NeighbourCost < 0.f)
+            {
+                continue;
+            }
+
+            float Weight;
+
+            if (bEdgeLength)
+            {
+                const FJCVEdge* g = Adjacency.GetEntryEdge(Entry);
+                Weight = (FJCVMathUtil::ToVector2D(g->pos[1])-FJCVMathUtil::ToVector2D(g->pos[0])).Size();
+            }
+            else
+            {
+                Weight = (Map.GetCell(ni).ToVector2DUnsafe()-CellPoint).Size();
+            }
+
+            const float NewDistance = Distance + Weight * .5f * (FMath::Max(CellCost, 0.f) + NeighbourCost);
+
+            if (NewDistance < Distances[ni] && NewDistance <= MaxDistance)
+            {
+                Distances[ni] = NewDistance;
+
+                if (NearestSources)
+                {
+                    NearestSources[ni] = NearestSources[CellIndex];
+                }
+
+                Heap.Push(NewDistance, ni);
+            }
+        }
+    }
+}
@@ -28,28 +28,56 @@
 #include "JCVFeatureUtility.h"
 #include "JCVCellUtility.h"
 #include "JCVDiagramMap.h"
+#include "JCVDistanceField.h"
+#include "JCVFrontierSearch.h"
+#include "Async/ParallelFor.h"
 
 // Visit Utility
 
 void FJCVFeatureUtility::PointFill(FJCVDiagramMap& Map, const TArray<FJCVCell*>& OriginCells, uint8 FeatureTypeFilter)
 {
-    FJCVCellUtility::PointFillVisit(
-        Map,
-        OriginCells,
-        [FeatureTypeFilter](
-            FJCVCell& CurrentCell,
-            FJCVCell& NeighbourCell,
-            FJCVEdge& CellEdge
-            )
+    if (Map.IsEmpty() || OriginCells.Num() < 1)
+    {
+        return;
+    }
+
+    TArray<int32> Sources;
+    Sources.Reserve(OriginCells.Num());
+
+    for (const FJCVCell* c : OriginCells)
+    {
+        if (c)
         {
-            if (FeatureTypeFilter != 255 && NeighbourCell.FeatureType != FeatureTypeFilter)
-            {
-                return false;
-            }
+            Sources.Emplace(c->GetIndex());
+        }
+    }
 
-            NeighbourCell.SetType(CurrentCell);
-            return true;
-        } );
+    // Search cells reachable through filtered cells, each cell takes the
+    // feature of its source cell
+
+    TArray<int32> Distances;
+    TArray<int32> CellSources;
+
+    FJCVFrontierSearch::Search(
+        Map.GetAdjacency(),
+        Sources,
+        [&Map, FeatureTypeFilter](int32 CellIndex, int32 ParentIndex)
+        {
+            return FeatureTypeFilter == 255 || Map.GetCell(CellIndex).GetFeatureType() == FeatureTypeFilter;
+        },
+        Distances,
+        CellSources
+        );
+
+    // Apply features on the calling thread, feature changes are journaled
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        if (Distances[i] > 0)
+        {
+            Map.GetCell(i).SetType(Map.GetCell(CellSources[i]));
+        }
+    }
 }
 
 void FJCVFeatureUtility::PointFillIsolated(
@@ -159,7 +187,7 @@ void FJCVFeatureUtility::GenerateSegmentExpands(
         for (FJCVCell* c : OriginCells)
         {
             float dist1 = (randPos-c->ToVector2D()).Size();
-            if (! plateS.Contains(c->FeatureType) && dist1 < dist0)
+            if (! plateS.Contains(c->GetFeatureType()) && dist1 < dist0)
             {
                 plateCell = c;
                 dist0 = dist1;
@@ -167,7 +195,7 @@ void FJCVFeatureUtility::GenerateSegmentExpands(
         }
         if (plateCell)
         {
-            FJCVFeatureGroup* fg = Map.GetFeatureGroup(plateCell->FeatureType);
+            FJCVFeatureGroup* fg = Map.GetFeatureGroup(plateCell->GetFeatureType());
             if (fg)
             {
                 plateQ.Enqueue(fg->FeatureType);
@@ -264,7 +292,7 @@ void FJCVFeatureUtility::PointFillSubdivideFeatures(
         {
             FJCVCell& c(Map.GetCell(i));
 
-            if (c.FeatureType == FeatureType)
+            if (c.GetFeatureType() == FeatureType)
             {
                 OriginCells.Emplace(&c);
             }
@@ -334,7 +362,7 @@ void FJCVFeatureUtility::PointFillSubdivideFeatures(
         {
             float distSq1 = (randPos-c->ToVector2D()).SizeSquared();
 
-            if (! VisitedFeatureSet.Contains(c->FeatureType) && distSq1 < distSq0)
+            if (! VisitedFeatureSet.Contains(c->GetFeatureType()) && distSq1 < distSq0)
             {
                 plateCell = c;
                 distSq0 = distSq1;
@@ -343,7 +371,7 @@ void FJCVFeatureUtility::PointFillSubdivideFeatures(
 
         if (plateCell)
         {
-            FJCVFeatureGroup* plateFeatureGroup = Map.GetFeatureGroup(plateCell->FeatureType);
+            FJCVFeatureGroup* plateFeatureGroup = Map.GetFeatureGroup(plateCell->GetFeatureType());
 
             if (plateFeatureGroup)
             {
@@ -393,6 +421,90 @@ void FJCVFeatureUtility::PointFillSubdivideFeatures(
 
 // Depth Map Utility
 
+void FJCVFeatureUtility::GenerateDepthField(
+    const FJCVDiagramMap& Map,
+    const FJCVFeatureId& FeatureId,
+    TArray<int32>& OutDepths,
+    TArray<int32>* OutNearestBorderCells
+    )
+{
+    const uint8 FeatureType = FeatureId.Type;
+    const int32 FeatureIndex = FeatureId.Index;
+
+    const int32 CellCount = Map.Num();
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+    const FJCVCellStorage& Storage(Map.GetCellStorage());
+    const uint8* Types = Storage.FeatureTypes.GetData();
+    const int32* Indices = Storage.FeatureIndices.GetData();
+
+    auto IsMatch = [=](int32 i)
+    {
+        return Types[i] == FeatureType && (FeatureIndex < 0 ? Indices[i] >= 0 : Indices[i] == FeatureIndex);
+    };
+
+    // Flag feature border cells in parallel, sources are collected in cell
+    // order to keep nearest border cells independent of thread count
+
+    TArray<uint8> BorderFlags;
+    BorderFlags.SetNumUninitialized(CellCount);
+
+    const int32 ChunkSize = 4096;
+    const int32 ChunkCount = FMath::DivideAndRoundUp(CellCount, ChunkSize);
+
+    ParallelFor(ChunkCount, [&](int32 ci)
+    {
+        const int32 CellStart = ci * ChunkSize;
+        const int32 CellEnd = FMath::Min(CellStart+ChunkSize, CellCount);
+
+        for (int32 i=CellStart; i<CellEnd; ++i)
+        {
+            bool bBorder = false;
+
+            if (IsMatch(i))
+            {
+                bBorder = Adjacency.IsBorder(i);
+
+                for (int32 ni : Adjacency.GetNeighbours(i))
+                {
+                    if (Types[ni] != FeatureType)
+                    {
+                        bBorder = true;
+                        break;
+                    }
+                }
+            }
+
+            BorderFlags[i] = bBorder ? 1 : 0;
+        }
+    } );
+
+    TArray<int32> Sources;
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (BorderFlags[i])
+        {
+            Sources.Emplace(i);
+        }
+    }
+
+    // Search all cell groups at once from their border cells, neighbours
+    // are visited only within the cell group of the visiting cell
+
+    TArray<int32> NearestBorderCells;
+
+    FJCVFrontierSearch::Search(
+        Adjacency,
+        Sources,
+        [Types, Indices](int32 CellIndex, int32 ParentIndex)
+        {
+            return Types[CellIndex] == Types[ParentIndex] && Indices[CellIndex] == Indices[ParentIndex];
+        },
+        OutDepths,
+        OutNearestBorderCells ? *OutNearestBorderCells : NearestBorderCells
+        );
+}
+
 void FJCVFeatureUtility::GenerateDepthMap(FJCVDiagramMap& SrcMap, FJCVDiagramMap& DstMap, const FJCVFeatureId& FeatureId)
 {
     const uint8 FeatureType = FeatureId.Type;
@@ -413,64 +525,27 @@ void FJCVFeatureUtility::GenerateDepthMap(FJCVDiagramMap& SrcMap, FJCVDiagramMap
     TArray<int32> FeatureIndices;
     SrcMap.GetFeatureIndices(FeatureIndices, FeatureType, FeatureIndex, true);
 
+    // Depth feature type of each evaluated cell group
+    TArray<int32> DepthFeatureTypes;
+    DepthFeatureTypes.Init(INDEX_NONE, SrcMap.GetFeatureGroupCount(FeatureType));
+
     for (int32 i=0; i<FeatureIndices.Num(); ++i)
     {
-        const int32 CurFeatureIndex = FeatureIndices[i];
-        const int32 DepthFeatureType = i+1;
-
-        FJCVConstCellSet VisitedCellSet;
-        FJCVConstCellSet PrevCellSet;
-        FJCVConstCellSet CurCellSet;
-
-        // Find feature border cells to use as initial cells to evaluate
-        SrcMap.GetBorderCells(CurCellSet, FeatureType, -1, CurFeatureIndex, true, true);
-
-        VisitedCellSet = CurCellSet;
-        PrevCellSet = CurCellSet;
-
-        int32 VisitedCellCount = 0;
+        DepthFeatureTypes[FeatureIndices[i]] = i+1;
+    }
 
-        // Callback for every visited cells
-        TFunctionRef<void(const FJCVCell*)> VisitCallback(
-            [&](const FJCVCell* Cell)
-            {
-                check(Cell != nullptr);
+    TArray<int32> Depths;
+    GenerateDepthField(SrcMap, FeatureId, Depths);
 
-                if (Cell->IsType(FeatureType, CurFeatureIndex) && ! VisitedCellSet.Contains(Cell))
-                {
-                    CurCellSet.Emplace(Cell);
-                }
-            } );
+    // Set cell depth as depth feature index
 
-        // Set border cells as lowest depth feature
-        for (const FJCVCell* Cell : CurCellSet)
-        {
-            FJCVCell& DstCell(DstMap.GetCell(Cell->GetIndex()));
-            DstCell.SetType(DepthFeatureType, 0);
-        }
-
-        int32 Depth = 1;
+    for (int32 i=0; i<SrcMap.Num(); ++i)
+    {
+        const int32 CellFeatureIndex = SrcMap.GetCell(i).GetFeatureIndex();
 
-        while (PrevCellSet.Num() > 0)
+        if (Depths[i] >= 0 && DepthFeatureTypes.IsValidIndex(CellFeatureIndex) && DepthFeatureTypes[CellFeatureIndex] > 0)
         {
-            CurCellSet.Reset();
-
-            for (const FJCVCell* Cell : PrevCellSet)
-            {
-                check(Cell != nullptr);
-                SrcMap.VisitNeighbours(*Cell, VisitCallback);
-            }
-
-            VisitedCellSet.Append(CurCellSet);
-            PrevCellSet = CurCellSet;
-
-            for (const FJCVCell* Cell : CurCellSet)
-            {
-                FJCVCell& DstCell(DstMap.GetCell(Cell->GetIndex()));
-                DstCell.SetType(DepthFeatureType, Depth);
-            }
-
-            ++Depth;
+            DstMap.GetCell(i).SetType(DepthFeatureTypes[CellFeatureIndex], Depths[i]);
         }
     }
 
@@ -610,11 +685,12 @@ void FJCVFeatureUtility::GetFeatureCellGroups(
     for (int32 i=0; i<FeatureIds.Num(); ++i)
     {
         const FJCVFeatureId& FeatureId(FeatureIds[i]);
-        FJCVCellGroup* CellGroup = Map.GetFeatureCellGroup(FeatureId);
+        const FJCVCellGroupView* CellGroup = Map.GetFeatureCellGroup(FeatureId);
 
         if (CellGroup)
         {
-            OutCellGroups[i] = *CellGroup;
+            OutCellGroups[i].Reset(CellGroup->Num());
+            CellGroup->AppendTo(OutCellGroups[i]);
         }
     }
 }
@@ -660,6 +736,35 @@ void UJCVFeatureUtility::K2_GenerateDepthMap(UJCVDiagramAccessor* SrcAccessor, U
     FJCVFeatureUtility::GenerateDepthMap(SrcMap, DstMap, FeatureId);
 }
 
+void UJCVFeatureUtility::K2_GenerateDistanceField(
+    UJCVDiagramAccessor* Accessor,
+    const TArray<FJCVCellRef>& SourceCellRefs,
+    TArray<float>& Distances,
+    const TArray<float>& TypeCostMultipliers,
+    bool bUseEdgeLength
+    )
+{
+    if (! IsValid(Accessor) || ! Accessor->HasValidMap())
+    {
+        UE_LOG(LogJCV,Warning, TEXT("UJCVFeatureUtility::GenerateDistanceField() ABORTED, INVALID ACCESSOR"));
+        return;
+    }
+
+    TArray<int32> Sources;
+    Sources.Reserve(SourceCellRefs.Num());
+
+    for (const FJCVCellRef& CellRef : SourceCellRefs)
+    {
+        Sources.Emplace(Accessor->GetCellIndex(CellRef));
+    }
+
+    FJCVDistanceFieldParams Params;
+    Params.Weight = bUseEdgeLength ? EJCVDistanceWeight::EdgeLength : EJCVDistanceWeight::SiteDistance;
+    Params.TypeCostMultipliers = TypeCostMultipliers;
+
+    FJCVDistanceField::Compute(Accessor->GetMap(), Sources, Params, Distances);
+}
+
 void UJCVFeatureUtility::GetFeatureIdRange(TArray<FJCVFeatureId>& FeatureIds, uint8 FeatureType, int32 FeatureIndexStart, int32 FeatureIndexEnd, bool bInclusiveEnd)
 {
     if (FeatureIndexStart <= FeatureIndexEnd)
@@ -701,17 +806,17 @@ void UJCVFeatureUtility::GetCellsFromFeatures(
     FJCVDiagramMap& Map(Accessor->GetMap());
     CellRefGroups.SetNum(FeatureIds.Num());
 
-    TSet<const FJCVCell*> FilterCellSet;
+    FJCVCellBitSet FilterCellSet;
 
     if (bUseFilterCells)
     {
-        FilterCellSet.Reserve(FilterCells.Num());
+        FilterCellSet.Init(Map.Num());
 
         for (const FJCVCellRef& FilterCell : FilterCells)
         {
-            if (FilterCell.HasValidCell())
+            if (FilterCell.HasValidCell() && FilterCellSet.IsValidIndex(FilterCell.Data->GetIndex()))
             {
-                FilterCellSet.Emplace(FilterCell.Data);
+                FilterCellSet.Add(FilterCell.Data->GetIndex());
             }
         }
     }
@@ -721,20 +826,20 @@ void UJCVFeatureUtility::GetCellsFromFeatures(
         const FJCVFeatureId& FeatureId(FeatureIds[i]);
         TArray<FJCVCellRef>& CellRefs(CellRefGroups[i].Data);
 
-        FJCVCellGroup* CellGroupPtr = Map.GetFeatureCellGroup(FeatureId);
+        const FJCVCellGroupView* CellGroupPtr = Map.GetFeatureCellGroup(FeatureId);
 
         if (! CellGroupPtr)
         {
             continue;
         }
 
-        FJCVCellGroup& CellGroup(*CellGroupPtr);
+        const FJCVCellGroupView& CellGroup(*CellGroupPtr);
 
         if (bUseFilterCells)
         {
             for (FJCVCell* Cell : CellGroup)
             {
-                if (! FilterCellSet.Contains(Cell))
+                if (! FilterCellSet.Contains(Cell->GetIndex()))
                 {
                     CellRefs.Emplace(Cell);
                 }
@@ -69,10 +69,10 @@ void FJCVCellDetailsRef::Set(const FJCVCell* InCell)
     {
         Index        = Cell->GetIndex();
         Point        = Cell->ToVector2D();
-        Value        = Cell->Value;
-        bIsBorder    = Cell->bIsBorder;
-        FeatureType  = Cell->FeatureType;
-        FeatureIndex = Cell->FeatureIndex;
+        Value        = Cell->GetValue();
+        bIsBorder    = Cell->IsBorder();
+        FeatureType  = Cell->GetFeatureType();
+        FeatureIndex = Cell->GetFeatureIndex();
     }
 }
 
@@ -85,7 +85,7 @@ bool FJCVFeatureTraits::HasMatchingTraits(const FJCVCell& Cell) const
 
 bool FJCVValueTraits::HasMatchingTraits(const FJCVCell& Cell) const
 {
-    return Cell.Value >= ValueLo && Cell.Value <= ValueHi;
+    return Cell.GetValue() >= ValueLo && Cell.GetValue() <= ValueHi;
 }
 
 bool FJCVPointRadiusTraits::HasMatchingTraits(const FJCVCell& Cell) const
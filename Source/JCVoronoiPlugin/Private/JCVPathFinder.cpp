@@ -0,0 +1,909 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "JCVPathFinder.h"
+#include "JCVDiagramMap.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Reverse.h"
+
+namespace JCVPathFinder
+{
+    struct FCostTable
+    {
+        float TypeCosts[256];
+        float MinTypeCost;
+
+        void Init(const FJCVPathParams& Params)
+        {
+            MinTypeCost = BIG_NUMBER;
+
+            for (int32 t=0; t<256; ++t)
+            {
+                TypeCosts[t] = Params.TypeCostMultipliers.IsValidIndex(t)
+                    ? Params.TypeCostMultipliers[t]
+                    : 1.f;
+
+                if (TypeCosts[t] >= 0.f)
+                {
+                    MinTypeCost = FMath::Min(MinTypeCost, TypeCosts[t]);
+                }
+            }
+
+            if (MinTypeCost >= BIG_NUMBER)
+            {
+                MinTypeCost = 0.f;
+            }
+        }
+
+        void Init(const float* InTypeCosts, float InMinTypeCost)
+        {
+            FMemory::Memcpy(TypeCosts, InTypeCosts, sizeof(TypeCosts));
+            MinTypeCost = InMinTypeCost;
+        }
+    };
+
+    struct FOpenEntry
+    {
+        float Cost;
+        int32 Index;
+
+        FORCEINLINE bool operator<(const FOpenEntry& Other) const
+        {
+            return Cost < Other.Cost;
+        }
+    };
+
+    // Epoch stamped search state. A cell is open or closed when its stamp
+    // matches the current epoch, its cost and parent are valid once open.
+
+    class FSearchScratch
+    {
+        TArray<uint32> OpenStamps;
+        TArray<uint32> ClosedStamps;
+        uint32 Epoch = 0;
+
+    public:
+
+        TArray<float> Costs;
+        TArray<int32> Parents;
+        TArray<FOpenEntry> OpenHeap;
+
+        void Begin(int32 CellCount)
+        {
+            if (OpenStamps.Num() < CellCount)
+            {
+                const int32 AddCount = CellCount-OpenStamps.Num();
+                OpenStamps.AddZeroed(AddCount);
+                ClosedStamps.AddZeroed(AddCount);
+                Costs.AddUninitialized(AddCount);
+                Parents.AddUninitialized(AddCount);
+            }
+
+            // Clear stamps on epoch wrap around
+
+            if (++Epoch == 0)
+            {
+                FMemory::Memzero(OpenStamps.GetData(), OpenStamps.Num()*sizeof(uint32));
+                FMemory::Memzero(ClosedStamps.GetData(), ClosedStamps.Num()*sizeof(uint32));
+                Epoch = 1;
+            }
+
+            OpenHeap.Reset();
+        }
+
+        FORCEINLINE bool IsOpen(int32 i) const
+        {
+            return OpenStamps[i] == Epoch;
+        }
+
+        FORCEINLINE bool IsClosed(int32 i) const
+        {
+            return ClosedStamps[i] == Epoch;
+        }
+
+        FORCEINLINE void Open(int32 i, float Cost, int32 Parent, float Estimate)
+        {
+            OpenStamps[i] = Epoch;
+            Costs[i] = Cost;
+            Parents[i] = Parent;
+            OpenHeap.HeapPush({ Cost+Estimate, i });
+        }
+
+        FORCEINLINE void Close(int32 i)
+        {
+            ClosedStamps[i] = Epoch;
+        }
+
+        // Calling thread cell search state, cell searches must not nest
+        static FSearchScratch& Get()
+        {
+            static thread_local FSearchScratch Scratch;
+            return Scratch;
+        }
+
+        // Calling thread portal graph search state
+        static FSearchScratch& GetPortals()
+        {
+            static thread_local FSearchScratch Scratch;
+            return Scratch;
+        }
+    };
+
+    typedef TPair<int32, float> FPortalLink;
+
+    // Calling thread path hierarchy query state
+    struct FQueryScratch
+    {
+        // Start and goal links to the portal nodes of their cluster, in
+        // ascending node order
+        TArray<FPortalLink> StartLinks;
+        TArray<FPortalLink> GoalLinks;
+
+        TArray<int32> PathCells;
+
+        static FQueryScratch& Get()
+        {
+            static thread_local FQueryScratch Scratch;
+            return Scratch;
+        }
+    };
+
+    FORCEINLINE float GetStepCost(const FJCVDiagramMap& Map, const FCostTable& Costs, const uint8* Types, int32 i0, int32 i1)
+    {
+        const float Cost1 = Costs.TypeCosts[Types[i1]];
+
+        if (Cost1 < 0.f)
+        {
+            return -1.f;
+        }
+
+        const float Cost0 = FMath::Max(Costs.TypeCosts[Types[i0]], 0.f);
+        const float Distance = (Map.GetCell(i1).ToVector2DUnsafe()-Map.GetCell(i0).ToVector2DUnsafe()).Size();
+
+        return Distance * .5f * (Cost0+Cost1);
+    }
+
+    /**
+     * A* search from the start cell over cells accepted by
+     * CanEnter(CellIndex), directed towards the estimate cell or with zero
+     * estimates if INDEX_NONE. Estimates are consistent, costs of closed
+     * cells are final whichever cell the search is directed to. Returns
+     * true once OnClose(CellIndex) returns true for a closed cell, false
+     * if all reachable cells are closed. Results remain in the calling
+     * thread scratch.
+     */
+    template<class FCanEnter, class FOnClose>
+    bool SearchUntil(
+        const FJCVDiagramMap& Map,
+        const FCostTable& Costs,
+        int32 StartIndex,
+        int32 EstimateIndex,
+        const FCanEnter& CanEnter,
+        const FOnClose& OnClose
+        )
+    {
+        const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+        const uint8* Types = Map.GetCellStorage().FeatureTypes.GetData();
+        const bool bHasEstimate = EstimateIndex >= 0;
+        const FVector2D EstimatePoint = bHasEstimate ? Map.GetCell(EstimateIndex).ToVector2DUnsafe() : FVector2D::ZeroVector;
+
+        // Estimate scaled by the lowest step cost multiplier is admissible
+        // and consistent with the step costs
+        auto Estimate = [&](int32 i)
+        {
+            return bHasEstimate
+                ? (Map.GetCell(i).ToVector2DUnsafe()-EstimatePoint).Size() * Costs.MinTypeCost
+                : 0.f;
+        };
+
+        FSearchScratch& Scratch(FSearchScratch::Get());
+        Scratch.Begin(Map.Num());
+        Scratch.Open(StartIndex, 0.f, INDEX_NONE, Estimate(StartIndex));
+
+        while (Scratch.OpenHeap.Num() > 0)
+        {
+            FOpenEntry Entry;
+            Scratch.OpenHeap.HeapPop(Entry, false);
+
+            const int32 CellIndex = Entry.Index;
+
+            // Stale entry of a closed cell
+            if (Scratch.IsClosed(CellIndex))
+            {
+                continue;
+            }
+
+            Scratch.Close(CellIndex);
+
+            if (OnClose(CellIndex))
+            {
+                return true;
+            }
+
+            const float CellCost = Scratch.Costs[CellIndex];
+
+            for (int32 ni : Adjacency.GetNeighbours(CellIndex))
+            {
+                if (Scratch.IsClosed(ni) || ! CanEnter(ni))
+                {
+                    continue;
+                }
+
+                const float StepCost = GetStepCost(Map, Costs, Types, CellIndex, ni);
+
+                if (StepCost < 0.f)
+                {
+                    continue;
+                }
+
+                const float NewCost = CellCost + StepCost;
+
+                if (! Scratch.IsOpen(ni) || NewCost < Scratch.Costs[ni])
+                {
+                    Scratch.Open(ni, NewCost, CellIndex, Estimate(ni));
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * A* search from the start cell to the goal cell over cells accepted by
+     * CanEnter(CellIndex). Without goal, searches all reachable cells with
+     * zero estimates. Results remain in the calling thread scratch.
+     */
+    template<class FCanEnter>
+    bool Search(
+        const FJCVDiagramMap& Map,
+        const FCostTable& Costs,
+        int32 StartIndex,
+        int32 GoalIndex,
+        const FCanEnter& CanEnter
+        )
+    {
+        const bool bFound = SearchUntil(Map, Costs, StartIndex, GoalIndex, CanEnter, [GoalIndex](int32 i) { return i == GoalIndex; });
+        return bFound || GoalIndex < 0;
+    }
+
+    /**
+     * In-cluster search from the start cell directed towards the estimate
+     * cell, stops once all portal cells of the cluster are closed. Costs of
+     * closed portal cells remain in the calling thread scratch.
+     */
+    void SearchPortals(
+        const FJCVDiagramMap& Map,
+        const FCostTable& Costs,
+        const TArray<int32>& CellClusters,
+        const TArray<int32>& CellNodes,
+        int32 Cluster,
+        int32 PortalCount,
+        int32 StartIndex,
+        int32 EstimateIndex
+        )
+    {
+        int32 OpenPortalCount = PortalCount;
+
+        SearchUntil(
+            Map,
+            Costs,
+            StartIndex,
+            EstimateIndex,
+            [&CellClusters, Cluster](int32 i) { return CellClusters[i] == Cluster; },
+            [&CellNodes, &OpenPortalCount](int32 i) { return CellNodes[i] != INDEX_NONE && --OpenPortalCount == 0; }
+            );
+    }
+
+    // Append path from the scratch parents of the goal cell, skipping the
+    // start cell if it is already the last path cell
+    void AppendPath(int32 GoalIndex, TArray<int32>& OutPath)
+    {
+        const FSearchScratch& Scratch(FSearchScratch::Get());
+        const int32 PathStart = OutPath.Num();
+
+        for (int32 i=GoalIndex; i!=INDEX_NONE; i=Scratch.Parents[i])
+        {
+            OutPath.Emplace(i);
+        }
+
+        Algo::Reverse(OutPath.GetData()+PathStart, OutPath.Num()-PathStart);
+
+        if (PathStart > 0 && OutPath[PathStart-1] == OutPath[PathStart])
+        {
+            OutPath.RemoveAt(PathStart, 1, false);
+        }
+    }
+
+    float GetPathCost(const FJCVDiagramMap& Map, const FCostTable& Costs, const TArray<int32>& Path)
+    {
+        const uint8* Types = Map.GetCellStorage().FeatureTypes.GetData();
+        float PathCost = 0.f;
+
+        for (int32 i=1; i<Path.Num(); ++i)
+        {
+            PathCost += FMath::Max(GetStepCost(Map, Costs, Types, Path[i-1], Path[i]), 0.f);
+        }
+
+        return PathCost;
+    }
+
+    bool FindPath(
+        const FJCVDiagramMap& Map,
+        const FCostTable& Costs,
+        int32 StartIndex,
+        int32 GoalIndex,
+        TArray<int32>& OutPath,
+        float* OutCost
+        )
+    {
+        OutPath.Reset();
+
+        if (! Map.IsValidIndex(StartIndex) || ! Map.IsValidIndex(GoalIndex))
+        {
+            return false;
+        }
+
+        if (! Search(Map, Costs, StartIndex, GoalIndex, [](int32) { return true; }))
+        {
+            return false;
+        }
+
+        AppendPath(GoalIndex, OutPath);
+
+        if (OutCost)
+        {
+            *OutCost = FSearchScratch::Get().Costs[GoalIndex];
+        }
+
+        return true;
+    }
+}
+
+// -- PATH FINDER
+
+bool FJCVPathFinder::FindPath(
+    const FJCVDiagramMap& Map,
+    int32 StartIndex,
+    int32 GoalIndex,
+    const FJCVPathParams& Params,
+    TArray<int32>& OutPath,
+    float* OutCost
+    )
+{
+    JCVPathFinder::FCostTable Costs;
+    Costs.Init(Params);
+
+    return JCVPathFinder::FindPath(Map, Costs, StartIndex, GoalIndex, OutPath, OutCost);
+}
+
+// -- PATH HIERARCHY
+
+bool FJCVPathHierarchy::IsValidFor(const FJCVDiagramMap& Map) const
+{
+    return IsValid() && CellClusters.Num() == Map.Num();
+}
+
+void FJCVPathHierarchy::Empty()
+{
+    CellClusters.Empty();
+    CellNodes.Empty();
+    NodeCells.Empty();
+    NodeEdgeOffsets.Empty();
+    NodeEdgeTargets.Empty();
+    NodeEdgeCosts.Empty();
+    ClusterNodeOffsets.Empty();
+    ClusterNodes.Empty();
+}
+
+SIZE_T FJCVPathHierarchy::GetAllocatedSize() const
+{
+    return CellClusters.GetAllocatedSize()
+        + CellNodes.GetAllocatedSize()
+        + NodeCells.GetAllocatedSize()
+        + NodeEdgeOffsets.GetAllocatedSize()
+        + NodeEdgeTargets.GetAllocatedSize()
+        + NodeEdgeCosts.GetAllocatedSize()
+        + ClusterNodeOffsets.GetAllocatedSize()
+        + ClusterNodes.GetAllocatedSize();
+}
+
+void FJCVPathHierarchy::Build(const FJCVDiagramMap& Map, const FJCVPathParams& Params)
+{
+    using namespace JCVPathFinder;
+
+    Empty();
+
+    const int32 CellCount = Map.Num();
+
+    if (CellCount == 0)
+    {
+        return;
+    }
+
+    FCostTable Costs;
+    Costs.Init(Params);
+
+    FMemory::Memcpy(TypeCosts, Costs.TypeCosts, sizeof(TypeCosts));
+    MinTypeCost = Costs.MinTypeCost;
+
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+    const FJCVCellStorage& Storage(Map.GetCellStorage());
+    const uint8* Types = Storage.FeatureTypes.GetData();
+    const int32* Indices = Storage.FeatureIndices.GetData();
+
+    // Dense cluster of each cell by feature type and feature index
+
+    int32 TypeClusterOffsets[257] = { 0 };
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        TypeClusterOffsets[Types[i]+1] = FMath::Max(TypeClusterOffsets[Types[i]+1], Indices[i]+1);
+    }
+
+    for (int32 t=0; t<256; ++t)
+    {
+        TypeClusterOffsets[t+1] += TypeClusterOffsets[t];
+    }
+
+    const int32 ClusterCount = TypeClusterOffsets[256];
+
+    CellClusters.SetNumUninitialized(CellCount);
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        CellClusters[i] = (Indices[i] >= 0)
+            ? TypeClusterOffsets[Types[i]]+Indices[i]
+            : INDEX_NONE;
+    }
+
+    // Border cell pairs of adjacent clusters, accumulate the border middle
+    // of each cluster pair, then pick the pair closest to it as portal.
+    // Both portal cells must be enterable.
+
+    struct FClusterBorder
+    {
+        FVector2D PointSum = FVector2D::ZeroVector;
+        int32 PairCount = 0;
+        float BestDistSq = BIG_NUMBER;
+        int32 Cell0 = INDEX_NONE;
+        int32 Cell1 = INDEX_NONE;
+    };
+
+    TMap<uint64, FClusterBorder> Borders;
+
+    auto GetBorderKey = [this](int32 i0, int32 i1)
+    {
+        return (uint64(uint32(CellClusters[i0])) << 32) | uint32(CellClusters[i1]);
+    };
+
+    auto IsBorderPair = [&](int32 i0, int32 i1)
+    {
+        return CellClusters[i0] < CellClusters[i1]
+            && CellClusters[i0] != INDEX_NONE
+            && TypeCosts[Types[i0]] >= 0.f
+            && TypeCosts[Types[i1]] >= 0.f;
+    };
+
+    auto GetPairPoint = [&](int32 i0, int32 i1)
+    {
+        return (Map.GetCell(i0).ToVector2DUnsafe()+Map.GetCell(i1).ToVector2DUnsafe()) * .5f;
+    };
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        for (int32 ni : Adjacency.GetNeighbours(i))
+        {
+            if (IsBorderPair(i, ni))
+            {
+                FClusterBorder& Border(Borders.FindOrAdd(GetBorderKey(i, ni)));
+                Border.PointSum += GetPairPoint(i, ni);
+                ++Border.PairCount;
+            }
+        }
+    }
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        for (int32 ni : Adjacency.GetNeighbours(i))
+        {
+            if (IsBorderPair(i, ni))
+            {
+                FClusterBorder& Border(Borders.FindChecked(GetBorderKey(i, ni)));
+                const FVector2D BorderMid = Border.PointSum / Border.PairCount;
+                const float DistSq = (GetPairPoint(i, ni)-BorderMid).SizeSquared();
+
+                if (DistSq < Border.BestDistSq)
+                {
+                    Border.BestDistSq = DistSq;
+                    Border.Cell0 = i;
+                    Border.Cell1 = ni;
+                }
+            }
+        }
+    }
+
+    // Portal nodes in cell order
+
+    CellNodes.Init(INDEX_NONE, CellCount);
+
+    for (const TPair<uint64, FClusterBorder>& Border : Borders)
+    {
+        CellNodes[Border.Value.Cell0] = 0;
+        CellNodes[Border.Value.Cell1] = 0;
+    }
+
+    for (int32 i=0; i<CellCount; ++i)
+    {
+        if (CellNodes[i] != INDEX_NONE)
+        {
+            CellNodes[i] = NodeCells.Emplace(i);
+        }
+    }
+
+    const int32 NodeCount = NodeCells.Num();
+
+    // Portal nodes of each cluster
+
+    ClusterNodeOffsets.SetNumZeroed(ClusterCount+1);
+
+    for (int32 Cell : NodeCells)
+    {
+        ++ClusterNodeOffsets[CellClusters[Cell]+1];
+    }
+
+    for (int32 c=0; c<ClusterCount; ++c)
+    {
+        ClusterNodeOffsets[c+1] += ClusterNodeOffsets[c];
+    }
+
+    ClusterNodes.SetNumUninitialized(NodeCount);
+
+    {
+        TArray<int32> ClusterFill(ClusterNodeOffsets);
+
+        for (int32 n=0; n<NodeCount; ++n)
+        {
+            ClusterNodes[ClusterFill[CellClusters[NodeCells[n]]]++] = n;
+        }
+    }
+
+    // Portal graph edges. Inter cluster edges link portal pairs, intra
+    // cluster edges link portals of a cluster by their in-cluster cost.
+
+    TArray<TArray<TPair<int32, float>>> NodeEdges;
+    NodeEdges.SetNum(NodeCount);
+
+    for (const TPair<uint64, FClusterBorder>& Border : Borders)
+    {
+        const int32 Cell0 = Border.Value.Cell0;
+        const int32 Cell1 = Border.Value.Cell1;
+        const float Cost = GetStepCost(Map, Costs, Types, Cell0, Cell1);
+
+        NodeEdges[CellNodes[Cell0]].Emplace(CellNodes[Cell1], Cost);
+        NodeEdges[CellNodes[Cell1]].Emplace(CellNodes[Cell0], Cost);
+    }
+
+    for (int32 c=0; c<ClusterCount; ++c)
+    {
+        const int32 NodeBegin = ClusterNodeOffsets[c];
+        const int32 NodeEnd = ClusterNodeOffsets[c+1];
+
+        if (NodeEnd-NodeBegin < 2)
+        {
+            continue;
+        }
+
+        // Step costs are symmetric, each portal pair is linked in both
+        // directions by the search from its lower node. Cluster nodes are
+        // in ascending node order, each search stops once the higher
+        // portal nodes of the cluster are closed.
+
+        for (int32 n0=NodeBegin; n0<NodeEnd-1; ++n0)
+        {
+            const int32 Node0 = ClusterNodes[n0];
+            int32 OpenPortalCount = NodeEnd-n0-1;
+
+            SearchUntil(
+                Map,
+                Costs,
+                NodeCells[Node0],
+                INDEX_NONE,
+                [this, c](int32 i) { return CellClusters[i] == c; },
+                [this, Node0, &OpenPortalCount](int32 i) { return CellNodes[i] > Node0 && --OpenPortalCount == 0; }
+                );
+
+            const FSearchScratch& Scratch(FSearchScratch::Get());
+
+            for (int32 n1=n0+1; n1<NodeEnd; ++n1)
+            {
+                const int32 Node1 = ClusterNodes[n1];
+                const int32 Cell1 = NodeCells[Node1];
+
+                if (Scratch.IsClosed(Cell1))
+                {
+                    NodeEdges[Node0].Emplace(Node1, Scratch.Costs[Cell1]);
+                    NodeEdges[Node1].Emplace(Node0, Scratch.Costs[Cell1]);
+                }
+            }
+        }
+    }
+
+    NodeEdgeOffsets.SetNumUninitialized(NodeCount+1);
+    NodeEdgeOffsets[0] = 0;
+
+    for (int32 n=0; n<NodeCount; ++n)
+    {
+        NodeEdgeOffsets[n+1] = NodeEdgeOffsets[n] + NodeEdges[n].Num();
+    }
+
+    NodeEdgeTargets.Reserve(NodeEdgeOffsets[NodeCount]);
+    NodeEdgeCosts.Reserve(NodeEdgeOffsets[NodeCount]);
+
+    for (int32 n=0; n<NodeCount; ++n)
+    {
+        for (const TPair<int32, float>& Edge : NodeEdges[n])
+        {
+            NodeEdgeTargets.Emplace(Edge.Key);
+            NodeEdgeCosts.Emplace(Edge.Value);
+        }
+    }
+}
+
+bool FJCVPathHierarchy::FindPath(
+    const FJCVDiagramMap& Map,
+    int32 StartIndex,
+    int32 GoalIndex,
+    TArray<int32>& OutPath,
+    float* OutCost
+    ) const
+{
+    using namespace JCVPathFinder;
+
+    OutPath.Reset();
+
+    if (! IsValidFor(Map) || ! Map.IsValidIndex(StartIndex) || ! Map.IsValidIndex(GoalIndex))
+    {
+        return false;
+    }
+
+    FCostTable Costs;
+    Costs.Init(TypeCosts, MinTypeCost);
+
+    // Goal cell not enterable
+    if (StartIndex != GoalIndex && TypeCosts[Map.GetCellStorage().FeatureTypes[GoalIndex]] < 0.f)
+    {
+        return false;
+    }
+
+    const int32 StartCluster = CellClusters[StartIndex];
+    const int32 GoalCluster = CellClusters[GoalIndex];
+
+    // Cells without cluster, search the cell graph
+
+    if (StartCluster == INDEX_NONE || GoalCluster == INDEX_NONE)
+    {
+        return JCVPathFinder::FindPath(Map, Costs, StartIndex, GoalIndex, OutPath, OutCost);
+    }
+
+    const TArray<int32>& Clusters(CellClusters);
+
+    auto InCluster = [&Clusters](int32 Cluster)
+    {
+        return [&Clusters, Cluster](int32 i) { return Clusters[i] == Cluster; };
+    };
+
+    // Same cluster, try an in-cluster path first
+
+    if (StartCluster == GoalCluster && Search(Map, Costs, StartIndex, GoalIndex, InCluster(StartCluster)))
+    {
+        AppendPath(GoalIndex, OutPath);
+
+        if (OutCost)
+        {
+            *OutCost = FSearchScratch::Get().Costs[GoalIndex];
+        }
+
+        return true;
+    }
+
+    // Portal graph with start and goal nodes linked to the portals of their
+    // cluster by in-cluster costs. Goal links are reversed, step costs are
+    // symmetric. Link searches are directed to the opposite query cell and
+    // stop once all portals of the cluster are closed.
+
+    const int32 StartPortalCount = ClusterNodeOffsets[StartCluster+1]-ClusterNodeOffsets[StartCluster];
+    const int32 GoalPortalCount = ClusterNodeOffsets[GoalCluster+1]-ClusterNodeOffsets[GoalCluster];
+
+    if (StartPortalCount == 0 || GoalPortalCount == 0)
+    {
+        return false;
+    }
+
+    FQueryScratch& Query(FQueryScratch::Get());
+    const FSearchScratch& CellScratch(FSearchScratch::Get());
+
+    auto GetLinks = [&](TArray<FPortalLink>& OutLinks, int32 Cluster)
+    {
+        OutLinks.Reset();
+
+        for (int32 n=ClusterNodeOffsets[Cluster]; n<ClusterNodeOffsets[Cluster+1]; ++n)
+        {
+            const int32 Node = ClusterNodes[n];
+
+            if (CellScratch.IsClosed(NodeCells[Node]))
+            {
+                OutLinks.Emplace(Node, CellScratch.Costs[NodeCells[Node]]);
+            }
+        }
+    };
+
+    SearchPortals(Map, Costs, CellClusters, CellNodes, StartCluster, StartPortalCount, StartIndex, GoalIndex);
+    GetLinks(Query.StartLinks, StartCluster);
+
+    SearchPortals(Map, Costs, CellClusters, CellNodes, GoalCluster, GoalPortalCount, GoalIndex, StartIndex);
+    GetLinks(Query.GoalLinks, GoalCluster);
+
+    if (Query.StartLinks.Num() == 0 || Query.GoalLinks.Num() == 0)
+    {
+        return false;
+    }
+
+    // A* over the portal graph
+
+    const int32 NodeCount = NodeCells.Num();
+    const int32 StartNode = NodeCount;
+    const int32 GoalNode = NodeCount+1;
+
+    const FVector2D GoalPoint = Map.GetCell(GoalIndex).ToVector2DUnsafe();
+
+    auto Estimate = [&](int32 Node)
+    {
+        return (Node == GoalNode)
+            ? 0.f
+            : ((Node == StartNode ? Map.GetCell(StartIndex) : Map.GetCell(NodeCells[Node])).ToVector2DUnsafe()-GoalPoint).Size() * MinTypeCost;
+    };
+
+    FSearchScratch& NodeScratch(FSearchScratch::GetPortals());
+    NodeScratch.Begin(NodeCount+2);
+
+    auto OpenNode = [&](int32 Node, float Cost, int32 Parent)
+    {
+        if (! NodeScratch.IsClosed(Node) && (! NodeScratch.IsOpen(Node) || Cost < NodeScratch.Costs[Node]))
+        {
+            NodeScratch.Open(Node, Cost, Parent, Estimate(Node));
+        }
+    };
+
+    OpenNode(StartNode, 0.f, INDEX_NONE);
+
+    bool bFound = false;
+
+    while (NodeScratch.OpenHeap.Num() > 0)
+    {
+        FOpenEntry Entry;
+        NodeScratch.OpenHeap.HeapPop(Entry, false);
+
+        const int32 Node = Entry.Index;
+
+        if (NodeScratch.IsClosed(Node))
+        {
+            continue;
+        }
+
+        NodeScratch.Close(Node);
+
+        if (Node == GoalNode)
+        {
+            bFound = true;
+            break;
+        }
+
+        const float Cost = NodeScratch.Costs[Node];
+
+        if (Node == StartNode)
+        {
+            for (const FPortalLink& Link : Query.StartLinks)
+            {
+                OpenNode(Link.Key, Cost+Link.Value, Node);
+            }
+
+            continue;
+        }
+
+        // Goal links are sorted by node
+        if (CellClusters[NodeCells[Node]] == GoalCluster)
+        {
+            const int32 LinkIndex = Algo::LowerBoundBy(Query.GoalLinks, Node, [](const FPortalLink& Link) { return Link.Key; });
+
+            if (Query.GoalLinks.IsValidIndex(LinkIndex) && Query.GoalLinks[LinkIndex].Key == Node)
+            {
+                OpenNode(GoalNode, Cost+Query.GoalLinks[LinkIndex].Value, Node);
+            }
+        }
+
+        for (int32 e=NodeEdgeOffsets[Node]; e<NodeEdgeOffsets[Node+1]; ++e)
+        {
+            OpenNode(NodeEdgeTargets[e], Cost+NodeEdgeCosts[e], Node);
+        }
+    }
+
+    if (! bFound)
+    {
+        return false;
+    }
+
+    // Portal path cells from start to goal
+
+    TArray<int32>& PathCells(Query.PathCells);
+    PathCells.Reset();
+
+    for (int32 Node=GoalNode; Node!=INDEX_NONE; Node=NodeScratch.Parents[Node])
+    {
+        PathCells.Emplace(Node == GoalNode ? GoalIndex : (Node == StartNode ? StartIndex : NodeCells[Node]));
+    }
+
+    Algo::Reverse(PathCells);
+
+    // Refine portal steps, adjacent cells of different clusters are linked
+    // directly, cells of the same cluster by an in-cluster search
+
+    OutPath.Emplace(PathCells[0]);
+
+    for (int32 i=1; i<PathCells.Num(); ++i)
+    {
+        const int32 Cell0 = PathCells[i-1];
+        const int32 Cell1 = PathCells[i];
+        const int32 Cluster = CellClusters[Cell0];
+
+        if (Cell0 == Cell1)
+        {
+            continue;
+        }
+
+        if (Cluster != CellClusters[Cell1])
+        {
+            OutPath.Emplace(Cell1);
+        }
+        else
+        if (Search(Map, Costs, Cell0, Cell1, InCluster(Cluster)))
+        {
+            AppendPath(Cell1, OutPath);
+        }
+        else
+        {
+            OutPath.Reset();
+            return false;
+        }
+    }
+
+    if (OutCost)
+    {
+        *OutCost = GetPathCost(Map, Costs, OutPath);
+    }
+
+    return true;
+}
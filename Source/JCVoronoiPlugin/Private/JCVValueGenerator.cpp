@@ -81,48 +81,43 @@ void FJCVValueGenerator::AddRadialFill0(FJCVDiagramMap& Map, FRandomStream& Rand
     const bool bFilterBorder = FillParams.bFilterBorder;
     const bool bUseSharpness = Sharpness > KINDA_SMALL_NUMBER;
 
-    TQueue<FJCVCell*> cellQ;
-    TSet<FJCVCell*> ExclusionSet;
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
 
-    OriginCell.Value = FMath::Min(OriginCell.Value+BaseValue, 1.f);
-    ExclusionSet.Reserve(Map.Num());
-    ExclusionSet.Emplace(&OriginCell);
-    cellQ.Enqueue(&OriginCell);
+    FJCVCellVisitScope ExclusionSet(Map.GetVisitStamp(), Map.Num());
+    TArray<int32>& cellQ(ExclusionSet->GetQueue());
 
-    while (! cellQ.IsEmpty() && BaseValue > .01f)
+    OriginCell.SetValue(FMath::Min(OriginCell.GetValue()+BaseValue, 1.f));
+    ExclusionSet->MarkVisited(OriginCell.GetIndex());
+    cellQ.Emplace(OriginCell.GetIndex());
+
+    for (int32 q=0; q<cellQ.Num() && BaseValue > .01f; ++q)
     {
-        FJCVCell* cell;
-        cellQ.Dequeue(cell);
+        FJCVCell* cell = &Map.GetCell(cellQ[q]);
 
         if (bRadial)
         {
-            BaseValue = cell->Value;
+            BaseValue = cell->GetValue();
         }
 
         BaseValue *= Radius;
 
-        FJCVEdge* g = cell->GetEdge();
-        check(g);
-
-        do
+        for (int32 ni : Adjacency.GetNeighbours(cell->GetIndex()))
         {
-            FJCVCell* n = Map.GetCellNeighbour(g);
-
-            // Skip invalid or already visited cells
+            // Skip already visited cells, otherwise mark visited
 
-            if (! n || ExclusionSet.Contains(n))
+            if (! ExclusionSet->TryVisit(ni))
             {
                 continue;
             }
 
-            ExclusionSet.Emplace(n);
-            cellQ.Enqueue(n);
+            FJCVCell* n = &Map.GetCell(ni);
+            cellQ.Emplace(ni);
 
             // Zero border cell values if required
 
             if (bFilterBorder && n->IsBorder())
             {
-                n->Value = 0.f;
+                n->SetValue(0.f);
                 continue;
             }
 
@@ -135,15 +130,14 @@ void FJCVValueGenerator::AddRadialFill0(FJCVDiagramMap& Map, FRandomStream& Rand
                 SharpnessModifier = Rand.GetFraction() * Sharpness + 1.1f - Sharpness;
             }
 
-            float CellValue = n->Value + BaseValue * SharpnessModifier;
+            float CellValue = n->GetValue() + BaseValue * SharpnessModifier;
             CellValue = FMath::Min(CellValue, 1.f);
 
-            if (n->Value < CellValue)
+            if (n->GetValue() < CellValue)
             {
-                n->Value = CellValue;
+                n->SetValue(CellValue);
             }
         }
-        while ((g = g->next) != nullptr);
     }
 }
 
@@ -168,39 +162,34 @@ void FJCVValueGenerator::AddRadialFill(FJCVDiagramMap& Map, FRandomStream& Rand,
 
     float BaseValue = FillParams.Value;
 
-    // Cell queue and visited cell set
+    // Visited cells and cell queue
 
-    TQueue<FJCVCell*> cellQ;
-    TSet<FJCVCell*> cellS;
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+    FJCVCellVisitScope cellS(Map.GetVisitStamp(), Map.Num());
+    TArray<int32>& cellQ(cellS->GetQueue());
 
     // Assign base value to origin cell
 
-    OriginCell.Value = BaseValue;
+    OriginCell.SetValue(BaseValue);
 
-    cellS.Reserve(Map.Num());
-    cellS.Emplace(&OriginCell);
-    cellQ.Enqueue(&OriginCell);
+    cellS->MarkVisited(OriginCell.GetIndex());
+    cellQ.Emplace(OriginCell.GetIndex());
 
-    while (! cellQ.IsEmpty())
+    for (int32 q=0; q<cellQ.Num(); ++q)
     {
-        FJCVCell* cell;
-        cellQ.Dequeue(cell);
-
-        FJCVEdge* g = cell->GetEdge();
-        check(g);
+        FJCVCell* cell = &Map.GetCell(cellQ[q]);
 
-        do
+        for (int32 ni : Adjacency.GetNeighbours(cell->GetIndex()))
         {
-            FJCVCell* n = Map.GetCellNeighbour(g);
+            // Skip already visited cells, otherwise mark visited
 
-            // Skip invalid or already visited cells
-
-            if (! n || cellS.Contains(n))
+            if (! cellS->TryVisit(ni))
             {
                 continue;
             }
 
-            cellS.Emplace(n);
+            FJCVCell* n = &Map.GetCell(ni);
 
             float DistToOriginSq = (n->ToVector2D()-OriginPosition).SizeSquared();
 
@@ -211,13 +200,13 @@ void FJCVValueGenerator::AddRadialFill(FJCVDiagramMap& Map, FRandomStream& Rand,
                 continue;
             }
 
-            cellQ.Enqueue(n);
+            cellQ.Emplace(ni);
 
             // Set border cell value to zero if filter is set
 
             if (bFilterBorder && n->IsBorder())
             {
-                n->Value = 0.f;
+                n->SetValue(0.f);
                 continue;
             }
 
@@ -230,9 +219,8 @@ void FJCVValueGenerator::AddRadialFill(FJCVDiagramMap& Map, FRandomStream& Rand,
                 ValueRatio = ValueCurve->GetFloatValue(ValueRatio);
             }
 
-            n->Value = BaseValue * ValueRatio;
+            n->SetValue(BaseValue * ValueRatio);
         }
-        while ((g = g->next) != nullptr);
     }
 }
 
@@ -300,22 +288,25 @@ void FJCVValueGenerator::MapNormalizedDistanceFromCell(
     const float FurthestDistanceFromCell = FJCVCellUtility::GetFurthestDistanceFromCell(Map, OriginCell, FeatureId, bAgainstAnyType);
     const float InvDistanceFromCell = 1.f / FMath::Max(FurthestDistanceFromCell, KINDA_SMALL_NUMBER);
 
-    TFunctionRef<void(FJCVCell&)> CellCallback(
-        [&](FJCVCell& Cell)
-        {
-            const FVector2D CellPoint = Cell.ToVector2D();
-            const float CellDist = (CellPoint-Origin).Size();
+    // Map distance over the contiguous cell value array
 
-            Cell.SetValue(CellDist * InvDistanceFromCell);
-        } );
+    FJCVCellStorage& CellStorage(Map.GetCellStorage());
+    float* Values = CellStorage.Values.GetData();
 
-    if (bAgainstAnyType)
-    {
-        Map.VisitCells(CellCallback, &OriginCell);
-    }
-    else
+    const int32 CellCount = Map.Num();
+    const int32 OriginIndex = OriginCell.GetIndex();
+
+    for (int32 i=0; i<CellCount; ++i)
     {
-        Map.VisitFeatureCells(CellCallback, FeatureType, FeatureIndex);
+        const bool bMapCell = bAgainstAnyType
+            ? i != OriginIndex
+            : CellStorage.IsType(i, FeatureType, FeatureIndex);
+
+        if (bMapCell)
+        {
+            const FVector2D CellPoint = Map.GetCell(i).ToVector2DUnsafe();
+            Values[i] = (CellPoint-Origin).Size() * InvDistanceFromCell;
+        }
     }
 }
 
@@ -334,12 +325,7 @@ void UJCVValueUtilityLibrary::SetCellValues(UJCVDiagramAccessor* Accessor, float
     }
 
     FJCVDiagramMap& Map(Accessor->GetMap());
-    const int32 CellCount = Map.Num();
-
-    for (int32 i=0; i<CellCount; ++i)
-    {
-        Map.GetCell(i).SetValue(Value);
-    }
+    Map.GetCellStorage().SetValues(Value);
 }
 
 void UJCVValueUtilityLibrary::AddRadialFillAtPosition(UJCVDiagramAccessor* Accessor, int32 Seed, const FVector2D& Position, FJCVRadialFill FillParams)
@@ -452,7 +438,7 @@ void UJCVValueUtilityLibrary::AddRadialFillNum(UJCVDiagramAccessor* Accessor, in
             int32 CellIdx = Rand.RandHelper(CellCount);
             FJCVCell& OriginCell(Map.GetCell(CellIdx));
 
-            if (OriginCell.Value < tMin && BoundsExpand.IsInside(OriginCell.ToVector2D()))
+            if (OriginCell.GetValue() < tMin && BoundsExpand.IsInside(OriginCell.ToVector2D()))
             {
                 FillParams.Value *= tMax*Rand.GetFraction();
                 FillParams.Value += tMin;
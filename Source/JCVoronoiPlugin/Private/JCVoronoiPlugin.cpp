@@ -47,5 +47,21 @@ void FJCVoronoiPlugin::ShutdownModule()
 
 IMPLEMENT_MODULE(FJCVoronoiPlugin, JCVoronoiPlugin)
 DEFINE_LOG_CATEGORY(LogJCV);
+DEFINE_STAT(STAT_JCV_GenerateDiagram);
+DEFINE_STAT(STAT_JCV_GenerateDiagramTiled);
+DEFINE_STAT(STAT_JCV_BuildSiteGrid);
+DEFINE_STAT(STAT_JCV_BuildSiteTree);
+DEFINE_STAT(STAT_JCV_BuildCellPolygons);
+DEFINE_STAT(STAT_JCV_BuildAdjacency);
+DEFINE_STAT(STAT_JCV_GroupByFeatures);
+DEFINE_STAT(STAT_JCV_UpdateFeatureGroups);
+DEFINE_STAT(STAT_JCV_LabelConnectedComponents);
+DEFINE_STAT(STAT_JCV_FrontierSearch);
+DEFINE_STAT(STAT_JCV_DistanceField);
+DEFINE_STAT(STAT_JCV_FlowField);
+DEFINE_STAT(STAT_JCV_FindCellsBatch);
+DEFINE_STAT(STAT_JCV_RelaxDiagram);
+DEFINE_STAT(STAT_JCV_GeneratedSites);
+DEFINE_STAT(STAT_JCV_ArenaPeakBytes);
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,1852 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+// 
+
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "JCVCellBitSet.h"
+#include "JCVDiagramAccessor.h"
+#include "JCVDiagramMap.h"
+#include "JCVDiagramObject.h"
+#include "JCVFeatureTypeMask.h"
+#include "JCVFeatureUtility.h"
+#include "JCVFrontierSearch.h"
+#include "JCVPathFinder.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace JCVDiagramMapTests
+{
+    const FBox2D TestBounds(FVector2D(0.f, 0.f), FVector2D(1000.f, 1000.f));
+
+    void GenerateRandomPoints(TArray<FVector2D>& OutPoints, int32 PointCount, FRandomStream& Rand)
+    {
+        const FVector2D Size(TestBounds.GetSize());
+
+        OutPoints.SetNumUninitialized(PointCount);
+
+        for (FVector2D& Point : OutPoints)
+        {
+            Point = TestBounds.Min + FVector2D(Rand.GetFraction()*Size.X, Rand.GetFraction()*Size.Y);
+        }
+    }
+
+    // Assign cells to random groups, groups are spread over feature types
+    void AssignRandomGroups(FJCVDiagramMap& Map, int32 GroupCount, int32 TypeCount, FRandomStream& Rand)
+    {
+        for (int32 i=0; i<Map.Num(); ++i)
+        {
+            const int32 Group = Rand.RandHelper(GroupCount);
+            Map.GetCell(i).SetType((uint8) (Group % TypeCount), Group / TypeCount);
+        }
+    }
+
+    const uint8 LandType = 1;
+    const uint8 LakeType = 2;
+    const uint8 OceanType = 3;
+
+    // Land with an ocean strip along the left diagram border and small
+    // lakes grown from random land cells. Lakes may touch each other, the
+    // ocean or the diagram border.
+    void GenerateLakes(FJCVDiagramMap& Map, int32 LakeCount, int32 MaxLakeSize, FRandomStream& Rand)
+    {
+        const float OceanLimit = TestBounds.Min.X + TestBounds.GetSize().X*.1f;
+
+        for (int32 i=0; i<Map.Num(); ++i)
+        {
+            FJCVCell& Cell(Map.GetCell(i));
+            Cell.SetType(Cell.ToVector2D().X < OceanLimit ? OceanType : LandType, 0);
+        }
+
+        const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+        int32 LakeIndex = 0;
+
+        for (int32 l=0; l<LakeCount; ++l)
+        {
+            const int32 Origin = Rand.RandHelper(Map.Num());
+
+            if (! Map.GetCell(Origin).IsType(LandType))
+            {
+                continue;
+            }
+
+            const int32 LakeSize = 1 + Rand.RandHelper(MaxLakeSize);
+            int32 LakeCell = Origin;
+
+            Map.GetCell(LakeCell).SetType(LakeType, LakeIndex);
+
+            for (int32 s=1; s<LakeSize; ++s)
+            {
+                const TArrayView<const int32> Neighbours(Adjacency.GetNeighbours(LakeCell));
+
+                if (Neighbours.Num() == 0)
+                {
+                    break;
+                }
+
+                const int32 ni = Neighbours[Rand.RandHelper(Neighbours.Num())];
+                FJCVCell& n(Map.GetCell(ni));
+
+                if (n.IsType(LandType))
+                {
+                    n.SetType(LakeType, LakeIndex);
+                }
+
+                LakeCell = ni;
+            }
+
+            ++LakeIndex;
+        }
+    }
+
+    // Isolated lakes by per cell graph edge tests
+    void FindIsolatedLakes(FJCVDiagramMap& Map, const FJCVFeatureGroup& fg, TBitArray<>& OutIsolated)
+    {
+        OutIsolated.Init(false, fg.GetGroupCount());
+
+        for (int32 i=0; i<fg.GetGroupCount(); ++i)
+        {
+            bool bResult = true;
+            for (FJCVCell* c : fg.CellGroups[i])
+            {
+                const FJCVEdge* g = c->GetEdge();
+                while (g)
+                {
+                    const FJCVCell* n = Map.GetCell(g->neighbor);
+                    if (! n || (! n->IsType(LakeType, i) && ! n->IsType(LandType)))
+                    {
+                        bResult = false;
+                        break;
+                    }
+                    g = g->next;
+                }
+                if (! bResult)
+                    break;
+            }
+            OutIsolated[i] = bResult;
+        }
+    }
+
+    // Cell group and neighbour list mismatches of a map against a copy of
+    // the map grouped from scratch. Patched cell groups are not sorted by
+    // cell index, missing feature groups and cell groups count as empty.
+    int32 CountRegroupMismatches(const FJCVDiagramMap& Map)
+    {
+        FJCVDiagramMap RegroupedMap(Map);
+        RegroupedMap.GroupByFeatures();
+        RegroupedMap.GenerateNeighbourList();
+
+        const int32 TypeCount = FMath::Max(Map.GetFeatureCount(), RegroupedMap.GetFeatureCount());
+
+        int32 MismatchCount = 0;
+
+        for (int32 ft=0; ft<TypeCount; ++ft)
+        {
+            const FJCVFeatureGroup* fg0 = Map.GetFeatureGroup((uint8) ft);
+            const FJCVFeatureGroup* fg1 = RegroupedMap.GetFeatureGroup((uint8) ft);
+
+            const FJCVFeatureTypeMask Neighbours0(fg0 ? fg0->Neighbours : FJCVFeatureTypeMask());
+            const FJCVFeatureTypeMask Neighbours1(fg1 ? fg1->Neighbours : FJCVFeatureTypeMask());
+
+            if (Neighbours0 != Neighbours1)
+            {
+                ++MismatchCount;
+            }
+
+            const int32 GroupCount = FMath::Max(fg0 ? fg0->GetGroupCount() : 0, fg1 ? fg1->GetGroupCount() : 0);
+
+            for (int32 fi=0; fi<GroupCount; ++fi)
+            {
+                TArray<int32> CellIndices0;
+                TArray<int32> CellIndices1;
+
+                if (fg0 && fg0->IsValidIndex(fi))
+                {
+                    const TArrayView<const int32> GroupCellIndices(fg0->CellGroups[fi].GetCellIndices());
+                    CellIndices0.Append(GroupCellIndices.GetData(), GroupCellIndices.Num());
+                }
+
+                if (fg1 && fg1->IsValidIndex(fi))
+                {
+                    const TArrayView<const int32> GroupCellIndices(fg1->CellGroups[fi].GetCellIndices());
+                    CellIndices1.Append(GroupCellIndices.GetData(), GroupCellIndices.Num());
+                }
+
+                CellIndices0.Sort();
+
+                if (CellIndices0 != CellIndices1)
+                {
+                    ++MismatchCount;
+                }
+            }
+        }
+
+        return MismatchCount;
+    }
+
+    // Serial single queue breadth first search, reference of the frontier
+    // search. CanVisit(CellIndex) filters neighbour cells.
+    template<typename FCanVisit>
+    void SearchSerial(
+        const FJCVDiagramAdjacency& Adjacency,
+        TArrayView<const int32> Sources,
+        FCanVisit CanVisit,
+        TArray<int32>& OutOrder,
+        TArray<int32>& OutDistances,
+        TArray<int32>& OutSources
+        )
+    {
+        OutOrder.Reset();
+        OutDistances.Init(INDEX_NONE, Adjacency.Num());
+        OutSources.Init(INDEX_NONE, Adjacency.Num());
+
+        for (int32 CellIndex : Sources)
+        {
+            if (OutDistances.IsValidIndex(CellIndex) && OutDistances[CellIndex] < 0)
+            {
+                OutDistances[CellIndex] = 0;
+                OutSources[CellIndex] = CellIndex;
+                OutOrder.Emplace(CellIndex);
+            }
+        }
+
+        for (int32 qi=0; qi<OutOrder.Num(); ++qi)
+        {
+            const int32 CellIndex = OutOrder[qi];
+
+            for (int32 ni : Adjacency.GetNeighbours(CellIndex))
+            {
+                if (OutDistances[ni] < 0 && CanVisit(ni))
+                {
+                    OutDistances[ni] = OutDistances[CellIndex]+1;
+                    OutSources[ni] = OutSources[CellIndex];
+                    OutOrder.Emplace(ni);
+                }
+            }
+        }
+    }
+
+    struct FDijkstraEntry
+    {
+        float Distance;
+        int32 CellIndex;
+
+        FORCEINLINE bool operator<(const FDijkstraEntry& Other) const
+        {
+            return Distance < Other.Distance;
+        }
+    };
+
+    // Binary heap Dijkstra over cell graph edges, reference of the distance
+    // and depth fields. Weight(CellIndex, NeighbourIndex, Edge) returns the
+    // edge weight, negative if the neighbour is not entered.
+    template<typename FWeight>
+    void SearchDijkstra(
+        const FJCVDiagramMap& Map,
+        TArrayView<const int32> Sources,
+        FWeight Weight,
+        TArray<float>& OutDistances
+        )
+    {
+        OutDistances.Init(BIG_NUMBER, Map.Num());
+
+        TArray<FDijkstraEntry> Heap;
+
+        for (int32 CellIndex : Sources)
+        {
+            if (OutDistances.IsValidIndex(CellIndex))
+            {
+                OutDistances[CellIndex] = 0.f;
+                Heap.HeapPush(FDijkstraEntry{ 0.f, CellIndex });
+            }
+        }
+
+        while (Heap.Num() > 0)
+        {
+            FDijkstraEntry Entry;
+            Heap.HeapPop(Entry, false);
+
+            if (Entry.Distance > OutDistances[Entry.CellIndex])
+            {
+                continue;
+            }
+
+            for (const FJCVEdge* g = Map.GetCell(Entry.CellIndex).GetEdge(); g; g = g->next)
+            {
+                if (! g->neighbor)
+                {
+                    continue;
+                }
+
+                const int32 ni = g->neighbor->index;
+                const float EdgeWeight = Weight(Entry.CellIndex, ni, g);
+
+                if (EdgeWeight < 0.f)
+                {
+                    continue;
+                }
+
+                const float NewDistance = Entry.Distance + EdgeWeight;
+
+                if (NewDistance < OutDistances[ni])
+                {
+                    OutDistances[ni] = NewDistance;
+                    Heap.HeapPush(FDijkstraEntry{ NewDistance, ni });
+                }
+            }
+        }
+    }
+
+    // Shortest wall time of repeated runs, in seconds
+    template<typename FunctionType>
+    double TimeBestOf(int32 RunCount, FunctionType Function)
+    {
+        double BestTime = TNumericLimits<double>::Max();
+
+        for (int32 Run=0; Run<RunCount; ++Run)
+        {
+            const double StartTime = FPlatformTime::Seconds();
+            Function();
+            BestTime = FMath::Min(BestTime, FPlatformTime::Seconds()-StartTime);
+        }
+
+        return BestTime;
+    }
+
+    FORCEINLINE double GetSpeedup(double BaselineTime, double Time)
+    {
+        return Time > 0.0 ? BaselineTime/Time : 0.0;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapGroupByFeaturesTest, "JCVoronoiPlugin.DiagramMap.GroupByFeatures", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapGroupByFeaturesTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    // Cell count above the parallel membership build threshold
+    const int32 CellCount = 200000;
+    const int32 GroupCount = 1000;
+    const int32 TypeCount = 16;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    AssignRandomGroups(Map, GroupCount, TypeCount, Rand);
+
+    FJCVFeatureMembership SerialMembership;
+    SerialMembership.Build(Map.GetCellStorage());
+
+    Map.GroupByFeatures();
+
+    // Parallel membership must be identical to the serial membership
+
+    const FJCVFeatureMembership& Membership(Map.GetFeatureMembership());
+
+    TestTrue(TEXT("Parallel membership cell indices equal serial cell indices"), Membership.CellIndices == SerialMembership.CellIndices);
+    TestTrue(TEXT("Parallel membership group offsets equal serial group offsets"), Membership.GroupOffsets == SerialMembership.GroupOffsets);
+    TestTrue(TEXT("Parallel membership type offsets equal serial type offsets"), Membership.TypeOffsets == SerialMembership.TypeOffsets);
+    TestTrue(TEXT("Parallel membership cell slots equal serial cell slots"), Membership.CellSlots == SerialMembership.CellSlots);
+
+    // Cell group views must list group cells in cell index order
+
+    TArray<TArray<FJCVCellGroup>> ArrayGroups;
+    ArrayGroups.SetNum(TypeCount);
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        FJCVCell& Cell(Map.GetCell(i));
+        TArray<FJCVCellGroup>& CellGroups(ArrayGroups[Cell.GetFeatureType()]);
+        const int32 fi = Cell.GetFeatureIndex();
+
+        if (! CellGroups.IsValidIndex(fi))
+        {
+            CellGroups.SetNum(fi+1);
+        }
+
+        CellGroups[fi].Emplace(&Cell);
+    }
+
+    int32 MismatchCount = 0;
+
+    for (int32 ft=0; ft<ArrayGroups.Num(); ++ft)
+    for (int32 fi=0; fi<ArrayGroups[ft].Num(); ++fi)
+    {
+        const FJCVCellGroup& CellGroup(ArrayGroups[ft][fi]);
+        const FJCVCellGroupView* CellGroupView = Map.GetFeatureCellGroup(ft, fi);
+
+        if (! CellGroupView || CellGroupView->Num() != CellGroup.Num())
+        {
+            ++MismatchCount;
+            continue;
+        }
+
+        for (int32 ci=0; ci<CellGroup.Num(); ++ci)
+        {
+            if ((*CellGroupView)[ci] != CellGroup[ci])
+            {
+                ++MismatchCount;
+                break;
+            }
+        }
+    }
+
+    TestEqual(TEXT("Cell group view mismatches against cell arrays"), MismatchCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapUpdateFeatureGroupsTest, "JCVoronoiPlugin.DiagramMap.UpdateFeatureGroups", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapUpdateFeatureGroupsTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 20000;
+    const int32 GroupCount = 200;
+    const int32 TypeCount = 8;
+    const int32 GroupsPerType = GroupCount / TypeCount;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    AssignRandomGroups(Map, GroupCount, TypeCount, Rand);
+
+    Map.GroupByFeatures();
+    Map.GenerateNeighbourList();
+
+    const FJCVFeatureMembership& Membership(Map.GetFeatureMembership());
+
+    // Random changes between existing cell groups
+
+    for (int32 Round=0; Round<16; ++Round)
+    {
+        for (int32 c=0; c<200; ++c)
+        {
+            const int32 Group = Rand.RandHelper(GroupCount);
+            Map.GetCell(Rand.RandHelper(Map.Num())).SetType((uint8) (Group % TypeCount), Group / TypeCount);
+        }
+
+        Map.UpdateFeatureGroups();
+
+        TestEqual(FString::Printf(TEXT("Random changes round %d mismatches against regrouped map"), Round), CountRegroupMismatches(Map), 0);
+    }
+
+    // Grow a different cell group each round. Full groups are moved to the
+    // end of the cell index array until the abandoned slots outnumber the
+    // grouped cells and the membership is rebuilt.
+
+    bool bHasMovedGroups = false;
+    bool bHasCompacted = false;
+
+    for (int32 Round=0; Round<64 && ! bHasCompacted; ++Round)
+    {
+        const int32 Group = Round % GroupCount;
+
+        for (int32 c=0; c<1000; ++c)
+        {
+            Map.GetCell(Rand.RandHelper(Map.Num())).SetType((uint8) (Group % TypeCount), Group / TypeCount);
+        }
+
+        const bool bHadMovedGroups = Membership.DeadCount > 0;
+
+        Map.UpdateFeatureGroups();
+
+        bHasMovedGroups |= Membership.DeadCount > 0;
+        bHasCompacted |= bHadMovedGroups && Membership.DeadCount == 0;
+
+        TestEqual(FString::Printf(TEXT("Group growth round %d mismatches against regrouped map"), Round), CountRegroupMismatches(Map), 0);
+    }
+
+    TestTrue(TEXT("Full cell groups moved to the cell index array end"), bHasMovedGroups);
+    TestTrue(TEXT("Moved cell groups compacted by a membership rebuild"), bHasCompacted);
+    TestEqual(TEXT("Compacted cell index count"), Membership.CellIndices.Num(), Map.Num());
+
+    // New feature index requires a new cell group and a membership rebuild
+
+    for (int32 c=0; c<10; ++c)
+    {
+        Map.GetCell(Rand.RandHelper(Map.Num())).SetType(1, GroupsPerType);
+    }
+
+    Map.UpdateFeatureGroups();
+
+    TestEqual(TEXT("New feature index cell group count"), Map.GetFeatureGroup(1)->GetGroupCount(), GroupsPerType+1);
+    TestEqual(TEXT("New feature index mismatches against regrouped map"), CountRegroupMismatches(Map), 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapGroupByFeaturesPerfTest, "JCVoronoiPlugin.DiagramMap.Perf.GroupByFeatures", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FJCVDiagramMapGroupByFeaturesPerfTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 1000000;
+    const int32 GroupCount = 10000;
+    const int32 TypeCount = 16;
+    const int32 RunCount = 5;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    AssignRandomGroups(Map, GroupCount, TypeCount, Rand);
+
+    // Serial counting sort
+
+    FJCVFeatureMembership SerialMembership;
+
+    const double SerialTime = TimeBestOf(RunCount, [&]()
+    {
+        SerialMembership.Build(Map.GetCellStorage());
+    } );
+
+    // Parallel counting sort with cell group view rebinding
+
+    const double ParallelTime = TimeBestOf(RunCount, [&]()
+    {
+        Map.GroupByFeatures();
+    } );
+
+    TestTrue(TEXT("Parallel membership cell indices equal serial cell indices"), Map.GetFeatureMembership().CellIndices == SerialMembership.CellIndices);
+
+    AddInfo(FString::Printf(TEXT("%d cells, %d groups, serial %.2fms, parallel %.2fms, speedup %.2fx"),
+        Map.Num(),
+        GroupCount,
+        SerialTime*1000.0,
+        ParallelTime*1000.0,
+        GetSpeedup(SerialTime, ParallelTime)
+        ) );
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapConvertIsolatedTest, "JCVoronoiPlugin.DiagramMap.ConvertIsolated", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapConvertIsolatedTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 100000;
+    const int32 LakeCount = 500;
+    const int32 MaxLakeSize = 8;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    GenerateLakes(Map, LakeCount, MaxLakeSize, Rand);
+
+    Map.GroupByFeatures();
+
+    const FJCVFeatureGroup* pfg = Map.GetFeatureGroup(LakeType);
+
+    if (! TestNotNull(TEXT("Lake feature group"), pfg))
+    {
+        return false;
+    }
+
+    const FJCVFeatureGroup& fg(*pfg);
+
+    TBitArray<> EdgeIsolated;
+    FindIsolatedLakes(Map, fg, EdgeIsolated);
+
+    TArray<FJCVCell*> IsolatedCells;
+
+    for (int32 i=0; i<fg.GetGroupCount(); ++i)
+    {
+        if (EdgeIsolated[i])
+        {
+            fg.CellGroups[i].AppendTo(IsolatedCells);
+        }
+    }
+
+    // Isolated lakes by cell group adjacency summary
+
+    TArray<FJCVCellGroupAdjacency> GroupAdjacency;
+    Map.ComputeCellGroupAdjacency(LakeType, GroupAdjacency);
+
+    TestEqual(TEXT("Cell group adjacency summary count"), GroupAdjacency.Num(), fg.GetGroupCount());
+
+    int32 MismatchCount = 0;
+
+    for (int32 i=0; i<GroupAdjacency.Num(); ++i)
+    {
+        if (GroupAdjacency[i].IsEnclosedBy(LandType) != EdgeIsolated[i])
+        {
+            ++MismatchCount;
+        }
+    }
+
+    TestEqual(TEXT("Cell group adjacency isolation mismatches against edge tests"), MismatchCount, 0);
+
+    // Isolated lakes convert to land
+
+    Map.ConvertIsolated(LakeType, LandType, 0, true);
+
+    int32 UnconvertedCount = 0;
+
+    for (FJCVCell* c : IsolatedCells)
+    {
+        if (! c->IsType(LandType, 0))
+        {
+            ++UnconvertedCount;
+        }
+    }
+
+    TestEqual(TEXT("Isolated lake cells not converted to land"), UnconvertedCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapLabelConnectedComponentsTest, "JCVoronoiPlugin.DiagramMap.LabelConnectedComponents", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapLabelConnectedComponentsTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    // Cell count over many parallel union chunks
+    const int32 CellCount = 100000;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    // Random land and water cells, land near the percolation threshold
+    // forms both large and small components
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        Map.GetCell(i).SetType(Rand.GetFraction() < .5f ? LandType : OceanType, 0);
+    }
+
+    // Serial breadth first labelling of land cells
+
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+    TArray<int32> BFSLabels;
+    TArray<int32> BFSSizes;
+    BFSLabels.Init(INDEX_NONE, Map.Num());
+
+    TArray<int32> Queue;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        if (! Map.GetCell(i).IsType(LandType) || BFSLabels[i] != INDEX_NONE)
+        {
+            continue;
+        }
+
+        const int32 Label = BFSSizes.Emplace(0);
+
+        Queue.Reset();
+        Queue.Emplace(i);
+        BFSLabels[i] = Label;
+
+        for (int32 qi=0; qi<Queue.Num(); ++qi)
+        {
+            ++BFSSizes[Label];
+
+            for (int32 ni : Adjacency.GetNeighbours(Queue[qi]))
+            {
+                if (Map.GetCell(ni).IsType(LandType) && BFSLabels[ni] == INDEX_NONE)
+                {
+                    BFSLabels[ni] = Label;
+                    Queue.Emplace(ni);
+                }
+            }
+        }
+    }
+
+    TArray<int32> ComponentSizes;
+    const int32 ComponentCount = Map.LabelConnectedComponents(LandType, ComponentSizes);
+
+    TestEqual(TEXT("Component count"), ComponentCount, BFSSizes.Num());
+    TestEqual(TEXT("Component size count"), ComponentSizes.Num(), ComponentCount);
+
+    // Label values may differ, partitions must match. Map each component
+    // label to the breadth first label of its first cell, both directions.
+
+    TArray<int32> ToBFSLabel;
+    TArray<int32> FromBFSLabel;
+    ToBFSLabel.Init(INDEX_NONE, ComponentCount);
+    FromBFSLabel.Init(INDEX_NONE, BFSSizes.Num());
+
+    int32 MismatchCount = 0;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        const FJCVCell& Cell(Map.GetCell(i));
+
+        if (! Cell.IsType(LandType))
+        {
+            MismatchCount += BFSLabels[i] != INDEX_NONE;
+            continue;
+        }
+
+        const int32 Label = Cell.GetFeatureIndex();
+        const int32 BFSLabel = BFSLabels[i];
+
+        if (! ToBFSLabel.IsValidIndex(Label))
+        {
+            ++MismatchCount;
+            continue;
+        }
+
+        if (ToBFSLabel[Label] == INDEX_NONE && FromBFSLabel[BFSLabel] == INDEX_NONE)
+        {
+            ToBFSLabel[Label] = BFSLabel;
+            FromBFSLabel[BFSLabel] = Label;
+        }
+
+        if (ToBFSLabel[Label] != BFSLabel || FromBFSLabel[BFSLabel] != Label)
+        {
+            ++MismatchCount;
+        }
+    }
+
+    TestEqual(TEXT("Component partition mismatches against breadth first labelling"), MismatchCount, 0);
+
+    int32 SizeMismatchCount = 0;
+
+    for (int32 Label=0; Label<ComponentSizes.Num() && Label<ToBFSLabel.Num(); ++Label)
+    {
+        if (! BFSSizes.IsValidIndex(ToBFSLabel[Label]) || ComponentSizes[Label] != BFSSizes[ToBFSLabel[Label]])
+        {
+            ++SizeMismatchCount;
+        }
+    }
+
+    TestEqual(TEXT("Component size mismatches against breadth first labelling"), SizeMismatchCount, 0);
+
+    // Ocean cells keep their feature index
+
+    int32 ChangedOceanCount = 0;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        ChangedOceanCount += Map.GetCell(i).IsType(OceanType) && Map.GetCell(i).GetFeatureIndex() != 0;
+    }
+
+    TestEqual(TEXT("Ocean cells with changed feature index"), ChangedOceanCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapFrontierSearchTest, "JCVoronoiPlugin.DiagramMap.FrontierSearch", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapFrontierSearchTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    // Cell count with frontiers over many parallel chunks
+    const int32 CellCount = 100000;
+    const int32 SourceCount = 64;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    // Mostly land with ocean cells blocking the search
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        Map.GetCell(i).SetType(Rand.GetFraction() < .8f ? LandType : OceanType, 0);
+    }
+
+    // Random sources with a duplicate and an invalid source
+
+    TArray<int32> Sources;
+
+    for (int32 s=0; s<SourceCount; ++s)
+    {
+        Sources.Emplace(Rand.RandHelper(Map.Num()));
+    }
+
+    Sources.Emplace(Sources[0]);
+    Sources.Emplace(Map.Num());
+
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+    auto CanVisit = [&Map](int32 CellIndex)
+    {
+        return Map.GetCell(CellIndex).IsType(LandType);
+    };
+
+    TArray<int32> SerialOrder;
+    TArray<int32> SerialDistances;
+    TArray<int32> SerialSources;
+    SearchSerial(Adjacency, Sources, CanVisit, SerialOrder, SerialDistances, SerialSources);
+
+    // Frontier search visit order is the concatenation of its levels
+
+    TArray<int32> Order;
+    TArray<int32> Distances;
+    TArray<int32> CellSources;
+    int32 LevelMismatchCount = 0;
+
+    const int32 MaxDepth = FJCVFrontierSearch::Search(
+        Adjacency,
+        Sources,
+        [&CanVisit](int32 CellIndex, int32 ParentIndex) { return CanVisit(CellIndex); },
+        [&](int32 Depth, TArrayView<const int32> Frontier)
+        {
+            for (int32 CellIndex : Frontier)
+            {
+                LevelMismatchCount += SerialDistances[CellIndex] != Depth;
+                Order.Emplace(CellIndex);
+            }
+            return true;
+        },
+        Distances,
+        CellSources
+        );
+
+    TestEqual(TEXT("Frontier search deepest depth"), MaxDepth, FMath::Max(0, SerialDistances[SerialOrder.Last()]));
+    TestEqual(TEXT("Frontier level depth mismatches against serial search"), LevelMismatchCount, 0);
+    TestTrue(TEXT("Frontier search visit order equals serial search order"), Order == SerialOrder);
+    TestTrue(TEXT("Frontier search depths equal serial search depths"), Distances == SerialDistances);
+    TestTrue(TEXT("Frontier search sources equal serial search sources"), CellSources == SerialSources);
+
+    // Point fill assigns each reached land cell the feature of its source
+
+    FJCVDiagramMap FillMap(Map);
+    TArray<FJCVCell*> OriginCells;
+
+    for (int32 s=0; s<SourceCount; ++s)
+    {
+        FJCVCell& Cell(FillMap.GetCell(Sources[s]));
+
+        if (! OriginCells.Contains(&Cell))
+        {
+            Cell.SetType(LakeType, s);
+            OriginCells.Emplace(&Cell);
+        }
+    }
+
+    FJCVFeatureUtility::PointFill(FillMap, OriginCells, LandType);
+
+    int32 FillMismatchCount = 0;
+
+    for (int32 i=0; i<FillMap.Num(); ++i)
+    {
+        const FJCVCell& Cell(FillMap.GetCell(i));
+
+        if (SerialDistances[i] > 0)
+        {
+            const FJCVCell& Source(FillMap.GetCell(SerialSources[i]));
+            FillMismatchCount += ! Cell.IsType(Source.GetFeatureType(), Source.GetFeatureIndex());
+        }
+        else
+        if (SerialDistances[i] < 0)
+        {
+            const FJCVCell& SrcCell(Map.GetCell(i));
+            FillMismatchCount += ! Cell.IsType(SrcCell.GetFeatureType(), SrcCell.GetFeatureIndex());
+        }
+    }
+
+    TestEqual(TEXT("Point fill feature mismatches against serial search sources"), FillMismatchCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapDistanceFieldTest, "JCVoronoiPlugin.DiagramMap.DistanceField", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapDistanceFieldTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 20000;
+    const int32 LakeCount = 200;
+    const int32 MaxLakeSize = 16;
+    const int32 SourceCount = 16;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    UJCVDiagramObject* DiagramObject = NewObject<UJCVDiagramObject>();
+    DiagramObject->CreateContextByBounds(0, TestBounds, Points);
+    DiagramObject->CreateMap(0, 0);
+
+    UJCVDiagramAccessor* Accessor = DiagramObject->GetAccessor(0, 0);
+
+    if (! TestTrue(TEXT("Diagram accessor has valid map"), IsValid(Accessor) && Accessor->HasValidMap()))
+    {
+        return false;
+    }
+
+    FJCVDiagramMap& Map(Accessor->GetMap());
+
+    GenerateLakes(Map, LakeCount, MaxLakeSize, Rand);
+
+    Map.GroupByFeatures();
+
+    // Distance field from random land cells, lakes cost more and the
+    // ocean is not entered
+
+    TArray<int32> Sources;
+    TArray<FJCVCellRef> SourceCellRefs;
+
+    while (Sources.Num() < SourceCount)
+    {
+        const int32 CellIndex = Rand.RandHelper(Map.Num());
+
+        if (Map.GetCell(CellIndex).IsType(LandType))
+        {
+            Sources.Emplace(CellIndex);
+            SourceCellRefs.Emplace(Accessor->GetCellRef(CellIndex));
+        }
+    }
+
+    TArray<float> TypeCostMultipliers;
+    TypeCostMultipliers.Init(1.f, OceanType+1);
+    TypeCostMultipliers[LakeType] = 3.f;
+    TypeCostMultipliers[OceanType] = -1.f;
+
+    auto GetTypeCost = [&](int32 CellIndex)
+    {
+        return TypeCostMultipliers[Map.GetCell(CellIndex).GetFeatureType()];
+    };
+
+    for (bool bUseEdgeLength : { false, true })
+    {
+        TArray<float> Distances;
+        UJCVFeatureUtility::K2_GenerateDistanceField(Accessor, SourceCellRefs, Distances, TypeCostMultipliers, bUseEdgeLength);
+
+        TArray<float> RefDistances;
+        SearchDijkstra(Map, Sources, [&](int32 CellIndex, int32 NeighbourIndex, const FJCVEdge* g)
+        {
+            const float NeighbourCost = GetTypeCost(NeighbourIndex);
+
+            if (NeighbourCost < 0.f)
+            {
+                return -1.f;
+            }
+
+            const float Length = bUseEdgeLength
+                ? (FJCVMathUtil::ToVector2D(g->pos[1])-FJCVMathUtil::ToVector2D(g->pos[0])).Size()
+                : (Map.GetCell(NeighbourIndex).ToVector2DUnsafe()-Map.GetCell(CellIndex).ToVector2DUnsafe()).Size();
+
+            return Length * .5f * (FMath::Max(GetTypeCost(CellIndex), 0.f) + NeighbourCost);
+        },
+        RefDistances);
+
+        TestEqual(TEXT("Distance field cell count"), Distances.Num(), Map.Num());
+
+        int32 MismatchCount = 0;
+        int32 ReachedCount = 0;
+
+        for (int32 i=0; i<Distances.Num() && i<RefDistances.Num(); ++i)
+        {
+            MismatchCount += FMath::Abs(Distances[i]-RefDistances[i]) > KINDA_SMALL_NUMBER*FMath::Max(1.f, RefDistances[i]);
+            ReachedCount += RefDistances[i] < BIG_NUMBER;
+        }
+
+        TestEqual(
+            FString::Printf(TEXT("Distance field (%s) mismatches against reference Dijkstra"), bUseEdgeLength ? TEXT("edge length") : TEXT("site distance")),
+            MismatchCount,
+            0
+            );
+
+        TestTrue(TEXT("Distance field reaches beyond the sources"), ReachedCount > Sources.Num());
+    }
+
+    // Depth field of land and of each lake, unit weight Dijkstra within
+    // the cell group from cells next to another feature type or the
+    // diagram border
+
+    for (uint8 FeatureType : { LandType, LakeType })
+    {
+        auto IsSameGroup = [&](int32 a, int32 b)
+        {
+            const FJCVCell& c0(Map.GetCell(a));
+            const FJCVCell& c1(Map.GetCell(b));
+            return c0.IsType(c1.GetFeatureType(), c1.GetFeatureIndex());
+        };
+
+        TArray<int32> BorderCells;
+
+        for (int32 i=0; i<Map.Num(); ++i)
+        {
+            if (! Map.GetCell(i).IsType(FeatureType))
+            {
+                continue;
+            }
+
+            for (const FJCVEdge* g = Map.GetCell(i).GetEdge(); g; g = g->next)
+            {
+                if (! g->neighbor || ! Map.GetCell(g->neighbor->index).IsType(FeatureType))
+                {
+                    BorderCells.Emplace(i);
+                    break;
+                }
+            }
+        }
+
+        TArray<int32> Depths;
+        FJCVFeatureUtility::GenerateDepthField(Map, FJCVFeatureId(FeatureType, -1), Depths);
+
+        TArray<float> RefDepths;
+        SearchDijkstra(Map, BorderCells, [&](int32 CellIndex, int32 NeighbourIndex, const FJCVEdge* g)
+        {
+            return IsSameGroup(CellIndex, NeighbourIndex) ? 1.f : -1.f;
+        },
+        RefDepths);
+
+        int32 MismatchCount = 0;
+        int32 MaxDepth = 0;
+
+        for (int32 i=0; i<Map.Num(); ++i)
+        {
+            const int32 RefDepth = RefDepths[i] < BIG_NUMBER ? FMath::RoundToInt(RefDepths[i]) : INDEX_NONE;
+            MismatchCount += ! Depths.IsValidIndex(i) || Depths[i] != RefDepth;
+            MaxDepth = FMath::Max(MaxDepth, RefDepth);
+        }
+
+        TestEqual(FString::Printf(TEXT("Depth field (feature type %d) mismatches against reference Dijkstra"), FeatureType), MismatchCount, 0);
+
+        // Small lakes may have no inner cells
+        if (FeatureType == LandType)
+        {
+            TestTrue(TEXT("Land depth field has inner cells"), MaxDepth > 0);
+        }
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapPathFinderTest, "JCVoronoiPlugin.DiagramMap.PathFinder", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapPathFinderTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 20000;
+    const int32 LakeCount = 200;
+    const int32 MaxLakeSize = 16;
+    const int32 BlockCount = 8;
+    const int32 QueryCount = 32;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    GenerateLakes(Map, LakeCount, MaxLakeSize, Rand);
+
+    // Split land into block clusters of the path hierarchy
+
+    const FVector2D BlockSize(TestBounds.GetSize() / BlockCount);
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        FJCVCell& Cell(Map.GetCell(i));
+
+        if (Cell.IsType(LandType))
+        {
+            const FVector2D Block((Cell.ToVector2D()-TestBounds.Min) / BlockSize);
+            const int32 BlockX = FMath::Clamp(FMath::FloorToInt(Block.X), 0, BlockCount-1);
+            const int32 BlockY = FMath::Clamp(FMath::FloorToInt(Block.Y), 0, BlockCount-1);
+            Cell.SetType(LandType, BlockY*BlockCount + BlockX);
+        }
+    }
+
+    // Enclose a land cell with ocean, the cell is an unreachable goal
+
+    int32 EnclosedCell = INDEX_NONE;
+
+    while (EnclosedCell == INDEX_NONE)
+    {
+        const int32 CellIndex = Rand.RandHelper(Map.Num());
+
+        if (Map.GetCell(CellIndex).IsType(LandType) && ! Map.GetCell(CellIndex).IsBorder())
+        {
+            EnclosedCell = CellIndex;
+        }
+    }
+
+    const FJCVDiagramAdjacency& Adjacency(Map.GetAdjacency());
+
+    for (int32 ni : Adjacency.GetNeighbours(EnclosedCell))
+    {
+        Map.GetCell(ni).SetType(OceanType, 0);
+    }
+
+    Map.GroupByFeatures();
+
+    // Lakes cost more, the ocean is not entered
+
+    FJCVPathParams Params;
+    Params.TypeCostMultipliers.Init(1.f, OceanType+1);
+    Params.TypeCostMultipliers[LakeType] = 2.f;
+    Params.TypeCostMultipliers[OceanType] = -1.f;
+
+    auto GetTypeCost = [&](int32 CellIndex)
+    {
+        return Params.TypeCostMultipliers[Map.GetCell(CellIndex).GetFeatureType()];
+    };
+
+    auto GetStepCost = [&](int32 CellIndex, int32 NeighbourIndex)
+    {
+        const float NeighbourCost = GetTypeCost(NeighbourIndex);
+
+        if (NeighbourCost < 0.f)
+        {
+            return -1.f;
+        }
+
+        const float Distance = (Map.GetCell(NeighbourIndex).ToVector2DUnsafe()-Map.GetCell(CellIndex).ToVector2DUnsafe()).Size();
+        return Distance * .5f * (FMath::Max(GetTypeCost(CellIndex), 0.f) + NeighbourCost);
+    };
+
+    // Path must start and end at the query cells, step over adjacent cells
+    // and never enter cells with negative cost multipliers
+
+    auto IsValidPath = [&](const TArray<int32>& Path, int32 StartIndex, int32 GoalIndex)
+    {
+        if (Path.Num() == 0 || Path[0] != StartIndex || Path.Last() != GoalIndex)
+        {
+            return false;
+        }
+
+        for (int32 i=1; i<Path.Num(); ++i)
+        {
+            if (! Adjacency.GetNeighbours(Path[i-1]).Contains(Path[i]) || GetTypeCost(Path[i]) < 0.f)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    auto GetPathCost = [&](const TArray<int32>& Path)
+    {
+        float PathCost = 0.f;
+
+        for (int32 i=1; i<Path.Num(); ++i)
+        {
+            PathCost += GetStepCost(Path[i-1], Path[i]);
+        }
+
+        return PathCost;
+    };
+
+    FJCVPathHierarchy Hierarchy;
+    Hierarchy.Build(Map, Params);
+
+    TestTrue(TEXT("Path hierarchy has portals"), Hierarchy.GetNodeCount() > 0);
+
+    int32 ReachableCount = 0;
+    int32 HierarchyFoundCount = 0;
+
+    for (int32 q=0; q<QueryCount; ++q)
+    {
+        // Enterable start cell, the last query goal is the enclosed cell
+
+        int32 StartIndex = INDEX_NONE;
+
+        while (StartIndex == INDEX_NONE || GetTypeCost(StartIndex) < 0.f || StartIndex == EnclosedCell)
+        {
+            StartIndex = Rand.RandHelper(Map.Num());
+        }
+
+        const int32 GoalIndex = (q == QueryCount-1) ? EnclosedCell : Rand.RandHelper(Map.Num());
+
+        TArray<float> RefCosts;
+        SearchDijkstra(Map, TArrayView<const int32>(&StartIndex, 1), [&](int32 CellIndex, int32 NeighbourIndex, const FJCVEdge* g)
+        {
+            return GetStepCost(CellIndex, NeighbourIndex);
+        },
+        RefCosts);
+
+        const float RefCost = RefCosts[GoalIndex];
+        const bool bReachable = RefCost < BIG_NUMBER;
+        const float Tolerance = KINDA_SMALL_NUMBER * FMath::Max(1.f, RefCost);
+
+        TArray<int32> Path;
+        float Cost = 0.f;
+        const bool bFound = FJCVPathFinder::FindPath(Map, StartIndex, GoalIndex, Params, Path, &Cost);
+
+        TArray<int32> HierarchyPath;
+        float HierarchyCost = 0.f;
+        const bool bHierarchyFound = Hierarchy.FindPath(Map, StartIndex, GoalIndex, HierarchyPath, &HierarchyCost);
+
+        const FString QueryName(FString::Printf(TEXT("Query %d (%d to %d)"), q, StartIndex, GoalIndex));
+
+        TestTrue(QueryName + TEXT(" path found if goal is reachable"), bFound == bReachable);
+
+        if (! bReachable)
+        {
+            TestFalse(QueryName + TEXT(" hierarchy path not found for unreachable goal"), bHierarchyFound);
+            continue;
+        }
+
+        ++ReachableCount;
+
+        if (bFound)
+        {
+            TestTrue(QueryName + TEXT(" path is valid"), IsValidPath(Path, StartIndex, GoalIndex));
+            TestTrue(QueryName + TEXT(" path cost equals reference Dijkstra cost"), FMath::Abs(Cost-RefCost) <= Tolerance);
+            TestTrue(QueryName + TEXT(" path cost equals path step costs"), FMath::Abs(GetPathCost(Path)-Cost) <= Tolerance);
+        }
+
+        // Hierarchy paths are approximate, never below the optimum
+
+        if (bHierarchyFound)
+        {
+            ++HierarchyFoundCount;
+
+            TestTrue(QueryName + TEXT(" hierarchy path is valid"), IsValidPath(HierarchyPath, StartIndex, GoalIndex));
+            TestTrue(QueryName + TEXT(" hierarchy path cost is not below the optimum"), HierarchyCost >= RefCost-Tolerance);
+            TestTrue(QueryName + TEXT(" hierarchy path cost equals path step costs"), FMath::Abs(GetPathCost(HierarchyPath)-HierarchyCost) <= Tolerance);
+        }
+    }
+
+    TestTrue(TEXT("Queries with reachable goals"), ReachableCount > 0);
+    TestTrue(TEXT("Hierarchy paths found for reachable goals"), HierarchyFoundCount > 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapFlowFieldTest, "JCVoronoiPlugin.DiagramMap.FlowField", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapFlowFieldTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 50000;
+    const uint8 RiverType = OceanType+1;
+    const float MinLakeDepth = .01f;
+    const float MinRiverFlow = 50.f;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context, LandType, 0);
+
+    // Central hill with ridges and random noise, noise forms depressions
+
+    const FVector2D Center(TestBounds.GetCenter());
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        FJCVCell& Cell(Map.GetCell(i));
+        const FVector2D Point(Cell.ToVector2D());
+        const float Hill = 1.f - (Point-Center).Size() / TestBounds.GetSize().X;
+        const float Ridges = .1f * FMath::Sin(Point.X * .02f) * FMath::Cos(Point.Y * .03f);
+        Cell.SetValue(Hill + Ridges + .05f*Rand.GetFraction());
+    }
+
+    FJCVFlowField Flow;
+    Map.GenerateFlowField(Flow);
+
+    TestEqual(TEXT("Flow field cell count"), Flow.Num(), Map.Num());
+
+    if (Flow.Num() != Map.Num())
+    {
+        return false;
+    }
+
+    // Follow each receiver chain to its sink. Chain states are unvisited,
+    // on the current chain or resolved with a known sink, a chain that
+    // reaches a cell on itself is a cycle.
+
+    TArray<int32> Sinks;
+    TArray<uint8> ChainStates;
+    Sinks.Init(INDEX_NONE, Map.Num());
+    ChainStates.Init(0, Map.Num());
+
+    TArray<int32> Chain;
+    int32 CycleCount = 0;
+    int32 RisingCount = 0;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        Chain.Reset();
+
+        int32 c = i;
+
+        while (ChainStates[c] == 0)
+        {
+            ChainStates[c] = 1;
+            Chain.Emplace(c);
+
+            const int32 Receiver = Flow.Receivers[c];
+
+            if (Receiver == INDEX_NONE)
+            {
+                Sinks[c] = c;
+                break;
+            }
+
+            RisingCount += Flow.FilledValues[Receiver] > Flow.FilledValues[c];
+            c = Receiver;
+        }
+
+        if (ChainStates[c] == 1 && Sinks[c] == INDEX_NONE)
+        {
+            ++CycleCount;
+        }
+
+        for (int32 ci : Chain)
+        {
+            ChainStates[ci] = 2;
+            Sinks[ci] = Sinks[c];
+        }
+    }
+
+    TestEqual(TEXT("Receiver graph cycles"), CycleCount, 0);
+    TestEqual(TEXT("Receivers above their donor filled value"), RisingCount, 0);
+
+    // Every chain ends at a border sink, the sink accumulates all cells
+    // draining into it
+
+    TArray<int32> SinkDonorCounts;
+    SinkDonorCounts.SetNumZeroed(Map.Num());
+
+    int32 InnerSinkCount = 0;
+    int32 UnfilledCount = 0;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        const int32 Sink = Sinks[i];
+
+        if (Sink != INDEX_NONE)
+        {
+            ++SinkDonorCounts[Sink];
+        }
+
+        InnerSinkCount += Sink == INDEX_NONE || ! Map.GetCell(Sink).IsBorder();
+        UnfilledCount += Flow.FilledValues[i] < Map.GetCell(i).GetValue();
+    }
+
+    TestEqual(TEXT("Chains not ending at a border sink"), InnerSinkCount, 0);
+    TestEqual(TEXT("Filled values below cell values"), UnfilledCount, 0);
+
+    int32 AccumulationMismatchCount = 0;
+    int32 SinkCount = 0;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        if (Flow.Receivers[i] == INDEX_NONE)
+        {
+            ++SinkCount;
+            AccumulationMismatchCount += Flow.FlowAccumulation[i] != (float) SinkDonorCounts[i];
+        }
+    }
+
+    TestTrue(TEXT("Flow field has sinks"), SinkCount > 0);
+    TestEqual(TEXT("Sink accumulation mismatches against draining cell counts"), AccumulationMismatchCount, 0);
+
+    // Lakes and rivers, each river cell drains into a river, a lake or a
+    // sink since flow only increases downstream
+
+    Map.MarkLakesAndRivers(Flow, LakeType, RiverType, MinLakeDepth, MinRiverFlow);
+
+    int32 LakeCount = 0;
+    int32 RiverCount = 0;
+    int32 RiverMismatchCount = 0;
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        const FJCVCell& Cell(Map.GetCell(i));
+
+        if (Cell.IsType(LakeType))
+        {
+            ++LakeCount;
+        }
+        else
+        if (Cell.IsType(RiverType))
+        {
+            ++RiverCount;
+
+            const int32 Receiver = Flow.Receivers[i];
+
+            if (Receiver != INDEX_NONE && ! Map.GetCell(Receiver).IsType(RiverType) && ! Map.GetCell(Receiver).IsType(LakeType))
+            {
+                ++RiverMismatchCount;
+            }
+        }
+    }
+
+    TestTrue(TEXT("Filled depressions marked as lakes"), LakeCount > 0);
+    TestTrue(TEXT("High flow cells marked as rivers"), RiverCount > 0);
+    TestEqual(TEXT("River cells draining into neither a river, a lake or a sink"), RiverMismatchCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapCellSetTest, "JCVoronoiPlugin.DiagramMap.CellSet", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramMapCellSetTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    FRandomStream Rand(0);
+
+    // Cell sets of different cell counts, neither a multiple of the word
+    // size, checked against boolean arrays
+
+    auto GenerateCellSet = [&Rand](FJCVCellBitSet& Set, TArray<bool>& Flags, int32 CellCount)
+    {
+        Set.Init(CellCount);
+        Flags.Init(false, CellCount);
+
+        for (int32 i=0; i<CellCount; ++i)
+        {
+            if (Rand.FRand() < .4f)
+            {
+                Set.Add(i);
+                Flags[i] = true;
+            }
+        }
+    };
+
+    auto CountMismatches = [](const FJCVCellBitSet& Set, const TArray<bool>& Flags)
+    {
+        int32 MismatchCount = Set.GetCellCount() != Flags.Num();
+
+        for (int32 i=0; i<Flags.Num(); ++i)
+        {
+            MismatchCount += Set.Contains(i) != Flags[i];
+        }
+
+        return MismatchCount;
+    };
+
+    auto GetPaddingBits = [](const FJCVCellBitSet& Set)
+    {
+        const int32 WordCount = Set.GetWordCount();
+        const int32 PaddingBits = (WordCount << 6) - Set.GetCellCount();
+        return PaddingBits > 0
+            ? Set.GetWords()[WordCount-1] & ~(~uint64(0) >> PaddingBits)
+            : uint64(0);
+    };
+
+    const int32 SmallCount = 130;
+    const int32 LargeCount = 251;
+
+    FJCVCellBitSet Small;
+    FJCVCellBitSet Large;
+    TArray<bool> SmallFlags;
+    TArray<bool> LargeFlags;
+
+    GenerateCellSet(Small, SmallFlags, SmallCount);
+    GenerateCellSet(Large, LargeFlags, LargeCount);
+
+    // Union into the smaller set drops cells past its cell count, the
+    // shared last word must not carry them as padding bits
+
+    {
+        FJCVCellBitSet Set(Small);
+        TArray<bool> Flags(SmallFlags);
+
+        Set |= Large;
+
+        for (int32 i=0; i<SmallCount; ++i)
+        {
+            Flags[i] = Flags[i] || LargeFlags[i];
+        }
+
+        TestEqual(TEXT("Small |= Large mismatches"), CountMismatches(Set, Flags), 0);
+        TestTrue(TEXT("Small |= Large padding bits clear"), GetPaddingBits(Set) == 0);
+    }
+
+    {
+        FJCVCellBitSet Set(Large);
+        TArray<bool> Flags(LargeFlags);
+
+        Set |= Small;
+
+        for (int32 i=0; i<SmallCount; ++i)
+        {
+            Flags[i] = Flags[i] || SmallFlags[i];
+        }
+
+        TestEqual(TEXT("Large |= Small mismatches"), CountMismatches(Set, Flags), 0);
+        TestTrue(TEXT("Large |= Small padding bits clear"), GetPaddingBits(Set) == 0);
+    }
+
+    // Intersection clears cells past the other set cell count
+
+    {
+        FJCVCellBitSet Set(Large);
+        TArray<bool> Flags(LargeFlags);
+
+        Set &= Small;
+
+        for (int32 i=0; i<LargeCount; ++i)
+        {
+            Flags[i] = Flags[i] && i < SmallCount && SmallFlags[i];
+        }
+
+        TestEqual(TEXT("Large &= Small mismatches"), CountMismatches(Set, Flags), 0);
+        TestTrue(TEXT("Large &= Small padding bits clear"), GetPaddingBits(Set) == 0);
+    }
+
+    {
+        FJCVCellBitSet Set(Small);
+        TArray<bool> Flags(SmallFlags);
+
+        Set &= Large;
+
+        for (int32 i=0; i<SmallCount; ++i)
+        {
+            Flags[i] = Flags[i] && LargeFlags[i];
+        }
+
+        TestEqual(TEXT("Small &= Large mismatches"), CountMismatches(Set, Flags), 0);
+        TestTrue(TEXT("Small &= Large padding bits clear"), GetPaddingBits(Set) == 0);
+    }
+
+    // Difference keeps cells past the other set cell count
+
+    {
+        FJCVCellBitSet Set(Large);
+        TArray<bool> Flags(LargeFlags);
+
+        Set -= Small;
+
+        for (int32 i=0; i<SmallCount; ++i)
+        {
+            Flags[i] = Flags[i] && ! SmallFlags[i];
+        }
+
+        TestEqual(TEXT("Large -= Small mismatches"), CountMismatches(Set, Flags), 0);
+        TestTrue(TEXT("Large -= Small padding bits clear"), GetPaddingBits(Set) == 0);
+    }
+
+    {
+        FJCVCellBitSet Set(Small);
+        TArray<bool> Flags(SmallFlags);
+
+        Set -= Large;
+
+        for (int32 i=0; i<SmallCount; ++i)
+        {
+            Flags[i] = Flags[i] && ! LargeFlags[i];
+        }
+
+        TestEqual(TEXT("Small -= Large mismatches"), CountMismatches(Set, Flags), 0);
+        TestTrue(TEXT("Small -= Large padding bits clear"), GetPaddingBits(Set) == 0);
+    }
+
+    // Iteration, Num() and ToIndices() yield contained cells in ascending
+    // order
+
+    {
+        TArray<int32> ExpectedIndices;
+
+        for (int32 i=0; i<LargeCount; ++i)
+        {
+            if (LargeFlags[i])
+            {
+                ExpectedIndices.Emplace(i);
+            }
+        }
+
+        TArray<int32> IteratedIndices;
+
+        for (int32 i : Large)
+        {
+            IteratedIndices.Emplace(i);
+        }
+
+        TArray<int32> Indices;
+        Large.ToIndices(Indices);
+
+        TestEqual(TEXT("Cell set Num()"), Large.Num(), ExpectedIndices.Num());
+        TestTrue(TEXT("Cell set iteration order"), IteratedIndices == ExpectedIndices);
+        TestTrue(TEXT("Cell set ToIndices() order"), Indices == ExpectedIndices);
+
+        FJCVCellBitSet EmptySet(LargeCount);
+        int32 EmptyIterationCount = 0;
+
+        for (int32 i : EmptySet)
+        {
+            EmptyIterationCount += i >= 0;
+        }
+
+        TestTrue(TEXT("Cleared cell set is empty"), EmptySet.IsEmpty());
+        TestEqual(TEXT("Cleared cell set iteration count"), EmptyIterationCount, 0);
+    }
+
+    // Feature type mask set operations and iteration across all words
+
+    {
+        FJCVFeatureTypeMask MaskA;
+        FJCVFeatureTypeMask MaskB;
+        TArray<bool> FlagsA;
+        TArray<bool> FlagsB;
+        FlagsA.Init(false, 256);
+        FlagsB.Init(false, 256);
+
+        for (int32 t=0; t<256; ++t)
+        {
+            if (Rand.FRand() < .3f)
+            {
+                MaskA.Add((uint8) t);
+                FlagsA[t] = true;
+            }
+
+            if (Rand.FRand() < .3f)
+            {
+                MaskB.Add((uint8) t);
+                FlagsB[t] = true;
+            }
+        }
+
+        const FJCVFeatureTypeMask Union(MaskA | MaskB);
+        const FJCVFeatureTypeMask Intersection(MaskA & MaskB);
+        const FJCVFeatureTypeMask Complement(~MaskA);
+
+        int32 MismatchCount = 0;
+        int32 ExpectedCount = 0;
+        TArray<uint8> ExpectedTypes;
+
+        for (int32 t=0; t<256; ++t)
+        {
+            const uint8 Type = (uint8) t;
+
+            MismatchCount += MaskA.Contains(Type) != FlagsA[t];
+            MismatchCount += Union.Contains(Type) != (FlagsA[t] || FlagsB[t]);
+            MismatchCount += Intersection.Contains(Type) != (FlagsA[t] && FlagsB[t]);
+            MismatchCount += Complement.Contains(Type) == FlagsA[t];
+
+            if (FlagsA[t])
+            {
+                ++ExpectedCount;
+                ExpectedTypes.Emplace(Type);
+            }
+        }
+
+        TArray<uint8> IteratedTypes;
+
+        for (uint8 Type : MaskA)
+        {
+            IteratedTypes.Emplace(Type);
+        }
+
+        TestEqual(TEXT("Feature type mask operation mismatches"), MismatchCount, 0);
+        TestEqual(TEXT("Feature type mask Num()"), MaskA.Num(), ExpectedCount);
+        TestEqual(TEXT("Feature type mask complement Num()"), Complement.Num(), 256-ExpectedCount);
+        TestTrue(TEXT("Feature type mask iteration order"), IteratedTypes == ExpectedTypes);
+
+        FJCVFeatureTypeMask Removed(MaskA);
+        for (uint8 Type : MaskA)
+        {
+            Removed.Remove(Type);
+        }
+
+        TestTrue(TEXT("Feature type mask empty after removal"), Removed.IsEmpty());
+        TestTrue(TEXT("Feature type mask empty equality"), Removed == FJCVFeatureTypeMask());
+    }
+
+    // Map feature cells, a negative feature index matches any non-negative
+    // feature index and excludes cells without feature index
+
+    const int32 CellCount = 5000;
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context, LandType, 0);
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        const float Roll = Rand.FRand();
+
+        if (Roll < .2f)
+        {
+            Map.GetCell(i).SetType(LakeType, i%3);
+        }
+        else
+        if (Roll < .3f)
+        {
+            Map.GetCell(i).SetType(LakeType, INDEX_NONE);
+        }
+    }
+
+    int32 AnyIndexMismatchCount = 0;
+    int32 IndexMismatchCount = 0;
+
+    FJCVCellBitSet AnyLakes;
+    FJCVCellBitSet Lakes1;
+
+    // Different cell count set is reinitialized to the map cell count
+    AnyLakes.Init(7);
+    AnyLakes.Add(3);
+
+    Map.AddFeatureCells(AnyLakes, LakeType);
+    Map.GetFeatureCells(Lakes1, LakeType, 1);
+
+    TestEqual(TEXT("Feature cell set cell count"), AnyLakes.GetCellCount(), Map.Num());
+    TestTrue(TEXT("Feature cell set padding bits clear"), GetPaddingBits(AnyLakes) == 0);
+
+    for (int32 i=0; i<Map.Num(); ++i)
+    {
+        const FJCVCell& Cell(Map.GetCell(i));
+        const bool bIsLake = Cell.GetFeatureType() == LakeType;
+
+        AnyIndexMismatchCount += AnyLakes.Contains(i) != (bIsLake && Cell.GetFeatureIndex() >= 0);
+        IndexMismatchCount += Lakes1.Contains(i) != (bIsLake && Cell.GetFeatureIndex() == 1);
+    }
+
+    TestEqual(TEXT("Any index feature cell mismatches"), AnyIndexMismatchCount, 0);
+    TestEqual(TEXT("Feature index 1 cell mismatches"), IndexMismatchCount, 0);
+    TestTrue(TEXT("Feature index 1 cells within any index cells"), (Lakes1 - AnyLakes).IsEmpty());
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramMapConvertIsolatedPerfTest, "JCVoronoiPlugin.DiagramMap.Perf.ConvertIsolated", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FJCVDiagramMapConvertIsolatedPerfTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramMapTests;
+
+    const int32 CellCount = 1000000;
+    const int32 LakeCount = 20000;
+    const int32 MaxLakeSize = 8;
+    const int32 RunCount = 3;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, CellCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    FJCVDiagramMap Map(Context);
+
+    GenerateLakes(Map, LakeCount, MaxLakeSize, Rand);
+
+    Map.GroupByFeatures();
+    Map.GetAdjacency();
+
+    // Each run converts a copy of the source map, copies are not timed
+
+    double BaselineTime = TNumericLimits<double>::Max();
+    double SummaryTime = TNumericLimits<double>::Max();
+
+    TArray<uint8> BaselineTypes;
+    TArray<uint8> SummaryTypes;
+
+    for (int32 Run=0; Run<RunCount; ++Run)
+    {
+        // Baseline, per cell edge walk of each lake
+
+        {
+            FJCVDiagramMap RunMap(Map);
+            const FJCVFeatureGroup& fg(*RunMap.GetFeatureGroup(LakeType));
+
+            const double StartTime = FPlatformTime::Seconds();
+
+            TBitArray<> Isolated;
+            FindIsolatedLakes(RunMap, fg, Isolated);
+
+            for (int32 i=0; i<fg.GetGroupCount(); ++i)
+            {
+                if (Isolated[i])
+                {
+                    for (FJCVCell* c : fg.CellGroups[i])
+                    {
+                        c->SetType(LandType, 0);
+                    }
+                }
+            }
+
+            BaselineTime = FMath::Min(BaselineTime, FPlatformTime::Seconds()-StartTime);
+            BaselineTypes = RunMap.GetCellStorage().FeatureTypes;
+        }
+
+        // Cell group adjacency summaries
+
+        {
+            FJCVDiagramMap RunMap(Map);
+
+            const double StartTime = FPlatformTime::Seconds();
+
+            RunMap.ConvertIsolated(LakeType, LandType, 0, false);
+
+            SummaryTime = FMath::Min(SummaryTime, FPlatformTime::Seconds()-StartTime);
+            SummaryTypes = RunMap.GetCellStorage().FeatureTypes;
+        }
+    }
+
+    TestTrue(TEXT("Converted cell types equal edge walk converted cell types"), SummaryTypes == BaselineTypes);
+
+    AddInfo(FString::Printf(TEXT("%d cells, %d lakes, edge walk %.2fms, group adjacency %.2fms, speedup %.2fx"),
+        Map.Num(),
+        Map.GetFeatureGroup(LakeType)->GetGroupCount(),
+        BaselineTime*1000.0,
+        SummaryTime*1000.0,
+        GetSpeedup(BaselineTime, SummaryTime)
+        ) );
+
+    return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
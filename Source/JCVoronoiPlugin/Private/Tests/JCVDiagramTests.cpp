@@ -0,0 +1,500 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MIT License
+// 
+// Copyright (c) 2018-2019 Nuraga Wiswakarma
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "JCVDiagram.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace JCVDiagramTests
+{
+    const FBox2D TestBounds(FVector2D(0.f, 0.f), FVector2D(1000.f, 1000.f));
+
+    void GenerateRandomPoints(TArray<FVector2D>& OutPoints, int32 PointCount, FRandomStream& Rand)
+    {
+        const FVector2D Size(TestBounds.GetSize());
+
+        OutPoints.SetNumUninitialized(PointCount);
+
+        for (FVector2D& Point : OutPoints)
+        {
+            Point = TestBounds.Min + FVector2D(Rand.GetFraction()*Size.X, Rand.GetFraction()*Size.Y);
+        }
+    }
+
+    // Shortest wall time of repeated runs, in seconds
+    template<typename FunctionType>
+    double TimeBestOf(int32 RunCount, FunctionType Function)
+    {
+        double BestTime = TNumericLimits<double>::Max();
+
+        for (int32 Run=0; Run<RunCount; ++Run)
+        {
+            const double StartTime = FPlatformTime::Seconds();
+            Function();
+            BestTime = FMath::Min(BestTime, FPlatformTime::Seconds()-StartTime);
+        }
+
+        return BestTime;
+    }
+
+    FORCEINLINE double GetSpeedup(double BaselineTime, double Time)
+    {
+        return Time > 0.0 ? BaselineTime/Time : 0.0;
+    }
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramTiledGenerationTest, "JCVoronoiPlugin.Diagram.TiledGeneration", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramTiledGenerationTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramTests;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    GenerateRandomPoints(Points, 50000, Rand);
+
+    FJCVDiagramContext SerialContext;
+    SerialContext.GenerateDiagram(TestBounds, Points);
+
+    const FIntPoint TileCounts[] = { FIntPoint(1, 1), FIntPoint(2, 3), FIntPoint(4, 4) };
+
+    for (const FIntPoint& TileCount : TileCounts)
+    {
+        FJCVDiagramContext TiledContext;
+        TiledContext.GenerateDiagramTiled(TestBounds, Points, TileCount);
+
+        TestEqual(
+            FString::Printf(TEXT("Tiled (%d x %d) site count"), TileCount.X, TileCount.Y),
+            TiledContext.GetSiteNum(),
+            SerialContext.GetSiteNum()
+            );
+
+        TestTrue(
+            FString::Printf(TEXT("Tiled (%d x %d) neighbours equal single pass neighbours"), TileCount.X, TileCount.Y),
+            TiledContext.HasEqualNeighbours(SerialContext)
+            );
+    }
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramSiteGridTest, "JCVoronoiPlugin.Diagram.SiteGrid", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramSiteGridTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramTests;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    TArray<FVector2D> Lookups;
+
+    GenerateRandomPoints(Points, 20000, Rand);
+    GenerateRandomPoints(Lookups, 2000, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    Context.SetUseSiteGrid(true);
+
+    const FJCVSite* Sites = Context.GetSites();
+    const int32 SiteCount = Context.GetSiteNum();
+
+    int32 MismatchCount = 0;
+
+    for (const FVector2D& Lookup : Lookups)
+    {
+        const FJCVPoint p(FJCVMathUtil::ToPt(Lookup));
+
+        // Brute force closest site distance
+        float MinDistSqr = BIG_NUMBER;
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            MinDistSqr = FMath::Min(MinDistSqr, FJCVMathUtil::DistSqr(Sites[i].p, p));
+        }
+
+        // Equidistant sites may resolve to different sites
+        const FJCVSite* s = Context.FindClosest(Lookup);
+
+        if (! s || FJCVMathUtil::DistSqr(s->p, p) != MinDistSqr)
+        {
+            ++MismatchCount;
+        }
+    }
+
+    TestEqual(TEXT("Site grid closest site mismatches against brute force search"), MismatchCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramSiteGridPerfTest, "JCVoronoiPlugin.Diagram.Perf.SiteGrid", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FJCVDiagramSiteGridPerfTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramTests;
+
+    const int32 SiteCount = 1000000;
+    const int32 LookupCount = 1000000;
+    const int32 RunCount = 3;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    TArray<FVector2D> Lookups;
+
+    GenerateRandomPoints(Points, SiteCount, Rand);
+    GenerateRandomPoints(Lookups, LookupCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+
+    // Site points by site index, lookup results are compared by distance
+    // since equidistant sites may resolve to different sites
+
+    const FJCVSite* Sites = Context.GetSites();
+    const int32 ContextSiteCount = Context.GetSiteNum();
+
+    TArray<FJCVPoint> SitePoints;
+    SitePoints.SetNumUninitialized(ContextSiteCount);
+
+    for (int32 i=0; i<ContextSiteCount; ++i)
+    {
+        SitePoints[Sites[i].index] = Sites[i].p;
+    }
+
+    auto GetDistSqr = [&](int32 LookupIndex, int32 SiteIndex)
+    {
+        return SitePoints.IsValidIndex(SiteIndex)
+            ? FJCVMathUtil::DistSqr(SitePoints[SiteIndex], FJCVMathUtil::ToPt(Lookups[LookupIndex]))
+            : BIG_NUMBER;
+    };
+
+    TArray<int32> BaselineResults;
+    TArray<int32> GridResults;
+    TArray<int32> BatchResults;
+    TArray<int32> TreeResults;
+
+    BaselineResults.SetNumUninitialized(LookupCount);
+    GridResults.SetNumUninitialized(LookupCount);
+    BatchResults.SetNumUninitialized(LookupCount);
+    TreeResults.SetNumUninitialized(LookupCount);
+
+    // Baseline, closest site walk from the first site
+
+    Context.SetUseSiteGrid(false);
+
+    const double BaselineTime = TimeBestOf(1, [&]()
+    {
+        for (int32 i=0; i<LookupCount; ++i)
+        {
+            BaselineResults[i] = Context.FindClosest(Lookups[i])->index;
+        }
+    } );
+
+    // Closest site walk from the grid bucket seed, grid build excluded
+
+    Context.SetUseSiteGrid(true);
+    Context.GetSearchSeed(Lookups[0]);
+
+    const double GridTime = TimeBestOf(RunCount, [&]()
+    {
+        for (int32 i=0; i<LookupCount; ++i)
+        {
+            GridResults[i] = Context.FindClosest(Lookups[i])->index;
+        }
+    } );
+
+    // Morton ordered batch walk
+
+    const double BatchTime = TimeBestOf(RunCount, [&]()
+    {
+        Context.FindCellsBatch(Lookups, BatchResults);
+    } );
+
+    // Site tree nearest site, tree build excluded
+
+    Context.GetSiteTree();
+
+    const double TreeTime = TimeBestOf(RunCount, [&]()
+    {
+        float DistSqr;
+
+        for (int32 i=0; i<LookupCount; ++i)
+        {
+            Context.FindKNearest(Lookups[i], 1, &TreeResults[i], &DistSqr);
+        }
+    } );
+
+    int32 GridMismatchCount = 0;
+    int32 BatchMismatchCount = 0;
+    int32 TreeMismatchCount = 0;
+
+    for (int32 i=0; i<LookupCount; ++i)
+    {
+        const float BaselineDistSqr = GetDistSqr(i, BaselineResults[i]);
+
+        GridMismatchCount += GetDistSqr(i, GridResults[i]) != BaselineDistSqr;
+        BatchMismatchCount += GetDistSqr(i, BatchResults[i]) != BaselineDistSqr;
+        TreeMismatchCount += GetDistSqr(i, TreeResults[i]) != BaselineDistSqr;
+    }
+
+    TestEqual(TEXT("Site grid closest site mismatches against baseline search"), GridMismatchCount, 0);
+    TestEqual(TEXT("Batch closest site mismatches against baseline search"), BatchMismatchCount, 0);
+    TestEqual(TEXT("Site tree closest site mismatches against baseline search"), TreeMismatchCount, 0);
+
+    AddInfo(FString::Printf(TEXT("%d sites, %d lookups, baseline %.3fs, grid %.3fs (%.2fx), batch %.3fs (%.2fx), tree %.3fs (%.2fx)"),
+        ContextSiteCount,
+        LookupCount,
+        BaselineTime,
+        GridTime, GetSpeedup(BaselineTime, GridTime),
+        BatchTime, GetSpeedup(BaselineTime, BatchTime),
+        TreeTime, GetSpeedup(BaselineTime, TreeTime)
+        ) );
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramCellPolygonsTest, "JCVoronoiPlugin.Diagram.CellPolygons", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FJCVDiagramCellPolygonsTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramTests;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    TArray<FVector2D> Lookups;
+
+    GenerateRandomPoints(Points, 50000, Rand);
+    GenerateRandomPoints(Lookups, 50000, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+
+    // Containment tests start from the closest site
+
+    TArray<const FJCVSite*> StartSites;
+    StartSites.SetNumUninitialized(Lookups.Num());
+
+    for (int32 i=0; i<Lookups.Num(); ++i)
+    {
+        StartSites[i] = Context.FindClosest(Lookups[i]);
+    }
+
+    TArray<const FJCVSite*> ScalarResults;
+    ScalarResults.SetNumUninitialized(Lookups.Num());
+
+    Context.SetUseCellPolygons(false);
+
+    for (int32 i=0; i<Lookups.Num(); ++i)
+    {
+        ScalarResults[i] = Context.Find(Lookups[i], *StartSites[i]);
+    }
+
+    Context.SetUseCellPolygons(true);
+
+    int32 MismatchCount = 0;
+
+    for (int32 i=0; i<Lookups.Num(); ++i)
+    {
+        if (Context.Find(Lookups[i], *StartSites[i]) != ScalarResults[i])
+        {
+            ++MismatchCount;
+        }
+    }
+
+    TestEqual(TEXT("Cell polygon containment mismatches against scalar containment"), MismatchCount, 0);
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramCellPolygonsPerfTest, "JCVoronoiPlugin.Diagram.Perf.CellPolygons", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FJCVDiagramCellPolygonsPerfTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramTests;
+
+    const int32 SiteCount = 1000000;
+    const int32 LookupCount = 1000000;
+    const int32 RunCount = 3;
+
+    FRandomStream Rand(0);
+
+    TArray<FVector2D> Points;
+    TArray<FVector2D> Lookups;
+
+    GenerateRandomPoints(Points, SiteCount, Rand);
+    GenerateRandomPoints(Lookups, LookupCount, Rand);
+
+    FJCVDiagramContext Context(TestBounds, Points);
+    Context.SetUseSiteGrid(true);
+
+    // Containment tests start from a neighbour of the closest site, the
+    // start cell test fails and the neighbour cells are tested after
+
+    TArray<const FJCVSite*> StartSites;
+    StartSites.SetNumUninitialized(LookupCount);
+
+    for (int32 i=0; i<LookupCount; ++i)
+    {
+        const FJCVSite* s = Context.FindClosest(Lookups[i]);
+        StartSites[i] = (s->edges && s->edges->neighbor) ? s->edges->neighbor : s;
+    }
+
+    TArray<const FJCVSite*> ScalarResults;
+    TArray<const FJCVSite*> PolygonResults;
+    ScalarResults.SetNumUninitialized(LookupCount);
+    PolygonResults.SetNumUninitialized(LookupCount);
+
+    // Baseline, per cell edge walk containment
+
+    Context.SetUseCellPolygons(false);
+
+    const double ScalarTime = TimeBestOf(RunCount, [&]()
+    {
+        for (int32 i=0; i<LookupCount; ++i)
+        {
+            ScalarResults[i] = Context.Find(Lookups[i], *StartSites[i]);
+        }
+    } );
+
+    // Polygon extraction time, measured on a separate polygon store
+
+    FJCVCellPolygons Polygons;
+
+    const double BuildTime = TimeBestOf(RunCount, [&]()
+    {
+        Polygons.Build(Context.GetSites(), Context.GetSiteNum());
+    } );
+
+    // Vectorized containment, context polygon build excluded
+
+    Context.SetUseCellPolygons(true);
+    Context.GetCellPolygons();
+
+    const double PolygonTime = TimeBestOf(RunCount, [&]()
+    {
+        for (int32 i=0; i<LookupCount; ++i)
+        {
+            PolygonResults[i] = Context.Find(Lookups[i], *StartSites[i]);
+        }
+    } );
+
+    int32 MismatchCount = 0;
+
+    for (int32 i=0; i<LookupCount; ++i)
+    {
+        MismatchCount += PolygonResults[i] != ScalarResults[i];
+    }
+
+    TestEqual(TEXT("Cell polygon containment mismatches against scalar containment"), MismatchCount, 0);
+
+    AddInfo(FString::Printf(TEXT("%d sites, %d lookups, scalar %.3fs, polygons %.3fs, speedup %.2fx, polygon build %.3fs"),
+        Context.GetSiteNum(),
+        LookupCount,
+        ScalarTime,
+        PolygonTime,
+        GetSpeedup(ScalarTime, PolygonTime),
+        BuildTime
+        ) );
+
+    return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FJCVDiagramGeneratePerfTest, "JCVoronoiPlugin.Diagram.Perf.Generate", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FJCVDiagramGeneratePerfTest::RunTest(const FString& Parameters)
+{
+    using namespace JCVDiagramTests;
+
+    const int32 SiteCounts[] = { 100000, 1000000 };
+    const int32 RunCount = 3;
+
+    jcv_rect JCVBounds;
+    JCVBounds.min.x = TestBounds.Min.X;
+    JCVBounds.min.y = TestBounds.Min.Y;
+    JCVBounds.max.x = TestBounds.Max.X;
+    JCVBounds.max.y = TestBounds.Max.Y;
+
+    FRandomStream Rand(0);
+
+    for (int32 SiteCount : SiteCounts)
+    {
+        TArray<FVector2D> Points;
+        GenerateRandomPoints(Points, SiteCount, Rand);
+
+        // Both paths generate from the same jcv point buffer
+
+        TArray<FJCVPoint> JCVPoints;
+        JCVPoints.SetNumUninitialized(SiteCount);
+
+        for (int32 i=0; i<SiteCount; ++i)
+        {
+            JCVPoints[i] = FJCVMathUtil::ToPt(Points[i]);
+        }
+
+        // Baseline, jc_voronoi default allocator and diagram free
+
+        int32 BaselineSiteCount = 0;
+
+        const double BaselineTime = TimeBestOf(RunCount, [&]()
+        {
+            FJCVDiagram BaselineDiagram;
+            FMemory::Memzero(BaselineDiagram);
+            jcv_diagram_generate(SiteCount, JCVPoints.GetData(), &JCVBounds, &BaselineDiagram);
+            BaselineSiteCount = BaselineDiagram.numsites;
+            jcv_diagram_free(&BaselineDiagram);
+        } );
+
+        // Context arena, arena capacity is kept between runs
+
+        FJCVDiagramContext Context;
+
+        const double ArenaTime = TimeBestOf(RunCount, [&]()
+        {
+            Context.GenerateDiagram(TestBounds, TArrayView<const FJCVPoint>(JCVPoints));
+        } );
+
+        TestEqual(
+            FString::Printf(TEXT("Arena generation site count (%d sites)"), SiteCount),
+            Context.GetSiteNum(),
+            BaselineSiteCount
+            );
+
+        AddInfo(FString::Printf(TEXT("%d sites (%s), baseline %.0f sites/s, arena %.0f sites/s, speedup %.2fx"),
+            SiteCount,
+            JCV_USE_PREBUILT_LIB ? TEXT("prebuilt") : TEXT("vendored"),
+            BaselineTime > 0.0 ? SiteCount/BaselineTime : 0.0,
+            ArenaTime > 0.0 ? SiteCount/ArenaTime : 0.0,
+            GetSpeedup(BaselineTime, ArenaTime)
+            ) );
+    }
+
+    return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -51,3 +51,20 @@ public:
 
 DECLARE_LOG_CATEGORY_EXTERN(LogJCV, Verbose, All);
 DECLARE_STATS_GROUP(TEXT("JCVoronoiPlugin"), STATGROUP_JCVoronoiPlugin, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Diagram"), STAT_JCV_GenerateDiagram, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generate Diagram Tiled"), STAT_JCV_GenerateDiagramTiled, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Site Grid"), STAT_JCV_BuildSiteGrid, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Site Tree"), STAT_JCV_BuildSiteTree, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Cell Polygons"), STAT_JCV_BuildCellPolygons, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Adjacency"), STAT_JCV_BuildAdjacency, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Group By Features"), STAT_JCV_GroupByFeatures, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Feature Groups"), STAT_JCV_UpdateFeatureGroups, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Label Connected Components"), STAT_JCV_LabelConnectedComponents, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Frontier Search"), STAT_JCV_FrontierSearch, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Distance Field"), STAT_JCV_DistanceField, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Flow Field"), STAT_JCV_FlowField, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Find Cells Batch"), STAT_JCV_FindCellsBatch, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Relax Diagram"), STAT_JCV_RelaxDiagram, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Generated Sites"), STAT_JCV_GeneratedSites, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Diagram Arena Peak"), STAT_JCV_ArenaPeakBytes, STATGROUP_JCVoronoiPlugin, JCVORONOIPLUGIN_API);
@@ -6,6 +6,8 @@ ABOUT:
 
 HISTORY:
 
+    0.4     2019-06-02  - Implementation vendored with the plugin source (JC_VORONOI_IMPLEMENTATION)
+                        - Border cells are closed along the clipping box
     0.3     2017-04-16	- Added clipping box as input argument (Automatically calcuated if needed)
                         - Input points are pruned based on bounding box
     0.2     2016-12-30  - Fixed issue of edges not being closed properly
@@ -257,3 +259,1082 @@ extern const jcv_edge* jcv_diagram_get_edges( const jcv_diagram* diagram );
 #endif // JC_VORONOI_H
 
 
+#ifdef JC_VORONOI_IMPLEMENTATION
+#undef JC_VORONOI_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+
+// INTERNAL FUNCTIONS
+
+static const int JCV_DIRECTION_LEFT  = 0;
+static const int JCV_DIRECTION_RIGHT = 1;
+static const jcv_real JCV_EDGE_INTERSECT_THRESHOLD = (jcv_real)1.0e-10;
+static const jcv_real JCV_INVALID_VALUE = (jcv_real)-3.402823466e+38;
+
+// Pointer aligned allocation granularity for the packed structures
+#define JCV_ALIGN_SIZE(_X_) ( ((_X_) + sizeof(void*) - 1) & ~(sizeof(void*) - 1) )
+#define JCV_MEMORY_BLOCK_SIZE (16 * 1024)
+
+typedef struct _jcv_halfedge
+{
+	jcv_edge*				edge;
+	struct _jcv_halfedge*	left;
+	struct _jcv_halfedge*	right;
+	jcv_point				vertex;
+	jcv_real				y;
+	int						direction; // 0=left, 1=right
+	int						pqpos;
+} jcv_halfedge;
+
+typedef struct _jcv_memoryblock
+{
+	size_t						sizefree;
+	struct _jcv_memoryblock*	next;
+	char*						memory;
+} jcv_memoryblock;
+
+typedef struct _jcv_priorityqueue
+{
+	// Implements a binary heap, the first slot is unused
+	int				maxnumitems;
+	int				numitems;
+	jcv_halfedge**	items;
+} jcv_priorityqueue;
+
+typedef struct _jcv_context_internal
+{
+	void*				mem;
+	jcv_edge*			edges;
+	jcv_halfedge*		beachline_start;
+	jcv_halfedge*		beachline_end;
+	jcv_halfedge*		last_inserted;
+	jcv_priorityqueue*	eventqueue;
+
+	jcv_site*			sites;
+	jcv_site*			bottomsite;
+	int					numsites;
+	int					currentsite;
+
+	jcv_memoryblock*	memblocks;
+	jcv_halfedge*		halfedgepool;
+
+	void*				memctx;
+	FJCVAllocFn			alloc;
+	FJCVFreeFn			free;
+
+	jcv_rect			rect;
+} jcv_context_internal;
+
+static inline int jcv_point_cmp(const void* p1, const void* p2)
+{
+	const jcv_point* s1 = &((const jcv_site*)p1)->p;
+	const jcv_point* s2 = &((const jcv_site*)p2)->p;
+	if (s1->y != s2->y)
+		return (s1->y < s2->y) ? -1 : 1;
+	if (s1->x != s2->x)
+		return (s1->x < s2->x) ? -1 : 1;
+	// Keep the sort stable for duplicates so pruning keeps the lowest index
+	return ((const jcv_site*)p1)->index - ((const jcv_site*)p2)->index;
+}
+
+static inline int jcv_point_less(const jcv_point* pt1, const jcv_point* pt2)
+{
+	return (pt1->y == pt2->y) ? (pt1->x < pt2->x) : (pt1->y < pt2->y);
+}
+
+static inline int jcv_point_eq(const jcv_point* pt1, const jcv_point* pt2)
+{
+	return (pt1->y == pt2->y) && (pt1->x == pt2->x);
+}
+
+static inline int jcv_point_is_valid(const jcv_point* pt)
+{
+	return pt->x != JCV_INVALID_VALUE;
+}
+
+static inline int jcv_point_on_box_edge(const jcv_point* pt, const jcv_point* min, const jcv_point* max)
+{
+	return pt->x == min->x || pt->y == min->y || pt->x == max->x || pt->y == max->y;
+}
+
+static inline jcv_real jcv_point_dist(const jcv_point* pt1, const jcv_point* pt2)
+{
+	jcv_real dx = pt1->x - pt2->x;
+	jcv_real dy = pt1->y - pt2->y;
+	return JCV_SQRT(dx*dx + dy*dy);
+}
+
+static inline jcv_real jcv_determinant(const jcv_point* a, const jcv_point* b, const jcv_point* c)
+{
+	return (b->x - a->x)*(c->y - a->y) - (b->y - a->y)*(c->x - a->x);
+}
+
+// MEMORY
+
+static void* jcv_alloc(jcv_context_internal* internal, size_t size)
+{
+	size = JCV_ALIGN_SIZE(size);
+	if (!internal->memblocks || internal->memblocks->sizefree < size)
+	{
+		size_t blocksize = JCV_MEMORY_BLOCK_SIZE;
+		jcv_memoryblock* block = (jcv_memoryblock*)internal->alloc(internal->memctx, blocksize);
+		size_t offset = JCV_ALIGN_SIZE(sizeof(jcv_memoryblock));
+		block->sizefree = blocksize - offset;
+		block->next = internal->memblocks;
+		block->memory = ((char*)block) + offset;
+		internal->memblocks = block;
+	}
+	void* p = internal->memblocks->memory;
+	internal->memblocks->memory += size;
+	internal->memblocks->sizefree -= size;
+	return p;
+}
+
+static inline jcv_edge* jcv_alloc_edge(jcv_context_internal* internal)
+{
+	return (jcv_edge*)jcv_alloc(internal, sizeof(jcv_edge));
+}
+
+static inline jcv_graphedge* jcv_alloc_graphedge(jcv_context_internal* internal)
+{
+	return (jcv_graphedge*)jcv_alloc(internal, sizeof(jcv_graphedge));
+}
+
+static jcv_halfedge* jcv_alloc_halfedge(jcv_context_internal* internal)
+{
+	if (internal->halfedgepool)
+	{
+		jcv_halfedge* he = internal->halfedgepool;
+		internal->halfedgepool = he->right;
+		return he;
+	}
+	return (jcv_halfedge*)jcv_alloc(internal, sizeof(jcv_halfedge));
+}
+
+static void* jcv_default_alloc_fn(void* memctx, size_t size)
+{
+	(void)memctx;
+	return malloc(size);
+}
+
+static void jcv_default_free_fn(void* memctx, void* p)
+{
+	(void)memctx;
+	free(p);
+}
+
+// EDGES
+
+static jcv_edge* jcv_edge_new(jcv_context_internal* internal, jcv_site* s1, jcv_site* s2)
+{
+	jcv_edge* e = jcv_alloc_edge(internal);
+
+	e->next = 0;
+	e->pos[0].x = JCV_INVALID_VALUE;
+	e->pos[0].y = JCV_INVALID_VALUE;
+	e->pos[1].x = JCV_INVALID_VALUE;
+	e->pos[1].y = JCV_INVALID_VALUE;
+	e->sites[0] = s1;
+	e->sites[1] = s2;
+
+	jcv_real dx = s2->p.x - s1->p.x;
+	jcv_real dy = s2->p.y - s1->p.y;
+	int dx_is_larger = (dx*dx) > (dy*dy); // instead of fabs
+
+	// Simplify it, using dx and dy
+	e->c = dx * (s1->p.x + dx * (jcv_real)0.5) + dy * (s1->p.y + dy * (jcv_real)0.5);
+
+	if (dx_is_larger)
+	{
+		e->a = (jcv_real)1;
+		e->b = dy / dx;
+		e->c /= dx;
+	}
+	else
+	{
+		e->a = dx / dy;
+		e->b = (jcv_real)1;
+		e->c /= dy;
+	}
+
+	return e;
+}
+
+static int jcv_edge_clipline(jcv_edge* e, const jcv_point* min, const jcv_point* max)
+{
+	jcv_real pxmin = min->x;
+	jcv_real pxmax = max->x;
+	jcv_real pymin = min->y;
+	jcv_real pymax = max->y;
+
+	jcv_real x1, y1, x2, y2;
+	const jcv_point* s1;
+	const jcv_point* s2;
+
+	if (e->a == (jcv_real)1 && e->b >= (jcv_real)0)
+	{
+		s1 = jcv_point_is_valid(&e->pos[1]) ? &e->pos[1] : 0;
+		s2 = jcv_point_is_valid(&e->pos[0]) ? &e->pos[0] : 0;
+	}
+	else
+	{
+		s1 = jcv_point_is_valid(&e->pos[0]) ? &e->pos[0] : 0;
+		s2 = jcv_point_is_valid(&e->pos[1]) ? &e->pos[1] : 0;
+	}
+
+	if (e->a == (jcv_real)1) // delta x is larger
+	{
+		y1 = pymin;
+		if (s1 != 0 && s1->y > pymin)
+			y1 = s1->y;
+		if (y1 > pymax)
+			y1 = pymax;
+		x1 = e->c - e->b * y1;
+		y2 = pymax;
+		if (s2 != 0 && s2->y < pymax)
+			y2 = s2->y;
+		if (y2 < pymin)
+			y2 = pymin;
+		x2 = e->c - e->b * y2;
+
+		if (((x1 > pxmax) & (x2 > pxmax)) | ((x1 < pxmin) & (x2 < pxmin)))
+			return 0;
+
+		if (x1 > pxmax)
+		{
+			x1 = pxmax;
+			y1 = (e->c - x1) / e->b;
+		}
+		else if (x1 < pxmin)
+		{
+			x1 = pxmin;
+			y1 = (e->c - x1) / e->b;
+		}
+		if (x2 > pxmax)
+		{
+			x2 = pxmax;
+			y2 = (e->c - x2) / e->b;
+		}
+		else if (x2 < pxmin)
+		{
+			x2 = pxmin;
+			y2 = (e->c - x2) / e->b;
+		}
+	}
+	else // delta y is larger
+	{
+		x1 = pxmin;
+		if (s1 != 0 && s1->x > pxmin)
+			x1 = s1->x;
+		if (x1 > pxmax)
+			x1 = pxmax;
+		y1 = e->c - e->a * x1;
+		x2 = pxmax;
+		if (s2 != 0 && s2->x < pxmax)
+			x2 = s2->x;
+		if (x2 < pxmin)
+			x2 = pxmin;
+		y2 = e->c - e->a * x2;
+
+		if (((y1 > pymax) & (y2 > pymax)) | ((y1 < pymin) & (y2 < pymin)))
+			return 0;
+
+		if (y1 > pymax)
+		{
+			y1 = pymax;
+			x1 = (e->c - y1) / e->a;
+		}
+		else if (y1 < pymin)
+		{
+			y1 = pymin;
+			x1 = (e->c - y1) / e->a;
+		}
+		if (y2 > pymax)
+		{
+			y2 = pymax;
+			x2 = (e->c - y2) / e->a;
+		}
+		else if (y2 < pymin)
+		{
+			y2 = pymin;
+			x2 = (e->c - y2) / e->a;
+		}
+	}
+
+	// If the two points are equal, the result is invalid
+	if (x1 == x2 && y1 == y2)
+		return 0;
+
+	e->pos[0].x = x1;
+	e->pos[0].y = y1;
+	e->pos[1].x = x2;
+	e->pos[1].y = y2;
+
+	return 1;
+}
+
+// HALF EDGES
+
+static jcv_halfedge* jcv_halfedge_new(jcv_context_internal* internal, jcv_edge* e, int direction)
+{
+	jcv_halfedge* he = jcv_alloc_halfedge(internal);
+	he->edge = e;
+	he->left = 0;
+	he->right = 0;
+	he->vertex.x = 0;
+	he->vertex.y = 0;
+	he->y = 0;
+	he->direction = direction;
+	he->pqpos = 0;
+	return he;
+}
+
+static inline void jcv_halfedge_delete(jcv_context_internal* internal, jcv_halfedge* he)
+{
+	he->right = internal->halfedgepool;
+	internal->halfedgepool = he;
+}
+
+static inline void jcv_halfedge_link(jcv_halfedge* edge, jcv_halfedge* newedge)
+{
+	newedge->left = edge;
+	newedge->right = edge->right;
+	edge->right->left = newedge;
+	edge->right = newedge;
+}
+
+static inline void jcv_halfedge_unlink(jcv_halfedge* he)
+{
+	he->left->right = he->right;
+	he->right->left = he->left;
+	he->left = 0;
+	he->right = 0;
+}
+
+static inline jcv_site* jcv_halfedge_leftsite(const jcv_halfedge* he)
+{
+	return he->edge->sites[he->direction];
+}
+
+static inline jcv_site* jcv_halfedge_rightsite(const jcv_halfedge* he)
+{
+	return he->edge ? he->edge->sites[1 - he->direction] : 0;
+}
+
+static int jcv_halfedge_rightof(const jcv_halfedge* he, const jcv_point* p)
+{
+	const jcv_edge* e = he->edge;
+	const jcv_site* topsite = e->sites[1];
+
+	int right_of_site = (p->x > topsite->p.x) ? 1 : 0;
+	if (right_of_site && he->direction == JCV_DIRECTION_LEFT)
+		return 1;
+	if (!right_of_site && he->direction == JCV_DIRECTION_RIGHT)
+		return 0;
+
+	int above;
+
+	if (e->a == (jcv_real)1)
+	{
+		jcv_real dyp = p->y - topsite->p.y;
+		jcv_real dxp = p->x - topsite->p.x;
+		int fast = 0;
+		if ((!right_of_site & (e->b < (jcv_real)0)) | (right_of_site & (e->b >= (jcv_real)0)))
+		{
+			above = dyp >= e->b * dxp;
+			fast = above;
+		}
+		else
+		{
+			above = (p->x + p->y * e->b) > e->c;
+			if (e->b < (jcv_real)0)
+				above = !above;
+			if (!above)
+				fast = 1;
+		}
+		if (!fast)
+		{
+			jcv_real dxs = topsite->p.x - e->sites[0]->p.x;
+			above = e->b * (dxp * dxp - dyp * dyp) < dxs * dyp * ((jcv_real)1 + (jcv_real)2 * dxp / dxs + e->b * e->b);
+			if (e->b < (jcv_real)0)
+				above = !above;
+		}
+	}
+	else // e->b == 1
+	{
+		jcv_real yl = e->c - e->a * p->x;
+		jcv_real t1 = p->y - yl;
+		jcv_real t2 = p->x - topsite->p.x;
+		jcv_real t3 = yl - topsite->p.y;
+		above = t1 * t1 > (t2 * t2 + t3 * t3);
+	}
+	return (he->direction == JCV_DIRECTION_LEFT) ? above : !above;
+}
+
+// Keep in mind that we compare the half edges from the reversed perspective (the heap pops the smallest item)
+static inline int jcv_halfedge_compare(const jcv_halfedge* he1, const jcv_halfedge* he2)
+{
+	return (he1->y == he2->y) ? (he1->vertex.x > he2->vertex.x) : (he1->y > he2->y);
+}
+
+static int jcv_halfedge_intersect(const jcv_halfedge* he1, const jcv_halfedge* he2, jcv_point* out)
+{
+	const jcv_edge* e1 = he1->edge;
+	const jcv_edge* e2 = he2->edge;
+
+	jcv_real d = e1->a * e2->b - e1->b * e2->a;
+	if (-JCV_EDGE_INTERSECT_THRESHOLD < d && d < JCV_EDGE_INTERSECT_THRESHOLD)
+		return 0;
+
+	out->x = (e1->c * e2->b - e1->b * e2->c) / d;
+	out->y = (e1->a * e2->c - e1->c * e2->a) / d;
+
+	const jcv_edge* e;
+	const jcv_halfedge* he;
+	if (jcv_point_less(&e1->sites[1]->p, &e2->sites[1]->p))
+	{
+		he = he1;
+		e = e1;
+	}
+	else
+	{
+		he = he2;
+		e = e2;
+	}
+
+	int right_of_site = out->x >= e->sites[1]->p.x;
+	if ((right_of_site && he->direction == JCV_DIRECTION_LEFT) || (!right_of_site && he->direction == JCV_DIRECTION_RIGHT))
+		return 0;
+
+	return 1;
+}
+
+// PRIORITY QUEUE
+
+static void jcv_pq_create(jcv_priorityqueue* pq, int capacity, jcv_halfedge** buffer)
+{
+	pq->maxnumitems = capacity;
+	pq->numitems = 1;
+	pq->items = buffer;
+}
+
+static inline int jcv_pq_empty(const jcv_priorityqueue* pq)
+{
+	return pq->numitems == 1 ? 1 : 0;
+}
+
+static void jcv_pq_moveup(jcv_priorityqueue* pq, int pos)
+{
+	jcv_halfedge** items = pq->items;
+	jcv_halfedge* node = items[pos];
+
+	for (int parent = (pos >> 1);
+		 pos > 1 && jcv_halfedge_compare(items[parent], node);
+		 pos = parent, parent = parent >> 1)
+	{
+		items[pos] = items[parent];
+		items[pos]->pqpos = pos;
+	}
+
+	node->pqpos = pos;
+	items[pos] = node;
+}
+
+static inline int jcv_pq_minchild(const jcv_priorityqueue* pq, int pos)
+{
+	int child = pos << 1;
+	if (child >= pq->numitems)
+		return 0;
+	jcv_halfedge** items = pq->items;
+	if ((child + 1) < pq->numitems && jcv_halfedge_compare(items[child], items[child + 1]))
+		return child + 1;
+	return child;
+}
+
+static void jcv_pq_movedown(jcv_priorityqueue* pq, int pos)
+{
+	jcv_halfedge** items = pq->items;
+	jcv_halfedge* node = items[pos];
+
+	int child = jcv_pq_minchild(pq, pos);
+	while (child && jcv_halfedge_compare(node, items[child]))
+	{
+		items[pos] = items[child];
+		items[pos]->pqpos = pos;
+		pos = child;
+		child = jcv_pq_minchild(pq, pos);
+	}
+
+	items[pos] = node;
+	node->pqpos = pos;
+}
+
+static void jcv_pq_push(jcv_priorityqueue* pq, jcv_halfedge* node)
+{
+	assert(pq->numitems < pq->maxnumitems);
+	int n = pq->numitems++;
+	pq->items[n] = node;
+	jcv_pq_moveup(pq, n);
+}
+
+static inline jcv_halfedge* jcv_pq_top(const jcv_priorityqueue* pq)
+{
+	return pq->items[1];
+}
+
+static jcv_halfedge* jcv_pq_pop(jcv_priorityqueue* pq)
+{
+	jcv_halfedge* node = pq->items[1];
+	int last = --pq->numitems;
+	if (last > 1)
+	{
+		pq->items[1] = pq->items[last];
+		jcv_pq_movedown(pq, 1);
+	}
+	node->pqpos = 0;
+	return node;
+}
+
+static void jcv_pq_remove(jcv_priorityqueue* pq, jcv_halfedge* node)
+{
+	int pos = node->pqpos;
+	if (pos == 0)
+		return;
+
+	node->pqpos = 0;
+
+	int last = --pq->numitems;
+	if (pos == last)
+		return;
+
+	jcv_halfedge* moved = pq->items[last];
+	pq->items[pos] = moved;
+	moved->pqpos = pos;
+
+	if (jcv_halfedge_compare(node, moved))
+		jcv_pq_moveup(pq, pos);
+	else
+		jcv_pq_movedown(pq, pos);
+}
+
+// GRAPH EDGES
+
+static inline jcv_real jcv_calc_sort_metric(const jcv_site* site, const jcv_point* p0, const jcv_point* p1)
+{
+	jcv_real half = (jcv_real)0.5;
+	jcv_real x = (p0->x + p1->x) * half;
+	jcv_real y = (p0->y + p1->y) * half;
+	jcv_real diffy = y - site->p.y;
+	jcv_real angle = JCV_ATAN2(diffy, x - site->p.x);
+	if (diffy < 0)
+		angle = angle + 2 * JCV_PI;
+	return angle;
+}
+
+static void jcv_sortedges_insert(jcv_site* site, jcv_graphedge* edge)
+{
+	// Special case for the head end
+	if (site->edges == 0 || site->edges->angle >= edge->angle)
+	{
+		edge->next = site->edges;
+		site->edges = edge;
+	}
+	else
+	{
+		// Locate the node before the point of insertion
+		jcv_graphedge* current = site->edges;
+		while (current->next != 0 && current->next->angle < edge->angle)
+			current = current->next;
+		edge->next = current->next;
+		current->next = edge;
+	}
+}
+
+static void jcv_finishline(jcv_context_internal* internal, jcv_edge* e)
+{
+	if (!jcv_edge_clipline(e, &internal->rect.min, &internal->rect.max))
+		return;
+
+	// Only clipped edges are listed
+	e->next = internal->edges;
+	internal->edges = e;
+
+	// Make sure the graph edges are CCW
+	int flip = jcv_determinant(&e->sites[0]->p, &e->pos[0], &e->pos[1]) > (jcv_real)0 ? 0 : 1;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		jcv_graphedge* ge = jcv_alloc_graphedge(internal);
+
+		ge->edge = e;
+		ge->next = 0;
+		ge->neighbor = e->sites[1 - i];
+		ge->pos[flip] = e->pos[i];
+		ge->pos[1 - flip] = e->pos[1 - i];
+		ge->angle = jcv_calc_sort_metric(e->sites[i], &ge->pos[0], &ge->pos[1]);
+
+		jcv_sortedges_insert(e->sites[i], ge);
+	}
+}
+
+static void jcv_endpos(jcv_context_internal* internal, jcv_edge* e, const jcv_point* p, int direction)
+{
+	e->pos[direction] = *p;
+
+	if (!jcv_point_is_valid(&e->pos[1 - direction]))
+		return;
+
+	jcv_finishline(internal, e);
+}
+
+// BORDER GAPS
+
+// Returns the counter clockwise distance along the rect perimeter, starting from the min corner
+static jcv_real jcv_rect_perimeter_pos(const jcv_rect* rect, const jcv_point* p)
+{
+	jcv_real w = rect->max.x - rect->min.x;
+	jcv_real h = rect->max.y - rect->min.y;
+	if (p->y == rect->min.y)
+		return p->x - rect->min.x;
+	if (p->x == rect->max.x)
+		return w + (p->y - rect->min.y);
+	if (p->y == rect->max.y)
+		return w + h + (rect->max.x - p->x);
+	return w + h + w + (rect->max.y - p->y);
+}
+
+static jcv_graphedge* jcv_create_gap(jcv_context_internal* internal, jcv_site* site, const jcv_point* p0, const jcv_point* p1)
+{
+	jcv_edge* e = jcv_alloc_edge(internal);
+	e->next = 0;
+	e->sites[0] = site;
+	e->sites[1] = 0;
+	e->pos[0] = *p0;
+	e->pos[1] = *p1;
+	e->a = (jcv_real)0;
+	e->b = (jcv_real)0;
+	e->c = (jcv_real)0;
+
+	jcv_graphedge* ge = jcv_alloc_graphedge(internal);
+	ge->next = 0;
+	ge->edge = e;
+	ge->neighbor = 0;
+	ge->pos[0] = *p0;
+	ge->pos[1] = *p1;
+	ge->angle = jcv_calc_sort_metric(site, p0, p1);
+	return ge;
+}
+
+// Closes the gap between two points on the rect border, walking counter clockwise through the rect corners
+static void jcv_fillgap(jcv_context_internal* internal, jcv_site* site, jcv_graphedge* current, const jcv_point* target)
+{
+	const jcv_rect* rect = &internal->rect;
+	jcv_real w = rect->max.x - rect->min.x;
+	jcv_real h = rect->max.y - rect->min.y;
+	jcv_real perimeter = (w + h) * 2;
+
+	jcv_point corners[4];
+	jcv_real cornerpos[4];
+	corners[0].x = rect->max.x; corners[0].y = rect->min.y; cornerpos[0] = w;
+	corners[1].x = rect->max.x; corners[1].y = rect->max.y; cornerpos[1] = w + h;
+	corners[2].x = rect->min.x; corners[2].y = rect->max.y; cornerpos[2] = w + h + w;
+	corners[3].x = rect->min.x; corners[3].y = rect->min.y; cornerpos[3] = perimeter;
+
+	jcv_real t0 = jcv_rect_perimeter_pos(rect, &current->pos[1]);
+	jcv_real t1 = jcv_rect_perimeter_pos(rect, target);
+	if (t1 < t0)
+		t1 += perimeter;
+
+	jcv_graphedge* next = current->next;
+	jcv_graphedge* tail = current;
+	jcv_point p0 = current->pos[1];
+
+	for (int i = 0; i < 8; ++i)
+	{
+		jcv_real t = cornerpos[i & 3] + ((i < 4) ? (jcv_real)0 : perimeter);
+		if (t <= t0 || t >= t1)
+			continue;
+		const jcv_point* corner = &corners[i & 3];
+		if (jcv_point_eq(&p0, corner))
+			continue;
+		jcv_graphedge* gap = jcv_create_gap(internal, site, &p0, corner);
+		tail->next = gap;
+		tail = gap;
+		p0 = *corner;
+	}
+
+	jcv_graphedge* gap = jcv_create_gap(internal, site, &p0, target);
+	tail->next = gap;
+	gap->next = next;
+}
+
+static void jcv_fillgaps(jcv_context_internal* internal)
+{
+	const jcv_point* min = &internal->rect.min;
+	const jcv_point* max = &internal->rect.max;
+
+	for (int i = 0; i < internal->numsites; ++i)
+	{
+		jcv_site* site = &internal->sites[i];
+
+		// Single site, the cell is the whole rect
+		if (!site->edges)
+		{
+			jcv_point p;
+			p.x = min->x;
+			p.y = min->y;
+			jcv_graphedge* ge = jcv_create_gap(internal, site, &p, &p);
+			ge->pos[1].x = max->x;
+			site->edges = ge;
+			jcv_fillgap(internal, site, ge, &ge->pos[0]);
+			continue;
+		}
+
+		// Edges are sorted CCW, a mismatch between neighbouring edge end points is a gap along the border
+		jcv_graphedge* current = site->edges;
+		while (current)
+		{
+			jcv_graphedge* next = current->next;
+			const jcv_graphedge* target = next ? next : site->edges;
+
+			if (!jcv_point_eq(&current->pos[1], &target->pos[0])
+				&& jcv_point_on_box_edge(&current->pos[1], min, max)
+				&& jcv_point_on_box_edge(&target->pos[0], min, max))
+			{
+				jcv_fillgap(internal, site, current, &target->pos[0]);
+			}
+
+			current = next;
+		}
+	}
+}
+
+// SWEEP
+
+static inline jcv_site* jcv_nextsite(jcv_context_internal* internal)
+{
+	return (internal->currentsite < internal->numsites) ? &internal->sites[internal->currentsite++] : 0;
+}
+
+static jcv_halfedge* jcv_get_edge_above_x(jcv_context_internal* internal, const jcv_point* p)
+{
+	// Gets the arc on the beach line at the x coordinate (i.e. right above the new site event)
+
+	// A good guess it's close by (Can be optimized)
+	jcv_halfedge* he = internal->last_inserted;
+	if (!he)
+	{
+		if (p->x < (internal->rect.min.x + internal->rect.max.x) * (jcv_real)0.5)
+			he = internal->beachline_start;
+		else
+			he = internal->beachline_end;
+	}
+
+	if (he == internal->beachline_start || (he != internal->beachline_end && jcv_halfedge_rightof(he, p)))
+	{
+		do
+		{
+			he = he->right;
+		}
+		while (he != internal->beachline_end && jcv_halfedge_rightof(he, p));
+
+		he = he->left;
+	}
+	else
+	{
+		do
+		{
+			he = he->left;
+		}
+		while (he != internal->beachline_start && !jcv_halfedge_rightof(he, p));
+	}
+
+	return he;
+}
+
+static int jcv_check_circle_event(const jcv_halfedge* he1, const jcv_halfedge* he2, jcv_point* vertex)
+{
+	const jcv_edge* e1 = he1->edge;
+	const jcv_edge* e2 = he2->edge;
+	if (e1 == 0 || e2 == 0 || e1->sites[1] == e2->sites[1])
+		return 0;
+
+	return jcv_halfedge_intersect(he1, he2, vertex);
+}
+
+static void jcv_site_event(jcv_context_internal* internal, jcv_site* site)
+{
+	jcv_halfedge* left = jcv_get_edge_above_x(internal, &site->p);
+	jcv_halfedge* right = left->right;
+	jcv_site* bottom = jcv_halfedge_rightsite(left);
+	if (!bottom)
+		bottom = internal->bottomsite;
+
+	jcv_edge* edge = jcv_edge_new(internal, bottom, site);
+
+	jcv_halfedge* edge1 = jcv_halfedge_new(internal, edge, JCV_DIRECTION_LEFT);
+	jcv_halfedge* edge2 = jcv_halfedge_new(internal, edge, JCV_DIRECTION_RIGHT);
+
+	jcv_halfedge_link(left, edge1);
+	jcv_halfedge_link(edge1, edge2);
+
+	internal->last_inserted = right;
+
+	jcv_point p;
+	if (jcv_check_circle_event(left, edge1, &p))
+	{
+		jcv_pq_remove(internal->eventqueue, left);
+		left->vertex = p;
+		left->y = p.y + jcv_point_dist(&site->p, &p);
+		jcv_pq_push(internal->eventqueue, left);
+	}
+	if (jcv_check_circle_event(edge2, right, &p))
+	{
+		edge2->vertex = p;
+		edge2->y = p.y + jcv_point_dist(&site->p, &p);
+		jcv_pq_push(internal->eventqueue, edge2);
+	}
+}
+
+static void jcv_circle_event(jcv_context_internal* internal)
+{
+	jcv_halfedge* left = jcv_pq_pop(internal->eventqueue);
+
+	jcv_halfedge* leftleft = left->left;
+	jcv_halfedge* right = left->right;
+	jcv_halfedge* rightright = right->right;
+	jcv_site* bottom = jcv_halfedge_leftsite(left);
+	jcv_site* top = jcv_halfedge_rightsite(right);
+
+	jcv_point vertex = left->vertex;
+	jcv_endpos(internal, left->edge, &vertex, left->direction);
+	jcv_endpos(internal, right->edge, &vertex, right->direction);
+
+	internal->last_inserted = rightright;
+
+	jcv_pq_remove(internal->eventqueue, right);
+	jcv_halfedge_unlink(left);
+	jcv_halfedge_unlink(right);
+	jcv_halfedge_delete(internal, left);
+	jcv_halfedge_delete(internal, right);
+
+	int direction = JCV_DIRECTION_LEFT;
+	if (bottom->p.y > top->p.y)
+	{
+		jcv_site* temp = bottom;
+		bottom = top;
+		top = temp;
+		direction = JCV_DIRECTION_RIGHT;
+	}
+
+	jcv_edge* edge = jcv_edge_new(internal, bottom, top);
+
+	jcv_halfedge* he = jcv_halfedge_new(internal, edge, direction);
+	jcv_halfedge_link(leftleft, he);
+	jcv_endpos(internal, edge, &vertex, JCV_DIRECTION_RIGHT - direction);
+
+	jcv_point p;
+	if (jcv_check_circle_event(leftleft, he, &p))
+	{
+		jcv_pq_remove(internal->eventqueue, leftleft);
+		leftleft->vertex = p;
+		leftleft->y = p.y + jcv_point_dist(&bottom->p, &p);
+		jcv_pq_push(internal->eventqueue, leftleft);
+	}
+	if (jcv_check_circle_event(he, rightright, &p))
+	{
+		he->vertex = p;
+		he->y = p.y + jcv_point_dist(&bottom->p, &p);
+		jcv_pq_push(internal->eventqueue, he);
+	}
+}
+
+// PUBLIC API
+
+void jcv_diagram_free(jcv_diagram* d)
+{
+	jcv_context_internal* internal = d->internal;
+	if (!internal)
+		return;
+
+	void* memctx = internal->memctx;
+	FJCVFreeFn freefn = internal->free;
+	void* mem = internal->mem;
+
+	while (internal->memblocks)
+	{
+		jcv_memoryblock* p = internal->memblocks;
+		internal->memblocks = internal->memblocks->next;
+		freefn(memctx, p);
+	}
+
+	freefn(memctx, mem);
+
+	d->internal = 0;
+	d->edges = 0;
+	d->sites = 0;
+	d->numsites = 0;
+}
+
+const jcv_site* jcv_diagram_get_sites(const jcv_diagram* diagram)
+{
+	return diagram->internal ? diagram->internal->sites : 0;
+}
+
+const jcv_edge* jcv_diagram_get_edges(const jcv_diagram* diagram)
+{
+	return diagram->internal ? diagram->internal->edges : 0;
+}
+
+void jcv_diagram_generate_useralloc(int num_points, const jcv_point* points, const jcv_rect* rect, void* userallocctx, FJCVAllocFn allocfn, FJCVFreeFn freefn, jcv_diagram* d)
+{
+	if (d->internal)
+		jcv_diagram_free(d);
+
+	if (!allocfn || !freefn)
+	{
+		allocfn = jcv_default_alloc_fn;
+		freefn = jcv_default_free_fn;
+	}
+
+	// The beach line can have at most 2n-5 parabolas, each with at most one pending event
+	int max_num_events = num_points * 2 + 2;
+	size_t internalsize = JCV_ALIGN_SIZE(sizeof(jcv_context_internal));
+	size_t sitessize = JCV_ALIGN_SIZE((size_t)num_points * sizeof(jcv_site));
+	size_t queuesize = JCV_ALIGN_SIZE(sizeof(jcv_priorityqueue));
+	size_t eventsize = JCV_ALIGN_SIZE((size_t)max_num_events * sizeof(void*));
+	size_t memsize = internalsize + sitessize + queuesize + eventsize + sizeof(void*);
+
+	char* originalmem = (char*)allocfn(userallocctx, memsize);
+	memset(originalmem, 0, memsize);
+
+	// Align memory
+	char* mem = (char*)JCV_ALIGN_SIZE((size_t)originalmem);
+
+	jcv_context_internal* internal = (jcv_context_internal*)mem;
+	mem += internalsize;
+	internal->mem = originalmem;
+	internal->memctx = userallocctx;
+	internal->alloc = allocfn;
+	internal->free = freefn;
+
+	internal->sites = (jcv_site*)mem;
+	mem += sitessize;
+
+	internal->eventqueue = (jcv_priorityqueue*)mem;
+	mem += queuesize;
+
+	jcv_pq_create(internal->eventqueue, max_num_events, (jcv_halfedge**)mem);
+
+	jcv_site* sites = internal->sites;
+
+	jcv_rect tmp_rect;
+	tmp_rect.min.x = tmp_rect.min.y = (jcv_real)3.402823466e+38;
+	tmp_rect.max.x = tmp_rect.max.y = (jcv_real)-3.402823466e+38;
+
+	for (int i = 0; i < num_points; ++i)
+	{
+		sites[i].p = points[i];
+		sites[i].edges = 0;
+		sites[i].index = i;
+
+		if (points[i].x < tmp_rect.min.x) tmp_rect.min.x = points[i].x;
+		if (points[i].y < tmp_rect.min.y) tmp_rect.min.y = points[i].y;
+		if (points[i].x > tmp_rect.max.x) tmp_rect.max.x = points[i].x;
+		if (points[i].y > tmp_rect.max.y) tmp_rect.max.y = points[i].y;
+	}
+
+	if (!rect)
+		rect = &tmp_rect;
+
+	qsort(sites, (size_t)num_points, sizeof(jcv_site), jcv_point_cmp);
+
+	// Prune duplicates and points outside of the clipping rect
+	int offset = 0;
+	for (int i = 0; i < num_points; ++i)
+	{
+		const jcv_site* s = &sites[i];
+		if (i > 0 && jcv_point_eq(&s->p, &sites[i - 1].p))
+		{
+			offset++;
+			continue;
+		}
+		if (s->p.x < rect->min.x || s->p.x > rect->max.x || s->p.y < rect->min.y || s->p.y > rect->max.y)
+		{
+			offset++;
+			continue;
+		}
+		sites[i - offset] = sites[i];
+	}
+	num_points -= offset;
+
+	internal->rect = *rect;
+	internal->numsites = num_points;
+	internal->currentsite = 0;
+
+	d->internal = internal;
+	d->numsites = num_points;
+	d->min = rect->min;
+	d->max = rect->max;
+
+	internal->beachline_start = jcv_halfedge_new(internal, 0, 0);
+	internal->beachline_end = jcv_halfedge_new(internal, 0, 0);
+
+	internal->beachline_start->left = 0;
+	internal->beachline_start->right = internal->beachline_end;
+	internal->beachline_end->left = internal->beachline_start;
+	internal->beachline_end->right = 0;
+
+	internal->last_inserted = 0;
+
+	jcv_site* site = jcv_nextsite(internal);
+	internal->bottomsite = site;
+	site = jcv_nextsite(internal);
+
+	jcv_priorityqueue* pq = internal->eventqueue;
+	jcv_point lowest_pq_point;
+
+	for (;;)
+	{
+		if (!jcv_pq_empty(pq))
+		{
+			const jcv_halfedge* he = jcv_pq_top(pq);
+			lowest_pq_point.x = he->vertex.x;
+			lowest_pq_point.y = he->y;
+		}
+
+		if (site != 0 && (jcv_pq_empty(pq) || jcv_point_less(&site->p, &lowest_pq_point)))
+		{
+			jcv_site_event(internal, site);
+			site = jcv_nextsite(internal);
+		}
+		else if (!jcv_pq_empty(pq))
+		{
+			jcv_circle_event(internal);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	// Close the remaining unbounded edges, an edge may be referenced by two half edges
+	for (jcv_halfedge* he = internal->beachline_start->right; he != internal->beachline_end; he = he->right)
+	{
+		jcv_edge* e = he->edge;
+		if (!jcv_point_is_valid(&e->pos[0]) || !jcv_point_is_valid(&e->pos[1]))
+			jcv_finishline(internal, e);
+	}
+
+	if (num_points > 0)
+		jcv_fillgaps(internal);
+
+	d->edges = internal->edges;
+	d->sites = internal->sites;
+}
+
+#undef JCV_ALIGN_SIZE
+#undef JCV_MEMORY_BLOCK_SIZE
+
+#endif // JC_VORONOI_IMPLEMENTATION